@@ -33,6 +33,8 @@
 #include <ctype.h>
 #include <asm/unistd.h>
 #include <sys/utsname.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <linux/kdev_t.h>
 #include <tcf/framework/mdep-ptrace.h>
 #include <tcf/framework/mdep-fs.h>
@@ -56,12 +58,27 @@
 #include <tcf/services/tcf_elf.h>
 #include <tcf/services/profiler_sst.h>
 #include <system/GNU/Linux/tcf/regset.h>
+#include <system/GNU/Linux/tcf/profiler-perf.h>
 #if ENABLE_ContextMux
 #include <tcf/framework/context-mux.h>
 #endif
 
 #define USE_PTRACE_SYSCALL      0
 
+/* Use process_vm_readv/process_vm_writev or /proc/<pid>/mem for memory blocks,
+ * PTRACE_PEEKDATA/PTRACE_POKEDATA are used only for the words that cannot be accessed that way */
+#if !defined(USE_BULK_MEM_ACCESS)
+#  define USE_BULK_MEM_ACCESS   1
+#endif
+
+/* Attach with PTRACE_SEIZE and stop threads with PTRACE_INTERRUPT instead of SIGSTOP.
+ * Interrupt requests don't go through the signal queue, and any ptrace stop clears a pending
+ * interrupt, so a stale request cannot stop a thread after it was resumed or detached.
+ * Processes started by the agent use PTRACE_TRACEME and are still stopped with SIGSTOP. */
+#if !defined(USE_PTRACE_SEIZE)
+#  define USE_PTRACE_SEIZE      1
+#endif
+
 static const int PTRACE_FLAGS =
 #if USE_PTRACE_SYSCALL
       PTRACE_O_TRACESYSGOOD |
@@ -94,6 +111,7 @@ typedef struct ContextExtensionLinux {
     int                     pending_step;
     int                     stop_cnt;
     int                     sigstop_posted;
+    int                     seized;
     int                     sigkill_posted;
     int                     detach_req;
     int                     crt0_done;
@@ -123,6 +141,7 @@ static const char * event_name(int event) {
     case PTRACE_EVENT_EXEC: return "exec";
     case PTRACE_EVENT_VFORK_DONE: return "vfork-done";
     case PTRACE_EVENT_EXIT: return "exit";
+    case PTRACE_EVENT_STOP: return "stop";
     }
     trace(LOG_ALWAYS, "event_name(): unexpected event code %d", event);
     return "unknown";
@@ -184,16 +203,48 @@ static void get_thread_ids(pid_t pid, int * cnt, pid_t ** pids) {
     *pids = thread_pid;
 }
 
+#if USE_PTRACE_SEIZE
+static int seize_not_supported = 0;
+#endif
+
+/* Attach a thread and request it to stop. Sets 'seized' if the thread is attached with PTRACE_SEIZE */
+static int attach_thread(pid_t pid, int * seized) {
+#if USE_PTRACE_SEIZE
+    if (!seize_not_supported) {
+        if (ptrace(PTRACE_SEIZE, pid, 0, PTRACE_FLAGS) == 0) {
+            *seized = 1;
+            if (ptrace(PTRACE_INTERRUPT, pid, 0, 0) == 0) return 0;
+            return -1;
+        }
+        if (errno != EIO && errno != EINVAL) return -1;
+        /* Kernel older than 3.4 */
+        seize_not_supported = 1;
+    }
+#endif
+    *seized = 0;
+    return ptrace(PTRACE_ATTACH, pid, 0, 0);
+}
+
+/* Ask a thread to stop, the stop is reported as SIGSTOP by event_pid_stopped() */
+static int post_stop_request(ContextExtensionLinux * ext) {
+#if USE_PTRACE_SEIZE
+    if (ext->seized) return ptrace(PTRACE_INTERRUPT, ext->pid, 0, 0);
+#endif
+    return tkill(ext->pid, SIGSTOP);
+}
+
 int context_attach(pid_t pid, ContextAttachCallBack * done, void * data, int mode) {
     Context * ctx = NULL;
     ContextExtensionLinux * ext = NULL;
+    int seized = 0;
 
     assert(done != NULL);
     trace(LOG_CONTEXT, "context: attaching pid %d", pid);
-    if ((mode & CONTEXT_ATTACH_SELF) == 0 && ptrace(PTRACE_ATTACH, pid, 0, 0) < 0) {
+    if ((mode & CONTEXT_ATTACH_SELF) == 0 && attach_thread(pid, &seized) < 0) {
         int error = errno;
-        trace(LOG_ALWAYS, "error: ptrace(PTRACE_ATTACH) failed: pid %d, error %d %s",
-            pid, error, errno_to_str(error));
+        trace(LOG_ALWAYS, "error: ptrace(%s) failed: pid %d, error %d %s",
+            seized ? "PTRACE_INTERRUPT" : "PTRACE_ATTACH", pid, error, errno_to_str(error));
+        if (seized) ptrace(PTRACE_DETACH, pid, 0, 0);
         errno = error;
         return -1;
     }
@@ -208,6 +259,7 @@ int context_attach(pid_t pid, ContextAttachCallBack * done, void * data, int mod
     ctx->big_endian = big_endian_host();
     ext = EXT(ctx);
     ext->pid = pid;
+    ext->seized = seized;
     ext->attach_callback = done;
     ext->attach_data = data;
     ext->attach_mode = mode;
@@ -289,7 +341,7 @@ int context_stop(Context * ctx) {
         trace(LOG_ALWAYS, "error: waiting too long to stop %s, stat %c", ctx->id, ch);
     }
     if (!ext->sigstop_posted) {
-        if (tkill(ext->pid, SIGSTOP) < 0) {
+        if (post_stop_request(ext) < 0) {
             int error = errno;
             if (error == ESRCH) {
                 set_context_state_name(ctx, "Exited");
@@ -297,7 +349,8 @@ int context_stop(Context * ctx) {
                 return 0;
             }
             trace(LOG_ALWAYS,
-                "error: tkill(SIGSTOP) failed: ctx %#" PRIxPTR ", id %s, error %d %s",
+                "error: %s failed: ctx %#" PRIxPTR ", id %s, error %d %s",
+                ext->seized ? "ptrace(PTRACE_INTERRUPT)" : "tkill(SIGSTOP)",
                 (uintptr_t)ctx, ctx->id, error, errno_to_str(error));
             errno = error;
             return -1;
@@ -618,7 +671,7 @@ int context_continue(Context * ctx) {
         add_waitpid_process(ext->pid);
         if (ext->detach_req && !ext->sigstop_posted) {
             assert(ctx->exiting);
-            if (tkill(ext->pid, SIGSTOP) >= 0) ext->sigstop_posted = 1;
+            if (post_stop_request(ext) >= 0) ext->sigstop_posted = 1;
         }
 #if ENABLE_ProfilerSST
         else if (!ctx->exiting) {
@@ -675,6 +728,73 @@ int context_can_resume(Context * ctx, int mode) {
     return 0;
 }
 
+#if USE_BULK_MEM_ACCESS
+
+static int process_vm_disabled = 0;
+static int proc_mem_disabled = 0;
+
+/* Transfer as much as possible of a memory block with as few system calls as possible.
+ * Returns number of bytes transferred, starting from 'address'.
+ * The transfer stops at the first page that cannot be accessed. */
+static size_t bulk_mem_access(pid_t pid, ContextAddress address, void * buf, size_t size, int wr) {
+    size_t done = 0;
+#if defined(__NR_process_vm_readv) && defined(__NR_process_vm_writev)
+    while (!process_vm_disabled && done < size) {
+        ssize_t rd = 0;
+        struct iovec local;
+        struct iovec remote;
+        local.iov_base = (char *)buf + done;
+        local.iov_len = size - done;
+        remote.iov_base = (void *)(uintptr_t)(address + done);
+        remote.iov_len = size - done;
+        if (wr) rd = syscall(__NR_process_vm_writev, pid, &local, 1ul, &remote, 1ul, 0ul);
+        else rd = syscall(__NR_process_vm_readv, pid, &local, 1ul, &remote, 1ul, 0ul);
+        if (rd > 0) {
+            done += (size_t)rd;
+            continue;
+        }
+        if (rd < 0 && (errno == ENOSYS || errno == EPERM)) {
+            /* Not supported by the kernel, or restricted by a security module */
+            trace(LOG_CONTEXT, "context: process_vm_%s() not available: %s",
+                wr ? "writev" : "readv", errno_to_str(errno));
+            process_vm_disabled = 1;
+            break;
+        }
+        /* Faulting page, or write to read-only mapping */
+        if (wr && rd < 0 && errno == EFAULT) break;
+        return done;
+    }
+#else
+    process_vm_disabled = 1;
+#endif
+    if (done < size && !proc_mem_disabled && (process_vm_disabled || wr)) {
+        /* /proc/<pid>/mem can write read-only mappings, e.g. code sections */
+        int fd = -1;
+        char file_name[FILE_PATH_SIZE];
+        snprintf(file_name, sizeof(file_name), "/proc/%d/mem", pid);
+        fd = open(file_name, wr ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            if (errno == EACCES || errno == EPERM || errno == ENOENT) {
+                trace(LOG_CONTEXT, "context: cannot open %s: %s", file_name, errno_to_str(errno));
+                if (errno != ENOENT) proc_mem_disabled = 1;
+            }
+            return done;
+        }
+        while (done < size) {
+            ssize_t rd = 0;
+            off_t offs = (off_t)(address + done);
+            if (wr) rd = pwrite(fd, (char *)buf + done, size - done, offs);
+            else rd = pread(fd, (char *)buf + done, size - done, offs);
+            if (rd <= 0) break;
+            done += (size_t)rd;
+        }
+        close(fd);
+    }
+    return done;
+}
+
+#endif /* USE_BULK_MEM_ACCESS */
+
 #if ENABLE_MemoryAccessModes
 int context_write_mem_ext(Context * ctx, MemoryAccessMode * mode, ContextAddress address, void * buf, size_t size) {
     return context_write_mem(ctx, address, buf, size);
@@ -703,7 +823,15 @@ int context_write_mem(Context * ctx, ContextAddress address, void * buf, size_t
         return -1;
     }
     if (check_breakpoints_on_memory_write(ctx, address, buf, size) < 0) return -1;
-    for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
+    word_addr = address & ~((ContextAddress)word_size - 1);
+#if USE_BULK_MEM_ACCESS
+    if (size > word_size) {
+        size_t done = bulk_mem_access(ext->pid, address, buf, size, 1);
+        if (done == size) word_addr = address + size;
+        else word_addr = (address + done) & ~((ContextAddress)word_size - 1);
+    }
+#endif
+    for (; word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         if (word_addr < address || word_addr + word_size > address + size) {
             unsigned i = 0;
@@ -802,7 +930,17 @@ int context_read_mem(Context * ctx, ContextAddress address, void * buf, size_t s
         errno = EFAULT;
         return -1;
     }
-    for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
+    word_addr = address & ~((ContextAddress)word_size - 1);
+#if USE_BULK_MEM_ACCESS
+    if (size > word_size) {
+        /* Only the word at the faulting address is retried with PTRACE_PEEKDATA,
+         * so MemoryErrorInfo reports exact size of the valid part of the block */
+        size_t done = bulk_mem_access(ext->pid, address, buf, size, 0);
+        if (done == size) word_addr = address + size;
+        else word_addr = (address + done) & ~((ContextAddress)word_size - 1);
+    }
+#endif
+    for (; word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         errno = 0;
         word = ptrace(PTRACE_PEEKDATA, ext->pid, (void *)word_addr, 0);
@@ -1380,6 +1518,7 @@ static Context * add_thread(Context * parent, Context * creator, pid_t pid) {
     ctx = create_context(pid2id(pid, EXT(parent)->pid));
     EXT(ctx)->pid = pid;
     EXT(ctx)->attach_mode = EXT(parent)->attach_mode;
+    EXT(ctx)->seized = EXT(parent)->seized;
     EXT(ctx)->sigstop_posted = 1;
     alloc_regs(ctx);
     ctx->mem = parent;
@@ -1404,6 +1543,9 @@ static Context * add_thread(Context * parent, Context * creator, pid_t pid) {
     link_context(ctx);
 #if ENABLE_ProfilerSST
     profiler_sst_add(ctx);
+#endif
+#if ENABLE_ProfilerPerf
+    profiler_perf_add(ctx);
 #endif
     trace(LOG_EVENTS, "event: new context %#" PRIxPTR ", id %s", (uintptr_t)ctx, ctx->id);
     send_context_created_event(ctx);
@@ -1418,10 +1560,19 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
     ContextAddress pc0 = 0;
     ContextAddress pc1 = 0;
     int cb_found = 0;
+    int group_stop = 0;
 
     trace(LOG_EVENTS, "event: pid %d stopped, signal %d, event %s", pid, signal, event_name(event));
     detach_waitpid_process();
 
+    if (event == PTRACE_EVENT_STOP) {
+        /* PTRACE_INTERRUPT and initial stop of a seized thread are reported with SIGTRAP,
+         * group-stop is reported with the stopping signal: SIGSTOP, SIGTSTP, SIGTTIN or SIGTTOU */
+        if (signal == SIGTRAP) signal = SIGSTOP;
+        else group_stop = 1;
+        event = 0;
+    }
+
     ctx = context_find_from_pid(pid, 1);
 
     if (ctx == NULL) {
@@ -1441,10 +1592,12 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
             }
             get_thread_ids(pid, &cnt, &pids);
             for (n = 0; n < cnt; n++) {
+                int seized = 0;
                 if (pids[n] == pid) continue;
-                if (ptrace(PTRACE_ATTACH, pids[n], 0, 0) != 0) {
+                if (EXT(prs)->seized ? attach_thread(pids[n], &seized) != 0 : ptrace(PTRACE_ATTACH, pids[n], 0, 0) != 0) {
                     trace(LOG_ALWAYS,
-                        "error: ptrace(PTRACE_ATTACH) failed: pid %d, error %d %s",
+                        "error: ptrace(%s) failed: pid %d, error %d %s",
+                        seized ? "PTRACE_INTERRUPT" : "PTRACE_ATTACH",
                         pids[n], errno, errno_to_str(errno));
                 }
                 add_waitpid_process(pids[n]);
@@ -1481,7 +1634,8 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
     ext = EXT(ctx);
     assert(!ctx->exited);
     assert(!ext->attach_callback);
-    if (signal == SIGSTOP) ext->sigstop_posted = 0;
+    /* Any ptrace stop cancels pending PTRACE_INTERRUPT */
+    if (signal == SIGSTOP || ext->seized) ext->sigstop_posted = 0;
     ext->stop_cnt = 0;
 
     if (ext->ptrace_flags == 0) {
@@ -1530,6 +1684,7 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
                 prs2 = create_context(pid2id(msg, 0));
                 EXT(prs2)->pid = msg;
                 EXT(prs2)->attach_mode = ext->attach_mode & ~CONTEXT_ATTACH_SELF;
+                EXT(prs2)->seized = ext->seized;
                 prs2->mem = prs2;
                 prs2->mem_access |= MEM_ACCESS_INSTRUCTION;
                 prs2->mem_access |= MEM_ACCESS_DATA;
@@ -1583,7 +1738,8 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
     }
 
     if (signal != SIGSTOP && signal != SIGTRAP) {
-        sigset_set(&ctx->pending_signals, signal, 1);
+        /* The stopping signal of a group-stop is already consumed, it must not be delivered again */
+        if (!group_stop) sigset_set(&ctx->pending_signals, signal, 1);
 #if defined(__arm__)
         /* On ARM, Linux kernel appears to use SIGILL to lazily enable vector registers */
         if (signal == SIGILL && !EXT(ctx->mem)->crt0_done) {
@@ -1840,6 +1996,9 @@ void init_contexts_sys_dep(void) {
     add_context_query_comparator("tid", cmp_linux_tid);
     add_context_query_comparator("KernelName", cmp_linux_kernel_name);
     create_eventpoint("main", NULL, eventpoint_at_main, NULL);
+#if ENABLE_ProfilerPerf
+    ini_profiler_perf();
+#endif
 }
 
 #endif  /* if ENABLE_DebugContext */
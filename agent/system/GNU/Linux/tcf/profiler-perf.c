@@ -0,0 +1,666 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Statistical profiler that uses Linux perf events.
+ */
+
+#include <tcf/config.h>
+
+#if defined(__linux__)
+
+#if ENABLE_DebugContext && !ENABLE_ContextProxy
+
+#include <system/GNU/Linux/tcf/profiler-perf.h>
+
+#if ENABLE_ProfilerPerf
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <tcf/framework/link.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/cache.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/exceptions.h>
+#include <tcf/framework/trace.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/cpudefs.h>
+#include <tcf/services/symbols.h>
+#include <tcf/services/profiler.h>
+#include <tcf/services/profiler_sst.h>
+
+#define PERF_MMAP_PAGES     128     /* Ring buffer size in pages, must be power of 2 */
+#define PERF_STACK_SIZE     8192    /* Size of user stack copy in a sample */
+#define PERF_DEFAULT_FREQ   1000    /* Samples per second */
+#define PERF_READ_PERIOD    20000   /* Ring buffer polling period, microseconds */
+#define PERF_MAX_PENDING    0x400000 /* Max size of samples waiting to be unwound, bytes */
+#define PERF_EXPR_STACK     16
+
+/* Names of perf user registers, in PERF_REG_* order */
+#if defined(__x86_64__)
+static const char * perf_reg_names[] = {
+    "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp",
+    "rip", NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+#define PERF_REG_SP 7
+#define PERF_REG_PC 8
+#elif defined(__aarch64__)
+static const char * perf_reg_names[] = {
+    "x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7",
+    "x8", "x9", "x10", "x11", "x12", "x13", "x14", "x15",
+    "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23",
+    "x24", "x25", "x26", "x27", "x28", "x29", "x30", "sp",
+    "pc"
+};
+#define PERF_REG_SP 31
+#define PERF_REG_PC 32
+#endif
+
+#define PERF_REG_CNT (sizeof(perf_reg_names) / sizeof(char *))
+
+typedef struct PerfSample {
+    struct PerfSample * next;
+    ContextAddress * chain;     /* Kernel callchain, frame pointer based */
+    unsigned chain_cnt;
+    int has_regs;
+    uint64_t regs[PERF_REG_CNT];
+    uint8_t * stack;            /* Copy of user stack, starting at SP */
+    size_t stack_size;
+    size_t size;                /* Allocated size of the sample */
+} PerfSample;
+
+typedef struct ProfilerPerf {
+    LINK link_all;
+    Context * ctx;
+    Channel * channel;
+    unsigned frame_cnt;
+    unsigned sample_freq;
+    int fd;
+    struct perf_event_mmap_page * meta;
+    uint8_t * rec_buf;
+    size_t rec_max;
+    PerfSample * pending;
+    PerfSample * pending_last;
+    size_t pending_size;
+    ProfilerSamples * samples;
+    uint64_t lost;
+    uint64_t dropped;           /* Samples dropped because the queue was full */
+    int error;
+    int unwind_posted;
+    int disposed;
+    int lock;
+} ProfilerPerf;
+
+typedef struct UnwindFrame {
+    uint64_t * val;
+    uint8_t * valid;
+    uint64_t cfa;
+} UnwindFrame;
+
+static ProfilerClass profiler_class;
+static LINK profilers = TCF_LIST_INIT(profilers);
+static int read_posted = 0;
+static size_t page_size = 0;
+
+#define link_all2prf(x) ((ProfilerPerf *)((char *)(x) - offsetof(ProfilerPerf, link_all)))
+
+static uint64_t perf_regs_mask(void) {
+    unsigned i;
+    uint64_t mask = 0;
+    for (i = 0; i < PERF_REG_CNT; i++) {
+        if (perf_reg_names[i] != NULL) mask |= (uint64_t)1 << i;
+    }
+    return mask;
+}
+
+static int open_perf_event(ProfilerPerf * prf) {
+    struct perf_event_attr attr;
+    pid_t tid = id2pid(prf->ctx->id, NULL);
+    void * addr = NULL;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.freq = 1;
+    attr.sample_freq = prf->sample_freq;
+    attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN | PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+    attr.sample_regs_user = perf_regs_mask();
+    attr.sample_stack_user = PERF_STACK_SIZE;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+
+    prf->fd = (int)syscall(__NR_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (prf->fd < 0) return -1;
+    addr = mmap(NULL, (PERF_MMAP_PAGES + 1) * page_size, PROT_READ | PROT_WRITE, MAP_SHARED, prf->fd, 0);
+    if (addr == MAP_FAILED) {
+        int error = errno;
+        close(prf->fd);
+        prf->fd = -1;
+        errno = error;
+        return -1;
+    }
+    prf->meta = (struct perf_event_mmap_page *)addr;
+    return 0;
+}
+
+static void close_perf_event(ProfilerPerf * prf) {
+    if (prf->meta != NULL) {
+        munmap(prf->meta, (PERF_MMAP_PAGES + 1) * page_size);
+        prf->meta = NULL;
+    }
+    if (prf->fd >= 0) {
+        close(prf->fd);
+        prf->fd = -1;
+    }
+}
+
+static void free_pending(ProfilerPerf * prf) {
+    while (prf->pending != NULL) {
+        PerfSample * s = prf->pending;
+        prf->pending = s->next;
+        loc_free(s);
+    }
+    prf->pending_last = NULL;
+    prf->pending_size = 0;
+}
+
+static void ring_copy(ProfilerPerf * prf, uint64_t pos, void * buf, size_t size) {
+    uint8_t * data = (uint8_t *)prf->meta + page_size;
+    size_t ring_size = PERF_MMAP_PAGES * page_size;
+    size_t offs = (size_t)(pos & (ring_size - 1));
+    size_t n = ring_size - offs;
+    if (n > size) n = size;
+    memcpy(buf, data + offs, n);
+    if (n < size) memcpy((uint8_t *)buf + n, data, size - n);
+}
+
+static uint64_t rec_u64(uint8_t ** p, uint8_t * end) {
+    uint64_t v = 0;
+    if (*p + sizeof(v) > end) return 0;
+    memcpy(&v, *p, sizeof(v));
+    *p += sizeof(v);
+    return v;
+}
+
+static void add_pending(ProfilerPerf * prf, uint8_t * rec, size_t size) {
+    uint8_t * end = rec + size;
+    uint8_t * p = rec + sizeof(struct perf_event_header);
+    uint64_t * chain = NULL;
+    uint64_t chain_cnt = 0;
+    uint64_t abi = 0;
+    uint64_t regs[PERF_REG_CNT];
+    uint8_t * stack = NULL;
+    uint64_t stack_size = 0;
+    PerfSample * s = NULL;
+    size_t s_size = 0;
+    unsigned i, n;
+
+    rec_u64(&p, end); /* IP */
+    chain_cnt = rec_u64(&p, end);
+    if (p + chain_cnt * sizeof(uint64_t) > end) return;
+    chain = (uint64_t *)p;
+    p += chain_cnt * sizeof(uint64_t);
+    abi = rec_u64(&p, end);
+    memset(regs, 0, sizeof(regs));
+    if (abi != PERF_SAMPLE_REGS_ABI_NONE) {
+        for (i = 0; i < PERF_REG_CNT; i++) {
+            if (perf_reg_names[i] != NULL) regs[i] = rec_u64(&p, end);
+        }
+    }
+    stack_size = rec_u64(&p, end);
+    if (stack_size > 0) {
+        uint64_t dyn_size = 0;
+        if (p + stack_size + sizeof(uint64_t) > end) return;
+        stack = p;
+        p += stack_size;
+        dyn_size = rec_u64(&p, end);
+        if (dyn_size < stack_size) stack_size = dyn_size;
+    }
+
+    /* Skip context markers, keep user space addresses only */
+    n = 0;
+    for (i = 0; i < chain_cnt; i++) {
+        if (chain[i] < PERF_CONTEXT_MAX) n++;
+    }
+    if (abi != PERF_SAMPLE_REGS_ABI_64) stack_size = 0;
+    s_size = sizeof(PerfSample) + n * sizeof(ContextAddress) + (size_t)stack_size;
+    if (prf->pending_size + s_size > PERF_MAX_PENDING) {
+        /* Unwinding does not keep up with sampling, don't let the queue grow */
+        prf->dropped++;
+        return;
+    }
+    s = (PerfSample *)loc_alloc_zero(s_size);
+    s->size = s_size;
+    s->chain = (ContextAddress *)(s + 1);
+    for (i = 0; i < chain_cnt; i++) {
+        if (chain[i] < PERF_CONTEXT_MAX) s->chain[s->chain_cnt++] = (ContextAddress)chain[i];
+    }
+    s->has_regs = abi == PERF_SAMPLE_REGS_ABI_64;
+    memcpy(s->regs, regs, sizeof(regs));
+    if (s->has_regs && stack_size > 0) {
+        s->stack = (uint8_t *)(s->chain + n);
+        s->stack_size = (size_t)stack_size;
+        memcpy(s->stack, stack, s->stack_size);
+    }
+    if (prf->pending_last == NULL) prf->pending = s;
+    else prf->pending_last->next = s;
+    prf->pending_last = s;
+    prf->pending_size += s_size;
+}
+
+static void read_ring(ProfilerPerf * prf) {
+    struct perf_event_mmap_page * meta = prf->meta;
+    uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+
+    while (tail < head) {
+        struct perf_event_header hdr;
+        ring_copy(prf, tail, &hdr, sizeof(hdr));
+        if (hdr.size < sizeof(hdr) || tail + hdr.size > head) break;
+        if (hdr.type == PERF_RECORD_SAMPLE) {
+            if (prf->rec_max < hdr.size) {
+                prf->rec_max = hdr.size;
+                prf->rec_buf = (uint8_t *)loc_realloc(prf->rec_buf, prf->rec_max);
+            }
+            ring_copy(prf, tail, prf->rec_buf, hdr.size);
+            add_pending(prf, prf->rec_buf, hdr.size);
+        }
+        else if (hdr.type == PERF_RECORD_LOST) {
+            struct {
+                struct perf_event_header hdr;
+                uint64_t id;
+                uint64_t lost;
+            } rec;
+            if (hdr.size >= sizeof(rec)) {
+                ring_copy(prf, tail, &rec, sizeof(rec));
+                prf->lost += rec.lost;
+            }
+        }
+        tail += hdr.size;
+    }
+    __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+#if ENABLE_Symbols
+
+static int read_stack(PerfSample * s, uint64_t addr, size_t size, int big_endian, uint64_t * res) {
+    uint64_t sp = s->regs[PERF_REG_SP];
+    uint64_t v = 0;
+    size_t i;
+    if (size == 0 || size > sizeof(v)) return -1;
+    if (addr < sp || addr + size > sp + s->stack_size) return -1;
+    for (i = 0; i < size; i++) {
+        uint8_t b = s->stack[addr - sp + (big_endian ? i : size - i - 1)];
+        v = (v << 8) | b;
+    }
+    *res = v;
+    return 0;
+}
+
+/*
+ * Evaluate stack tracing commands using sampled registers and stack copy.
+ * Only commands that are used by call frame information are supported.
+ */
+static int eval_commands(PerfSample * s, RegisterDefinition * defs, size_t defs_cnt, UnwindFrame * frame,
+                         LocationExpressionCommand * cmds, unsigned cmds_cnt, uint64_t * res) {
+    uint64_t stk[PERF_EXPR_STACK];
+    unsigned pos = 0;
+    unsigned i;
+
+    for (i = 0; i < cmds_cnt; i++) {
+        LocationExpressionCommand * cmd = cmds + i;
+        if (cmd->cmd >= SFT_CMD_ADD && cmd->cmd <= SFT_CMD_SHR && cmd->cmd != SFT_CMD_NEG) {
+            uint64_t x, y;
+            if (pos < 2) return -1;
+            x = stk[pos - 2];
+            y = stk[pos - 1];
+            switch (cmd->cmd) {
+            case SFT_CMD_ADD: x = x + y; break;
+            case SFT_CMD_SUB: x = x - y; break;
+            case SFT_CMD_MUL: x = x * y; break;
+            case SFT_CMD_DIV: if (y == 0) return -1; x = x / y; break;
+            case SFT_CMD_AND: x = x & y; break;
+            case SFT_CMD_OR: x = x | y; break;
+            case SFT_CMD_XOR: x = x ^ y; break;
+            case SFT_CMD_GE: x = x >= y; break;
+            case SFT_CMD_GT: x = x > y; break;
+            case SFT_CMD_LE: x = x <= y; break;
+            case SFT_CMD_LT: x = x < y; break;
+            case SFT_CMD_SHL: x = x << y; break;
+            case SFT_CMD_SHR: x = x >> y; break;
+            }
+            stk[pos - 2] = x;
+            pos--;
+            continue;
+        }
+        switch (cmd->cmd) {
+        case SFT_CMD_NUMBER:
+            if (pos >= PERF_EXPR_STACK) return -1;
+            stk[pos++] = (uint64_t)cmd->args.num;
+            break;
+        case SFT_CMD_RD_REG:
+            {
+                size_t n = cmd->args.reg - defs;
+                if (cmd->args.reg < defs || n >= defs_cnt || !frame->valid[n]) return -1;
+                if (pos >= PERF_EXPR_STACK) return -1;
+                stk[pos++] = frame->val[n];
+            }
+            break;
+        case SFT_CMD_FP:
+            if (pos >= PERF_EXPR_STACK) return -1;
+            stk[pos++] = frame->cfa;
+            break;
+        case SFT_CMD_RD_MEM:
+            if (pos < 1) return -1;
+            if (read_stack(s, stk[pos - 1], cmd->args.mem.size, cmd->args.mem.big_endian, stk + pos - 1) < 0) return -1;
+            break;
+        case SFT_CMD_NEG:
+            if (pos < 1) return -1;
+            stk[pos - 1] = ~stk[pos - 1];
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (pos != 1) return -1;
+    *res = stk[0];
+    return 0;
+}
+
+/*
+ * Unwind sample stack using DWARF call frame information.
+ * Returns number of return addresses stored in 'buf'.
+ */
+static unsigned unwind_sample(ProfilerPerf * prf, PerfSample * s, ContextAddress * buf, unsigned buf_max) {
+    Context * ctx = prf->ctx;
+    RegisterDefinition * defs = get_reg_definitions(ctx);
+    RegisterDefinition * pc_def = get_PC_definition(ctx);
+    RegisterDefinition * sp_def = NULL;
+    RegisterDefinition * d = NULL;
+    UnwindFrame up;
+    UnwindFrame down;
+    size_t defs_cnt = 0;
+    unsigned cnt = 0;
+    unsigned i;
+
+    if (defs == NULL || pc_def == NULL || !s->has_regs) return 0;
+    for (d = defs; d->name != NULL; d++) defs_cnt++;
+    up.val = (uint64_t *)tmp_alloc_zero(sizeof(uint64_t) * defs_cnt * 2);
+    up.valid = (uint8_t *)tmp_alloc_zero(defs_cnt * 2);
+    up.cfa = 0;
+    down.val = up.val + defs_cnt;
+    down.valid = up.valid + defs_cnt;
+    down.cfa = 0;
+    for (d = defs; d->name != NULL; d++) {
+        if (d->parent != NULL) continue;
+        for (i = 0; i < PERF_REG_CNT; i++) {
+            if (perf_reg_names[i] == NULL || strcmp(perf_reg_names[i], d->name) != 0) continue;
+            up.val[d - defs] = s->regs[i];
+            up.valid[d - defs] = 1;
+            if (i == PERF_REG_SP) sp_def = d;
+        }
+    }
+    if (sp_def == NULL || !up.valid[pc_def - defs]) return 0;
+
+    while (cnt < buf_max) {
+        StackTracingInfo * info = NULL;
+        uint64_t ip = up.val[pc_def - defs];
+        uint64_t sp = up.val[sp_def - defs];
+        UnwindFrame t;
+
+        /* Return address can be next function, use (return address) - 1 to search frame info */
+        if (cnt > 0) ip--;
+        if (get_stack_tracing_info(ctx, (ContextAddress)ip, &info) < 0) {
+            if (cache_miss_count() > 0) exception(ERR_CACHE_MISS);
+            break;
+        }
+        if (info == NULL) break;
+        if (eval_commands(s, defs, defs_cnt, &up, info->fp->cmds, info->fp->cmds_cnt, &up.cfa) < 0) break;
+        memset(down.valid, 0, defs_cnt);
+        for (i = 0; i < (unsigned)info->reg_cnt; i++) {
+            StackFrameRegisterLocation * loc = info->regs[i];
+            size_t n = loc->reg - defs;
+            if (loc->reg < defs || n >= defs_cnt) continue;
+            if (eval_commands(s, defs, defs_cnt, &up, loc->cmds, loc->cmds_cnt, down.val + n) < 0) continue;
+            down.valid[n] = 1;
+        }
+        if (!down.valid[pc_def - defs] || down.val[pc_def - defs] == 0) break;
+        if (!down.valid[sp_def - defs]) {
+            down.val[sp_def - defs] = up.cfa;
+            down.valid[sp_def - defs] = 1;
+        }
+        /* Stack must grow, otherwise unwinding is not making progress */
+        if (down.val[sp_def - defs] <= sp) break;
+        buf[cnt++] = (ContextAddress)down.val[pc_def - defs];
+        t = up;
+        up = down;
+        down = t;
+    }
+    return cnt;
+}
+
+#endif /* ENABLE_Symbols */
+
+static void unwind_cache_client(void * x) {
+    ProfilerPerf * prf = *(ProfilerPerf **)x;
+    if (!prf->disposed) {
+        unsigned buf_max = prf->frame_cnt - 1;
+        ContextAddress * buf = (ContextAddress *)tmp_alloc(sizeof(ContextAddress) * (buf_max + 1));
+        /* Samples are removed from the queue only after they are unwound,
+         * so the client resumes with the same sample after a cache miss */
+        while (prf->pending != NULL) {
+            PerfSample * s = prf->pending;
+            ContextAddress pc = (ContextAddress)s->regs[PERF_REG_PC];
+            unsigned cnt = 0;
+            int error = 0;
+            if (!s->has_regs && s->chain_cnt > 0) pc = s->chain[0];
+#if ENABLE_Symbols
+            if (buf_max > 0) {
+                Trap trap;
+                if (set_trap(&trap)) {
+                    cnt = unwind_sample(prf, s, buf, buf_max);
+                    clear_trap(&trap);
+                }
+                else if (get_error_code(trap.error) == ERR_CACHE_MISS && cache_miss_count() > 0) {
+                    exception(trap.error);
+                }
+                else {
+                    /* Drop the sample and count it as lost, otherwise unwinding of the queue would never resume */
+                    trace(LOG_STACK, "Cannot unwind perf sample of %s: %s", prf->ctx->id, errno_to_str(trap.error));
+                    error = trap.error;
+                }
+            }
+#endif
+            if (error) {
+                prf->lost++;
+            }
+            else {
+                if (s->chain_cnt > cnt + 1 && s->chain[0] == pc) {
+                    /* Frame pointer based callchain is longer - use it */
+                    cnt = s->chain_cnt - 1;
+                    if (cnt > buf_max) cnt = buf_max;
+                    memcpy(buf, s->chain + 1, cnt * sizeof(ContextAddress));
+                }
+                profiler_samples_add(prf->samples, pc, buf, cnt);
+            }
+            prf->pending = s->next;
+            if (prf->pending == NULL) prf->pending_last = NULL;
+            prf->pending_size -= s->size;
+            loc_free(s);
+        }
+    }
+    cache_exit();
+    prf->unwind_posted = 0;
+    prf->lock--;
+    if (prf->disposed && prf->lock == 0) loc_free(prf);
+}
+
+static void read_event(void * args) {
+    LINK * l;
+    assert(read_posted);
+    read_posted = 0;
+    for (l = profilers.next; l != &profilers; l = l->next) {
+        ProfilerPerf * prf = link_all2prf(l);
+        if (prf->meta == NULL) continue;
+        read_ring(prf);
+        if (prf->pending != NULL && !prf->unwind_posted) {
+            prf->unwind_posted = 1;
+            prf->lock++;
+            cache_enter(unwind_cache_client, prf->channel, &prf, sizeof(prf));
+        }
+    }
+    if (!list_is_empty(&profilers)) {
+        post_event_with_delay(read_event, NULL, PERF_READ_PERIOD);
+        read_posted = 1;
+    }
+}
+
+static void profiler_dispose(void * args) {
+    ProfilerPerf * prf = (ProfilerPerf *)args;
+    assert(!prf->disposed);
+    list_remove(&prf->link_all);
+    close_perf_event(prf);
+    free_pending(prf);
+    profiler_samples_dispose(prf->samples);
+    prf->samples = NULL;
+    loc_free(prf->rec_buf);
+    prf->rec_buf = NULL;
+    prf->disposed = 1;
+    if (prf->lock == 0) loc_free(prf);
+}
+
+static char * profiler_capabilities(Context * ctx) {
+    char * res = NULL;
+    ByteArrayOutputStream buf;
+    OutputStream * out = create_byte_array_output_stream(&buf);
+
+    json_write_string(out, "PerfEvents");
+    write_stream(out, ':');
+    write_stream(out, '{');
+    json_write_string(out, "Format");
+    write_stream(out, ':');
+    json_write_string(out, "StackTraces");
+    write_stream(out, ',');
+    json_write_string(out, "Incremental");
+    write_stream(out, ':');
+    json_write_boolean(out, 1);
+    write_stream(out, '}');
+    write_stream(out, 0);
+
+    get_byte_array_output_stream_data(&buf, &res, NULL);
+    return res;
+}
+
+static void * profiler_configure(void * args, Context * ctx, ProfilerParams * params) {
+    ProfilerPerf * prf = (ProfilerPerf *)args;
+    if (params->frame_cnt > 0 && params->sampler != NULL && strcmp(params->sampler, "PerfEvents") == 0) {
+        /* Enabled */
+        unsigned freq = params->sample_freq > 0 ? params->sample_freq : PERF_DEFAULT_FREQ;
+        if (prf == NULL) {
+            prf = (ProfilerPerf *)loc_alloc_zero(sizeof(ProfilerPerf));
+            prf->samples = profiler_samples_create(params->incremental);
+            prf->channel = params->channel;
+            prf->ctx = ctx;
+            prf->fd = -1;
+            list_add_last(&prf->link_all, &profilers);
+        }
+        else {
+            assert(!prf->disposed);
+            profiler_samples_dispose(prf->samples);
+            prf->samples = profiler_samples_create(params->incremental);
+            free_pending(prf);
+            prf->lost = 0;
+            prf->dropped = 0;
+        }
+        prf->frame_cnt = params->frame_cnt;
+        if (prf->fd < 0 || prf->sample_freq != freq) {
+            close_perf_event(prf);
+            prf->sample_freq = freq;
+            prf->error = 0;
+            if (open_perf_event(prf) < 0) {
+                prf->error = errno;
+                trace(LOG_ALWAYS, "Cannot open perf event for %s: %s", ctx->id, errno_to_str(prf->error));
+            }
+        }
+        if (!read_posted) {
+            post_event_with_delay(read_event, NULL, PERF_READ_PERIOD);
+            read_posted = 1;
+        }
+    }
+    else {
+        /* Disabled */
+        if (prf != NULL) {
+            profiler_dispose(prf);
+            prf = NULL;
+        }
+    }
+    return prf;
+}
+
+static void profiler_read(void * args, OutputStream * out) {
+    ProfilerPerf * prf = (ProfilerPerf *)args;
+
+    assert(!prf->disposed);
+    write_stream(out, '{');
+    profiler_samples_write(prf->samples, prf->ctx, out);
+    if (prf->lost > 0) {
+        write_stream(out, ',');
+        json_write_string(out, "LostSamples");
+        write_stream(out, ':');
+        json_write_uint64(out, prf->lost);
+        prf->lost = 0;
+    }
+    if (prf->dropped > 0) {
+        write_stream(out, ',');
+        json_write_string(out, "DroppedSamples");
+        write_stream(out, ':');
+        json_write_uint64(out, prf->dropped);
+        prf->dropped = 0;
+    }
+    if (prf->error) {
+        write_stream(out, ',');
+        json_write_string(out, "Error");
+        write_stream(out, ':');
+        json_write_string(out, errno_to_str(prf->error));
+    }
+    write_stream(out, '}');
+}
+
+void profiler_perf_add(Context * ctx) {
+    add_profiler(ctx, &profiler_class);
+}
+
+void ini_profiler_perf(void) {
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    profiler_class.capabilities = profiler_capabilities;
+    profiler_class.configure = profiler_configure;
+    profiler_class.dispose = profiler_dispose;
+    profiler_class.read = profiler_read;
+}
+
+#endif /* ENABLE_ProfilerPerf */
+
+#endif /* ENABLE_DebugContext && !ENABLE_ContextProxy */
+
+#endif /* __linux__ */
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Statistical profiler that uses Linux perf events.
+ *
+ * The kernel samples the target threads into memory mapped ring buffers,
+ * each sample includes user registers and a copy of the top of the user stack.
+ * The agent unwinds the samples offline using DWARF call frame information,
+ * so the target is never stopped.
+ *
+ * The profiler is selected by Profiler.configure parameter "Sampler": "PerfEvents",
+ * "SampleFreq" sets sampling frequency in samples per second.
+ * Profiler.read returns data in same "StackTraces" format as the generic profiler.
+ * "LostSamples" counts samples lost by the kernel or not unwound,
+ * "DroppedSamples" counts samples dropped because the unwinding queue was full.
+ */
+
+#ifndef D_profiler_perf
+#define D_profiler_perf
+
+#include <tcf/config.h>
+
+#include <tcf/framework/context.h>
+
+#if !defined(ENABLE_ProfilerPerf)
+#  if ENABLE_ProfilerSST && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#    define ENABLE_ProfilerPerf 1
+#  else
+#    define ENABLE_ProfilerPerf 0
+#  endif
+#endif
+
+#if ENABLE_ProfilerPerf
+
+/* Add perf events profiling support for thread context 'ctx' */
+extern void profiler_perf_add(Context * ctx);
+
+extern void ini_profiler_perf(void);
+
+#endif /* ENABLE_ProfilerPerf */
+
+#endif /* D_profiler_perf */
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+#include <tcf/config.h>
+
+#include <assert.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/addrindex.h>
+
+uint64_t * addr_index_alloc(AddressIndex * idx, unsigned cnt) {
+    unsigned n = cnt;
+    unsigned pos = 0;
+
+    memset(idx, 0, sizeof(AddressIndex));
+    idx->cnt = cnt;
+    for (;;) {
+        assert(idx->levels < ADDR_INDEX_MAX_LEVELS);
+        idx->level_pos[idx->levels] = pos;
+        idx->level_cnt[idx->levels] = n;
+        idx->levels++;
+        pos += n;
+        if (n <= ADDR_INDEX_FANOUT) break;
+        n = n / ADDR_INDEX_FANOUT;
+    }
+    idx->keys = (uint64_t *)loc_alloc(sizeof(uint64_t) * (pos ? pos : 1));
+    return idx->keys;
+}
+
+void addr_index_build(AddressIndex * idx) {
+    unsigned l;
+    for (l = 1; l < idx->levels; l++) {
+        unsigned i;
+        uint64_t * src = idx->keys + idx->level_pos[l - 1];
+        uint64_t * dst = idx->keys + idx->level_pos[l];
+        /* Entry 'i' is the last key of block 'i' of the level below */
+        for (i = 0; i < idx->level_cnt[l]; i++) {
+            dst[i] = src[i * ADDR_INDEX_FANOUT + ADDR_INDEX_FANOUT - 1];
+        }
+    }
+}
+
+unsigned addr_index_rank(AddressIndex * idx, uint64_t key) {
+    unsigned r = 0;
+    unsigned l = idx->levels;
+    while (l > 0) {
+        unsigned i;
+        unsigned c = 0;
+        unsigned pos = 0;
+        unsigned n = 0;
+        uint64_t * blk = NULL;
+        l--;
+        /* Rank in the upper level selects the block in this level */
+        pos = r * ADDR_INDEX_FANOUT;
+        assert(pos <= idx->level_cnt[l]);
+        n = idx->level_cnt[l] - pos;
+        blk = idx->keys + idx->level_pos[l] + pos;
+        if (n >= ADDR_INDEX_FANOUT) {
+            /* Branch-free scan of a full block */
+            for (i = 0; i < ADDR_INDEX_FANOUT; i++) c += blk[i] <= key;
+        }
+        else {
+            for (i = 0; i < n; i++) c += blk[i] <= key;
+        }
+        r = pos + c;
+    }
+    return r;
+}
+
+size_t addr_index_memory_size(AddressIndex * idx) {
+    unsigned l = idx->levels;
+    if (idx->keys == NULL) return 0;
+    if (l == 0) return sizeof(uint64_t);
+    return sizeof(uint64_t) * (idx->level_pos[l - 1] + idx->level_cnt[l - 1]);
+}
+
+void addr_index_dispose(AddressIndex * idx) {
+    loc_free(idx->keys);
+    memset(idx, 0, sizeof(AddressIndex));
+}
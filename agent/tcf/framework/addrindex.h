@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Static search tree over a sorted array of addresses.
+ *
+ * Keys are kept in a dense array, separate from the table records they index,
+ * and upper levels of the tree hold every ADDR_INDEX_FANOUT-th key of the level below.
+ * A lookup scans one small block of keys per level instead of bisecting
+ * the records, which touches far fewer cache lines on large tables.
+ */
+
+#ifndef D_addrindex
+#define D_addrindex
+
+#include <tcf/config.h>
+
+#define ADDR_INDEX_FANOUT 16
+#define ADDR_INDEX_MAX_LEVELS 9
+
+typedef struct AddressIndex {
+    uint64_t * keys;        /* Sorted keys, followed by upper levels of the tree */
+    unsigned cnt;
+    unsigned levels;
+    unsigned level_pos[ADDR_INDEX_MAX_LEVELS];
+    unsigned level_cnt[ADDR_INDEX_MAX_LEVELS];
+} AddressIndex;
+
+/*
+ * Allocate index for 'cnt' keys.
+ * Returns array of 'cnt' elements that caller must fill with keys in ascending order,
+ * and then call addr_index_build().
+ */
+extern uint64_t * addr_index_alloc(AddressIndex * idx, unsigned cnt);
+
+/*
+ * Build upper levels of the tree.
+ */
+extern void addr_index_build(AddressIndex * idx);
+
+/*
+ * Return number of keys that are less or equal to 'key'.
+ */
+extern unsigned addr_index_rank(AddressIndex * idx, uint64_t key);
+
+/*
+ * Return size of memory used by the index, bytes.
+ */
+extern size_t addr_index_memory_size(AddressIndex * idx);
+
+/*
+ * Free memory used by the index.
+ */
+extern void addr_index_dispose(AddressIndex * idx);
+
+#endif /* D_addrindex */
@@ -38,6 +38,7 @@
 #include <tcf/framework/errors.h>
 #include <tcf/framework/link.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
 #include <tcf/framework/shutdown.h>
 
 #ifndef MAX_WORKER_THREADS
@@ -184,6 +185,22 @@ static void * worker_thread_handler(void * x) {
             }
             break;
 
+#if ENABLE_AsyncReqSendMsg
+        case AsyncReqSendMsg:           /* Socket sendmsg */
+            {
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = req->u.sio.iov;
+                msg.msg_iovlen = req->u.sio.iovcnt;
+                req->u.sio.rval = sendmsg(req->u.sio.sock, &msg, req->u.sio.flags);
+                if (req->u.sio.rval == -1) {
+                    req->error = errno;
+                    assert(req->error);
+                }
+            }
+            break;
+#endif
+
         case AsyncReqAccept:            /* Accept socket connections */
             req->u.acc.rval = accept(req->u.acc.sock, req->u.acc.addr, req->u.acc.addr ? &req->u.acc.addrlen : NULL);
             if (req->u.acc.rval == -1) {
@@ -597,6 +614,9 @@ void async_req_post(AsyncReqInfo * req) {
             return;
         }
     }
+#endif
+#if ENABLE_EPoll
+    if (is_dispatch_thread() && reactor_post(req)) return;
 #endif
     check_error(pthread_mutex_lock(&wtlock));
     if (list_is_empty(&wtlist)) {
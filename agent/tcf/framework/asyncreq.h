@@ -31,6 +31,14 @@
 #include <time.h>
 #include <sys/stat.h>
 
+#if !defined(ENABLE_AsyncReqSendMsg)
+#  define ENABLE_AsyncReqSendMsg TARGET_UNIX
+#endif
+
+#if ENABLE_AsyncReqSendMsg
+#  include <sys/uio.h>
+#endif
+
 #include <tcf/framework/events.h>
 
 enum {
@@ -59,6 +67,7 @@ enum {
     AsyncReqReadDir,                    /* Directory read */
     AsyncReqCloseDir,                   /* Directory close */
     AsyncReqRoots,                      /* Root device list */
+    AsyncReqSendMsg,                    /* Socket sendmsg, gathering write */
     AsyncReqUser                        /* User defined req */
 };
 
@@ -135,6 +144,10 @@ struct AsyncReqInfo {
 #else
             socklen_t addrlen;
 #endif
+#if ENABLE_AsyncReqSendMsg
+            struct iovec * iov;         /* AsyncReqSendMsg: data buffers, 'bufp' and 'bufsz' are not used */
+            int iovcnt;
+#endif
 
             /* Out */
             ssize_t rval;
@@ -92,6 +92,8 @@ static void run_cache_client(int retry) {
     unsigned i;
     unsigned id = current_client.id;
     void * args_copy = NULL;
+    MemArena * arena = tmp_arena_create();
+    MemArena * prev_arena = NULL;
 
     assert(id != 0);
     current_cache = NULL;
@@ -99,6 +101,9 @@ static void run_cache_client(int retry) {
     def_channel = NULL;
     if (current_client.args_copy) args_copy = current_client.args;
     for (i = 0; i < listeners_cnt; i++) listeners[i](retry ? CTLE_RETRY : CTLE_START);
+    /* Temporary memory of the client comes from a private arena,
+     * which is recycled without heap churn when the client is restarted after cache miss */
+    prev_arena = arena_enter(arena);
     if (set_trap(&trap)) {
         current_client.client(current_client.args);
         clear_trap(&trap);
@@ -138,6 +143,8 @@ static void run_cache_client(int retry) {
         cache_miss_cnt = 0;
         def_channel = NULL;
     }
+    arena_exit(prev_arena);
+    tmp_arena_dispose(arena);
     if (args_copy != NULL) loc_free(args_copy);
 }
 
@@ -54,6 +54,13 @@ typedef struct ChannelLock {
     unsigned timer;
 } ChannelLock;
 
+typedef struct ChannelOutputWaiter {
+    LINK link;
+    Channel * channel;
+    ChannelOutputCallBack * callback;
+    void * args;
+} ChannelOutputWaiter;
+
 typedef struct ChannelTransport {
     char * transportname;
     ChannelServerCreate create;
@@ -73,6 +80,7 @@ LINK channel_server_root = TCF_LIST_INIT(channel_server_root);
 #define susplink2channel(A) ((Channel *)((char *)(A) - offsetof(Channel, susplink)))
 #define chan2lock(A)        ((ChannelLock *)((char *)(A) - offsetof(ChannelLock, link)))
 #define client2channel(A)   ((Channel *)((char *)(A) - offsetof(Channel, client)))
+#define link2waiter(A)      ((ChannelOutputWaiter *)((char *)(A) - offsetof(ChannelOutputWaiter, link)))
 
 static ChannelTransport * channel_transport = NULL;
 static unsigned channel_transport_cnt = 0;
@@ -91,6 +99,9 @@ static unsigned close_listeners_max = 0;
 static size_t extension_size = 0;
 static int channel_created = 0;
 
+static LINK output_waiters = TCF_LIST_INIT(output_waiters);
+static int output_check_posted = 0;
+
 static const int BROADCAST_OK_STATES = (1 << ChannelStateConnected) | (1 << ChannelStateRedirectSent) | (1 << ChannelStateRedirectReceived);
 #define isBoardcastOkay(c) ((1 << (c)->state) & BROADCAST_OK_STATES)
 
@@ -114,42 +125,106 @@ static void trigger_channel_shutdown(ShutdownInfo * obj) {
     }
 }
 
+/*
+ * Broadcast messages are encoded once into a shared buffer, using channel escape sequences
+ * for ESC and stream markers. At end of message, the buffer is passed to every channel of the group:
+ * channels that implement write_shared() queue a reference to the data,
+ * other channels get the message decoded and written into their own output stream.
+ */
+
+#define BCG_MSG_MIN_SIZE    0x100
+#define BCG_MSG_KEEP_SIZE   0x4000
+
+static void bcg_reserve(TCFBroadcastGroup * bcg, size_t size) {
+    size_t pos = 0;
+    if (bcg->msg != NULL) {
+        pos = bcg->out.cur - bcg->msg->data;
+        if (pos + size <= bcg->msg_max) return;
+    }
+    if (bcg->msg_max < BCG_MSG_MIN_SIZE) bcg->msg_max = BCG_MSG_MIN_SIZE;
+    while (bcg->msg_max < pos + size) bcg->msg_max *= 2;
+    if (bcg->msg == NULL) bcg->msg = output_shared_buffer_alloc(bcg->msg_max);
+    else bcg->msg = output_shared_buffer_realloc(bcg->msg, bcg->msg_max);
+    bcg->out.cur = bcg->msg->data + pos;
+    bcg->out.end = bcg->msg->data + bcg->msg_max;
+}
+
+static void write_decoded(Channel * c, const unsigned char * p, size_t size) {
+    const unsigned char * e = p + size;
+    while (p < e) {
+        const unsigned char * s = p;
+        while (p < e && *p != ESC) p++;
+        if (p > s) c->out.write_block(&c->out, (const char *)s, p - s);
+        if (p < e) {
+            assert(p + 1 < e);
+            switch (p[1]) {
+            case 0: c->out.write(&c->out, ESC); break;
+            case 1: c->out.write(&c->out, MARKER_EOM); break;
+            case 2: c->out.write(&c->out, MARKER_EOS); break;
+            default: assert(0);
+            }
+            p += 2;
+        }
+    }
+}
+
 static void flush_bcg_buf(TCFBroadcastGroup * bcg) {
     LINK * l = bcg->channels.next;
-    size_t size = bcg->out.cur - bcg->buf;
+    OutputSharedBuffer * msg = bcg->msg;
+
+    msg->size = bcg->out.cur - msg->data;
     while (l != &bcg->channels) {
         Channel * c = bclink2channel(l);
-        if (isBoardcastOkay(c)) c->out.write_block(&c->out, (char *)bcg->buf, size);
+        if (isBoardcastOkay(c)) {
+            if (c->write_shared != NULL) c->write_shared(c, msg);
+            else write_decoded(c, msg->data, msg->size);
+        }
         l = l->next;
     }
-    bcg->out.cur = bcg->buf;
+    if (msg->ref_cnt > 1 || bcg->msg_max > BCG_MSG_KEEP_SIZE) {
+        /* The buffer is referenced by output queues, next message needs a new one */
+        output_shared_buffer_release(msg);
+        bcg->msg = NULL;
+        bcg->msg_max = 0;
+        bcg->out.cur = bcg->out.end = NULL;
+    }
+    else {
+        msg->size = 0;
+        bcg->out.cur = msg->data;
+    }
 }
 
 static void write_all(OutputStream * out, int byte) {
     TCFBroadcastGroup * bcg = out2bcast(out);
-    LINK * l = bcg->channels.next;
 
     assert(is_dispatch_thread());
     assert(bcg->magic == BCAST_MAGIC);
-    if (bcg->out.cur != bcg->buf) flush_bcg_buf(bcg);
-    while (l != &bcg->channels) {
-        Channel * c = bclink2channel(l);
-        if (isBoardcastOkay(c)) write_stream(&c->out, byte);
-        l = l->next;
+    bcg_reserve(bcg, 2);
+    if (byte < 0 || byte == ESC) {
+        *bcg->out.cur++ = ESC;
+        if (byte == ESC) *bcg->out.cur++ = 0;
+        else if (byte == MARKER_EOM) *bcg->out.cur++ = 1;
+        else if (byte == MARKER_EOS) *bcg->out.cur++ = 2;
+        else assert(0);
+        if (byte < 0) flush_bcg_buf(bcg);
+        return;
     }
+    *bcg->out.cur++ = (unsigned char)byte;
 }
 
 static void write_block_all(OutputStream * out, const char * bytes, size_t size) {
     TCFBroadcastGroup * bcg = out2bcast(out);
-    LINK * l = bcg->channels.next;
+    const unsigned char * src = (const unsigned char *)bytes;
+    const unsigned char * end = src + size;
 
     assert(is_dispatch_thread());
     assert(bcg->magic == BCAST_MAGIC);
-    if (bcg->out.cur != bcg->buf) flush_bcg_buf(bcg);
-    while (l != &bcg->channels) {
-        Channel * c = bclink2channel(l);
-        if (isBoardcastOkay(c)) c->out.write_block(&c->out, bytes, size);
-        l = l->next;
+    /* Reserve room for the worst case: every byte is escaped */
+    bcg_reserve(bcg, size * 2);
+    while (src < end) {
+        unsigned char ch = *src++;
+        *bcg->out.cur++ = ch;
+        if (ch == ESC) *bcg->out.cur++ = 0;
     }
 }
 
@@ -228,6 +303,49 @@ void notify_channel_opened(Channel * c) {
     channel_unlock(c);
 }
 
+static void call_output_waiter(ChannelOutputWaiter * w) {
+    Channel * c = w->channel;
+    w->callback(c, w->args);
+    channel_unlock(c);
+    loc_free(w);
+}
+
+static int is_output_queue_full(Channel * c) {
+    if (is_channel_closed(c)) return 0;
+    return c->out_queue_size > CHANNEL_OUT_QUEUE_LIMIT;
+}
+
+static void output_check_event(void * args) {
+    LINK list;
+
+    output_check_posted = 0;
+    list_init(&list);
+    list_concat(&list, &output_waiters);
+    list_init(&output_waiters);
+    while (!list_is_empty(&list)) {
+        ChannelOutputWaiter * w = link2waiter(list.next);
+        list_remove(&w->link);
+        if (is_output_queue_full(w->channel)) {
+            list_add_last(&w->link, &output_waiters);
+        }
+        else {
+            call_output_waiter(w);
+        }
+    }
+}
+
+static void post_output_check(void) {
+    if (output_check_posted) return;
+    output_check_posted = 1;
+    post_event(output_check_event, NULL);
+}
+
+static void output_delay_event(void * args) {
+    ChannelOutputWaiter * w = (ChannelOutputWaiter *)args;
+    list_add_last(&w->link, &output_waiters);
+    post_output_check();
+}
+
 void notify_channel_closed(Channel * c) {
     unsigned i;
     assert(channel_created);
@@ -239,9 +357,54 @@ void notify_channel_closed(Channel * c) {
     for (i = 0; i < close_listeners_cnt; i++) {
         close_listeners[i](c);
     }
+    {
+        LINK * l = output_waiters.next;
+        while (l != &output_waiters) {
+            ChannelOutputWaiter * w = link2waiter(l);
+            l = l->next;
+            if (w->channel == c) {
+                list_remove(&w->link);
+                call_output_waiter(w);
+                l = output_waiters.next;
+            }
+        }
+    }
     channel_unlock(c);
 }
 
+void notify_channel_output(Channel * c, size_t queue_size) {
+    c->out_queue_size = queue_size;
+    if (c->out_queue_peak < queue_size) c->out_queue_peak = queue_size;
+    if (!list_is_empty(&output_waiters) && !is_output_queue_full(c)) post_output_check();
+}
+
+int is_channel_broadcast_ok(Channel * c) {
+    return isBoardcastOkay(c) != 0;
+}
+
+int is_channel_congested(Channel * c) {
+    if (is_channel_closed(c)) return 0;
+    if (c->congestion_level > 0) return 1;
+    return c->out_queue_size > CHANNEL_OUT_QUEUE_LIMIT;
+}
+
+void channel_wait_output(Channel * c, ChannelOutputCallBack * callback, void * args) {
+    ChannelOutputWaiter * w = (ChannelOutputWaiter *)loc_alloc_zero(sizeof(ChannelOutputWaiter));
+    w->channel = c;
+    w->callback = callback;
+    w->args = args;
+    channel_lock(c);
+    list_init(&w->link);
+    if (c->congestion_level > 0 && !is_channel_closed(c)) {
+        /* Remote peer is congested: slow down, same delay as used for flushing the channel */
+        post_event_with_delay(output_delay_event, w, c->congestion_level * 2500);
+    }
+    else {
+        list_add_last(&w->link, &output_waiters);
+        post_output_check();
+    }
+}
+
 TCFBroadcastGroup * broadcast_group_alloc(void) {
     TCFBroadcastGroup * p = (TCFBroadcastGroup*)loc_alloc_zero(sizeof(TCFBroadcastGroup));
 
@@ -250,8 +413,6 @@ TCFBroadcastGroup * broadcast_group_alloc(void) {
     p->out.write = write_all;
     p->out.write_block = write_block_all;
     p->out.splice_block = splice_block_all;
-    p->out.cur = p->buf;
-    p->out.end = p->buf + sizeof(p->buf);
     p->ref_count = 1;
     return p;
 }
@@ -269,6 +430,7 @@ static void broadcast_group_dispose(TCFBroadcastGroup * p) {
         list_remove(&c->bclink);
     }
     assert(list_is_empty(&p->channels));
+    if (p->msg != NULL) output_shared_buffer_release(p->msg);
     p->magic = 0;
     loc_free(p);
 }
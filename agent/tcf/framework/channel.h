@@ -22,6 +22,7 @@
 
 #include <tcf/framework/streams.h>
 #include <tcf/framework/link.h>
+#include <tcf/framework/outputbuf.h>
 #include <tcf/framework/peer.h>
 #include <tcf/framework/client.h>
 #include <tcf/framework/shutdown.h>
@@ -32,6 +33,7 @@ extern LINK channel_server_root;
 
 #define chanlink2channelp(A) ((Channel *)((char *)(A) - offsetof(Channel, chanlink)))
 #define servlink2channelserverp(A) ((ChannelServer *)((char *)(A) - offsetof(ChannelServer, servlink)))
+#define bclink2channelp(A) ((Channel *)((char *)(A) - offsetof(Channel, bclink)))
 
 /*
  * broadcast_group_free() API is deprecated and replaced by
@@ -46,7 +48,8 @@ typedef struct Channel Channel;
 
 struct TCFBroadcastGroup {
     int magic;
-    unsigned char buf[256];
+    OutputSharedBuffer * msg;           /* Current message, encoded once and shared by all channels */
+    size_t msg_max;                     /* Allocated size of msg data */
     OutputStream out;                   /* Broadcast stream */
     LINK channels;                      /* Channels in group */
     unsigned ref_count;                 /* reference count, see broadcast_group_lock() and broadcast_group_unlock() */
@@ -77,8 +80,11 @@ struct Channel {
     LINK susplink;                      /* Suspend list */
     LINK locks;                         /* List of channel locks */
     int congestion_level;               /* Congestion level */
+    size_t out_queue_size;              /* Number of bytes queued for transmit */
+    size_t out_queue_peak;              /* Max value of out_queue_size */
     int state;                          /* Current state */
     int disable_zero_copy;              /* Don't send ZeroCopy in Hello message even if we support it */
+    int compress_output;                /* Remote peer accepts compressed data: "Deflate" in its Hello message */
     int incoming;                       /* Created by an incoming connect */
     ClientConnection client;
     int notified_open;
@@ -91,6 +97,7 @@ struct Channel {
     void (*unlock)(Channel *);          /* Unlock channel */
     int (*is_closed)(Channel *);        /* Return true if channel is closed */
     void (*close)(Channel *, int);      /* Close channel */
+    void (*write_shared)(Channel *, OutputSharedBuffer *); /* Optional: queue encoded broadcast message without copying */
 
     /* Populated by channel client, NULL values mean default handling */
     void (*connecting)(Channel *);      /* Called when channel is ready for transmit */
@@ -154,6 +161,13 @@ extern void notify_channel_opened(Channel *);
  */
 extern void notify_channel_closed(Channel *);
 
+/*
+ * Notify channel about change of its output queue size.
+ * The function is called from channel implementation code,
+ * it is not intended to be called by clients.
+ */
+extern void notify_channel_output(Channel *, size_t queue_size);
+
 /*
  * Start TCF channel server.
  * On error returns NULL and sets errno.
@@ -264,6 +278,37 @@ extern void channel_unlock_with_msg(Channel *, const char *);
  */
 extern int is_channel_closed(Channel *);
 
+/*
+ * Max number of bytes in channel output queue.
+ * When the queue is larger, the channel is congested, and event producers
+ * should postpone sending data to the channel.
+ */
+#ifndef CHANNEL_OUT_QUEUE_LIMIT
+#  define CHANNEL_OUT_QUEUE_LIMIT (0x2000 * MEM_USAGE_FACTOR)
+#endif
+
+/*
+ * Return 1 if broadcast group messages are sent to the channel, otherwise return 0.
+ */
+extern int is_channel_broadcast_ok(Channel *);
+
+/*
+ * Return 1 if channel output is congested, otherwise return 0.
+ * The channel is congested if its output queue is over the limit,
+ * or if the remote peer has reported congestion.
+ */
+extern int is_channel_congested(Channel *);
+
+/*
+ * Call 'callback' when the channel output queue is below the limit.
+ * If the remote peer has reported congestion, the callback is delayed
+ * according to the congestion level.
+ * The callback is also called if the channel is closed,
+ * it should check is_channel_closed().
+ */
+typedef void ChannelOutputCallBack(Channel *, void * args);
+extern void channel_wait_output(Channel *, ChannelOutputCallBack * callback, void * args);
+
 /* Deprecated function names are kept for backward compatibility */
 #define stream_lock(channel) channel_lock(channel)
 #define stream_unlock(channel) channel_unlock(channel)
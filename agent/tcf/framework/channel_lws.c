@@ -135,6 +135,7 @@ typedef struct ChannelWS {
     OutputBuffer * obuf;
     int out_errno;
     int out_flush_cnt;      /* Number of posted lazy flush events */
+    int out_flush_delayed;  /* Flush is delayed because remote peer is congested */
     int out_eom_cnt;        /* Number of end-of-message markers in the output buffer */
     OutputQueue out_queue;
     int is_ssl;
@@ -698,6 +699,7 @@ static void done_write_request(void * args) {
     pthread_mutex_unlock(&c->data->mutex);
     output_queue_done(&c->out_queue, error, size);
     if (error) c->out_errno = error;
+    notify_channel_output(c->chan, c->out_queue.size);
     if (output_queue_is_empty(&c->out_queue) &&
         c->chan->state == ChannelStateDisconnected) lws_shutdown(c);
     lws_unlock(c->chan);
@@ -751,6 +753,7 @@ static void lws_flush_with_flags(ChannelWS * c, int flags) {
         output_queue_add_obuf(&c->out_queue, c->obuf);
         c->obuf = output_queue_alloc_obuf();
         c->chan->out.end = c->obuf->buf + sizeof(c->obuf->buf);
+        notify_channel_output(c->chan, c->out_queue.size);
     }
     c->chan->out.cur = c->obuf->buf;
     c->out_eom_cnt = 0;
@@ -761,7 +764,14 @@ static void lws_flush_event(void * x) {
     assert(c->magic == CHANNEL_MAGIC);
     if (--c->out_flush_cnt == 0) {
         int congestion_level = c->chan->congestion_level;
-        if (congestion_level > 0) usleep(congestion_level * 2500);
+        if (congestion_level > 0 && !c->out_flush_delayed) {
+            /* Remote peer is congested: delay flushing of this channel only */
+            c->out_flush_delayed = 1;
+            c->out_flush_cnt++;
+            post_event_with_delay(lws_flush_event, c, congestion_level * 2500);
+            return;
+        }
+        c->out_flush_delayed = 0;
         lws_flush_with_flags(c, 0);
         lws_unlock(c->chan);
     }
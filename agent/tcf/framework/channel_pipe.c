@@ -64,6 +64,7 @@ struct ChannelPIPE {
 
     /* Output stream state */
     int out_flush_cnt;
+    int out_flush_delayed;
     unsigned char obuf[BUF_SIZE];
     OutputQueue out_queue;
     AsyncReqInfo out_req;
@@ -166,6 +167,7 @@ static void done_write_request(void * args) {
     if (c->out_req.u.fio.rval < 0) error = c->out_req.error;
     else size = c->out_req.u.fio.rval;
     output_queue_done(&c->out_queue, error, size);
+    notify_channel_output(c->chan, c->out_queue.size);
 
     if (output_queue_is_empty(&c->out_queue) &&
         c->chan->state == ChannelStateDisconnected) close_output_pipe(c);
@@ -189,6 +191,7 @@ static void create_write_request(ChannelPIPE * c, const void * buf, size_t size)
     if (c->chan->state == ChannelStateDisconnected) return;
     c->out_queue.post_io_request = post_write_request;
     output_queue_add(&c->out_queue, buf, size);
+    notify_channel_output(c->chan, c->out_queue.size);
 }
 
 static void pipe_flush(ChannelPIPE * c) {
@@ -208,7 +211,14 @@ static void pipe_flush_event(void * x) {
     assert(c->magic == CHANNEL_MAGIC);
     if (--c->out_flush_cnt == 0) {
         int congestion_level = c->chan->congestion_level;
-        if (congestion_level > 0) usleep(congestion_level * 2500);
+        if (congestion_level > 0 && !c->out_flush_delayed) {
+            /* Remote peer is congested: delay flushing of this channel only */
+            c->out_flush_delayed = 1;
+            c->out_flush_cnt++;
+            post_event_with_delay(pipe_flush_event, c, congestion_level * 2500);
+            return;
+        }
+        c->out_flush_delayed = 0;
         pipe_flush(c);
         pipe_unlock(c->chan);
     }
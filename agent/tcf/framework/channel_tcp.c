@@ -58,8 +58,10 @@
 #include <tcf/framework/peer.h>
 #include <tcf/framework/ip_ifc.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
 #include <tcf/framework/inputbuf.h>
 #include <tcf/framework/outputbuf.h>
+#include <tcf/framework/compression.h>
 #include <tcf/services/discovery.h>
 
 #ifndef MSG_MORE
@@ -88,9 +90,59 @@
 #  endif
 #endif
 
+#if !defined(ENABLE_OutputGather)
+#  define ENABLE_OutputGather (ENABLE_OutputQueue && ENABLE_AsyncReqSendMsg)
+#endif
+
+/* Number of output queue buffers sent by one sendmsg() call: initial and max value */
+#ifndef OUTPUT_GATHER_MIN
+#  define OUTPUT_GATHER_MIN 16
+#endif
+#ifndef OUTPUT_GATHER_MAX
+#  define OUTPUT_GATHER_MAX 128
+#endif
+
+/* Grow socket send buffer when measured throughput needs more than the buffer can hold in flight */
+#if !defined(ENABLE_SendBufferTuning)
+#  if ENABLE_OutputQueue && defined(__linux__) && defined(TCP_INFO)
+#    define ENABLE_SendBufferTuning 1
+#  else
+#    define ENABLE_SendBufferTuning 0
+#  endif
+#endif
+
+#if ENABLE_SendBufferTuning
+#  include <time.h>
+#endif
+
+/*
+ * Compressed output: after the remote peer has announced "Deflate" in its Hello message,
+ * starting at a message boundary, everything sent on the channel is a sequence of frames:
+ *   ESC 4 <3 bytes length, 7 bits per byte, LSB first> <length bytes of raw deflate data>
+ * Frames of a channel together form one deflate stream, each frame ends on a block boundary.
+ */
+#if !defined(ENABLE_ChannelCompression)
+#  if ENABLE_OutputQueue && BUF_SIZE <= DEFLATE_STREAM_MAX_BLOCK
+#    define ENABLE_ChannelCompression 1
+#  else
+#    define ENABLE_ChannelCompression 0
+#  endif
+#endif
+
+#define FRAME_HDR_SIZE 5
+
+/* Broadcast messages larger than this are queued by reference instead of copying */
+#define SHARED_MSG_MIN_SIZE (BUF_SIZE / 4)
+
 #ifndef SOCKET_SEND_BUFFER_MINSIZE
 #  define SOCKET_SEND_BUFFER_MINSIZE  200 * 1024
 #endif
+#ifndef SOCKET_SEND_BUFFER_MAXSIZE
+#  define SOCKET_SEND_BUFFER_MAXSIZE  (4 * 1024 * 1024)
+#endif
+#ifndef SOCKET_SEND_BUFFER_PERIOD
+#  define SOCKET_SEND_BUFFER_PERIOD   100000 /* Throughput measurement period, microseconds */
+#endif
 #ifndef SOCKET_RECV_BUFFER_MINSIZE
 #  define SOCKET_RECV_BUFFER_MINSIZE  120 * 1024
 #endif
@@ -123,11 +175,27 @@ struct ChannelTCP {
     OutputBuffer * obuf;
     int out_errno;
     int out_flush_cnt;      /* Number of posted lazy flush events */
+    int out_flush_delayed;  /* Flush is delayed because remote peer is congested */
     int out_eom_cnt;        /* Number of end-of-message markers in the output buffer */
+#if ENABLE_ChannelCompression
+    DeflateStream * out_deflate; /* Output compressor, allocated when compression starts */
+    uint64_t out_raw_size;  /* Compression statistics: data size before and after compression */
+    uint64_t out_frame_size;
+#endif /* ENABLE_ChannelCompression */
 #if ENABLE_OutputQueue
     OutputQueue out_queue;
     AsyncReqInfo wr_req;
 #endif /* ENABLE_OutputQueue */
+#if ENABLE_OutputGather
+    struct iovec wr_iov[OUTPUT_GATHER_MAX];
+    int wr_iov_max;         /* Current limit of buffers per sendmsg() call */
+    size_t wr_size;         /* Number of bytes in the posted gathering write */
+#endif /* ENABLE_OutputGather */
+#if ENABLE_SendBufferTuning
+    int out_sndbuf;         /* Current socket send buffer size */
+    size_t out_rate_bytes;  /* Bytes sent since out_rate_time */
+    uint64_t out_rate_time; /* Start of throughput measurement, microseconds, 0 if not started */
+#endif /* ENABLE_SendBufferTuning */
 
     /* Async read request */
     AsyncReqInfo rd_req;
@@ -318,6 +386,13 @@ static void delete_channel(ChannelTCP * c) {
     close(c->pipefd[1]);
 #endif /* ENABLE_Splice */
     output_queue_free_obuf(c->obuf);
+#if ENABLE_ChannelCompression
+    if (c->out_deflate != NULL) {
+        trace(LOG_PROTOCOL, "Channel %#" PRIxPTR ": compressed %" PRIu64 " bytes into %" PRIu64,
+            (uintptr_t)c, c->out_raw_size, c->out_frame_size);
+        deflate_stream_free(c->out_deflate);
+    }
+#endif /* ENABLE_ChannelCompression */
     loc_free(c->ibuf.buf);
     loc_free(c->chan->peer_name);
     loc_free(c->addr_buf);
@@ -353,6 +428,63 @@ static int tcp_is_closed(Channel * channel) {
 }
 
 #if ENABLE_OutputQueue
+#if ENABLE_SendBufferTuning
+static void tcp_tune_send_buffer(ChannelTCP * c, size_t size) {
+    struct timespec ts;
+    uint64_t now = 0;
+    uint64_t time = 0;
+
+    if (output_queue_is_empty(&c->out_queue)) {
+        /* The channel is not the bottleneck, restart measurement */
+        c->out_rate_time = 0;
+        return;
+    }
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) return;
+    now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (c->out_rate_time == 0) {
+        c->out_rate_time = now;
+        c->out_rate_bytes = 0;
+        return;
+    }
+    c->out_rate_bytes += size;
+    time = now - c->out_rate_time;
+    if (time < SOCKET_SEND_BUFFER_PERIOD) return;
+    if (c->out_sndbuf == 0) {
+        int snd_buf = 0;
+        socklen_t snd_len = sizeof(snd_buf);
+        /* Linux reports doubled value, to allow space for bookkeeping overhead */
+        if (getsockopt(c->socket, SOL_SOCKET, SO_SNDBUF, (char *)&snd_buf, &snd_len) < 0) snd_buf = 0;
+        c->out_sndbuf = snd_buf / 2;
+        if (c->out_sndbuf < SOCKET_SEND_BUFFER_MINSIZE) c->out_sndbuf = SOCKET_SEND_BUFFER_MINSIZE;
+    }
+    if (c->out_sndbuf < SOCKET_SEND_BUFFER_MAXSIZE) {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+        memset(&info, 0, sizeof(info));
+        if (getsockopt(c->socket, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 && info.tcpi_rtt > 0) {
+            /* Keep two round trips worth of data in flight */
+            uint64_t need = (uint64_t)c->out_rate_bytes * info.tcpi_rtt / time * 2;
+            if (need > (uint64_t)c->out_sndbuf) {
+                int snd_buf = c->out_sndbuf;
+                while ((uint64_t)snd_buf < need && snd_buf < SOCKET_SEND_BUFFER_MAXSIZE) snd_buf *= 2;
+                if (snd_buf > SOCKET_SEND_BUFFER_MAXSIZE) snd_buf = SOCKET_SEND_BUFFER_MAXSIZE;
+                if (setsockopt(c->socket, SOL_SOCKET, SO_SNDBUF, (char *)&snd_buf, sizeof(snd_buf)) < 0) {
+                    trace(LOG_PROTOCOL, "setsockopt(SOL_SOCKET,SO_SNDBUF,%d) error: %s", snd_buf, errno_to_str(errno));
+                    snd_buf = SOCKET_SEND_BUFFER_MAXSIZE;
+                }
+                else {
+                    trace(LOG_PROTOCOL, "Channel %#" PRIxPTR ": send buffer %d, rate %" PRIu64 " B/s, RTT %u us",
+                        (uintptr_t)c, snd_buf, (uint64_t)c->out_rate_bytes * 1000000 / time, (unsigned)info.tcpi_rtt);
+                }
+                c->out_sndbuf = snd_buf;
+            }
+        }
+    }
+    c->out_rate_time = now;
+    c->out_rate_bytes = 0;
+}
+#endif /* ENABLE_SendBufferTuning */
+
 static void done_write_request(void * args) {
     ChannelTCP * c = (ChannelTCP *)((AsyncReqInfo *)args)->client_data;
     int size = 0;
@@ -363,8 +495,22 @@ static void done_write_request(void * args) {
 
     if (c->wr_req.u.sio.rval < 0) error = c->wr_req.error;
     else if (c->wr_req.type == AsyncReqSend) size = c->wr_req.u.sio.rval;
+#if ENABLE_OutputGather
+    else if (c->wr_req.type == AsyncReqSendMsg) size = c->wr_req.u.sio.rval;
+#endif
+#if ENABLE_OutputGather
+    if (c->wr_req.type == AsyncReqSendMsg && (size_t)size == c->wr_size &&
+            c->wr_req.u.sio.iovcnt == c->wr_iov_max && c->wr_iov_max < OUTPUT_GATHER_MAX) {
+        /* The socket accepted whole batch and more data is queued: use larger batches */
+        c->wr_iov_max *= 2;
+    }
+#endif
     output_queue_done(&c->out_queue, error, size);
     if (error) c->out_errno = error;
+#if ENABLE_SendBufferTuning
+    else if (size > 0) tcp_tune_send_buffer(c, size);
+#endif
+    notify_channel_output(c->chan, c->out_queue.size);
     if (output_queue_is_empty(&c->out_queue) &&
         c->chan->state == ChannelStateDisconnected) shutdown(c->socket, SHUT_WR);
     tcp_unlock(c->chan);
@@ -379,7 +525,7 @@ static void post_write_request(OutputBuffer * bf) {
     c->wr_req.done = done_write_request;
 #if ENABLE_SSL
     if (c->ssl) {
-        int wr = SSL_write(c->ssl, bf->buf + bf->buf_pos, bf->buf_len - bf->buf_pos);
+        int wr = SSL_write(c->ssl, output_buffer_data(bf) + bf->buf_pos, bf->buf_len - bf->buf_pos);
         if (wr <= 0) {
             int err = SSL_get_error(c->ssl, wr);
             if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
@@ -411,11 +557,34 @@ static void post_write_request(OutputBuffer * bf) {
         }
     }
     else
+#endif
+#if ENABLE_OutputGather
+    if (c->out_queue.queue.next != c->out_queue.queue.prev) {
+        /* Send several queued buffers with one system call */
+        LINK * l = &bf->link;
+        int n = 0;
+        c->wr_size = 0;
+        while (l != &c->out_queue.queue && n < c->wr_iov_max) {
+            OutputBuffer * b = output_queue_link2buf(l);
+            c->wr_iov[n].iov_base = output_buffer_data(b) + b->buf_pos;
+            c->wr_iov[n].iov_len = b->buf_len - b->buf_pos;
+            c->wr_size += c->wr_iov[n].iov_len;
+            l = l->next;
+            n++;
+        }
+        c->wr_req.type = AsyncReqSendMsg;
+        c->wr_req.u.sio.sock = c->socket;
+        c->wr_req.u.sio.iov = c->wr_iov;
+        c->wr_req.u.sio.iovcnt = n;
+        c->wr_req.u.sio.flags = l == &c->out_queue.queue ? 0 : MSG_MORE;
+        async_req_post(&c->wr_req);
+    }
+    else
 #endif
     {
         c->wr_req.type = AsyncReqSend;
         c->wr_req.u.sio.sock = c->socket;
-        c->wr_req.u.sio.bufp = bf->buf + bf->buf_pos;
+        c->wr_req.u.sio.bufp = output_buffer_data(bf) + bf->buf_pos;
         c->wr_req.u.sio.bufsz = bf->buf_len - bf->buf_pos;
         c->wr_req.u.sio.flags = c->out_queue.queue.next == c->out_queue.queue.prev ? 0 : MSG_MORE;
         async_req_post(&c->wr_req);
@@ -424,6 +593,42 @@ static void post_write_request(OutputBuffer * bf) {
 }
 #endif /* ENABLE_OutputQueue */
 
+#if ENABLE_ChannelCompression
+static void tcp_frame_header(unsigned char * p, size_t len) {
+    assert(len < (1u << 21));
+    p[0] = ESC;
+    p[1] = 4;
+    p[2] = (unsigned char)((len & 0x7fu) | 0x80u);
+    p[3] = (unsigned char)(((len >> 7) & 0x7fu) | 0x80u);
+    p[4] = (unsigned char)(len >> 14);
+}
+
+static void tcp_compress_obuf(ChannelTCP * c) {
+    OutputBuffer * bf = c->obuf;
+    OutputBuffer * fr = output_queue_alloc_obuf();
+    size_t hdr = FRAME_HDR_SIZE;
+    size_t n = deflate_stream_block(c->out_deflate, bf->buf, bf->buf_len, fr->buf + hdr, sizeof(fr->buf) - hdr);
+
+    c->out_raw_size += bf->buf_len;
+    if (n > 0) {
+        tcp_frame_header(fr->buf, n);
+        fr->buf_len = hdr + n;
+        output_queue_add_obuf(&c->out_queue, fr);
+        output_queue_free_obuf(bf);
+    }
+    else {
+        /* Not compressible: frame header and stored block header, followed by the data as is */
+        n = deflate_stream_stored_header(bf->buf_len, fr->buf + hdr);
+        tcp_frame_header(fr->buf, n + bf->buf_len);
+        fr->buf_len = hdr + n;
+        output_queue_add_obuf(&c->out_queue, fr);
+        output_queue_add_obuf(&c->out_queue, bf);
+        n += bf->buf_len;
+    }
+    c->out_frame_size += hdr + n;
+}
+#endif /* ENABLE_ChannelCompression */
+
 static void tcp_flush_with_flags(ChannelTCP * c, int flags) {
     unsigned char * p = c->obuf->buf;
     assert(is_dispatch_thread());
@@ -437,9 +642,14 @@ static void tcp_flush_with_flags(ChannelTCP * c, int flags) {
 #if ENABLE_OutputQueue
         c->obuf->buf_len = c->chan->out.cur - p;
         c->out_queue.post_io_request = post_write_request;
+#if ENABLE_ChannelCompression
+        if (c->out_deflate != NULL) tcp_compress_obuf(c);
+        else
+#endif
         output_queue_add_obuf(&c->out_queue, c->obuf);
         c->obuf = output_queue_alloc_obuf();
         c->chan->out.end = c->obuf->buf + sizeof(c->obuf->buf);
+        notify_channel_output(c->chan, c->out_queue.size);
 #else
         assert(c->ssl == NULL);
         while (p < c->chan->out.cur) {
@@ -467,7 +677,14 @@ static void tcp_flush_event(void * x) {
     assert(c->magic == CHANNEL_MAGIC);
     if (--c->out_flush_cnt == 0) {
         int congestion_level = c->chan->congestion_level;
-        if (congestion_level > 0) usleep(congestion_level * 2500);
+        if (congestion_level > 0 && !c->out_flush_delayed) {
+            /* Remote peer is congested: delay flushing of this channel only */
+            c->out_flush_delayed = 1;
+            c->out_flush_cnt++;
+            post_event_with_delay(tcp_flush_event, c, congestion_level * 2500);
+            return;
+        }
+        c->out_flush_delayed = 0;
         tcp_flush_with_flags(c, 0);
         tcp_unlock(c->chan);
     }
@@ -476,6 +693,22 @@ static void tcp_flush_event(void * x) {
     }
 }
 
+static void tcp_post_flush(ChannelTCP * c) {
+#if ENABLE_ChannelCompression
+    if (c->chan->compress_output && c->out_deflate == NULL) {
+        /* Start compression at message boundary */
+        tcp_flush_with_flags(c, MSG_MORE);
+        c->out_deflate = deflate_stream_alloc();
+        trace(LOG_PROTOCOL, "Channel %#" PRIxPTR ": output compression enabled", (uintptr_t)c);
+    }
+#endif
+    c->out_eom_cnt++;
+    if (c->out_flush_cnt < 2) {
+        if (c->out_flush_cnt++ == 0) tcp_lock(c->chan);
+        post_event_with_delay(tcp_flush_event, c, 0);
+    }
+}
+
 static void tcp_bin_block_start(ChannelTCP * c) {
     *c->chan->out.cur++ = ESC;
     *c->chan->out.cur++ = 3;
@@ -524,13 +757,7 @@ static void tcp_write_stream(OutputStream * out, int byte) {
             else assert(0);
             if (c->chan->out.cur == c->chan->out.end) tcp_flush_with_flags(c, MSG_MORE);
             *c->chan->out.cur++ = esc;
-            if (byte == MARKER_EOM) {
-                c->out_eom_cnt++;
-                if (c->out_flush_cnt < 2) {
-                    if (c->out_flush_cnt++ == 0) tcp_lock(c->chan);
-                    post_event_with_delay(tcp_flush_event, c, 0);
-                }
-            }
+            if (byte == MARKER_EOM) tcp_post_flush(c);
             return;
         }
     }
@@ -576,13 +803,54 @@ static void tcp_write_block_stream(OutputStream * out, const char * bytes, size_
     }
 }
 
+#if ENABLE_OutputQueue
+static void tcp_write_shared(Channel * channel, OutputSharedBuffer * sb) {
+    ChannelTCP * c = channel2tcp(channel);
+    assert(is_dispatch_thread());
+    assert(c->magic == CHANNEL_MAGIC);
+    if (c->out_bin_block != NULL) tcp_bin_block_end(c);
+#if ENABLE_ChannelCompression
+    if (sb->size < SHARED_MSG_MIN_SIZE || c->out_deflate != NULL) {
+#else
+    if (sb->size < SHARED_MSG_MIN_SIZE) {
+#endif
+        /* Small message: copy already encoded data into the output buffer */
+        const unsigned char * src = sb->data;
+        size_t size = sb->size;
+        while (size > 0) {
+            size_t n = c->chan->out.end - c->chan->out.cur;
+            if (n == 0) {
+                tcp_flush_with_flags(c, MSG_MORE);
+                continue;
+            }
+            if (n > size) n = size;
+            memcpy(c->chan->out.cur, src, n);
+            c->chan->out.cur += n;
+            src += n;
+            size -= n;
+        }
+        tcp_post_flush(c);
+        return;
+    }
+    tcp_flush_with_flags(c, MSG_MORE);
+    if (c->chan->state == ChannelStateDisconnected || c->out_errno) return;
+    c->out_queue.post_io_request = post_write_request;
+    output_queue_add_shared(&c->out_queue, sb);
+    notify_channel_output(c->chan, c->out_queue.size);
+}
+#endif /* ENABLE_OutputQueue */
+
 static ssize_t tcp_splice_block_stream(OutputStream * out, int fd, size_t size, int64_t * offset) {
     assert(is_dispatch_thread());
     if (size == 0) return 0;
 #if ENABLE_Splice
     {
         ChannelTCP * c = channel2tcp(out2channel(out));
+#if ENABLE_ChannelCompression
+        if (!c->ssl && out->supports_zero_copy && c->out_deflate == NULL) {
+#else
         if (!c->ssl && out->supports_zero_copy) {
+#endif
             ssize_t rd = splice(fd, offset, c->pipefd[1], NULL, size, SPLICE_F_MOVE);
             if (rd > 0) {
                 /* Send the binary data escape seq */
@@ -1069,6 +1337,9 @@ static ChannelTCP * create_channel(int sock, int en_ssl, int server, int unix_do
     c->chan->unlock = tcp_unlock;
     c->chan->is_closed = tcp_is_closed;
     c->chan->close = send_eof_and_close;
+#if ENABLE_OutputQueue
+    c->chan->write_shared = tcp_write_shared;
+#endif
     ibuf_init(&c->ibuf, &c->chan->inp);
     c->ibuf.post_read = tcp_post_read;
     c->ibuf.wait_read = tcp_wait_read;
@@ -1092,6 +1363,9 @@ static ChannelTCP * create_channel(int sock, int en_ssl, int server, int unix_do
     }
 #if ENABLE_OutputQueue
     output_queue_ini(&c->out_queue);
+#if ENABLE_OutputGather
+    c->wr_iov_max = OUTPUT_GATHER_MIN;
+#endif
 #endif
     return c;
 }
@@ -1227,6 +1501,7 @@ static void server_close(ChannelServer * serv) {
     list_remove(&s->servlink);
     peer_server_free(s->serv.ps);
     shutdown(s->sock, SHUT_RDWR);
+    reactor_close(s->sock);
     closesocket(s->sock);
     s->sock = -1;
     /* TODO: free server struct */
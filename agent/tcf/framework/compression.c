@@ -19,307 +19,1059 @@
  * RFC 1951 defines a lossless compressed data format that
  * compresses data using a combination of the LZ77 algorithm and Huffman coding.
  *
- * Only decompressor is implemented.
+ * The decompressor decodes a complete stream from a memory buffer.
+ * It does not use static data, and can be called from any thread.
+ * The compressor produces a raw deflate stream incrementally, one block per call,
+ * each block followed by an empty stored block, so that every chunk of output ends on a byte boundary
+ * and can be decoded as soon as it is received (same as zlib Z_SYNC_FLUSH).
  */
 
 #include <tcf/config.h>
 
 #include <assert.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
 #include <tcf/framework/errors.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/compression.h>
 
-#define FAST_LOOKUP_BITS 8
+/*************************************************************************************************/
+/* Decompressor */
+
+/*
+ * Huffman codes are decoded by table lookup: a root table indexed by next 'root' bits of input,
+ * longer codes are resolved by a second lookup in a sub-table.
+ * The literal/length root table also has entries that decode two literals at once.
+ * All decoder state is kept in InflateState, so the decompressor can run on any thread.
+ */
+
+#define MAX_CODE_BITS   15
 #define MAX_SYMBOLS_CNT 288
+#define MAX_DIST_CNT    32
+#define LITLEN_BITS     10
+#define DIST_BITS       8
+#define CLEN_BITS       7
 
-typedef struct HuffmanSymbol {
-    uint16_t code;
-    uint8_t size;
-    uint8_t tree;
-} HuffmanSymbol;
+/* Each sub-table has at least one code, so number of sub-tables is limited by number of symbols */
+#define LITLEN_TABLE_SIZE ((1 << LITLEN_BITS) + MAX_SYMBOLS_CNT * (1 << (MAX_CODE_BITS - LITLEN_BITS)))
+#define DIST_TABLE_SIZE   ((1 << DIST_BITS) + MAX_DIST_CNT * (1 << (MAX_CODE_BITS - DIST_BITS)))
 
-typedef struct HuffmanTable {
-    unsigned syms_cnt;
-    uint8_t code_size[MAX_SYMBOLS_CNT];
-    HuffmanSymbol lookup[1 << FAST_LOOKUP_BITS];
-    HuffmanSymbol tree[MAX_SYMBOLS_CNT * 2];
-} HuffmanTable;
-
-static HuffmanTable tables[3];
-
-static uint8_t * inp_buf = NULL;
-static size_t inp_size = 0;
-static unsigned inp_pos = 0;
-static uint32_t inp_bit_buf = 0;
-static unsigned inp_bit_cnt = 0;
-static uint8_t * out_buf = NULL;
-static size_t out_size = 0;
-static unsigned out_pos = 0;
-
-static unsigned get_bits(unsigned bit_cnt) {
-    unsigned v = 0;
-    if (bit_cnt > 0) {
-        assert(bit_cnt <= 32);
-        while (inp_bit_cnt < bit_cnt) {
-            if (inp_pos >= inp_size) exception(ERR_BUFFER_OVERFLOW);
-            inp_bit_buf |= (uint32_t)inp_buf[inp_pos++] << inp_bit_cnt;
-            inp_bit_cnt += 8;
-        }
-        v = inp_bit_buf & ((1u << bit_cnt) - 1);
-        inp_bit_buf >>= bit_cnt;
-        inp_bit_cnt -= bit_cnt;
+#define ENTRY_INVALID   0
+#define ENTRY_LITERAL   1   /* 'sym' is literal byte value */
+#define ENTRY_LITERAL2  2   /* 'sym' is two literal bytes, first one in low byte */
+#define ENTRY_SYMBOL    3   /* 'sym' is length code index, distance code or code length symbol */
+#define ENTRY_END       4   /* End of block */
+#define ENTRY_SUBTABLE  5   /* 'sym' is sub-table offset, 'bits' is sub-table index size */
+
+#define TABLE_LITLEN    0
+#define TABLE_DIST      1
+#define TABLE_CLEN      2
+
+typedef struct InflateEntry {
+    uint16_t sym;
+    uint8_t bits;
+    uint8_t kind;
+} InflateEntry;
+
+typedef struct InflateState {
+    const uint8_t * inp_buf;
+    size_t inp_size;
+    size_t inp_pos;
+    size_t inp_extra;       /* Number of zero bytes added to the bit buffer past end of input */
+    uint64_t bit_buf;
+    unsigned bit_cnt;
+    uint8_t * out_buf;
+    size_t out_size;
+    size_t out_pos;
+    int fixed_tables;
+    InflateEntry litlen[LITLEN_TABLE_SIZE];
+    InflateEntry litlen2[1 << LITLEN_BITS];
+    InflateEntry dist[DIST_TABLE_SIZE];
+    InflateEntry clen[1 << CLEN_BITS];
+} InflateState;
+
+static const unsigned length_base[31] = {
+      3,   4,   5,   6,   7,   8,   9,  10,
+     11,  13,  15,  17,  19,  23,  27,  31,
+     35,  43,  51,  59,  67,  83,  99, 115,
+    131, 163, 195, 227, 258,   0,   0
+};
+static const unsigned length_extra[31] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0, 0, 0
+};
+static const unsigned dist_base[32] = {
+       1,    2,    3,     4,     5,     7,    9,   13,
+      17,   25,   33,    49,    65,    97,  129,  193,
+     257,  385,  513,   769,  1025,  1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577,    0,    0
+};
+static const unsigned dist_extra[32] = {
+     0,  0,  0,  0,  1,  1,  2,  2,
+     3,  3,  4,  4,  5,  5,  6,  6,
+     7,  7,  8,  8,  9,  9, 10, 10,
+    11, 11, 12, 12, 13, 13,  0,  0
+};
+
+/* Fill bit buffer up to at least 56 bits, past end of input the buffer is padded with zeros */
+static void fill_bits(InflateState * s) {
+    while (s->bit_cnt <= 56) {
+        uint64_t b = 0;
+        if (s->inp_pos < s->inp_size) b = s->inp_buf[s->inp_pos++];
+        else s->inp_extra++;
+        s->bit_buf |= b << s->bit_cnt;
+        s->bit_cnt += 8;
     }
+}
+
+static unsigned get_bits(InflateState * s, unsigned bit_cnt) {
+    unsigned v;
+    assert(bit_cnt <= 32);
+    if (s->bit_cnt < bit_cnt) fill_bits(s);
+    v = (unsigned)(s->bit_buf & (((uint64_t)1 << bit_cnt) - 1));
+    s->bit_buf >>= bit_cnt;
+    s->bit_cnt -= bit_cnt;
     return v;
 }
 
-static unsigned decode_huffman_symbol(HuffmanTable * t) {
-    HuffmanSymbol v;
+/* Return error if decoder has consumed padding bits past end of input */
+static int check_input(InflateState * s) {
+    if (s->inp_extra * 8 > s->bit_cnt) {
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
+    }
+    return 0;
+}
+
+static InflateEntry make_entry(unsigned type, unsigned sym, unsigned bits) {
+    InflateEntry e;
+    e.sym = (uint16_t)sym;
+    e.bits = (uint8_t)bits;
+    e.kind = ENTRY_SYMBOL;
+    if (type == TABLE_LITLEN) {
+        if (sym < 256) e.kind = ENTRY_LITERAL;
+        else if (sym == 256) e.kind = ENTRY_END;
+        else if (sym < 286) e.sym = (uint16_t)(sym - 257);
+        else e.kind = ENTRY_INVALID;
+    }
+    else if (type == TABLE_DIST && sym >= 30) {
+        e.kind = ENTRY_INVALID;
+    }
+    return e;
+}
+
+static int build_table(InflateState * s, unsigned type, const uint8_t * code_size, unsigned syms_cnt) {
+    InflateEntry * table = NULL;
+    unsigned table_size = 0;
+    unsigned root = 0;
+    unsigned root_size = 0;
+    unsigned size_cnt[MAX_CODE_BITS + 1];
+    unsigned next_code[MAX_CODE_BITS + 1];
+    uint16_t rev_code[MAX_SYMBOLS_CNT];
+    uint8_t sub_bits[1 << LITLEN_BITS];
+    uint16_t sub_offs[1 << LITLEN_BITS];
+    unsigned used = 0;
+    unsigned left = 1;
+    unsigned code = 0;
+    unsigned pos = 0;
+    unsigned sym;
+    unsigned i;
 
-    while (inp_bit_cnt < 15) {
-        if (inp_pos >= inp_size) exception(ERR_BUFFER_OVERFLOW);
-        inp_bit_buf |= (uint32_t)inp_buf[inp_pos++] << inp_bit_cnt;
-        inp_bit_cnt += 8;
+    switch (type) {
+    case TABLE_LITLEN: table = s->litlen; table_size = LITLEN_TABLE_SIZE; root = LITLEN_BITS; break;
+    case TABLE_DIST: table = s->dist; table_size = DIST_TABLE_SIZE; root = DIST_BITS; break;
+    default: table = s->clen; table_size = 1 << CLEN_BITS; root = CLEN_BITS; break;
     }
+    root_size = 1u << root;
+    assert(syms_cnt <= MAX_SYMBOLS_CNT);
 
-    v = t->lookup[inp_bit_buf & ((1 << FAST_LOOKUP_BITS) - 1)];
-    if (v.tree) {
-        unsigned b = FAST_LOOKUP_BITS;
-        do {
-            assert(b <= 14);
-            assert(v.code <= MAX_SYMBOLS_CNT * 2 - 2);
-            v = t->tree[v.code + ((inp_bit_buf >> b++) & 1)];
+    memset(size_cnt, 0, sizeof(size_cnt));
+    for (sym = 0; sym < syms_cnt; sym++) size_cnt[code_size[sym]]++;
+    for (i = 1; i <= MAX_CODE_BITS; i++) {
+        left <<= 1;
+        if (left < size_cnt[i]) {
+            /* Over-subscribed code */
+            errno = ERR_INV_FORMAT;
+            return -1;
         }
-        while (v.tree);
-        assert(v.size == b);
+        left -= size_cnt[i];
+        used += size_cnt[i];
+        next_code[i] = code;
+        code = (code + size_cnt[i]) << 1;
     }
-    assert(v.size <= 15);
-    if (v.size == 0) exception(ERR_OTHER);
-    inp_bit_buf >>= v.size;
-    inp_bit_cnt -= v.size;
-    return v.code;
+    if (left != 0 && used > 1) {
+        /* Incomplete code, only allowed when there is at most one symbol */
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+
+    memset(sub_bits, 0, sizeof(sub_bits));
+    for (sym = 0; sym < syms_cnt; sym++) {
+        unsigned n = code_size[sym];
+        unsigned c, r = 0;
+        if (n == 0) continue;
+        c = next_code[n]++;
+        for (i = 0; i < n; i++) {
+            r = (r << 1) | (c & 1);
+            c >>= 1;
+        }
+        rev_code[sym] = (uint16_t)r;
+        if (n > root) {
+            unsigned prefix = r & (root_size - 1);
+            if (sub_bits[prefix] < n - root) sub_bits[prefix] = (uint8_t)(n - root);
+        }
+    }
+
+    memset(table, 0, sizeof(InflateEntry) * root_size);
+    pos = root_size;
+    for (i = 0; i < root_size; i++) {
+        unsigned size;
+        if (sub_bits[i] == 0) continue;
+        size = 1u << sub_bits[i];
+        if (pos + size > table_size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        sub_offs[i] = (uint16_t)pos;
+        table[i].kind = ENTRY_SUBTABLE;
+        table[i].bits = sub_bits[i];
+        table[i].sym = (uint16_t)pos;
+        memset(table + pos, 0, sizeof(InflateEntry) * size);
+        pos += size;
+    }
+
+    for (sym = 0; sym < syms_cnt; sym++) {
+        unsigned n = code_size[sym];
+        unsigned r = rev_code[sym];
+        if (n == 0) continue;
+        if (n <= root) {
+            InflateEntry e = make_entry(type, sym, n);
+            while (r < root_size) {
+                table[r] = e;
+                r += 1u << n;
+            }
+        }
+        else {
+            unsigned prefix = r & (root_size - 1);
+            InflateEntry * sub = table + sub_offs[prefix];
+            InflateEntry e = make_entry(type, sym, n - root);
+            r >>= root;
+            while (r < (1u << sub_bits[prefix])) {
+                sub[r] = e;
+                r += 1u << (n - root);
+            }
+        }
+    }
+
+    if (type == TABLE_LITLEN) {
+        /* Root table that decodes two literals in one lookup when both codes fit */
+        for (i = 0; i < root_size; i++) {
+            InflateEntry e = table[i];
+            if (e.kind == ENTRY_LITERAL && e.bits < root) {
+                InflateEntry f = table[i >> e.bits];
+                if (f.kind == ENTRY_LITERAL && f.bits <= root - e.bits) {
+                    e.kind = ENTRY_LITERAL2;
+                    e.sym = (uint16_t)(e.sym | (f.sym << 8));
+                    e.bits = (uint8_t)(e.bits + f.bits);
+                }
+            }
+            s->litlen2[i] = e;
+        }
+    }
+    return 0;
+}
+
+static int build_fixed_tables(InflateState * s) {
+    uint8_t code_size[MAX_SYMBOLS_CNT];
+    unsigned i = 0;
+    for (; i <= 143; i++) code_size[i] = 8;
+    for (; i <= 255; i++) code_size[i] = 9;
+    for (; i <= 279; i++) code_size[i] = 7;
+    for (; i <= 287; i++) code_size[i] = 8;
+    if (build_table(s, TABLE_LITLEN, code_size, MAX_SYMBOLS_CNT) < 0) return -1;
+    for (i = 0; i < MAX_DIST_CNT; i++) code_size[i] = 5;
+    if (build_table(s, TABLE_DIST, code_size, MAX_DIST_CNT) < 0) return -1;
+    s->fixed_tables = 1;
+    return 0;
 }
 
-static void decode_tables(unsigned type) {
-    memset(tables, 0, sizeof(tables));
-    if (type == 1) {
-        unsigned t;
-        for (t = 0; t < 2; t++) {
-            unsigned i = 0;
-            uint8_t * p = tables[t].code_size;
-            switch (t) {
-            case 0:
-                for (; i <= 143; i++) *p++ = 8;
-                for (; i <= 255; i++) *p++ = 9;
-                for (; i <= 279; i++) *p++ = 7;
-                for (; i <= 287; i++) *p++ = 8;
-                tables[t].syms_cnt = MAX_SYMBOLS_CNT;
-                break;
-            case 1:
-                for (; i <= 31; i++) *p++ = 5;
-                tables[t].syms_cnt = 32;
-                break;
+static int build_dynamic_tables(InflateState * s) {
+    static const uint8_t clen_zigzag[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+    uint8_t code_size[MAX_SYMBOLS_CNT + MAX_DIST_CNT];
+    unsigned litlen_cnt = get_bits(s, 5) + 257;
+    unsigned dist_cnt = get_bits(s, 5) + 1;
+    unsigned clen_cnt = get_bits(s, 4) + 4;
+    unsigned i = 0;
+
+    s->fixed_tables = 0;
+    if (litlen_cnt > 286 || dist_cnt > 30) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    memset(code_size, 0, 19);
+    for (i = 0; i < clen_cnt; i++) {
+        code_size[clen_zigzag[i]] = (uint8_t)get_bits(s, 3);
+    }
+    if (build_table(s, TABLE_CLEN, code_size, 19) < 0) return -1;
+
+    i = 0;
+    while (i < litlen_cnt + dist_cnt) {
+        InflateEntry e;
+        unsigned n = 0;
+        uint8_t v = 0;
+        if (s->bit_cnt < CLEN_BITS) fill_bits(s);
+        /* Code lengths codes are at most 7 bits long, the table has no sub-tables */
+        e = s->clen[s->bit_buf & ((1u << CLEN_BITS) - 1)];
+        s->bit_buf >>= e.bits;
+        s->bit_cnt -= e.bits;
+        if (e.kind != ENTRY_SYMBOL) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (e.sym < 16) {
+            code_size[i++] = (uint8_t)e.sym;
+            continue;
+        }
+        switch (e.sym) {
+        case 16:
+            if (i == 0) {
+                errno = ERR_INV_FORMAT;
+                return -1;
             }
+            v = code_size[i - 1];
+            n = get_bits(s, 2) + 3;
+            break;
+        case 17: n = get_bits(s, 3) + 3; break;
+        default: n = get_bits(s, 7) + 11; break;
         }
+        if (i + n > litlen_cnt + dist_cnt) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        memset(code_size + i, v, n);
+        i += n;
     }
-    else {
-        unsigned i;
-        static const uint8_t zigzag[19] = {
-            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
-        };
-        tables[0].syms_cnt = get_bits(5) + 257;
-        tables[1].syms_cnt = get_bits(5) + 1;
-        tables[2].syms_cnt = get_bits(4) + 4;
-        for (i = 0; i < tables[2].syms_cnt; i++) {
-            tables[2].code_size[zigzag[i]] = (uint8_t)get_bits(3);
-        }
-        tables[2].syms_cnt = 19;
+    if (check_input(s) < 0) return -1;
+    if (code_size[256] == 0) {
+        /* End of block code is missing */
+        errno = ERR_INV_FORMAT;
+        return -1;
     }
+    if (build_table(s, TABLE_LITLEN, code_size, litlen_cnt) < 0) return -1;
+    if (build_table(s, TABLE_DIST, code_size + litlen_cnt, dist_cnt) < 0) return -1;
+    return 0;
+}
+
+static int decode_data_block(InflateState * s) {
+    uint8_t * out_buf = s->out_buf;
+    size_t out_size = s->out_size;
+    size_t out_pos = s->out_pos;
+
     for (;;) {
-        unsigned i;
-        unsigned sym;
-        unsigned syms_used = 0;
-        unsigned syms_total = 0;
-        unsigned syms_next[17];
-        unsigned syms_per_size[16];
-        HuffmanSymbol hs, hs_next;
-
-        memset(syms_next, 0, sizeof(syms_next));
-        memset(syms_per_size, 0, sizeof(syms_per_size));
-        for (i = 0; i < tables[type].syms_cnt; i++) syms_per_size[tables[type].code_size[i]]++;
-        for (i = 1; i <= 15; i++) {
-            syms_used += syms_per_size[i];
-            syms_total = (syms_total + syms_per_size[i]) << 1;
-            syms_next[i + 1] = syms_total;
-        }
-        if (syms_total != 0x10000 && syms_used > 1) exception(ERR_OTHER);
-
-        hs_next.tree = 1;
-        hs_next.code = 0;
-        hs_next.size = 0;
-        for (sym = 0; sym < tables[type].syms_cnt; sym++) {
-            unsigned code_size = tables[type].code_size[sym];
-            unsigned rev_code = 0;
-            unsigned cur_code = 0;
-            if (code_size == 0) continue;
-            assert(code_size <= 15);
-            cur_code = syms_next[code_size]++;
-            for (i = 0; i < code_size; i++) {
-                rev_code <<= 1;
-                rev_code = rev_code | (cur_code & 1);
-                cur_code >>= 1;
+        InflateEntry e;
+        unsigned len, ofs;
+
+        /* Longest length/distance pair takes 15 + 5 + 15 + 13 bits, so one refill is enough */
+        if (s->bit_cnt < 48) {
+            if (s->inp_pos + 8 <= s->inp_size) {
+                const uint8_t * p = s->inp_buf + s->inp_pos;
+                uint64_t v =
+                    (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+                    (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+                s->bit_buf |= v << s->bit_cnt;
+                s->inp_pos += (63 - s->bit_cnt) >> 3;
+                s->bit_cnt |= 56;
             }
-            if (code_size <= FAST_LOOKUP_BITS) {
-                hs.tree = 0;
-                hs.code = (uint16_t)sym;
-                hs.size = (uint8_t)code_size;
-                while (rev_code < (1 << FAST_LOOKUP_BITS)) {
-                    tables[type].lookup[rev_code] = hs;
-                    rev_code += 1 << code_size;
-                }
-                continue;
+            else {
+                fill_bits(s);
             }
-            hs = tables[type].lookup[rev_code & ((1 << FAST_LOOKUP_BITS) - 1)];
-            assert(hs.size == 0);
-            if (hs.tree == 0) {
-                hs = tables[type].lookup[rev_code & ((1 << FAST_LOOKUP_BITS) - 1)] = hs_next;
-                hs_next.code += 2;
+        }
+
+        e = s->litlen2[s->bit_buf & ((1u << LITLEN_BITS) - 1)];
+        if (e.kind == ENTRY_SUBTABLE) {
+            s->bit_buf >>= LITLEN_BITS;
+            s->bit_cnt -= LITLEN_BITS;
+            e = s->litlen[e.sym + (s->bit_buf & ((1u << e.bits) - 1))];
+        }
+        s->bit_buf >>= e.bits;
+        s->bit_cnt -= e.bits;
+
+        switch (e.kind) {
+        case ENTRY_LITERAL2:
+            if (out_pos + 2 > out_size) break;
+            out_buf[out_pos++] = (uint8_t)e.sym;
+            out_buf[out_pos++] = (uint8_t)(e.sym >> 8);
+            continue;
+        case ENTRY_LITERAL:
+            if (out_pos >= out_size) break;
+            out_buf[out_pos++] = (uint8_t)e.sym;
+            continue;
+        case ENTRY_END:
+            s->out_pos = out_pos;
+            return check_input(s);
+        case ENTRY_SYMBOL:
+            len = length_base[e.sym];
+            if (length_extra[e.sym]) {
+                len += (unsigned)(s->bit_buf & ((1u << length_extra[e.sym]) - 1));
+                s->bit_buf >>= length_extra[e.sym];
+                s->bit_cnt -= length_extra[e.sym];
             }
-            rev_code >>= FAST_LOOKUP_BITS;
-            for (i = code_size; i > FAST_LOOKUP_BITS + 1; i--) {
-                hs.code += rev_code & 1;
-                if (tables[type].tree[hs.code].tree) {
-                    hs = tables[type].tree[hs.code];
-                }
-                else {
-                    hs = tables[type].tree[hs.code] = hs_next;
-                    hs_next.code += 2;
-                }
-                rev_code >>= 1;
+            e = s->dist[s->bit_buf & ((1u << DIST_BITS) - 1)];
+            if (e.kind == ENTRY_SUBTABLE) {
+                s->bit_buf >>= DIST_BITS;
+                s->bit_cnt -= DIST_BITS;
+                e = s->dist[e.sym + (s->bit_buf & ((1u << e.bits) - 1))];
             }
-            assert(hs_next.code <= MAX_SYMBOLS_CNT * 2);
-            hs.code += rev_code & 1;
-            tables[type].tree[hs.code].code = (uint16_t)sym;
-            tables[type].tree[hs.code].size = (uint8_t)code_size;
-        }
-
-        if (type == 2) {
-            uint8_t len_codes[MAX_SYMBOLS_CNT + 32 + 137];
-            i = 0;
-            while (i < tables[0].syms_cnt + tables[1].syms_cnt) {
-                unsigned s = 0;
-                unsigned d = decode_huffman_symbol(tables + 2);
-                if (d < 16) {
-                    len_codes[i++] = (uint8_t)d;
-                    continue;
-                }
-                if (d == 16 && i == 0) exception(ERR_OTHER);
-                switch (d - 16) {
-                case 0: s = get_bits(2) + 3; break;
-                case 1: s = get_bits(3) + 3; break;
-                case 2: s = get_bits(7) + 11; break;
+            s->bit_buf >>= e.bits;
+            s->bit_cnt -= e.bits;
+            if (e.kind != ENTRY_SYMBOL) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            ofs = dist_base[e.sym];
+            if (dist_extra[e.sym]) {
+                ofs += (unsigned)(s->bit_buf & ((1u << dist_extra[e.sym]) - 1));
+                s->bit_buf >>= dist_extra[e.sym];
+                s->bit_cnt -= dist_extra[e.sym];
+            }
+            if (ofs > out_pos) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            if (out_pos + len > out_size) break;
+            if (ofs >= len) {
+                memcpy(out_buf + out_pos, out_buf + out_pos - ofs, len);
+                out_pos += len;
+            }
+            else {
+                uint8_t * p = out_buf + out_pos;
+                out_pos += len;
+                while (len > 0) {
+                    *p = *(p - ofs);
+                    p++;
+                    len--;
                 }
-                if (s == 0) exception(ERR_OTHER);
-                memset(len_codes + i, d == 16 ? len_codes[i - 1] : 0, s);
-                i += s;
             }
-            if (tables[0].syms_cnt + tables[1].syms_cnt != i) exception(ERR_OTHER);
-            memcpy(tables[0].code_size, len_codes, tables[0].syms_cnt);
-            memcpy(tables[1].code_size, len_codes + tables[0].syms_cnt, tables[1].syms_cnt);
+            continue;
+        default:
+            errno = ERR_INV_FORMAT;
+            return -1;
         }
-        if (type == 0) break;
-        type--;
+        /* Output buffer overflow */
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
     }
 }
 
-static void decode_data_block() {
-    static const unsigned length_base[31] = {
-          3,   4,   5,   6,   7,   8,   9,  10,
-         11,  13,  15,  17,  19,  23,  27,  31,
-         35,  43,  51,  59,  67,  83,  99, 115,
-        131, 163, 195, 227, 258,   0,   0
-    };
-    static const unsigned length_extra[31] = {
-        0, 0, 0, 0, 0, 0, 0, 0,
-        1, 1, 1, 1, 2, 2, 2, 2,
-        3, 3, 3, 3, 4, 4, 4, 4,
-        5, 5, 5, 5, 0, 0, 0
-    };
-    static const unsigned dist_base[32] = {
-           1,    2,    3,     4,     5,     7,    9,   13,
-          17,   25,   33,    49,    65,    97,  129,  193,
-         257,  385,  513,   769,  1025,  1537, 2049, 3073,
-        4097, 6145, 8193, 12289, 16385, 24577,    0,    0
-    };
-    static const unsigned dist_extra[32] = {
-         0,  0,  0,  0,  1,  1,  2,  2,
-         3,  3,  4,  4,  5,  5,  6,  6,
-         7,  7,  8,  8,  9,  9, 10, 10,
-        11, 11, 12, 12, 13, 13,  0,  0
-    };
+static int inflate_state(InflateState * s) {
     for (;;) {
-        unsigned sym = decode_huffman_symbol(tables);
-        if (sym < 256) {
-            if (out_pos >= out_size) exception(ERR_OTHER);
-            out_buf[out_pos++] = (uint8_t)sym;
+        unsigned final = get_bits(s, 1);
+        unsigned type = get_bits(s, 2);
+        if (type == 0) {
+            size_t len = 0, nlen = 0;
+            if (check_input(s) < 0) return -1;
+            /* Discard bits up to byte boundary and return whole bytes back to the input */
+            s->inp_pos -= (s->bit_cnt >> 3) - s->inp_extra;
+            s->inp_extra = 0;
+            s->bit_buf = 0;
+            s->bit_cnt = 0;
+            if (s->inp_pos + 4 > s->inp_size) {
+                errno = ERR_BUFFER_OVERFLOW;
+                return -1;
+            }
+            len |= s->inp_buf[s->inp_pos++];
+            len |= (size_t)s->inp_buf[s->inp_pos++] << 8;
+            nlen |= s->inp_buf[s->inp_pos++];
+            nlen |= (size_t)s->inp_buf[s->inp_pos++] << 8;
+            if ((len ^ nlen) != 0xffff) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            if (s->inp_pos + len > s->inp_size || s->out_pos + len > s->out_size) {
+                errno = ERR_BUFFER_OVERFLOW;
+                return -1;
+            }
+            memcpy(s->out_buf + s->out_pos, s->inp_buf + s->inp_pos, len);
+            s->inp_pos += len;
+            s->out_pos += len;
         }
-        else if (sym == 256) {
-            return;
+        else if (type == 3) {
+            errno = ERR_INV_FORMAT;
+            return -1;
         }
         else {
-            unsigned len = length_base[sym - 257] + get_bits(length_extra[sym - 257]);
-            unsigned sym_ofs = decode_huffman_symbol(tables + 1);
-            unsigned ofs = dist_base[sym_ofs] + get_bits(dist_extra[sym_ofs]);
+            if (type == 1) {
+                if (!s->fixed_tables && build_fixed_tables(s) < 0) return -1;
+            }
+            else if (build_dynamic_tables(s) < 0) {
+                return -1;
+            }
+            if (decode_data_block(s) < 0) return -1;
+        }
+        if (final) break;
+    }
+    if (check_input(s) < 0) return -1;
+    s->inp_pos -= (s->bit_cnt >> 3) - s->inp_extra;
+    s->inp_extra = 0;
+    s->bit_buf = 0;
+    s->bit_cnt = 0;
+    return 0;
+}
 
-            if (ofs > out_pos) exception(ERR_OTHER);
-            if (out_pos + len > out_size) exception(ERR_OTHER);
+int inflate_buf(const void * src_buf, size_t src_size, size_t * src_used, void * dst_buf, size_t dst_size, size_t * dst_used) {
+    InflateState * s = (InflateState *)loc_alloc(sizeof(InflateState));
+    int error = 0;
 
-            while (len > 0) {
-                out_buf[out_pos] = out_buf[out_pos - ofs];
-                out_pos++;
-                len--;
-            }
+    s->inp_buf = (const uint8_t *)src_buf;
+    s->inp_size = src_size;
+    s->inp_pos = 0;
+    s->inp_extra = 0;
+    s->bit_buf = 0;
+    s->bit_cnt = 0;
+    s->out_buf = (uint8_t *)dst_buf;
+    s->out_size = dst_size;
+    s->out_pos = 0;
+    s->fixed_tables = 0;
+    if (inflate_state(s) < 0) error = errno;
+    if (src_used != NULL) *src_used = s->inp_pos;
+    if (dst_used != NULL) *dst_used = s->out_pos;
+    loc_free(s);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t adler32(const uint8_t * buf, size_t size) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0) {
+        /* 5552 is the largest n such that 255n(n+1)/2 + (n+1)(65521-1) fits 32 bits */
+        size_t n = size < 5552 ? size : 5552;
+        size -= n;
+        while (n-- > 0) {
+            a += *buf++;
+            b += a;
         }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+int inflate_zlib(const void * src_buf, size_t src_size, void * dst_buf, size_t dst_size, size_t * dst_used) {
+    const uint8_t * inp = (const uint8_t *)src_buf;
+    size_t inp_used = 0;
+    size_t out_used = 0;
+    uint32_t checksum = 0;
+    unsigned cmf, flg;
+
+    if (src_size < 6) {
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
     }
+    cmf = inp[0];
+    flg = inp[1];
+    if ((cmf & 0xf) != 0x08 || (cmf >> 4) > 7) {
+        errno = ERR_UNSUPPORTED;
+        return -1;
+    }
+    if ((cmf * 256 + flg) % 31 != 0 || (flg & 0x20) != 0) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    if (inflate_buf(inp + 2, src_size - 2, &inp_used, dst_buf, dst_size, &out_used) < 0) return -1;
+    inp_used += 2;
+    if (inp_used + 4 > src_size) {
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
+    }
+    checksum = (uint32_t)inp[inp_used] << 24 | (uint32_t)inp[inp_used + 1] << 16 |
+        (uint32_t)inp[inp_used + 2] << 8 | (uint32_t)inp[inp_used + 3];
+    if (checksum != adler32((const uint8_t *)dst_buf, out_used)) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    if (dst_used != NULL) *dst_used = out_used;
+    return 0;
 }
 
 unsigned decompress(void * src_buf, size_t src_size, void * dst_buf, size_t dst_size) {
-    inp_buf = (uint8_t *)src_buf;
-    inp_size = src_size;
-    inp_pos = 0;
-    inp_bit_buf = 0;
-    inp_bit_cnt = 0;
-    out_buf = (uint8_t *)dst_buf;
-    out_size = dst_size;
-    out_pos = 0;
+    size_t src_used = 0;
+    if (inflate_buf(src_buf, src_size, &src_used, dst_buf, dst_size, NULL) < 0) exception(errno);
+    return (unsigned)src_used;
+}
+
+/*************************************************************************************************/
+/* Compressor */
+
+#define WIN_SIZE        0x8000
+#define HASH_BITS       15
+#define HASH_SIZE       (1 << HASH_BITS)
+#define MIN_MATCH       3
+#define MAX_MATCH       258
+#define MAX_CHAIN       16
+#define NICE_MATCH      64
+#define TOO_FAR         4096
+#define LIT_CODES       286
+#define FIXED_LIT_CODES 288
+#define DIST_CODES      30
+#define CLEN_CODES      19
+
+#define HASH(p) ((((unsigned)(p)[0] << 10) ^ ((unsigned)(p)[1] << 5) ^ (p)[2]) & (HASH_SIZE - 1))
+
+struct DeflateStream {
+    /* Sliding window: history followed by the data being compressed */
+    uint8_t window[WIN_SIZE * 2];
+    unsigned win_len;
+    unsigned ins_pos;               /* Next window position to add to hash chains */
+    /* Hash chains, window positions, 0 means end of chain */
+    uint16_t head[HASH_SIZE];
+    uint16_t prev[WIN_SIZE * 2];
+    /* LZ77 output of current block: literal (< 256) or match length + 256, and match distance */
+    uint16_t * sym_len;
+    uint16_t * sym_dist;
+    unsigned sym_max;
+};
+
+typedef struct BitWriter {
+    uint8_t * buf;
+    size_t size;
+    size_t pos;
+    uint32_t bit_buf;
+    unsigned bit_cnt;
+    int overflow;
+} BitWriter;
+
+static uint8_t len_code[MAX_MATCH - MIN_MATCH + 1];
+static uint8_t dist_code[512];
+static int encoder_tables_done = 0;
+
+static const uint8_t clen_order[CLEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static void init_encoder_tables(void) {
+    unsigned code;
+    unsigned n;
+    for (code = 0; code < 29; code++) {
+        unsigned cnt = 1u << length_extra[code];
+        for (n = 0; n < cnt && length_base[code] - MIN_MATCH + n <= MAX_MATCH - MIN_MATCH; n++) {
+            len_code[length_base[code] - MIN_MATCH + n] = (uint8_t)code;
+        }
+    }
+    /* Distances 1..256 are indexed directly, larger distances by (dist - 1) >> 7 */
+    for (code = 0; code < DIST_CODES; code++) {
+        unsigned cnt = 1u << dist_extra[code];
+        for (n = 0; n < cnt; n++) {
+            unsigned d = dist_base[code] - 1 + n;
+            if (d < 256) dist_code[d] = (uint8_t)code;
+            else dist_code[256 + (d >> 7)] = (uint8_t)code;
+        }
+    }
+    encoder_tables_done = 1;
+}
+
+static unsigned get_dist_code(unsigned dist) {
+    return dist <= 256 ? dist_code[dist - 1] : dist_code[256 + ((dist - 1) >> 7)];
+}
+
+static void put_bits(BitWriter * w, unsigned v, unsigned bit_cnt) {
+    assert(bit_cnt <= 16);
+    w->bit_buf |= (uint32_t)v << w->bit_cnt;
+    w->bit_cnt += bit_cnt;
+    while (w->bit_cnt >= 8) {
+        if (w->pos < w->size) w->buf[w->pos++] = (uint8_t)w->bit_buf;
+        else w->overflow = 1;
+        w->bit_buf >>= 8;
+        w->bit_cnt -= 8;
+    }
+}
+
+static void align_bits(BitWriter * w) {
+    if (w->bit_cnt > 0) put_bits(w, 0, 8 - w->bit_cnt);
+}
+
+/* Compute Huffman code lengths, limited to 'max_bits', for symbols with non-zero frequency */
+static void build_code_lengths(const uint32_t * freq, unsigned cnt, unsigned max_bits, uint8_t * lens) {
+    uint32_t weight[LIT_CODES * 2];
+    unsigned parent[LIT_CODES * 2];
+    unsigned leaves[LIT_CODES];
+    unsigned depth[LIT_CODES * 2];
+    unsigned leaf_cnt = 0;
+    unsigned shift = 0;
+    unsigned i;
+
+    assert(cnt <= LIT_CODES);
+    memset(lens, 0, cnt);
+    for (i = 0; i < cnt; i++) {
+        if (freq[i] > 0) leaves[leaf_cnt++] = i;
+    }
+    if (leaf_cnt == 0) return;
+    if (leaf_cnt == 1) {
+        lens[leaves[0]] = 1;
+        return;
+    }
+    /* Insertion sort by frequency, the number of symbols is small */
+    for (i = 1; i < leaf_cnt; i++) {
+        unsigned j = i;
+        unsigned s = leaves[i];
+        while (j > 0 && freq[leaves[j - 1]] > freq[s]) {
+            leaves[j] = leaves[j - 1];
+            j--;
+        }
+        leaves[j] = s;
+    }
     for (;;) {
-        unsigned final = get_bits(1);
-        unsigned type = get_bits(2);
-        if (type == 0) {
-            unsigned len = 0, nlen = 0;
-            inp_pos -= inp_bit_cnt >> 3;
-            inp_bit_cnt = 0;
-            if (inp_pos + 4 > inp_size) exception(ERR_OTHER);
-            len |= inp_buf[inp_pos++];
-            len |= (unsigned)inp_buf[inp_pos++] << 8;
-            nlen |= inp_buf[inp_pos++];
-            nlen |= (unsigned)inp_buf[inp_pos++] << 8;
-            if ((len ^ nlen) != 0xffff) exception(ERR_OTHER);
-            if (inp_pos + len > inp_size) exception(ERR_OTHER);
-            if (out_pos + len > out_size) exception(ERR_OTHER);
-            memcpy(out_buf + out_pos, inp_buf + inp_pos, len);
-            inp_pos += len;
-            out_pos += len;
+        /* Two queues method: leaves are sorted, internal nodes are created in order of weight */
+        unsigned node_cnt = leaf_cnt;
+        unsigned q1 = 0;
+        unsigned q2 = leaf_cnt;
+        unsigned max_depth = 0;
+        for (i = 0; i < leaf_cnt; i++) {
+            uint32_t f = freq[leaves[i]] >> shift;
+            weight[i] = f > 0 ? f : 1;
         }
-        else if (type == 3) {
-            exception(ERR_OTHER);
+        while (node_cnt < leaf_cnt * 2 - 1) {
+            unsigned k;
+            unsigned n[2];
+            for (k = 0; k < 2; k++) {
+                if (q1 < leaf_cnt && (q2 >= node_cnt || weight[q1] <= weight[q2])) n[k] = q1++;
+                else n[k] = q2++;
+            }
+            weight[node_cnt] = weight[n[0]] + weight[n[1]];
+            parent[n[0]] = parent[n[1]] = node_cnt;
+            node_cnt++;
+        }
+        depth[node_cnt - 1] = 0;
+        for (i = node_cnt - 1; i-- > 0;) {
+            depth[i] = depth[parent[i]] + 1;
+            if (i < leaf_cnt && depth[i] > max_depth) max_depth = depth[i];
+        }
+        if (max_depth <= max_bits) {
+            for (i = 0; i < leaf_cnt; i++) lens[leaves[i]] = (uint8_t)depth[i];
+            return;
+        }
+        /* Flatten frequency distribution and try again */
+        shift++;
+    }
+}
+
+/* Assign canonical codes, bit-reversed for LSB-first output */
+static void build_codes(const uint8_t * lens, unsigned cnt, uint16_t * codes) {
+    unsigned bl_count[16];
+    unsigned next_code[16];
+    unsigned code = 0;
+    unsigned i;
+
+    memset(bl_count, 0, sizeof(bl_count));
+    for (i = 0; i < cnt; i++) bl_count[lens[i]]++;
+    bl_count[0] = 0;
+    for (i = 1; i < 16; i++) {
+        code = (code + bl_count[i - 1]) << 1;
+        next_code[i] = code;
+    }
+    for (i = 0; i < cnt; i++) {
+        unsigned len = lens[i];
+        unsigned c = 0;
+        unsigned v = 0;
+        unsigned k;
+        if (len == 0) continue;
+        c = next_code[len]++;
+        for (k = 0; k < len; k++) {
+            v = (v << 1) | (c & 1);
+            c >>= 1;
+        }
+        codes[i] = (uint16_t)v;
+    }
+}
+
+static void insert_hash(DeflateStream * s, unsigned pos) {
+    unsigned h = HASH(s->window + pos);
+    s->prev[pos] = s->head[h];
+    s->head[h] = (uint16_t)pos;
+}
+
+static void slide_window(DeflateStream * s, unsigned size) {
+    unsigned shift = 0;
+    unsigned i;
+
+    if (s->win_len + size <= sizeof(s->window)) return;
+    shift = s->win_len - WIN_SIZE;
+    memmove(s->window, s->window + shift, WIN_SIZE);
+    memmove(s->prev, s->prev + shift, WIN_SIZE * sizeof(s->prev[0]));
+    for (i = 0; i < HASH_SIZE; i++) s->head[i] = (uint16_t)(s->head[i] > shift ? s->head[i] - shift : 0);
+    for (i = 0; i < WIN_SIZE; i++) s->prev[i] = (uint16_t)(s->prev[i] > shift ? s->prev[i] - shift : 0);
+    s->win_len -= shift;
+    s->ins_pos = s->ins_pos > shift ? s->ins_pos - shift : 0;
+}
+
+/* Find matches in the window, returns number of symbols */
+static unsigned find_matches(DeflateStream * s, unsigned pos, unsigned end) {
+    uint8_t * w = s->window;
+    unsigned cnt = 0;
+
+    /* Complete hash chains of previous block tail */
+    while (s->ins_pos < pos && s->ins_pos + MIN_MATCH <= end) {
+        if (s->ins_pos > 0) insert_hash(s, s->ins_pos);
+        s->ins_pos++;
+    }
+    while (pos < end) {
+        unsigned best_len = 0;
+        unsigned best_dist = 0;
+        if (pos + MIN_MATCH <= end) {
+            unsigned max_len = end - pos;
+            unsigned cand = s->head[HASH(w + pos)];
+            unsigned chain = MAX_CHAIN;
+            if (max_len > MAX_MATCH) max_len = MAX_MATCH;
+            while (cand > 0 && cand < pos && pos - cand <= WIN_SIZE && chain-- > 0) {
+                if (w[cand + best_len] == w[pos + best_len] && w[cand] == w[pos]) {
+                    unsigned len = 1;
+                    while (len < max_len && w[cand + len] == w[pos + len]) len++;
+                    if (len > best_len) {
+                        best_len = len;
+                        best_dist = pos - cand;
+                        if (len >= NICE_MATCH || len >= max_len) break;
+                    }
+                }
+                if (s->prev[cand] >= cand) break;
+                cand = s->prev[cand];
+            }
+            if (best_len == MIN_MATCH && best_dist > TOO_FAR) best_len = 0;
+        }
+        if (best_len >= MIN_MATCH) {
+            unsigned i;
+            s->sym_len[cnt] = (uint16_t)(best_len + 256);
+            s->sym_dist[cnt] = (uint16_t)best_dist;
+            for (i = 0; i < best_len; i++) {
+                if (pos + i > 0 && pos + i + MIN_MATCH <= end) {
+                    insert_hash(s, pos + i);
+                    s->ins_pos = pos + i + 1;
+                }
+            }
+            pos += best_len;
         }
         else {
-            decode_tables(type);
-            decode_data_block();
+            if (pos > 0 && pos + MIN_MATCH <= end) {
+                insert_hash(s, pos);
+                s->ins_pos = pos + 1;
+            }
+            s->sym_len[cnt] = w[pos++];
+            s->sym_dist[cnt] = 0;
+        }
+        cnt++;
+    }
+    return cnt;
+}
+
+static void write_symbols(BitWriter * w, DeflateStream * s, unsigned cnt,
+        const uint8_t * lit_lens, const uint16_t * lit_codes,
+        const uint8_t * dist_lens, const uint16_t * dist_codes) {
+    unsigned i;
+    for (i = 0; i < cnt && !w->overflow; i++) {
+        unsigned v = s->sym_len[i];
+        if (v < 256) {
+            put_bits(w, lit_codes[v], lit_lens[v]);
+        }
+        else {
+            unsigned len = v - 256;
+            unsigned dist = s->sym_dist[i];
+            unsigned lc = len_code[len - MIN_MATCH];
+            unsigned dc = get_dist_code(dist);
+            put_bits(w, lit_codes[lc + 257], lit_lens[lc + 257]);
+            if (length_extra[lc]) put_bits(w, len - length_base[lc], length_extra[lc]);
+            put_bits(w, dist_codes[dc], dist_lens[dc]);
+            if (dist_extra[dc]) put_bits(w, dist - dist_base[dc], dist_extra[dc]);
+        }
+    }
+    put_bits(w, lit_codes[256], lit_lens[256]);
+}
+
+DeflateStream * deflate_stream_alloc(void) {
+    DeflateStream * s = (DeflateStream *)loc_alloc_zero(sizeof(DeflateStream));
+    if (!encoder_tables_done) init_encoder_tables();
+    return s;
+}
+
+void deflate_stream_free(DeflateStream * s) {
+    if (s == NULL) return;
+    loc_free(s->sym_len);
+    loc_free(s->sym_dist);
+    loc_free(s);
+}
+
+size_t deflate_stream_stored_header(size_t size, void * dst) {
+    uint8_t * p = (uint8_t *)dst;
+    assert(size <= DEFLATE_STREAM_MAX_BLOCK);
+    /* BFINAL = 0, BTYPE = 00, padded to byte boundary */
+    p[0] = 0;
+    p[1] = (uint8_t)size;
+    p[2] = (uint8_t)(size >> 8);
+    p[3] = (uint8_t)~size;
+    p[4] = (uint8_t)(~size >> 8);
+    return 5;
+}
+
+size_t deflate_stream_block(DeflateStream * s, const void * src, size_t size, void * dst, size_t dst_size) {
+    uint32_t lit_freq[LIT_CODES];
+    uint32_t dist_freq[DIST_CODES];
+    uint32_t clen_freq[CLEN_CODES];
+    uint8_t lit_lens[FIXED_LIT_CODES];
+    uint8_t dist_lens[DIST_CODES];
+    uint8_t clen_lens[CLEN_CODES];
+    uint16_t lit_codes[FIXED_LIT_CODES];
+    uint16_t dist_codes[DIST_CODES];
+    uint16_t clen_codes[CLEN_CODES];
+    uint8_t all_lens[LIT_CODES + DIST_CODES];
+    uint16_t rle[LIT_CODES + DIST_CODES];
+    unsigned rle_cnt = 0;
+    unsigned lit_cnt = 257;
+    unsigned dist_cnt = 1;
+    unsigned clen_cnt = 4;
+    unsigned lit_codes_cnt = LIT_CODES;
+    uint64_t extra_bits = 0;
+    uint64_t fixed_bits = 3;
+    uint64_t dyn_bits = 3 + 5 + 5 + 4;
+    uint64_t stored_bits = (5 + (uint64_t)size) * 8;
+    unsigned sym_cnt = 0;
+    unsigned pos = 0;
+    unsigned i;
+    BitWriter w;
+
+    assert(size <= DEFLATE_STREAM_MAX_BLOCK);
+    if (size == 0) return 0;
+    slide_window(s, (unsigned)size);
+    pos = s->win_len;
+    memcpy(s->window + pos, src, size);
+    s->win_len += (unsigned)size;
+    if (s->sym_max < size) {
+        s->sym_max = (unsigned)size;
+        s->sym_len = (uint16_t *)loc_realloc(s->sym_len, size * sizeof(uint16_t));
+        s->sym_dist = (uint16_t *)loc_realloc(s->sym_dist, size * sizeof(uint16_t));
+    }
+    sym_cnt = find_matches(s, pos, s->win_len);
+
+    memset(lit_freq, 0, sizeof(lit_freq));
+    memset(dist_freq, 0, sizeof(dist_freq));
+    for (i = 0; i < sym_cnt; i++) {
+        unsigned v = s->sym_len[i];
+        if (v < 256) {
+            lit_freq[v]++;
+        }
+        else {
+            unsigned lc = len_code[v - 256 - MIN_MATCH];
+            unsigned dc = get_dist_code(s->sym_dist[i]);
+            lit_freq[lc + 257]++;
+            dist_freq[dc]++;
+            extra_bits += length_extra[lc] + dist_extra[dc];
+        }
+    }
+    lit_freq[256] = 1;
+
+    /* Cost of fixed Huffman codes */
+    for (i = 0; i < LIT_CODES; i++) {
+        unsigned len = i <= 143 ? 8 : i <= 255 ? 9 : i <= 279 ? 7 : 8;
+        fixed_bits += (uint64_t)lit_freq[i] * len;
+    }
+    for (i = 0; i < DIST_CODES; i++) fixed_bits += (uint64_t)dist_freq[i] * 5;
+    fixed_bits += extra_bits;
+
+    /* Cost of dynamic Huffman codes */
+    build_code_lengths(lit_freq, LIT_CODES, 15, lit_lens);
+    build_code_lengths(dist_freq, DIST_CODES, 15, dist_lens);
+    for (i = 0; i < LIT_CODES; i++) {
+        if (lit_lens[i]) lit_cnt = i + 1;
+        dyn_bits += (uint64_t)lit_freq[i] * lit_lens[i];
+    }
+    for (i = 0; i < DIST_CODES; i++) {
+        if (dist_lens[i]) dist_cnt = i + 1;
+        dyn_bits += (uint64_t)dist_freq[i] * dist_lens[i];
+    }
+    if (lit_cnt < 257) lit_cnt = 257;
+    dyn_bits += extra_bits;
+    memcpy(all_lens, lit_lens, lit_cnt);
+    memcpy(all_lens + lit_cnt, dist_lens, dist_cnt);
+    memset(clen_freq, 0, sizeof(clen_freq));
+    i = 0;
+    while (i < lit_cnt + dist_cnt) {
+        unsigned len = all_lens[i];
+        unsigned run = 1;
+        while (i + run < lit_cnt + dist_cnt && all_lens[i + run] == len) run++;
+        if (len == 0 && run >= 11) {
+            if (run > 138) run = 138;
+            rle[rle_cnt++] = (uint16_t)(18 | ((run - 11) << 8));
+        }
+        else if (len == 0 && run >= 3) {
+            rle[rle_cnt++] = (uint16_t)(17 | ((run - 3) << 8));
+        }
+        else if (len != 0 && run >= 4) {
+            if (run > 7) run = 7;
+            rle[rle_cnt++] = (uint16_t)len;
+            rle[rle_cnt++] = (uint16_t)(16 | ((run - 4) << 8));
+        }
+        else {
+            run = 1;
+            rle[rle_cnt++] = (uint16_t)len;
+        }
+        i += run;
+    }
+    for (i = 0; i < rle_cnt; i++) {
+        unsigned c = rle[i] & 0xff;
+        clen_freq[c]++;
+        dyn_bits += c == 16 ? 2 : c == 17 ? 3 : c == 18 ? 7 : 0;
+    }
+    build_code_lengths(clen_freq, CLEN_CODES, 7, clen_lens);
+    for (i = 0; i < CLEN_CODES; i++) {
+        dyn_bits += (uint64_t)clen_freq[i] * clen_lens[i];
+        if (clen_lens[clen_order[i]]) clen_cnt = i + 1;
+    }
+    if (clen_cnt < 4) clen_cnt = 4;
+    dyn_bits += clen_cnt * 3;
+
+    /* Compressed block is followed by empty stored block: 3 bits, padding and 4 bytes */
+    if (stored_bits <= (dyn_bits < fixed_bits ? dyn_bits : fixed_bits) + 3 + 7 + 32) return 0;
+
+    memset(&w, 0, sizeof(w));
+    w.buf = (uint8_t *)dst;
+    w.size = dst_size;
+    if (dyn_bits < fixed_bits) {
+        put_bits(&w, 0, 1);
+        put_bits(&w, 2, 2);
+        put_bits(&w, lit_cnt - 257, 5);
+        put_bits(&w, dist_cnt - 1, 5);
+        put_bits(&w, clen_cnt - 4, 4);
+        for (i = 0; i < clen_cnt; i++) put_bits(&w, clen_lens[clen_order[i]], 3);
+        build_codes(clen_lens, CLEN_CODES, clen_codes);
+        for (i = 0; i < rle_cnt; i++) {
+            unsigned c = rle[i] & 0xff;
+            put_bits(&w, clen_codes[c], clen_lens[c]);
+            if (c == 16) put_bits(&w, rle[i] >> 8, 2);
+            else if (c == 17) put_bits(&w, rle[i] >> 8, 3);
+            else if (c == 18) put_bits(&w, rle[i] >> 8, 7);
         }
-        if (final) break;
     }
-    inp_pos -= inp_bit_cnt >> 3;
-    inp_bit_cnt = 0;
-    return inp_pos;
+    else {
+        /* Fixed code lengths are defined for 288 symbols, unused symbols 286 and 287 still shift the 9 bits codes */
+        lit_codes_cnt = FIXED_LIT_CODES;
+        for (i = 0; i < lit_codes_cnt; i++) lit_lens[i] = (uint8_t)(i <= 143 ? 8 : i <= 255 ? 9 : i <= 279 ? 7 : 8);
+        for (i = 0; i < DIST_CODES; i++) dist_lens[i] = 5;
+        put_bits(&w, 0, 1);
+        put_bits(&w, 1, 2);
+    }
+    build_codes(lit_lens, lit_codes_cnt, lit_codes);
+    build_codes(dist_lens, DIST_CODES, dist_codes);
+    write_symbols(&w, s, sym_cnt, lit_lens, lit_codes, dist_lens, dist_codes);
+
+    /* Sync flush: empty stored block */
+    put_bits(&w, 0, 3);
+    align_bits(&w);
+    put_bits(&w, 0, 16);
+    put_bits(&w, 0xffff, 16);
+    if (w.overflow) return 0;
+    return w.pos;
 }
@@ -15,7 +15,7 @@
 
 /*
  * Implements RFC 1951: http://www.ietf.org/rfc/rfc1951.txt
- * Only decompressor is implemented.
+ * and RFC 1950 zlib stream decoding.
  */
 
 #ifndef D_compression
@@ -23,6 +23,47 @@
 
 #include <tcf/config.h>
 
+/*
+ * Decode raw deflate stream, returns number of source bytes used.
+ * Errors are reported by exceptions.
+ */
 extern unsigned decompress(void * src_buf, size_t src_size, void * dst_buf, size_t dst_size);
 
+/*
+ * Decode raw deflate stream. The function does not use exceptions and can be called from any thread.
+ * Number of bytes consumed and produced are returned in 'src_used' and 'dst_used', if not NULL.
+ * Returns 0 on success, or -1 and sets errno.
+ */
+extern int inflate_buf(const void * src_buf, size_t src_size, size_t * src_used, void * dst_buf, size_t dst_size, size_t * dst_used);
+
+/*
+ * Decode RFC 1950 zlib stream and verify its Adler-32 checksum.
+ * Same as inflate_buf(), can be called from any thread.
+ */
+extern int inflate_zlib(const void * src_buf, size_t src_size, void * dst_buf, size_t dst_size, size_t * dst_used);
+
+/*
+ * Streaming compressor: output of consecutive deflate_stream_block() calls,
+ * together with stored blocks of data the caller did not compress, forms a single raw deflate stream.
+ * Each block can reference data of previous blocks, up to 32K bytes back.
+ */
+typedef struct DeflateStream DeflateStream;
+
+#define DEFLATE_STREAM_MAX_BLOCK 0x8000
+
+extern DeflateStream * deflate_stream_alloc(void);
+extern void deflate_stream_free(DeflateStream * s);
+
+/*
+ * Compress 'size' bytes (at most DEFLATE_STREAM_MAX_BLOCK) into 'dst_buf'.
+ * Returns number of bytes written, the output ends on a byte boundary.
+ * Returns 0 if the compressed block would not be smaller than a stored block,
+ * or it does not fit into 'dst_size' bytes. In that case the data is still added to the stream history,
+ * and the caller must send it as a stored block: deflate_stream_stored_header() followed by the data.
+ */
+extern size_t deflate_stream_block(DeflateStream * s, const void * src_buf, size_t size, void * dst_buf, size_t dst_size);
+
+/* Write stored block header for 'size' bytes of data, returns header size, which is always 5 */
+extern size_t deflate_stream_stored_header(size_t size, void * dst_buf);
+
 #endif /* D_compression */
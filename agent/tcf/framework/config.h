@@ -282,6 +282,26 @@
 #  endif
 #endif
 
+#if !defined(ENABLE_EPoll)
+/* Use epoll() on the dispatch thread for socket and pipe I/O instead of worker threads */
+#  if defined(__linux__) && !defined(__UCLIBC__)
+#    define ENABLE_EPoll        1
+#  else
+#    define ENABLE_EPoll        0
+#  endif
+#endif
+
+#if !defined(ENABLE_SlabAlloc)
+/* Serve small loc_alloc() requests from size class slabs instead of libc malloc() */
+#  define ENABLE_SlabAlloc      0
+#endif
+
+#if !defined(ENABLE_EventStatistics)
+/* Collect timing statistics of event handlers and commands, see eventstats.h.
+ * Timing is collected only after it is enabled at run time */
+#  define ENABLE_EventStatistics 1
+#endif
+
 #if !defined(ENABLE_STREAM_MACROS)
 /* Enabling stream macros increases code size about 5%, and increases speed about 7% */
 #  define ENABLE_STREAM_MACROS  0
@@ -35,6 +35,8 @@
 #include <tcf/framework/errors.h>
 #include <tcf/framework/trace.h>
 #include <tcf/framework/events.h>
+#include <tcf/framework/reactor.h>
+#include <tcf/framework/eventstats.h>
 
 #if !defined(ENABLE_FastMemAlloc)
 #  define ENABLE_FastMemAlloc 1
@@ -60,6 +62,14 @@
 #  define EVENTS_CLOCK_TYPE CLOCK_REALTIME
 #endif
 
+#if !defined(ENABLE_LockFreeEvents)
+#  if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#    define ENABLE_LockFreeEvents 1
+#  else
+#    define ENABLE_LockFreeEvents 0
+#  endif
+#endif
+
 typedef struct event_node event_node;
 
 struct event_node {
@@ -69,6 +79,11 @@ struct event_node {
     void *              arg;
 };
 
+typedef struct TimerList {
+    event_node * first;
+    event_node * last;
+} TimerList;
+
 #if defined(_WIN32) || defined(__CYGWIN__)
    static DWORD event_thread;
 #  define current_thread GetCurrentThreadId()
@@ -86,21 +101,16 @@ struct event_node {
 
 #if ENABLE_FastMemAlloc
 
+/* The pool is used by the dispatch thread only, background threads use loc_alloc(), see post_from_bg_thread() */
 #define EVENT_BUF_SIZE 0x200
 static event_node event_buf[EVENT_BUF_SIZE];
 static event_node * free_queue = NULL;
-static event_node * free_bg_queue = NULL;
 
 #define alloc_event_node(ev) \
     ev = free_queue; \
     if (ev != NULL) free_queue = ev->next; \
     else ev = (event_node *)loc_alloc(sizeof(event_node));
 
-#define alloc_event_node_bg(ev) \
-    ev = free_bg_queue; \
-    if (ev != NULL) free_bg_queue = ev->next; \
-    else ev = (event_node *)loc_alloc(sizeof(event_node));
-
 #define free_event_node(ev) \
     if (ev >= event_buf && ev < event_buf + EVENT_BUF_SIZE) { \
         ev->next = free_queue; \
@@ -113,25 +123,68 @@ static event_node * free_bg_queue = NULL;
 #else
 
 #define alloc_event_node(ev) ev = (event_node *)loc_alloc(sizeof(event_node))
-#define alloc_event_node_bg(ev) alloc_event_node(ev)
 #define free_event_node(ev) loc_free(ev)
 
 #endif
 
+/*
+ * Timers are kept in a hierarchical timing wheel with 1ms ticks.
+ * Level 0 has a slot for each of next 256 ticks, upper levels have 64 slots
+ * each covering 256, 16K and 1M ticks. Timers are moved (cascaded) down to
+ * lower levels when level 0 wraps around. Timers beyond the last level are
+ * kept in the last slot of the last level until they come into range.
+ * The wheel is accessed by the dispatch thread only.
+ */
+#define WHEEL_BITS0     8
+#define WHEEL_BITS      6
+#define WHEEL_SIZE0     (1u << WHEEL_BITS0)
+#define WHEEL_SIZE      (1u << WHEEL_BITS)
+#define WHEEL_LEVELS    3
+#define WHEEL_SPAN(n)   ((uint64_t)1 << (WHEEL_BITS0 + (n) * WHEEL_BITS))
+
+static TimerList wheel0[WHEEL_SIZE0];
+static TimerList wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static TimerList timers_due;
+static uint64_t wheel_tick = 0;
+static unsigned wheel_cnt = 0;
+
 static pthread_mutex_t event_lock;
 static pthread_cond_t event_cond;
 static pthread_cond_t cancel_cond;
 
 static event_node * event_queue = NULL;
 static event_node * event_last = NULL;
-static event_node * timer_queue = NULL;
-static EventCallBack * cancel_handler = NULL;
-static void * cancel_arg = NULL;
 static int process_events = 0;
 static event_node * exit_event = NULL;
 
+/*
+ * Events posted by background threads are pushed into a LIFO list,
+ * the dispatch thread takes the whole list at once.
+ * Background threads wake up the dispatch thread only when it is waiting for events
+ * and the list was empty - one wakeup for a batch of events.
+ */
+static event_node * posted_queue = NULL;
+static int dispatch_idle = 0;
+static int cancel_waiting = 0;
+
+#if ENABLE_LockFreeEvents
+#  define atomic_get(x) __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#  define atomic_set(x, v) __atomic_store_n(&(x), v, __ATOMIC_SEQ_CST)
+#  define posted_lock()
+#  define posted_unlock()
+#else
+#  define atomic_get(x) (x)
+#  define atomic_set(x, v) ((x) = (v))
+#  define posted_lock() check_error(pthread_mutex_lock(&event_lock))
+#  define posted_unlock() check_error(pthread_mutex_unlock(&event_lock))
+#endif
+
 uint32_t events_timer_ms = 0;
 
+#if ENABLE_EPoll
+static int use_reactor = 0;
+#endif
+
 static int time_cmp(const struct timespec * tv1, const struct timespec * tv2) {
     assert(tv1->tv_nsec < 1000000000);
     assert(tv2->tv_nsec < 1000000000);
@@ -152,80 +205,331 @@ static void time_add_usec(struct timespec * tv, unsigned long usec) {
     }
 }
 
-static void post_from_bg_thread(EventCallBack * handler, void * arg, unsigned long delay) {
-    event_node * ev;
-    event_node * next;
-    event_node * prev;
-    struct timespec runtime;
+#if ENABLE_EventStatistics
+static uint64_t time_to_ns(const struct timespec * tv) {
+    return (uint64_t)tv->tv_sec * 1000000000 + tv->tv_nsec;
+}
+
+static void update_queue_depth(unsigned cnt) {
+    event_loop_stats.queue_depth += cnt;
+    if (event_loop_stats.queue_depth > event_loop_stats.queue_depth_max) {
+        event_loop_stats.queue_depth_max = event_loop_stats.queue_depth;
+    }
+}
+#endif
+
+/* Timer tick that contains given time */
+static uint64_t time_to_tick(const struct timespec * tv) {
+    return (uint64_t)tv->tv_sec * 1000 + tv->tv_nsec / 1000000;
+}
+
+/* First timer tick that is not earlier than given time */
+static uint64_t time_to_expire_tick(const struct timespec * tv) {
+    return (uint64_t)tv->tv_sec * 1000 + (tv->tv_nsec + 999999) / 1000000;
+}
+
+static void timer_list_add(TimerList * list, event_node * ev) {
+    ev->next = NULL;
+    if (list->first == NULL) list->first = ev;
+    else list->last->next = ev;
+    list->last = ev;
+}
+
+static event_node * timer_list_remove(TimerList * list, EventCallBack * handler, void * arg) {
+    event_node * prev = NULL;
+    event_node * ev = list->first;
+    while (ev != NULL) {
+        if (ev->handler == handler && ev->arg == arg) {
+            if (prev == NULL) list->first = ev->next;
+            else prev->next = ev->next;
+            if (list->last == ev) list->last = prev;
+            return ev;
+        }
+        prev = ev;
+        ev = ev->next;
+    }
+    return NULL;
+}
+
+static void timer_add(event_node * ev) {
+    uint64_t expire = time_to_expire_tick(&ev->runtime);
+    uint64_t diff = expire - wheel_tick;
+    TimerList * list = NULL;
+
+    if (expire < wheel_tick) {
+        timer_list_add(&timers_due, ev);
+        return;
+    }
+    if (diff < WHEEL_SPAN(0)) {
+        list = wheel0 + (unsigned)(expire & (WHEEL_SIZE0 - 1));
+    }
+    else {
+        unsigned n = 0;
+        while (n < WHEEL_LEVELS - 1 && diff >= WHEEL_SPAN(n + 1)) n++;
+        if (diff >= WHEEL_SPAN(WHEEL_LEVELS)) expire = wheel_tick + WHEEL_SPAN(WHEEL_LEVELS) - 1;
+        list = wheel[n] + (unsigned)((expire >> (WHEEL_BITS0 + n * WHEEL_BITS)) & (WHEEL_SIZE - 1));
+    }
+    timer_list_add(list, ev);
+    wheel_cnt++;
+}
+
+static void timer_readd(event_node * ev) {
+    while (ev != NULL) {
+        event_node * next = ev->next;
+        assert(wheel_cnt > 0);
+        wheel_cnt--;
+        timer_add(ev);
+        ev = next;
+    }
+}
+
+/* Move timers from slot of upper level 'n' down to lower levels, return the slot index */
+static unsigned timer_cascade(unsigned n) {
+    unsigned idx = (unsigned)(wheel_tick >> (WHEEL_BITS0 + n * WHEEL_BITS)) & (WHEEL_SIZE - 1);
+    TimerList * list = wheel[n] + idx;
+    event_node * ev = list->first;
+    list->first = list->last = NULL;
+    timer_readd(ev);
+    return idx;
+}
+
+/* Move timers that expire at or before tick 'now' to the list of due timers */
+static void timer_run(uint64_t now) {
+    if (wheel_cnt > 0 && now >= wheel_tick && now - wheel_tick >= WHEEL_SPAN(1)) {
+        /* The clock has jumped, re-insert all timers instead of stepping through the ticks */
+        TimerList all;
+        unsigned n, i;
+        memset(&all, 0, sizeof(all));
+        for (i = 0; i < WHEEL_SIZE0; i++) {
+            TimerList * list = wheel0 + i;
+            if (list->first == NULL) continue;
+            if (all.first == NULL) all.first = list->first;
+            else all.last->next = list->first;
+            all.last = list->last;
+            list->first = list->last = NULL;
+        }
+        for (n = 0; n < WHEEL_LEVELS; n++) {
+            for (i = 0; i < WHEEL_SIZE; i++) {
+                TimerList * list = wheel[n] + i;
+                if (list->first == NULL) continue;
+                if (all.first == NULL) all.first = list->first;
+                else all.last->next = list->first;
+                all.last = list->last;
+                list->first = list->last = NULL;
+            }
+        }
+        wheel_tick = now + 1;
+        timer_readd(all.first);
+    }
+    while (wheel_tick <= now) {
+        unsigned idx = (unsigned)wheel_tick & (WHEEL_SIZE0 - 1);
+        TimerList * list = wheel0 + idx;
+        if (wheel_cnt == 0) {
+            wheel_tick = now + 1;
+            break;
+        }
+        if (idx == 0) {
+            unsigned n = 0;
+            while (n < WHEEL_LEVELS && timer_cascade(n) == 0) n++;
+        }
+        if (list->first != NULL) {
+            event_node * ev = list->first;
+            while (ev != NULL) {
+                assert(wheel_cnt > 0);
+                wheel_cnt--;
+                ev = ev->next;
+            }
+            if (timers_due.first == NULL) timers_due.first = list->first;
+            else timers_due.last->next = list->first;
+            timers_due.last = list->last;
+            list->first = list->last = NULL;
+        }
+        wheel_tick++;
+    }
+}
+
+/* Get tick when the dispatch thread needs to check the timers next time, return 0 if there are no timers */
+static int timer_next(uint64_t * tick) {
+    uint64_t t = wheel_tick;
+    if (wheel_cnt == 0) return 0;
+    if ((t & (WHEEL_SIZE0 - 1)) != 0) {
+        /* Scan level 0 up to the next cascade */
+        while (wheel0[t & (WHEEL_SIZE0 - 1)].first == NULL) {
+            t++;
+            if ((t & (WHEEL_SIZE0 - 1)) == 0) break;
+        }
+    }
+    *tick = t;
+    return 1;
+}
 
-    if (clock_gettime(EVENTS_CLOCK_TYPE, &runtime)) check_error(errno);
-    time_add_usec(&runtime, delay);
+static event_node * timer_remove(EventCallBack * handler, void * arg) {
+    event_node * ev = NULL;
+    unsigned n, i;
+    if ((ev = timer_list_remove(&timers_due, handler, arg)) != NULL) return ev;
+    if (wheel_cnt == 0) return NULL;
+    for (i = 0; i < WHEEL_SIZE0; i++) {
+        if ((ev = timer_list_remove(wheel0 + i, handler, arg)) != NULL) {
+            wheel_cnt--;
+            return ev;
+        }
+    }
+    for (n = 0; n < WHEEL_LEVELS; n++) {
+        for (i = 0; i < WHEEL_SIZE; i++) {
+            if ((ev = timer_list_remove(wheel[n] + i, handler, arg)) != NULL) {
+                wheel_cnt--;
+                return ev;
+            }
+        }
+    }
+    return NULL;
+}
 
+static void wakeup_dispatch_thread(void) {
+#if ENABLE_EPoll
+    if (use_reactor) {
+        reactor_wakeup();
+        return;
+    }
+#endif
     check_error(pthread_mutex_lock(&event_lock));
-    if (cancel_handler == handler && cancel_arg == arg) {
-        cancel_handler = NULL;
+    check_error(pthread_cond_signal(&event_cond));
+    check_error(pthread_mutex_unlock(&event_lock));
+}
+
+static void push_posted_event(event_node * ev) {
+    event_node * head = NULL;
+    int idle = 0;
+    int cancel = 0;
+
+    posted_lock();
+#if ENABLE_LockFreeEvents
+    head = __atomic_load_n(&posted_queue, __ATOMIC_RELAXED);
+    do ev->next = head;
+    while (!__atomic_compare_exchange_n(&posted_queue, &head, ev, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+#else
+    head = posted_queue;
+    ev->next = head;
+    posted_queue = ev;
+#endif
+    idle = atomic_get(dispatch_idle);
+    cancel = atomic_get(cancel_waiting);
+    posted_unlock();
+
+    if (head == NULL && idle) wakeup_dispatch_thread();
+    if (cancel) {
+        check_error(pthread_mutex_lock(&event_lock));
         check_error(pthread_cond_signal(&cancel_cond));
         check_error(pthread_mutex_unlock(&event_lock));
-        return;
     }
-    alloc_event_node_bg(ev);
-    ev->runtime = runtime;
-    ev->handler = handler;
-    ev->arg = arg;
+}
 
-    prev = NULL;
-    next = timer_queue;
-    while (next != NULL && time_cmp(&ev->runtime, &next->runtime) >= 0) {
-        prev = next;
-        next = next->next;
+/* Take events posted by background threads, put them into timer wheel or the list of due timers */
+static void take_posted_events(const struct timespec * timenow) {
+    event_node * ev = NULL;
+    event_node * list = NULL;
+#if ENABLE_EventStatistics
+    unsigned cnt = 0;
+#endif
+
+    if (atomic_get(posted_queue) == NULL) return;
+#if ENABLE_LockFreeEvents
+    ev = __atomic_exchange_n(&posted_queue, NULL, __ATOMIC_SEQ_CST);
+#else
+    posted_lock();
+    ev = posted_queue;
+    posted_queue = NULL;
+    posted_unlock();
+#endif
+    /* Restore posting order */
+    while (ev != NULL) {
+        event_node * next = ev->next;
+        ev->next = list;
+        list = ev;
+        ev = next;
+#if ENABLE_EventStatistics
+        cnt++;
+#endif
     }
-    ev->next = next;
-    if (prev == NULL) {
-        timer_queue = ev;
-        check_error(pthread_cond_signal(&event_cond));
+#if ENABLE_EventStatistics
+    if (cnt > event_loop_stats.posted_batch_max) event_loop_stats.posted_batch_max = cnt;
+#endif
+    while (list != NULL) {
+        ev = list;
+        list = ev->next;
+        if (time_cmp(&ev->runtime, timenow) <= 0) timer_list_add(&timers_due, ev);
+        else timer_add(ev);
     }
-    else {
-        prev->next = ev;
+}
+
+/* Wait until next timer is due or a background thread posts an event */
+static void wait_for_events(const struct timespec * timenow) {
+    uint64_t tick = 0;
+    int has_timer = timer_next(&tick);
+    uint64_t now = time_to_tick(timenow);
+
+    if (has_timer && tick <= now) return;
+#if ENABLE_EPoll
+    if (use_reactor) {
+        int empty = 0;
+        posted_lock();
+        atomic_set(dispatch_idle, 1);
+        empty = atomic_get(posted_queue) == NULL;
+        posted_unlock();
+        if (empty) reactor_wait(has_timer ? (int)(tick - now) : -1);
+        atomic_set(dispatch_idle, 0);
+        return;
     }
+#endif
+    check_error(pthread_mutex_lock(&event_lock));
+    atomic_set(dispatch_idle, 1);
+    if (atomic_get(posted_queue) == NULL) {
+        if (has_timer) {
+            struct timespec runtime;
+            int error = 0;
+            runtime.tv_sec = (time_t)(tick / 1000);
+            runtime.tv_nsec = (long)(tick % 1000) * 1000000;
+            error = pthread_cond_timedwait(&event_cond, &event_lock, &runtime);
+            if (error && error != ETIMEDOUT) check_error(error);
+        }
+        else {
+            check_error(pthread_cond_wait(&event_cond, &event_lock));
+        }
+    }
+    atomic_set(dispatch_idle, 0);
+    check_error(pthread_mutex_unlock(&event_lock));
+}
+
+static void post_from_bg_thread(EventCallBack * handler, void * arg, unsigned long delay) {
+    /* Plain loc_alloc(): in default configuration it is libc malloc(), which does not take agent locks.
+     * With ENABLE_SlabAlloc it locks the slab allocator, like allocation of event arguments does */
+    event_node * ev = (event_node *)loc_alloc(sizeof(event_node));
+
+    if (clock_gettime(EVENTS_CLOCK_TYPE, &ev->runtime)) check_error(errno);
+    time_add_usec(&ev->runtime, delay);
+    ev->handler = handler;
+    ev->arg = arg;
+
     trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR ", runtime %02u:%02u.%03u",
         (uintptr_t)ev, (uintptr_t)ev->handler, (uintptr_t)ev->arg,
         (unsigned)(ev->runtime.tv_sec / 60 % 60),
         (unsigned)(ev->runtime.tv_sec % 60),
         (unsigned)(ev->runtime.tv_nsec / 1000000));
-    check_error(pthread_mutex_unlock(&event_lock));
+    push_posted_event(ev);
 }
 
 void post_event_with_delay(EventCallBack * handler, void * arg, unsigned long delay) {
-    if (is_event_thread && cancel_handler == NULL) {
+    if (is_event_thread) {
         event_node * ev;
-        event_node * next;
-        event_node * prev;
-        struct timespec runtime;
-
-        if (clock_gettime(EVENTS_CLOCK_TYPE, &runtime)) check_error(errno);
-        time_add_usec(&runtime, delay);
 
         alloc_event_node(ev);
-        ev->runtime = runtime;
+        if (clock_gettime(EVENTS_CLOCK_TYPE, &ev->runtime)) check_error(errno);
+        time_add_usec(&ev->runtime, delay);
         ev->handler = handler;
         ev->arg = arg;
 
-        check_error(pthread_mutex_lock(&event_lock));
-
-        prev = NULL;
-        next = timer_queue;
-        while (next != NULL && time_cmp(&ev->runtime, &next->runtime) >= 0) {
-            prev = next;
-            next = next->next;
-        }
-        ev->next = next;
-        if (prev == NULL) {
-            timer_queue = ev;
-        }
-        else {
-            prev->next = ev;
-        }
-        check_error(pthread_mutex_unlock(&event_lock));
+        if (delay == 0) timer_list_add(&timers_due, ev);
+        else timer_add(ev);
 
         trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR ", runtime %02u%02u.%03u",
             (uintptr_t)ev, (uintptr_t)ev->handler, (uintptr_t)ev->arg,
@@ -239,7 +543,7 @@ void post_event_with_delay(EventCallBack * handler, void * arg, unsigned long de
 }
 
 void post_event(EventCallBack * handler, void * arg) {
-    if (is_event_thread && cancel_handler == NULL) {
+    if (is_event_thread) {
         event_node * ev;
 
         alloc_event_node(ev);
@@ -256,6 +560,9 @@ void post_event(EventCallBack * handler, void * arg) {
             event_last->next = ev;
             event_last = ev;
         }
+#if ENABLE_EventStatistics
+        update_queue_depth(1);
+#endif
         trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR,
             (uintptr_t)ev, (uintptr_t)ev->handler, (uintptr_t)ev->arg);
     }
@@ -264,15 +571,11 @@ void post_event(EventCallBack * handler, void * arg) {
     }
 }
 
-int cancel_event(EventCallBack * handler, void * arg, int wait) {
+static int remove_event(EventCallBack * handler, void * arg) {
     event_node * ev;
     event_node * prev;
+    struct timespec timenow;
 
-    assert(is_dispatch_thread());
-    assert(handler != NULL);
-    assert(cancel_handler == NULL);
-
-    trace(LOG_EVENTCORE, "cancel_event: handler %#" PRIxPTR ", arg %#" PRIxPTR ", wait %d", (uintptr_t)handler, (uintptr_t)arg, wait);
     prev = NULL;
     ev = event_queue;
     while (ev != NULL) {
@@ -288,42 +591,44 @@ int cancel_event(EventCallBack * handler, void * arg, int wait) {
                 prev->next = ev->next;
             }
             free_event_node(ev);
+#if ENABLE_EventStatistics
+            event_loop_stats.queue_depth--;
+#endif
             return 1;
         }
         prev = ev;
         ev = ev->next;
     }
 
-    check_error(pthread_mutex_lock(&event_lock));
-    prev = NULL;
-    ev = timer_queue;
-    while (ev != NULL) {
-        if (ev->handler == handler && ev->arg == arg) {
-            if (prev == NULL) {
-                timer_queue = ev->next;
-            }
-            else {
-                prev->next = ev->next;
-            }
-            free_event_node(ev);
-            check_error(pthread_mutex_unlock(&event_lock));
-            return 1;
-        }
-        prev = ev;
-        ev = ev->next;
+    if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
+    take_posted_events(&timenow);
+    ev = timer_remove(handler, arg);
+    if (ev != NULL) {
+        free_event_node(ev);
+        return 1;
     }
+    return 0;
+}
 
-    if (!wait) {
+int cancel_event(EventCallBack * handler, void * arg, int wait) {
+    assert(is_dispatch_thread());
+    assert(handler != NULL);
+
+    trace(LOG_EVENTCORE, "cancel_event: handler %#" PRIxPTR ", arg %#" PRIxPTR ", wait %d", (uintptr_t)handler, (uintptr_t)arg, wait);
+    if (remove_event(handler, arg)) return 1;
+    if (!wait) return 0;
+
+    /* Wait until a background thread posts the event */
+    for (;;) {
+        check_error(pthread_mutex_lock(&event_lock));
+        atomic_set(cancel_waiting, 1);
+        if (atomic_get(posted_queue) == NULL) {
+            check_error(pthread_cond_wait(&cancel_cond, &event_lock));
+        }
+        atomic_set(cancel_waiting, 0);
         check_error(pthread_mutex_unlock(&event_lock));
-        return 0;
+        if (remove_event(handler, arg)) return 1;
     }
-
-    cancel_handler = handler;
-    cancel_arg = arg;
-    do check_error(pthread_cond_wait(&cancel_cond, &event_lock));
-    while (cancel_handler != NULL);
-    check_error(pthread_mutex_unlock(&event_lock));
-    return 1;
 }
 
 int is_dispatch_thread(void) {
@@ -331,6 +636,7 @@ int is_dispatch_thread(void) {
 }
 
 void ini_events_queue(void) {
+    struct timespec timenow;
     event_thread = current_thread;
     check_error(pthread_mutex_init(&event_lock, NULL));
 #if USE_CLOCK_MONOTONIC
@@ -349,15 +655,23 @@ void ini_events_queue(void) {
     {
         int i;
         assert(free_queue == NULL);
-        assert(free_bg_queue == NULL);
         for (i = 0; i < EVENT_BUF_SIZE; i++) {
             event_node * ev = event_buf + i;
             ev->next = free_queue;
             free_queue = ev;
         }
     }
+#endif
+    if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
+    wheel_tick = time_to_tick(&timenow);
+#if ENABLE_EventStatistics
+    event_loop_stats.reset_time_ns = event_stats_time();
 #endif
     exit_event = (event_node *)loc_alloc_zero(sizeof(event_node));
+#if ENABLE_EPoll
+    if (ini_reactor() == 0) use_reactor = 1;
+    else trace(LOG_ALWAYS, "Cannot initialize epoll() reactor: %s", errno_to_str(errno));
+#endif
 }
 
 void cancel_event_loop(void) {
@@ -375,15 +689,19 @@ static void exit_event_handler(void * args) {
 
 void exit_event_loop(void) {
     /* Note: need to wake main thread in case exit_event_loop() is called from signal handler */
+    event_node * ev = NULL;
+#if ENABLE_LockFreeEvents
+    ev = __atomic_exchange_n(&exit_event, NULL, __ATOMIC_SEQ_CST);
+#else
     check_error(pthread_mutex_lock(&event_lock));
-    if (exit_event != NULL) {
-        exit_event->handler = exit_event_handler;
-        exit_event->next = timer_queue;
-        timer_queue = exit_event;
-        exit_event = NULL;
-        check_error(pthread_cond_signal(&event_cond));
-    }
+    ev = exit_event;
+    exit_event = NULL;
     check_error(pthread_mutex_unlock(&event_lock));
+#endif
+    if (ev != NULL) {
+        ev->handler = exit_event_handler;
+        push_posted_event(ev);
+    }
 }
 
 void run_event_loop(void) {
@@ -400,55 +718,41 @@ void run_event_loop(void) {
         event_node * ev = NULL;
 
         if (event_queue == NULL || event_cnt >= 100 || (event_cnt >= 1 && events_timer_ms - last_tick_count_ms >= 100)) {
-            check_error(pthread_mutex_lock(&event_lock));
-            event_cnt = 0;
-#if ENABLE_FastMemAlloc
-            while (free_queue != NULL && (free_bg_queue == NULL || free_bg_queue->next == NULL)) {
-                event_node * x = free_queue;
-                free_queue = x->next;
-                x->next = free_bg_queue;
-                free_bg_queue = x;
-            }
+#if ENABLE_EPoll
+            /* Don't let a busy event queue starve I/O */
+            if (use_reactor && event_queue != NULL) reactor_wait(0);
 #endif
+            event_cnt = 0;
             for (;;) {
+                struct timespec timenow;
                 last_tick_count_ms = events_timer_ms;
-                if ((ev = timer_queue) != NULL) {
-                    struct timespec timenow;
-                    event_node * evlast = NULL;
-                    if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
-                    while (ev != NULL && time_cmp(&ev->runtime, &timenow) <= 0) {
-                        evlast = ev;
-                        ev = ev->next;
-                    }
-                    if (evlast != NULL) {
-                        /* Move timed events that are ready to the
-                         * beginning of the untimed event queue. */
-                        ev = timer_queue;
-                        timer_queue = evlast->next;
-                        evlast->next = event_queue;
-                        if (event_queue == NULL) {
-                            assert(event_last == NULL);
-                            event_last = evlast;
-                        }
-                        event_queue = ev;
-                        break;
-                    }
+                if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
+                take_posted_events(&timenow);
+                timer_run(time_to_tick(&timenow));
+#if ENABLE_EventStatistics
+                event_loop_stats.timers = wheel_cnt;
+                if (wheel_cnt > event_loop_stats.timers_max) event_loop_stats.timers_max = wheel_cnt;
+#endif
+                if (timers_due.first != NULL) {
+                    /* Move timed events that are ready to the
+                     * beginning of the untimed event queue. */
+#if ENABLE_EventStatistics
+                    unsigned cnt = 0;
+                    for (ev = timers_due.first; ev != NULL; ev = ev->next) cnt++;
+                    update_queue_depth(cnt);
+#endif
+                    timers_due.last->next = event_queue;
                     if (event_queue == NULL) {
-                        int error = pthread_cond_timedwait(&event_cond, &event_lock, &timer_queue->runtime);
-                        if (error && error != ETIMEDOUT) check_error(error);
-                    }
-                    else {
-                        break;
+                        assert(event_last == NULL);
+                        event_last = timers_due.last;
                     }
-                }
-                else if (event_queue == NULL) {
-                    check_error(pthread_cond_wait(&event_cond, &event_lock));
-                }
-                else {
+                    event_queue = timers_due.first;
+                    timers_due.first = timers_due.last = NULL;
                     break;
                 }
+                if (event_queue != NULL) break;
+                wait_for_events(&timenow);
             }
-            check_error(pthread_mutex_unlock(&event_lock));
         }
 
         ev = event_queue;
@@ -466,7 +770,30 @@ void run_event_loop(void) {
              * can cause starvation of the main queue */
             event_cnt++;
         }
+#if ENABLE_EventStatistics
+        event_loop_stats.events++;
+        event_loop_stats.queue_depth_sum += event_loop_stats.queue_depth;
+        event_loop_stats.queue_depth--;
+        if (event_stats_enabled) {
+            /* Timing needs two clock reads per event, it is collected only when enabled at run time */
+            struct timespec timenow;
+            uint64_t t0 = 0;
+            if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
+            t0 = time_to_ns(&timenow);
+            if (ev->runtime.tv_sec != 0 || ev->runtime.tv_nsec != 0) {
+                uint64_t due = time_to_ns(&ev->runtime);
+                latency_statistics_add(&event_loop_stats.lag, t0 > due ? t0 - due : 0);
+            }
+            ev->handler(ev->arg);
+            if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
+            event_stats_add_handler_time((void *)ev->handler, time_to_ns(&timenow) - t0);
+        }
+        else {
+            ev->handler(ev->arg);
+        }
+#else
         ev->handler(ev->arg);
+#endif
         free_event_node(ev);
     }
 }
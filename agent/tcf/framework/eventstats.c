@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Event loop statistics, see eventstats.h
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_EventStatistics
+
+#include <time.h>
+#include <assert.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/eventstats.h>
+
+typedef struct HandlerStatistics {
+    void * handler;
+    LatencyStatistics stats;
+} HandlerStatistics;
+
+typedef struct CommandStatistics {
+    char * service;
+    char * name;
+    LatencyStatistics stats;
+} CommandStatistics;
+
+EventLoopStatistics event_loop_stats;
+int event_stats_enabled = 0;
+
+/* Open addressing hash table, keyed by handler address */
+static HandlerStatistics * handlers = NULL;
+static unsigned handlers_max = 0;
+static unsigned handlers_cnt = 0;
+
+static CommandStatistics ** commands = NULL;
+static unsigned commands_max = 0;
+static unsigned commands_cnt = 0;
+
+void latency_statistics_add(LatencyStatistics * s, uint64_t ns) {
+    uint64_t us = ns / 1000;
+    unsigned n = 0;
+    while (us != 0 && n < LATENCY_HISTOGRAM_SIZE - 1) {
+        us >>= 1;
+        n++;
+    }
+    s->histogram[n]++;
+    s->count++;
+    s->total_ns += ns;
+    if (s->max_ns < ns) s->max_ns = ns;
+}
+
+uint64_t event_stats_time(void) {
+    struct timespec t;
+#if defined(CLOCK_MONOTONIC)
+    if (clock_gettime(CLOCK_MONOTONIC, &t)) check_error(errno);
+#else
+    if (clock_gettime(CLOCK_REALTIME, &t)) check_error(errno);
+#endif
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static unsigned handler_hash(void * handler) {
+    uintptr_t h = (uintptr_t)handler;
+    h ^= h >> 16;
+    return (unsigned)(h * 0x9e3779b1u);
+}
+
+static HandlerStatistics * find_handler(void * handler) {
+    unsigned mask = handlers_max - 1;
+    unsigned i = handler_hash(handler) & mask;
+    for (;;) {
+        HandlerStatistics * h = handlers + i;
+        if (h->handler == handler || h->handler == NULL) return h;
+        i = (i + 1) & mask;
+    }
+}
+
+void event_stats_add_handler_time(void * handler, uint64_t ns) {
+    HandlerStatistics * h = NULL;
+
+    assert(is_dispatch_thread());
+    if (handlers_cnt * 2 >= handlers_max) {
+        HandlerStatistics * old = handlers;
+        unsigned old_max = handlers_max;
+        unsigned i;
+        handlers_max = handlers_max ? handlers_max * 2 : 256;
+        handlers = (HandlerStatistics *)loc_alloc_zero(sizeof(HandlerStatistics) * handlers_max);
+        for (i = 0; i < old_max; i++) {
+            if (old[i].handler == NULL) continue;
+            *find_handler(old[i].handler) = old[i];
+        }
+        loc_free(old);
+    }
+    h = find_handler(handler);
+    if (h->handler == NULL) {
+        h->handler = handler;
+        handlers_cnt++;
+    }
+    latency_statistics_add(&h->stats, ns);
+}
+
+LatencyStatistics * event_stats_get_command(const char * service, const char * name) {
+    CommandStatistics * c = NULL;
+    unsigned i;
+
+    assert(is_dispatch_thread());
+    for (i = 0; i < commands_cnt; i++) {
+        c = commands[i];
+        if (strcmp(c->service, service) == 0 && strcmp(c->name, name) == 0) return &c->stats;
+    }
+    if (commands_cnt >= commands_max) {
+        commands_max = commands_max ? commands_max * 2 : 64;
+        commands = (CommandStatistics **)loc_realloc(commands, sizeof(CommandStatistics *) * commands_max);
+    }
+    c = (CommandStatistics *)loc_alloc_zero(sizeof(CommandStatistics));
+    c->service = loc_strdup(service);
+    c->name = loc_strdup(name);
+    commands[commands_cnt++] = c;
+    return &c->stats;
+}
+
+void event_stats_iterate_handlers(EventHandlerStatisticsCallBack * call_back, void * args) {
+    unsigned i;
+    for (i = 0; i < handlers_max; i++) {
+        HandlerStatistics * h = handlers + i;
+        if (h->handler == NULL || h->stats.count == 0) continue;
+        call_back(h->handler, &h->stats, args);
+    }
+}
+
+void event_stats_iterate_commands(CommandStatisticsCallBack * call_back, void * args) {
+    unsigned i;
+    for (i = 0; i < commands_cnt; i++) {
+        CommandStatistics * c = commands[i];
+        if (c->stats.count == 0) continue;
+        call_back(c->service, c->name, &c->stats, args);
+    }
+}
+
+void event_stats_enable(int enable) {
+    assert(is_dispatch_thread());
+    if (enable && !event_stats_enabled) event_stats_reset();
+    event_stats_enabled = enable != 0;
+}
+
+void event_stats_reset(void) {
+    unsigned i;
+    for (i = 0; i < handlers_max; i++) {
+        memset(&handlers[i].stats, 0, sizeof(LatencyStatistics));
+    }
+    for (i = 0; i < commands_cnt; i++) {
+        memset(&commands[i]->stats, 0, sizeof(LatencyStatistics));
+    }
+    memset(&event_loop_stats.lag, 0, sizeof(LatencyStatistics));
+    event_loop_stats.events = 0;
+    event_loop_stats.queue_depth_sum = 0;
+    event_loop_stats.queue_depth_max = event_loop_stats.queue_depth;
+    event_loop_stats.timers_max = event_loop_stats.timers;
+    event_loop_stats.posted_batch_max = 0;
+    event_loop_stats.reset_time_ns = event_stats_time();
+}
+
+#endif /* ENABLE_EventStatistics */
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Event loop statistics: time spent in event handlers and command handlers,
+ * dispatch lag of timed events and event queue depth.
+ *
+ * The statistics are collected by the event loop and the protocol layer,
+ * and are accessed by the dispatch thread only.
+ * Diagnostics service reports them, see Diagnostics.getEventStatistics command,
+ * and starts timing collection, see Diagnostics.setEventStatistics command.
+ */
+
+#ifndef D_eventstats
+#define D_eventstats
+
+#include <tcf/config.h>
+
+#if ENABLE_EventStatistics
+
+/*
+ * Number of histogram buckets. Bucket 0 counts samples shorter than 1us,
+ * bucket N counts samples in range [2^(N-1), 2^N) us, the last bucket also counts all longer samples.
+ */
+#define LATENCY_HISTOGRAM_SIZE 24
+
+typedef struct LatencyStatistics {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t histogram[LATENCY_HISTOGRAM_SIZE];
+} LatencyStatistics;
+
+typedef struct EventLoopStatistics {
+    LatencyStatistics lag;      /* Delay between due time of timed or background events and dispatch */
+    uint64_t events;            /* Number of dispatched events */
+    uint64_t queue_depth_sum;   /* Sum of queue depth sampled at each dispatch */
+    unsigned queue_depth;       /* Current number of events in the queue */
+    unsigned queue_depth_max;
+    unsigned timers;            /* Current number of pending timed events */
+    unsigned timers_max;
+    unsigned posted_batch_max;  /* Max number of events taken from background threads at once */
+    uint64_t reset_time_ns;     /* Time of last statistics reset */
+} EventLoopStatistics;
+
+extern EventLoopStatistics event_loop_stats;
+
+/*
+ * Non-zero if timing of event handlers, commands and dispatch lag is collected.
+ * Queue depth counters are always maintained, timing costs two clock reads
+ * per event and per command, so it is off until enabled at run time.
+ */
+extern int event_stats_enabled;
+
+/* Start or stop timing collection, starting it also clears all counters */
+extern void event_stats_enable(int enable);
+
+/* Add a sample to latency statistics */
+extern void latency_statistics_add(LatencyStatistics * s, uint64_t ns);
+
+/* Current time in nanoseconds, monotonic if the system supports it */
+extern uint64_t event_stats_time(void);
+
+/* Add handler execution time, 'handler' is address of event callback function */
+extern void event_stats_add_handler_time(void * handler, uint64_t ns);
+
+/*
+ * Get statistics of a command handler. The returned pointer remains valid
+ * until the agent exits, the protocol layer caches it.
+ */
+extern LatencyStatistics * event_stats_get_command(const char * service, const char * name);
+
+typedef void EventHandlerStatisticsCallBack(void * handler, LatencyStatistics * s, void * args);
+typedef void CommandStatisticsCallBack(const char * service, const char * name, LatencyStatistics * s, void * args);
+
+/* Call 'call_back' for each event handler that has statistics */
+extern void event_stats_iterate_handlers(EventHandlerStatisticsCallBack * call_back, void * args);
+
+/* Call 'call_back' for each command that has statistics */
+extern void event_stats_iterate_commands(CommandStatisticsCallBack * call_back, void * args);
+
+/* Clear all counters */
+extern void event_stats_reset(void);
+
+#endif /* ENABLE_EventStatistics */
+
+#endif /* D_eventstats */
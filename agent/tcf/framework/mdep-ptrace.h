@@ -55,4 +55,13 @@
 #  define PTRACE_EVENT_EXIT       6
 #endif
 
+#if !defined(PTRACE_SEIZE)
+#  define PTRACE_SEIZE            0x4206
+#  define PTRACE_INTERRUPT        0x4207
+#endif
+
+#if !defined(PTRACE_EVENT_STOP)
+#  define PTRACE_EVENT_STOP       128
+#endif
+
 #endif /* D_mdep_ptrace */
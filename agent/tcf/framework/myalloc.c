@@ -22,6 +22,8 @@
 #include <string.h>
 #include <stdarg.h>
 #include <tcf/framework/link.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/trace.h>
 #include <tcf/framework/events.h>
 #include <tcf/framework/myalloc.h>
@@ -44,16 +46,215 @@ static size_t tmp_pool_max = 0;
 static size_t tmp_pool_avr = 0;
 #endif
 
+#if !ENABLE_FastMemAlloc
+/* Header of a tmp block: list link and block size, padded to keep malloc() alignment */
+#define TMP_HDR_ALIGNMENT   16
+#define TMP_HDR_SIZE        ((sizeof(LINK) + sizeof(size_t) + TMP_HDR_ALIGNMENT - 1) & ~(TMP_HDR_ALIGNMENT - 1))
+#endif
+
 static LINK tmp_alloc_list = TCF_LIST_INIT(tmp_alloc_list);
 static size_t tmp_alloc_size = 0;
 static int tmp_gc_posted = 0;
 
+#define ARENA_CHUNK_SIZE    0x4000
+#define ARENA_KEEP_SIZE     (0x40000 * MEM_USAGE_FACTOR)
+#define ARENA_KEEP_CNT      8
+
+typedef struct ArenaChunk ArenaChunk;
+
+struct ArenaChunk {
+    ArenaChunk * next;
+    size_t size;
+};
+
+struct MemArena {
+    ArenaChunk * first;
+    ArenaChunk * cur;
+    size_t pos;
+    size_t chunk_size;
+    size_t total;
+    MemArena * next;
+};
+
+#define ARENA_HDR_SIZE ((sizeof(ArenaChunk) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+#if defined(_MSC_VER)
+#  define ARENA_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#  define ARENA_THREAD_LOCAL __thread
+#else
+/* No thread local storage, arenas can be made current only by the dispatch thread */
+#  define ARENA_THREAD_LOCAL
+#  define ARENA_DISPATCH_ONLY
+#endif
+
+static ARENA_THREAD_LOCAL MemArena * current_arena = NULL;
+static MemArena * arena_free_list = NULL;
+static MemArena * arena_retired_list = NULL;
+static unsigned arena_free_cnt = 0;
+
 static void gc_event(void * args) {
     tmp_gc_posted = 0;
     tmp_gc();
 }
 
+static void post_gc_event(void) {
+    if (!tmp_gc_posted) {
+        post_event(gc_event, NULL);
+        tmp_gc_posted = 1;
+    }
+}
+
+MemArena * arena_create(size_t chunk_size) {
+    MemArena * arena = (MemArena *)loc_alloc_zero(sizeof(MemArena));
+    if (chunk_size == 0) chunk_size = ARENA_CHUNK_SIZE;
+    if (chunk_size < ARENA_HDR_SIZE * 4) chunk_size = ARENA_HDR_SIZE * 4;
+    arena->chunk_size = chunk_size;
+    arena->pos = ARENA_HDR_SIZE;
+    return arena;
+}
+
+void * arena_alloc(MemArena * arena, size_t size) {
+    for (;;) {
+        ArenaChunk * c = arena->cur;
+        if (c != NULL) {
+            size_t pos = arena->pos + sizeof(size_t);
+            pos = (pos + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            if (pos + size <= c->size) {
+                char * p = (char *)c + pos;
+                *((size_t *)p - 1) = size;
+                arena->pos = pos + size;
+                return p;
+            }
+            if (c->next != NULL) {
+                /* Reuse chunks that were kept by arena_reset() or arena_release() */
+                arena->cur = c->next;
+                arena->pos = ARENA_HDR_SIZE;
+                continue;
+            }
+        }
+        else if (arena->first != NULL) {
+            arena->cur = arena->first;
+            arena->pos = ARENA_HDR_SIZE;
+            continue;
+        }
+        {
+            size_t n = ARENA_HDR_SIZE + sizeof(size_t) + ALIGNMENT + size;
+            ArenaChunk * x = NULL;
+            if (n < arena->chunk_size) n = arena->chunk_size;
+            x = (ArenaChunk *)loc_alloc(n);
+            x->next = NULL;
+            x->size = n;
+            if (c != NULL) c->next = x;
+            else arena->first = x;
+            arena->cur = x;
+            arena->pos = ARENA_HDR_SIZE;
+            arena->total += n;
+        }
+    }
+}
+
+void * arena_alloc_zero(MemArena * arena, size_t size) {
+    return memset(arena_alloc(arena, size), 0, size);
+}
+
+void * arena_realloc(MemArena * arena, void * ptr, size_t size) {
+    void * p;
+    size_t m;
+    if (ptr == NULL) return arena_alloc(arena, size);
+    m = *((size_t *)ptr - 1);
+    if (m >= size) return ptr;
+    if (arena->cur != NULL) {
+        char * base = (char *)arena->cur;
+        size_t pos = arena->pos - m;
+        if (ptr == base + pos && pos + size <= arena->cur->size) {
+            arena->pos = pos + size;
+            *((size_t *)ptr - 1) = size;
+            return ptr;
+        }
+    }
+    p = arena_alloc(arena, size);
+    return memcpy(p, ptr, m);
+}
+
+void arena_mark(MemArena * arena, MemArenaMark * mark) {
+    mark->chunk = arena->cur;
+    mark->pos = arena->pos;
+}
+
+void arena_release(MemArena * arena, MemArenaMark * mark) {
+    arena->cur = (ArenaChunk *)mark->chunk;
+    arena->pos = mark->pos;
+}
+
+void arena_reset(MemArena * arena) {
+    arena->cur = arena->first;
+    arena->pos = ARENA_HDR_SIZE;
+}
+
+size_t arena_size(MemArena * arena) {
+    return arena->total;
+}
+
+void arena_dispose(MemArena * arena) {
+    assert(arena != current_arena);
+    while (arena->first != NULL) {
+        ArenaChunk * c = arena->first;
+        arena->first = c->next;
+        loc_free(c);
+    }
+    loc_free(arena);
+}
+
+MemArena * arena_enter(MemArena * arena) {
+    MemArena * prev = current_arena;
+#ifdef ARENA_DISPATCH_ONLY
+    assert(is_dispatch_thread());
+#endif
+    current_arena = arena;
+    return prev;
+}
+
+void arena_exit(MemArena * prev) {
+    current_arena = prev;
+}
+
+MemArena * arena_current(void) {
+    return current_arena;
+}
+
+MemArena * tmp_arena_create(void) {
+    MemArena * arena = arena_free_list;
+    assert(is_dispatch_thread());
+    if (arena == NULL) return arena_create(0);
+    arena_free_list = arena->next;
+    arena_free_cnt--;
+    arena->next = NULL;
+    return arena;
+}
+
+void tmp_arena_dispose(MemArena * arena) {
+    assert(is_dispatch_thread());
+    assert(arena != current_arena);
+    arena->next = arena_retired_list;
+    arena_retired_list = arena;
+    post_gc_event();
+}
+
 void tmp_gc(void) {
+    while (arena_retired_list != NULL) {
+        MemArena * arena = arena_retired_list;
+        arena_retired_list = arena->next;
+        if (arena_free_cnt >= ARENA_KEEP_CNT || arena->total > ARENA_KEEP_SIZE) {
+            arena_dispose(arena);
+        }
+        else {
+            arena_reset(arena);
+            arena->next = arena_free_list;
+            arena_free_list = arena;
+            arena_free_cnt++;
+        }
+    }
 #if ENABLE_FastMemAlloc
     if (tmp_pool_pos + tmp_alloc_size >= tmp_pool_avr) {
         tmp_pool_avr = tmp_pool_pos + tmp_alloc_size;
@@ -84,11 +285,9 @@ void tmp_gc(void) {
 void * tmp_alloc(size_t size) {
     void * p;
     LINK * l;
+    if (current_arena != NULL) return arena_alloc(current_arena, size);
     assert(is_dispatch_thread());
-    if (!tmp_gc_posted) {
-        post_event(gc_event, NULL);
-        tmp_gc_posted = 1;
-    }
+    post_gc_event();
 #if ENABLE_FastMemAlloc
     if (tmp_pool_pos + size + ALIGNMENT + sizeof(size_t *) > tmp_pool_max) {
         if (tmp_pool != NULL) {
@@ -107,10 +306,11 @@ void * tmp_alloc(size_t size) {
     tmp_pool_pos += size;
     return p;
 #else
-    l = (LINK *)loc_alloc(sizeof(LINK) + size);
+    l = (LINK *)loc_alloc(TMP_HDR_SIZE + size);
     list_add_last(l, &tmp_alloc_list);
-    tmp_alloc_size += size + ALIGNMENT + sizeof(size_t *);
-    p = l + 1;
+    tmp_alloc_size += TMP_HDR_SIZE + size;
+    p = (char *)l + TMP_HDR_SIZE;
+    *((size_t *)p - 1) = size;
     return p;
 #endif
 }
@@ -120,35 +320,27 @@ void * tmp_alloc_zero(size_t size) {
 }
 
 void * tmp_realloc(void * ptr, size_t size) {
+    void * p;
+    size_t m;
     if (ptr == NULL) return tmp_alloc(size);
+    if (current_arena != NULL) return arena_realloc(current_arena, ptr, size);
     assert(is_dispatch_thread());
     assert(tmp_gc_posted);
+    /* All tmp blocks, including arena blocks, keep block size just before the block */
+    m = *((size_t *)ptr - 1);
+    if (m >= size) return ptr;
 #if ENABLE_FastMemAlloc
-    {
-        void * p;
-        size_t m = *((size_t *)ptr - 1);
-        if (m >= size) return ptr;
-        if ((char *)ptr >= tmp_pool && (char *)ptr <= tmp_pool + tmp_pool_max) {
-            size_t pos = tmp_pool_pos - m;
-            if (ptr == tmp_pool + pos && pos + size <= tmp_pool_max) {
-                tmp_pool_pos = pos + size;
-                *((size_t *)ptr - 1) = size;
-                return ptr;
-            }
+    if ((char *)ptr >= tmp_pool && (char *)ptr <= tmp_pool + tmp_pool_max) {
+        size_t pos = tmp_pool_pos - m;
+        if (ptr == tmp_pool + pos && pos + size <= tmp_pool_max) {
+            tmp_pool_pos = pos + size;
+            *((size_t *)ptr - 1) = size;
+            return ptr;
         }
-        p = tmp_alloc(size);
-        if (m > size) m = size;
-        return memcpy(p, ptr, m);
-    }
-#else
-    {
-        LINK * l = (LINK *)ptr - 1;
-        list_remove(l);
-        l = (LINK *)loc_realloc(l, sizeof(LINK) + size);
-        list_add_last(l, &tmp_alloc_list);
-        return l + 1;
     }
 #endif
+    p = tmp_alloc(size);
+    return memcpy(p, ptr, m);
 }
 
 char * tmp_strdup(const char * s) {
@@ -198,7 +390,420 @@ char * tmp_printf(const char * fmt, ...) {
     return buf;
 }
 
-#if USE_libc_malloc
+#if ENABLE_SlabAlloc && !USE_libc_malloc
+#  error "ENABLE_SlabAlloc requires USE_libc_malloc"
+#endif
+
+#if ENABLE_SlabAlloc
+
+#include <stddef.h>
+#include <stdio.h>
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#  include <sys/mman.h>
+#endif
+
+/*
+ * Size class slab allocator.
+ * Slabs are SLAB_SIZE aligned blocks of memory requested directly from the OS,
+ * each slab holds objects of single size class or single memory pool.
+ * Empty slabs are returned to the OS, except one cached slab per pool.
+ * Blocks larger than SLAB_MAX_OBJ are allocated by libc malloc().
+ * loc_free() finds the slab of a block by address, using a hash set of slab addresses.
+ * Statistics are kept per size class, objects of a typed pool are accounted
+ * in the size class of the pool object size.
+ */
+
+#define SLAB_SIZE       0x10000
+#define SLAB_HDR_SIZE   64
+#define SLAB_MAX_OBJ    2048
+#define SLAB_ALIGNMENT  16
+
+typedef struct Slab {
+    LINK link;
+    MemPool * pool;
+    void * free_list;
+    char * top;
+    unsigned used;
+    unsigned cnt;
+} Slab;
+
+#define link2slab(A) ((Slab *)((char *)(A) - offsetof(Slab, link)))
+
+struct MemPool {
+    char * name;
+    size_t size;
+    LINK partial;
+    Slab * empty;
+    MemPoolStatistics * stats;
+    MemPool * next;
+};
+
+static const size_t class_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+    320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+
+#define CLASS_CNT (sizeof(class_sizes) / sizeof(size_t))
+
+static MemPool classes[CLASS_CNT];
+static MemPoolStatistics class_stats[CLASS_CNT];
+static unsigned char size2class[SLAB_MAX_OBJ / SLAB_ALIGNMENT + 1];
+static MemPool * pools = NULL;
+static pthread_mutex_t slab_lock;
+static int slab_ready = 0;
+
+static uintptr_t * slab_set = NULL;
+static size_t slab_set_max = 0;
+static size_t slab_set_cnt = 0;
+
+static void slab_ini(void) {
+    unsigned i;
+    unsigned c = 0;
+    MemPool ** last = &pools;
+    check_error(pthread_mutex_init(&slab_lock, NULL));
+    for (i = 0; i <= SLAB_MAX_OBJ / SLAB_ALIGNMENT; i++) {
+        while (class_sizes[c] < i * SLAB_ALIGNMENT) c++;
+        size2class[i] = (unsigned char)c;
+    }
+    for (i = 0; i < CLASS_CNT; i++) {
+        MemPool * pool = classes + i;
+        list_init(&pool->partial);
+        pool->size = class_sizes[i];
+        pool->stats = class_stats + i;
+        pool->stats->size = class_sizes[i];
+        *last = pool;
+        last = &pool->next;
+    }
+    slab_ready = 1;
+}
+
+static size_t slab_hash(uintptr_t addr) {
+    addr /= SLAB_SIZE;
+    return (size_t)(addr * 0x9e3779b1u) & (slab_set_max - 1);
+}
+
+static void slab_set_add(uintptr_t addr) {
+    size_t i;
+    if (slab_set_cnt * 2 >= slab_set_max) {
+        uintptr_t * old = slab_set;
+        size_t old_max = slab_set_max;
+        slab_set_max = slab_set_max ? slab_set_max * 2 : 256;
+        if ((slab_set = (uintptr_t *)calloc(slab_set_max, sizeof(uintptr_t))) == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+        slab_set_cnt = 0;
+        for (i = 0; i < old_max; i++) {
+            if (old[i] != 0) slab_set_add(old[i]);
+        }
+        free(old);
+    }
+    i = slab_hash(addr);
+    while (slab_set[i] != 0) i = (i + 1) & (slab_set_max - 1);
+    slab_set[i] = addr;
+    slab_set_cnt++;
+}
+
+static void slab_set_remove(uintptr_t addr) {
+    size_t i = slab_hash(addr);
+    size_t j;
+    while (slab_set[i] != addr) {
+        assert(slab_set[i] != 0);
+        i = (i + 1) & (slab_set_max - 1);
+    }
+    /* Backward shift deletion */
+    j = i;
+    for (;;) {
+        size_t k;
+        j = (j + 1) & (slab_set_max - 1);
+        if (slab_set[j] == 0) break;
+        k = slab_hash(slab_set[j]);
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        slab_set[i] = slab_set[j];
+        i = j;
+    }
+    slab_set[i] = 0;
+    slab_set_cnt--;
+}
+
+static Slab * slab_find(const void * p) {
+    uintptr_t addr = (uintptr_t)p & ~(uintptr_t)(SLAB_SIZE - 1);
+    size_t i;
+    if (slab_set_cnt == 0) return NULL;
+    i = slab_hash(addr);
+    for (;;) {
+        uintptr_t x = slab_set[i];
+        if (x == addr) return (Slab *)x;
+        if (x == 0) return NULL;
+        i = (i + 1) & (slab_set_max - 1);
+    }
+}
+
+static Slab * slab_create(MemPool * pool) {
+    char * mem = NULL;
+    Slab * s = NULL;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    /* VirtualAlloc() address is aligned to allocation granularity, which is 64K */
+    mem = (char *)VirtualAlloc(NULL, SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (mem == NULL) return NULL;
+    if (((uintptr_t)mem & (SLAB_SIZE - 1)) != 0) {
+        VirtualFree(mem, 0, MEM_RELEASE);
+        return NULL;
+    }
+#else
+    {
+        uintptr_t addr = 0;
+        size_t head = 0;
+        mem = (char *)mmap(NULL, SLAB_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == (char *)MAP_FAILED) return NULL;
+        addr = ((uintptr_t)mem + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1);
+        head = addr - (uintptr_t)mem;
+        if (head > 0) munmap(mem, head);
+        munmap((char *)addr + SLAB_SIZE, SLAB_SIZE - head);
+        mem = (char *)addr;
+    }
+#endif
+    s = (Slab *)mem;
+    list_init(&s->link);
+    s->pool = pool;
+    s->free_list = NULL;
+    s->top = mem + SLAB_HDR_SIZE;
+    s->used = 0;
+    s->cnt = (unsigned)((SLAB_SIZE - SLAB_HDR_SIZE) / pool->size);
+    slab_set_add((uintptr_t)s);
+    pool->stats->slabs++;
+    return s;
+}
+
+static void slab_destroy(Slab * s) {
+    slab_set_remove((uintptr_t)s);
+    s->pool->stats->slabs--;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    VirtualFree(s, 0, MEM_RELEASE);
+#else
+    munmap(s, SLAB_SIZE);
+#endif
+}
+
+/* Allocate object from a pool, slab_lock must be locked by the caller */
+static void * slab_alloc(MemPool * pool) {
+    Slab * s = NULL;
+    void * p = NULL;
+    if (list_is_empty(&pool->partial)) {
+        s = pool->empty;
+        if (s != NULL) pool->empty = NULL;
+        else if ((s = slab_create(pool)) == NULL) return NULL;
+        list_add_first(&s->link, &pool->partial);
+    }
+    s = link2slab(pool->partial.next);
+    if (s->free_list != NULL) {
+        p = s->free_list;
+        s->free_list = *(void **)p;
+    }
+    else {
+        p = s->top;
+        s->top += pool->size;
+    }
+    if (++s->used == s->cnt) {
+        /* Full slabs are not kept in any list */
+        list_remove(&s->link);
+        list_init(&s->link);
+    }
+    pool->stats->allocs++;
+    if (++pool->stats->used > pool->stats->used_max) pool->stats->used_max = pool->stats->used;
+    return p;
+}
+
+/* Return object to its slab, slab_lock must be locked by the caller */
+static void slab_free(Slab * s, void * p) {
+    MemPool * pool = s->pool;
+    assert(s->used > 0);
+    if (s->used == s->cnt) list_add_first(&s->link, &pool->partial);
+    *(void **)p = s->free_list;
+    s->free_list = p;
+    pool->stats->frees++;
+    pool->stats->used--;
+    if (--s->used == 0) {
+        list_remove(&s->link);
+        list_init(&s->link);
+        if (pool->empty == NULL) {
+            s->free_list = NULL;
+            s->top = (char *)s + SLAB_HDR_SIZE;
+            pool->empty = s;
+        }
+        else {
+            slab_destroy(s);
+        }
+    }
+}
+
+static void * loc_alloc_slab(size_t size) {
+    void * p = NULL;
+    if (size == 0) size = 1;
+    if (!slab_ready) slab_ini();
+    if (size <= SLAB_MAX_OBJ) {
+        check_error(pthread_mutex_lock(&slab_lock));
+        p = slab_alloc(classes + size2class[(size + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT]);
+        check_error(pthread_mutex_unlock(&slab_lock));
+        if (p != NULL) return p;
+    }
+    if ((p = malloc(size)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    return p;
+}
+
+void * loc_alloc(size_t size) {
+    void * p = loc_alloc_slab(size);
+    trace(LOG_ALLOC, "loc_alloc(%u) = %#" PRIxPTR, (unsigned)size, (uintptr_t)p);
+    return p;
+}
+
+void * loc_alloc_zero(size_t size) {
+    void * p = loc_alloc_slab(size);
+    memset(p, 0, size);
+    trace(LOG_ALLOC, "loc_alloc_zero(%u) = %#" PRIxPTR, (unsigned)size, (uintptr_t)p);
+    return p;
+}
+
+void * loc_realloc(void * ptr, size_t size) {
+    void * p = NULL;
+    Slab * s = NULL;
+
+    if (size == 0) size = 1;
+    if (ptr != NULL && slab_ready) {
+        check_error(pthread_mutex_lock(&slab_lock));
+        s = slab_find(ptr);
+        check_error(pthread_mutex_unlock(&slab_lock));
+    }
+    if (s != NULL) {
+        size_t old_size = s->pool->size;
+        if (size <= old_size) {
+            p = ptr;
+        }
+        else {
+            p = loc_alloc_slab(size);
+            memcpy(p, ptr, old_size);
+            loc_free(ptr);
+        }
+    }
+    else if (ptr == NULL) {
+        p = loc_alloc_slab(size);
+    }
+    else if ((p = realloc(ptr, size)) == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    trace(LOG_ALLOC, "loc_realloc(%#" PRIxPTR ", %u) = %#" PRIxPTR, (uintptr_t)ptr, (unsigned)size, (uintptr_t)p);
+    return p;
+}
+
+void loc_free(const void * p) {
+    Slab * s = NULL;
+    trace(LOG_ALLOC, "loc_free %#" PRIxPTR, (uintptr_t)p);
+    if (p == NULL) return;
+    if (slab_ready) {
+        check_error(pthread_mutex_lock(&slab_lock));
+        s = slab_find(p);
+        if (s != NULL) slab_free(s, (void *)p);
+        check_error(pthread_mutex_unlock(&slab_lock));
+    }
+    if (s == NULL) free((void *)p);
+}
+
+MemPool * mem_pool_create(const char * name, size_t size) {
+    MemPool * pool = NULL;
+    if (!slab_ready) slab_ini();
+    if (size == 0) size = 1;
+    size = (size + SLAB_ALIGNMENT - 1) & ~(size_t)(SLAB_ALIGNMENT - 1);
+    pool = (MemPool *)loc_alloc_zero(sizeof(MemPool));
+    pool->name = loc_strdup(name);
+    list_init(&pool->partial);
+    pool->size = size;
+    /* Pools of objects that are too large for a slab just use loc_alloc() */
+    if (size > SLAB_MAX_OBJ) return pool;
+    pool->stats = class_stats + size2class[size / SLAB_ALIGNMENT];
+    check_error(pthread_mutex_lock(&slab_lock));
+    pool->next = pools;
+    pools = pool;
+    check_error(pthread_mutex_unlock(&slab_lock));
+    return pool;
+}
+
+void * mem_pool_alloc(MemPool * pool) {
+    void * p = NULL;
+    if (pool->size <= SLAB_MAX_OBJ) {
+        check_error(pthread_mutex_lock(&slab_lock));
+        p = slab_alloc(pool);
+        check_error(pthread_mutex_unlock(&slab_lock));
+    }
+    if (p == NULL) p = loc_alloc_slab(pool->size);
+    trace(LOG_ALLOC, "mem_pool_alloc(%s) = %#" PRIxPTR, pool->name, (uintptr_t)p);
+    return p;
+}
+
+void mem_pool_statistics(MemPoolStatisticsCallBack * call_back, void * args) {
+    const char ** names = NULL;
+    unsigned names_max = 0;
+    unsigned i;
+
+    if (!slab_ready) return;
+    for (i = 0; i < CLASS_CNT; i++) {
+        MemPoolStatistics stats;
+        unsigned names_cnt = 0;
+        MemPool * pool = NULL;
+        /* The callback can allocate memory, so it is called with the lock released */
+        check_error(pthread_mutex_lock(&slab_lock));
+        stats = class_stats[i];
+        for (pool = pools; pool != NULL; pool = pool->next) {
+            if (pool->name == NULL || pool->stats != class_stats + i) continue;
+            if (names_cnt >= names_max) {
+                names_max += 8;
+                names = (const char **)realloc(names, sizeof(char *) * names_max);
+                if (names == NULL) {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            /* Pools are never disposed, so the names stay valid */
+            names[names_cnt++] = pool->name;
+        }
+        check_error(pthread_mutex_unlock(&slab_lock));
+        call_back(&stats, names, names_cnt, args);
+    }
+    free(names);
+}
+
+#else /* ENABLE_SlabAlloc */
+
+struct MemPool {
+    char * name;
+    size_t size;
+};
+
+MemPool * mem_pool_create(const char * name, size_t size) {
+    MemPool * pool = (MemPool *)loc_alloc_zero(sizeof(MemPool));
+    pool->name = loc_strdup(name);
+    pool->size = size;
+    return pool;
+}
+
+void * mem_pool_alloc(MemPool * pool) {
+    return loc_alloc(pool->size);
+}
+
+void mem_pool_statistics(MemPoolStatisticsCallBack * call_back, void * args) {
+}
+
+#endif /* ENABLE_SlabAlloc */
+
+void * mem_pool_alloc_zero(MemPool * pool) {
+    void * p = mem_pool_alloc(pool);
+    return memset(p, 0, pool->size);
+}
+
+#if USE_libc_malloc && !ENABLE_SlabAlloc
 
 void * loc_alloc(size_t size) {
     void * p;
@@ -244,7 +849,7 @@ void loc_free(const void * p) {
     free((void *)p);
 }
 
-#endif /* USE_libc_malloc */
+#endif /* USE_libc_malloc && !ENABLE_SlabAlloc */
 
 /* strdup() with end-of-memory checking. */
 char * loc_strdup(const char * s) {
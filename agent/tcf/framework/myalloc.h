@@ -37,9 +37,92 @@ extern char * loc_printf(const char * fmt, ...) ATTR_PRINTF(1, 2);
 
 extern void loc_free(const void * p);
 
+/*
+ * Memory pools for frequently allocated objects of same type.
+ * When ENABLE_SlabAlloc is set, each pool has its own slabs, and objects of
+ * different types don't share memory pages, which reduces heap fragmentation
+ * of long running agents. Otherwise, pools just call loc_alloc().
+ * Pool objects are disposed with loc_free().
+ * mem_pool_create() should be called during initialization or by the dispatch thread,
+ * mem_pool_alloc() can be called by any thread.
+ */
+typedef struct MemPool MemPool;
+
+extern MemPool * mem_pool_create(const char * name, size_t size);
+extern void * mem_pool_alloc(MemPool * pool);
+extern void * mem_pool_alloc_zero(MemPool * pool);
+
+typedef struct MemPoolStatistics {
+    size_t size;        /* Size class */
+    size_t slabs;       /* Number of slabs */
+    size_t used;        /* Number of objects in use */
+    size_t used_max;
+    uint64_t allocs;
+    uint64_t frees;
+} MemPoolStatistics;
+
+typedef void MemPoolStatisticsCallBack(MemPoolStatistics * stats, const char ** pools, unsigned pools_cnt, void * args);
+
+/*
+ * Call 'call_back' for each size class of the slab allocator.
+ * Statistics of a size class include loc_alloc() blocks of the class and
+ * objects of typed pools that fall into the class, 'pools' are names of the typed pools.
+ * Does nothing if ENABLE_SlabAlloc is not set.
+ */
+extern void mem_pool_statistics(MemPoolStatisticsCallBack * call_back, void * args);
+
+/*
+ * Scoped memory arenas.
+ * An arena allocates blocks from a chain of memory chunks by bumping a pointer.
+ * Blocks are not freed individually: arena_reset() releases all blocks in O(1) time,
+ * arena_release() releases blocks allocated after arena_mark().
+ * The chunks are kept by the arena and reused until arena_dispose() is called.
+ * An arena can be used by any thread, but only by one thread at a time.
+ */
+typedef struct MemArena MemArena;
+
+typedef struct MemArenaMark {
+    void * chunk;
+    size_t pos;
+} MemArenaMark;
+
+/* Create an arena, 'chunk_size' can be 0 to use default chunk size */
+extern MemArena * arena_create(size_t chunk_size);
+extern void * arena_alloc(MemArena * arena, size_t size);
+extern void * arena_alloc_zero(MemArena * arena, size_t size);
+extern void * arena_realloc(MemArena * arena, void * ptr, size_t size);
+extern void arena_mark(MemArena * arena, MemArenaMark * mark);
+extern void arena_release(MemArena * arena, MemArenaMark * mark);
+extern void arena_reset(MemArena * arena);
+extern size_t arena_size(MemArena * arena);
+extern void arena_dispose(MemArena * arena);
+
+/*
+ * Make 'arena' current for the calling thread, return previously current arena.
+ * While an arena is current, tmp_*() functions allocate from the arena,
+ * and can be called by any thread.
+ * Scopes can be nested, the scope ends by calling arena_exit() with the value
+ * returned by arena_enter(). 'arena' can be NULL to temporary restore default tmp_alloc() behavior.
+ */
+extern MemArena * arena_enter(MemArena * arena);
+extern void arena_exit(MemArena * prev);
+extern MemArena * arena_current(void);
+
+/*
+ * Get an arena from the pool of recycled arenas, dispatch thread only.
+ * tmp_arena_dispose() returns the arena to the pool, blocks allocated in the arena
+ * remain valid until the end of current dispatch cycle.
+ * The only scope that uses such arenas is a cache client run, see cache.c.
+ * Commands started with cache_enter() and DWARF parsing done by cache clients allocate from it;
+ * other command handlers and DWARF parsing outside of cache clients use the dispatch cycle pool.
+ */
+extern MemArena * tmp_arena_create(void);
+extern void tmp_arena_dispose(MemArena * arena);
+
 /*
  * Allocate memory that can be used only during single dispatch cycle.
  * Such blocks are freed automatically at the end of the cycle.
+ * If an arena is current, see arena_enter(), the blocks are allocated from the arena.
  */
 extern void * tmp_alloc(size_t size);
 extern void * tmp_alloc_zero(size_t size);
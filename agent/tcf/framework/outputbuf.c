@@ -27,13 +27,17 @@
 
 #define MAX_POOL_SIZE 32
 
-#define link2buf(A) ((OutputBuffer *)((char *)(A) - offsetof(OutputBuffer, link)))
+#define link2buf(A) output_queue_link2buf(A)
+
+/* Size of a queue element that references shared data */
+#define SHARED_OBUF_SIZE offsetof(OutputBuffer, buf)
 
 static LINK pool = TCF_LIST_INIT(pool);
 static int pool_size = 0;
 
 void output_queue_ini(OutputQueue * q) {
     list_init(&q->queue);
+    q->size = 0;
 }
 
 OutputBuffer * output_queue_alloc_obuf(void) {
@@ -53,6 +57,11 @@ OutputBuffer * output_queue_alloc_obuf(void) {
 }
 
 void output_queue_free_obuf(OutputBuffer * bf) {
+    if (bf->shared != NULL) {
+        output_shared_buffer_release(bf->shared);
+        loc_free(bf);
+        return;
+    }
     if (pool_size < MAX_POOL_SIZE) {
         bf->queue = NULL;
         list_add_last(&bf->link, &pool);
@@ -64,12 +73,13 @@ void output_queue_free_obuf(OutputBuffer * bf) {
 }
 
 void output_queue_add_obuf(OutputQueue * q, OutputBuffer * bf) {
+    q->size += bf->buf_len;
     if (q->queue.next != q->queue.prev) {
         /* Append data to the last pending buffer */
         OutputBuffer * bp = link2buf(q->queue.prev);
         size_t gap = sizeof(bp->buf) - bp->buf_len;
         assert(bp->buf_pos == 0);
-        if (gap >= bf->buf_len) {
+        if (bp->shared == NULL && gap >= bf->buf_len) {
             memcpy(bp->buf + bp->buf_len, bf->buf, bf->buf_len);
             bp->buf_len += bf->buf_len;
             output_queue_free_obuf(bf);
@@ -86,12 +96,13 @@ void output_queue_add_obuf(OutputQueue * q, OutputBuffer * bf) {
 
 void output_queue_add(OutputQueue * q, const void * buf, size_t size) {
     if (q->error) return;
+    q->size += size;
     if (q->queue.next != q->queue.prev) {
         /* Append data to the last pending buffer */
         OutputBuffer * bf = link2buf(q->queue.prev);
         size_t gap = sizeof(bf->buf) - bf->buf_len;
         assert(bf->buf_pos == 0);
-        if (gap > 0) {
+        if (bf->shared == NULL && gap > 0) {
             size_t len = size;
             if (len > gap) len = gap;
             memcpy(bf->buf + bf->buf_len, buf, len);
@@ -127,13 +138,20 @@ void output_queue_done(OutputQueue * q, int error, int size) {
         output_queue_clear(q);
     }
     else {
-        bf->buf_pos += size;
-        if (bf->buf_pos < bf->buf_len) {
-            /* Nothing */
-        }
-        else {
+        /* A gathering write can complete several buffers at once */
+        q->size -= size;
+        while (!list_is_empty(&q->queue)) {
+            size_t n;
+            bf = link2buf(q->queue.next);
+            n = bf->buf_len - bf->buf_pos;
+            if (n > (size_t)size) {
+                bf->buf_pos += size;
+                break;
+            }
+            size -= (int)n;
             list_remove(&bf->link);
             output_queue_free_obuf(bf);
+            if (size == 0) break;
         }
     }
     if (!list_is_empty(&q->queue)) {
@@ -143,9 +161,42 @@ void output_queue_done(OutputQueue * q, int error, int size) {
 }
 
 void output_queue_clear(OutputQueue * q) {
+    q->size = 0;
     while (!list_is_empty(&q->queue)) {
         OutputBuffer * bf = link2buf(q->queue.next);
         list_remove(&bf->link);
         output_queue_free_obuf(bf);
     }
 }
+
+OutputSharedBuffer * output_shared_buffer_alloc(size_t size) {
+    OutputSharedBuffer * sb = (OutputSharedBuffer *)loc_alloc(offsetof(OutputSharedBuffer, data) + size);
+    sb->ref_cnt = 1;
+    sb->size = 0;
+    return sb;
+}
+
+OutputSharedBuffer * output_shared_buffer_realloc(OutputSharedBuffer * sb, size_t size) {
+    assert(sb->ref_cnt == 1);
+    return (OutputSharedBuffer *)loc_realloc(sb, offsetof(OutputSharedBuffer, data) + size);
+}
+
+void output_shared_buffer_release(OutputSharedBuffer * sb) {
+    assert(sb->ref_cnt > 0);
+    if (--sb->ref_cnt == 0) loc_free(sb);
+}
+
+void output_queue_add_shared(OutputQueue * q, OutputSharedBuffer * sb) {
+    OutputBuffer * bf = NULL;
+    if (q->error || sb->size == 0) return;
+    bf = (OutputBuffer *)loc_alloc_zero(SHARED_OBUF_SIZE);
+    bf->shared = sb;
+    bf->buf_len = sb->size;
+    bf->queue = q;
+    sb->ref_cnt++;
+    q->size += sb->size;
+    list_add_last(&bf->link, &q->queue);
+    if (q->queue.next == &bf->link) {
+        q->post_io_request(bf);
+    }
+}
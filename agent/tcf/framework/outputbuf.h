@@ -33,22 +33,37 @@
 
 typedef struct OutputQueue OutputQueue;
 typedef struct OutputBuffer OutputBuffer;
+typedef struct OutputSharedBuffer OutputSharedBuffer;
 
 struct OutputQueue {
     int error;
     LINK queue;
+    size_t size;            /* Number of bytes in the queue */
     void (*post_io_request)(OutputBuffer *);
 };
 
+/*
+ * Reference counted read-only data that can be queued in several output queues,
+ * e.g. a broadcast message that is sent to all channels of a broadcast group.
+ */
+struct OutputSharedBuffer {
+    unsigned ref_cnt;
+    size_t size;
+    unsigned char data[1];
+};
+
 struct OutputBuffer {
     LINK link;
     OutputQueue * queue;
-    unsigned char buf[OUTPUT_QUEUE_BUF_SIZE];
+    OutputSharedBuffer * shared;    /* If not NULL, the buffer data is shared->data, and 'buf' is not allocated */
     size_t buf_len;
     size_t buf_pos;
+    unsigned char buf[OUTPUT_QUEUE_BUF_SIZE];
 };
 
 #define output_queue_is_empty(q) (list_is_empty(&(q)->queue))
+#define output_queue_link2buf(A) ((OutputBuffer *)((char *)(A) - offsetof(OutputBuffer, link)))
+#define output_buffer_data(bf) ((bf)->shared != NULL ? (bf)->shared->data : (bf)->buf)
 
 extern OutputBuffer * output_queue_alloc_obuf(void);
 extern void output_queue_free_obuf(OutputBuffer * bf);
@@ -59,4 +74,19 @@ extern void output_queue_add_obuf(OutputQueue * q, OutputBuffer * buf);
 extern void output_queue_done(OutputQueue * q, int error, int size);
 extern void output_queue_clear(OutputQueue * q);
 
+/*
+ * Allocate shared buffer with room for 'size' bytes of data, reference count is 1.
+ * Buffer 'size' field is set by the caller when the data is ready.
+ */
+extern OutputSharedBuffer * output_shared_buffer_alloc(size_t size);
+
+/* Change the data size of a shared buffer, the buffer must not be referenced by any queue */
+extern OutputSharedBuffer * output_shared_buffer_realloc(OutputSharedBuffer * sb, size_t size);
+
+/* Decrement reference count, dispose the buffer when the count becomes 0 */
+extern void output_shared_buffer_release(OutputSharedBuffer * sb);
+
+/* Add a reference to shared buffer data at the end of the queue, the data is not copied */
+extern void output_queue_add_shared(OutputQueue * q, OutputSharedBuffer * sb);
+
 #endif /* D_outputbuf */
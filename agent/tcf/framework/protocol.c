@@ -34,6 +34,7 @@
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/json.h>
 #include <tcf/framework/myalloc.h>
+#include <tcf/framework/eventstats.h>
 
 static const char * LOCATOR = "Locator";
 
@@ -49,6 +50,9 @@ struct MessageHandlerInfo {
     const char * name;
     ProtocolCommandHandler2 handler;
     void * client_data;
+#if ENABLE_EventStatistics
+    LatencyStatistics * stats;
+#endif
     struct MessageHandlerInfo * next;
 };
 
@@ -114,6 +118,7 @@ ServiceInfo * protocol_get_service(void * owner, const char * name) {
     while (s != NULL && (s->owner != owner || strcmp(s->name, name) != 0)) s = s->next;
     if (s == NULL) {
         assert(strcmp(name, "ZeroCopy") != 0);
+        assert(strcmp(name, "Deflate") != 0);
         s = (ServiceInfo *)loc_alloc(sizeof(ServiceInfo));
         s->owner = owner;
         s->name = loc_strdup(name);
@@ -229,31 +234,46 @@ void handle_protocol_message(Channel * c) {
             write_stringz(&c->out, token);
             write_stream(&c->out, MARKER_EOM);
         }
-        else if (set_trap(&trap)) {
+        else {
             MessageHandlerInfo * mh = find_message_handler(p, service, name);
-            if (mh != NULL) {
-                mh->handler(token, c, mh->client_data);
+#if ENABLE_EventStatistics
+            /* Set before the trap: the latency is recorded also when the handler throws */
+            LatencyStatistics * stats = NULL;
+            uint64_t t0 = 0;
+            if (mh != NULL && event_stats_enabled) {
+                if (mh->stats == NULL) mh->stats = event_stats_get_command(mh->service->name, mh->name);
+                stats = mh->stats;
+                t0 = event_stats_time();
             }
-            else if (p->default_handler != NULL) {
-                args[0] = type;
-                args[1] = token;
-                args[2] = service;
-                args[3] = name;
-                p->default_handler(c, args, 4, p->client_data);
+#endif
+            if (set_trap(&trap)) {
+                if (mh != NULL) {
+                    mh->handler(token, c, mh->client_data);
+                }
+                else if (p->default_handler != NULL) {
+                    args[0] = type;
+                    args[1] = token;
+                    args[2] = service;
+                    args[3] = name;
+                    p->default_handler(c, args, 4, p->client_data);
+                }
+                else {
+                    trace(LOG_PROTOCOL, "Command is not recognized: %s %s ...", service, name);
+                    skip_until_EOM(c);
+                    write_stringz(&c->out, "N");
+                    write_stringz(&c->out, token);
+                    write_stream(&c->out, MARKER_EOM);
+                }
+                clear_trap(&trap);
             }
             else {
-                trace(LOG_PROTOCOL, "Command is not recognized: %s %s ...", service, name);
-                skip_until_EOM(c);
-                write_stringz(&c->out, "N");
-                write_stringz(&c->out, token);
-                write_stream(&c->out, MARKER_EOM);
+                trace(LOG_ALWAYS, "Exception handling command %s.%s: %d %s",
+                    service, name, trap.error, errno_to_str(trap.error));
+                error = trap.error;
             }
-            clear_trap(&trap);
-        }
-        else {
-            trace(LOG_ALWAYS, "Exception handling command %s.%s: %d %s",
-                service, name, trap.error, errno_to_str(trap.error));
-            error = trap.error;
+#if ENABLE_EventStatistics
+            if (stats != NULL) latency_statistics_add(stats, event_stats_time() - t0);
+#endif
         }
     }
     else if (type[0] == 'R' || type[0] == 'P' || type[0] == 'N') {
@@ -361,7 +381,10 @@ void handle_protocol_message(Channel * c) {
             trace(LOG_ALWAYS, "Received F with no zero termination.");
         }
         if (ch != MARKER_EOM) error = ERR_PROTOCOL;
-        else c->congestion_level = s ? -n : n;
+        else {
+            c->congestion_level = s ? -n : n;
+            notify_channel_output(c, c->out_queue_size);
+        }
     }
     else if (p->default_handler != NULL) {
         args[0] = type;
@@ -405,6 +428,9 @@ void add_command_handler2(Protocol * p, const char * service, const char * name,
     mh->name = name;
     mh->handler = handler;
     mh->client_data = client_data;
+#if ENABLE_EventStatistics
+    mh->stats = NULL;
+#endif
     mh->next = message_handlers[h];
     message_handlers[h] = mh;
 }
@@ -611,6 +637,7 @@ static void event_locator_hello(Channel * c) {
     char **list = NULL;
 
     c->out.supports_zero_copy = 0;
+    c->compress_output = 0;
     do ch = read_stream(&c->inp);
     while (ch > 0 && isspace(ch));
     if (ch != '[') exception(ERR_PROTOCOL);
@@ -623,6 +650,7 @@ static void event_locator_hello(Channel * c) {
         for (;;) {
             char * service = json_read_alloc_string(&c->inp);
             if (strcmp(service, "ZeroCopy") == 0) c->out.supports_zero_copy = 1;
+            if (strcmp(service, "Deflate") == 0) c->compress_output = 1;
             if (cnt == max) {
                 max *= 2;
                 list = (char **)loc_realloc(list, max * sizeof *list);
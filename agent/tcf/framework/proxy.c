@@ -167,6 +167,7 @@ static void proxy_connected(Channel * c) {
         char * nm = target->c->peer_service_list[i];
         trace(LOG_PROXY, "    %s", nm);
         if (strcmp(nm, "ZeroCopy") == 0) continue;
+        if (strcmp(nm, "Deflate") == 0) continue;
         protocol_get_service(host->proto, nm);
     }
 
@@ -429,6 +430,7 @@ void proxy_create(Channel * c1, Channel * c2) {
         char * nm = c1->peer_service_list[i];
         trace(LOG_PROXY, "    %s", nm);
         if (strcmp(nm, "ZeroCopy") == 0) continue;
+        if (strcmp(nm, "Deflate") == 0) continue;
         protocol_get_service(proxy[1].proto, nm);
     }
 
@@ -441,6 +443,7 @@ void proxy_create(Channel * c1, Channel * c2) {
             char * nm = c2->peer_service_list[i];
             c2_peer_service_list[i] = loc_strdup(nm);
             if (strcmp(nm, "ZeroCopy") == 0) continue;
+            if (strcmp(nm, "Deflate") == 0) continue;
             protocol_get_service(proxy[0].proto, nm);
         }
     }
@@ -0,0 +1,403 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * I/O reactor: epoll() based readiness notification for sockets and pipes.
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_EPoll
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <tcf/framework/mdep-inet.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/trace.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/reactor.h>
+
+#define MAX_EPOLL_EVENTS    64
+
+#define WAKEUP_ID           (~(uint64_t)0)
+
+typedef struct ReactorReq {
+    AsyncReqInfo * req;
+} ReactorReq;
+
+typedef struct ReactorFD {
+    ReactorReq rd;
+    ReactorReq wr;
+    uint32_t gen;
+    int registered;
+    int is_socket;
+} ReactorFD;
+
+static int epoll_fd = -1;
+static int wakeup_fd = -1;
+static ReactorFD * fds = NULL;
+static unsigned fds_max = 0;
+static unsigned pending_cnt = 0;
+
+static ReactorFD * get_fd_info(int fd) {
+    if ((unsigned)fd >= fds_max) {
+        unsigned n = fds_max == 0 ? 64 : fds_max;
+        while (n <= (unsigned)fd) n *= 2;
+        fds = (ReactorFD *)loc_realloc(fds, sizeof(ReactorFD) * n);
+        memset(fds + fds_max, 0, sizeof(ReactorFD) * (n - fds_max));
+        fds_max = n;
+    }
+    return fds + fd;
+}
+
+static int get_req_fd(AsyncReqInfo * req) {
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqSend:
+    case AsyncReqRecvFrom:
+    case AsyncReqSendTo:
+#if ENABLE_AsyncReqSendMsg
+    case AsyncReqSendMsg:
+#endif
+        return req->u.sio.sock;
+    case AsyncReqAccept:
+        return req->u.acc.sock;
+    case AsyncReqRead:
+    case AsyncReqWrite:
+        return req->u.fio.fd;
+    }
+    return -1;
+}
+
+static void set_result(AsyncReqInfo * req, ssize_t rval, int error) {
+    req->error = error;
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqSend:
+    case AsyncReqRecvFrom:
+    case AsyncReqSendTo:
+#if ENABLE_AsyncReqSendMsg
+    case AsyncReqSendMsg:
+#endif
+        req->u.sio.rval = rval;
+        break;
+    case AsyncReqAccept:
+        req->u.acc.rval = (int)rval;
+        break;
+    case AsyncReqRead:
+    case AsyncReqWrite:
+        req->u.fio.rval = rval;
+        break;
+    }
+}
+
+static int is_readable(int fd) {
+    struct pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    p.revents = 0;
+    return poll(&p, 1, 0) > 0;
+}
+
+/*
+ * Try to execute the request without blocking.
+ * Returns 0 if the request would block, 1 if the request is complete.
+ * Requests that cannot be done with MSG_DONTWAIT are executed only after
+ * the file descriptor is reported ready, and confirmed by poll().
+ */
+static int try_io(ReactorFD * info, AsyncReqInfo * req, int ready) {
+    ssize_t rval = 0;
+
+    switch (req->type) {
+    case AsyncReqRecv:
+        rval = recv(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT);
+        break;
+    case AsyncReqSend:
+        rval = send(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT);
+        break;
+    case AsyncReqRecvFrom:
+        rval = recvfrom(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT,
+            req->u.sio.addr, &req->u.sio.addrlen);
+        break;
+    case AsyncReqSendTo:
+        rval = sendto(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT,
+            req->u.sio.addr, req->u.sio.addrlen);
+        break;
+#if ENABLE_AsyncReqSendMsg
+    case AsyncReqSendMsg:
+        {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = req->u.sio.iov;
+            msg.msg_iovlen = req->u.sio.iovcnt;
+            rval = sendmsg(req->u.sio.sock, &msg, req->u.sio.flags | MSG_DONTWAIT);
+        }
+        break;
+#endif
+    case AsyncReqAccept:
+        if (!ready || !is_readable(req->u.acc.sock)) return 0;
+        rval = accept(req->u.acc.sock, req->u.acc.addr, req->u.acc.addr ? &req->u.acc.addrlen : NULL);
+        break;
+    case AsyncReqRead:
+        if (info->is_socket) {
+            rval = recv(req->u.fio.fd, req->u.fio.bufp, req->u.fio.bufsz, MSG_DONTWAIT);
+        }
+        else {
+            if (!ready || !is_readable(req->u.fio.fd)) return 0;
+            rval = read(req->u.fio.fd, req->u.fio.bufp, req->u.fio.bufsz);
+        }
+        break;
+    case AsyncReqWrite:
+        assert(info->is_socket);
+        rval = send(req->u.fio.fd, req->u.fio.bufp, req->u.fio.bufsz, MSG_DONTWAIT);
+        break;
+    default:
+        assert(0);
+        return 0;
+    }
+    if (rval < 0) {
+        int error = errno;
+        if (error == EAGAIN || error == EWOULDBLOCK || error == EINTR) return 0;
+        set_result(req, -1, error);
+        trace(LOG_ASYNCREQ, "reactor: req %p, type %d, error %d", req, req->type, error);
+        return 1;
+    }
+    set_result(req, rval, 0);
+    return 1;
+}
+
+static void complete_req(ReactorReq * r) {
+    AsyncReqInfo * req = r->req;
+    assert(pending_cnt > 0);
+    r->req = NULL;
+    pending_cnt--;
+    trace(LOG_ASYNCREQ, "async_req_complete: req %p, type %d, error %d", req, req->type, req->error);
+    post_event(req->done, req);
+}
+
+static void complete_stale_req(int fd, ReactorReq * r) {
+    trace(LOG_ASYNCREQ, "reactor: fd %d was closed while req %p was pending", fd, r->req);
+    set_result(r->req, -1, EBADF);
+    complete_req(r);
+}
+
+static uint32_t get_epoll_events(ReactorFD * info) {
+    uint32_t events = 0;
+    if (info->rd.req != NULL) events |= EPOLLIN | EPOLLRDHUP;
+    if (info->wr.req != NULL) events |= EPOLLOUT;
+    if (events == 0) return 0;
+    /* Edge triggered one-shot notification: the descriptor is disarmed
+     * after each event and re-armed only while a request is pending */
+    return events | EPOLLET | EPOLLONESHOT;
+}
+
+/*
+ * Arm epoll notification for pending requests of the descriptor.
+ * epoll silently drops registration of a descriptor when it is closed, so EPOLL_CTL_MOD
+ * fails with ENOENT if the descriptor number was reused since. Owners of descriptors call
+ * reactor_close() before closing, this is a fallback for descriptors closed without it:
+ * requests that were pending on the closed descriptor, other than 'cur', are completed
+ * with EBADF then.
+ */
+static int update_epoll(int fd, ReactorFD * info, ReactorReq * cur) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = get_epoll_events(info);
+    if (ev.events == 0) return 0;
+    if (info->registered) {
+        ev.data.u64 = ((uint64_t)info->gen << 32) | (uint32_t)fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0) return 0;
+        if (errno != ENOENT) return -1;
+        info->registered = 0;
+        if (info->rd.req != NULL && &info->rd != cur) complete_stale_req(fd, &info->rd);
+        if (info->wr.req != NULL && &info->wr != cur) complete_stale_req(fd, &info->wr);
+        ev.events = get_epoll_events(info);
+        if (ev.events == 0) return 0;
+    }
+    /* Events of stale registrations carry old generation number and are ignored */
+    info->gen++;
+    ev.data.u64 = ((uint64_t)info->gen << 32) | (uint32_t)fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        if (errno != EEXIST) return -1;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) return -1;
+    }
+    info->registered = 1;
+    return 0;
+}
+
+int reactor_post(AsyncReqInfo * req) {
+    int fd = get_req_fd(req);
+    int wr = 0;
+    int is_socket = 1;
+    ReactorFD * info = NULL;
+    ReactorReq * r = NULL;
+    struct stat st;
+
+    assert(is_dispatch_thread());
+    if (epoll_fd < 0 || fd < 0) return 0;
+    switch (req->type) {
+    case AsyncReqSend:
+    case AsyncReqSendTo:
+#if ENABLE_AsyncReqSendMsg
+    case AsyncReqSendMsg:
+#endif
+        wr = 1;
+        break;
+    case AsyncReqRead:
+    case AsyncReqWrite:
+        /* Regular files are always "ready", only sockets, pipes and terminals use the reactor.
+         * Blocking write to a pipe can block the dispatch thread, so use worker threads for it. */
+        if (fstat(fd, &st) < 0) return 0;
+        wr = req->type == AsyncReqWrite;
+        is_socket = S_ISSOCK(st.st_mode);
+        if (!is_socket && (wr || (!S_ISFIFO(st.st_mode) && !S_ISCHR(st.st_mode)))) return 0;
+        break;
+    }
+
+    info = get_fd_info(fd);
+    r = wr ? &info->wr : &info->rd;
+    if (r->req != NULL) {
+        /* Either the descriptor was closed and reused, or the caller needs a worker thread for this request */
+        if (update_epoll(fd, info, NULL) < 0 || r->req != NULL) return 0;
+    }
+    info->is_socket = is_socket;
+    req->error = 0;
+
+    trace(LOG_ASYNCREQ, "reactor_post: req %p, type %d, fd %d", req, req->type, fd);
+    if (is_socket && try_io(info, req, 0)) {
+        trace(LOG_ASYNCREQ, "async_req_complete: req %p, type %d, error %d", req, req->type, req->error);
+        post_event(req->done, req);
+        return 1;
+    }
+
+    r->req = req;
+    if (update_epoll(fd, info, r) < 0) {
+        trace(LOG_ASYNCREQ, "reactor: cannot use epoll for fd %d: %s", fd, errno_to_str(errno));
+        r->req = NULL;
+        return 0;
+    }
+    pending_cnt++;
+    return 1;
+}
+
+static void fd_ready(int fd, ReactorFD * info, uint32_t events) {
+    if (info->rd.req != NULL && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+        if (try_io(info, info->rd.req, 1)) complete_req(&info->rd);
+    }
+    if (info->wr.req != NULL && (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+        if (try_io(info, info->wr.req, 1)) complete_req(&info->wr);
+    }
+    if (update_epoll(fd, info, NULL) < 0) {
+        int error = errno;
+        if (info->rd.req != NULL) {
+            set_result(info->rd.req, -1, error);
+            complete_req(&info->rd);
+        }
+        if (info->wr.req != NULL) {
+            set_result(info->wr.req, -1, error);
+            complete_req(&info->wr);
+        }
+    }
+}
+
+void reactor_close(int fd) {
+    ReactorFD * info = NULL;
+
+    assert(is_dispatch_thread());
+    if (epoll_fd < 0 || fd < 0 || (unsigned)fd >= fds_max) return;
+    info = fds + fd;
+    if (info->rd.req != NULL) complete_stale_req(fd, &info->rd);
+    if (info->wr.req != NULL) complete_stale_req(fd, &info->wr);
+    if (info->registered) {
+        /* Explicit removal, in case the descriptor is shared with another process */
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0 && errno != ENOENT && errno != EBADF) {
+            trace(LOG_ASYNCREQ, "reactor: cannot remove fd %d: %s", fd, errno_to_str(errno));
+        }
+        info->registered = 0;
+    }
+    /* Events that are already queued for the descriptor are ignored */
+    info->gen++;
+}
+
+void reactor_wait(int timeout_ms) {
+    int i;
+    int n = 0;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    assert(is_dispatch_thread());
+    n = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return;
+        check_error(errno);
+    }
+    for (i = 0; i < n; i++) {
+        uint64_t id = events[i].data.u64;
+        int fd = (int)(uint32_t)id;
+        if (id == WAKEUP_ID) {
+            uint64_t cnt = 0;
+            if (read(wakeup_fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) check_error(errno);
+            continue;
+        }
+        if ((unsigned)fd >= fds_max) continue;
+        if (fds[fd].gen != (uint32_t)(id >> 32)) continue;
+        fd_ready(fd, fds + fd, events[i].events);
+    }
+}
+
+void reactor_wakeup(void) {
+    uint64_t cnt = 1;
+    /* Note: can be called from a signal handler, must not use locks */
+    if (write(wakeup_fd, &cnt, sizeof(cnt)) < 0) {
+        /* EAGAIN: the counter is saturated, the reactor is already awake */
+    }
+}
+
+int ini_reactor(void) {
+    struct epoll_event ev;
+
+    assert(epoll_fd < 0);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) return -1;
+    wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeup_fd < 0) {
+        int error = errno;
+        close(epoll_fd);
+        epoll_fd = -1;
+        errno = error;
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKEUP_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) < 0) {
+        int error = errno;
+        close(wakeup_fd);
+        close(epoll_fd);
+        wakeup_fd = -1;
+        epoll_fd = -1;
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* ENABLE_EPoll */
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * I/O reactor: epoll() based readiness notification for sockets and pipes.
+ *
+ * The reactor is driven by the dispatch thread: instead of blocking on a condition
+ * variable, run_event_loop() waits in reactor_wait(), which performs non-blocking
+ * I/O for ready file descriptors and posts AsyncReqInfo completion callbacks.
+ * This removes worker thread hand-offs for socket recv/send/accept requests.
+ */
+
+#ifndef D_reactor
+#define D_reactor
+
+#include <tcf/config.h>
+
+#if ENABLE_EPoll
+
+#include <tcf/framework/asyncreq.h>
+
+/*
+ * Try to execute asynchronous request using the reactor.
+ * Returns 1 if the request is accepted, its 'done' callback will be posted
+ * as a regular event when the request is complete.
+ * Returns 0 if the request type or the file descriptor type is not supported,
+ * the caller should use a worker thread then.
+ * Can be called only from the dispatch thread.
+ */
+extern int reactor_post(AsyncReqInfo * req);
+
+/*
+ * Wait until a file descriptor becomes ready, reactor_wakeup() is called,
+ * or the timeout expires. Negative timeout means infinite wait.
+ * Called by the event loop with the event queue lock released.
+ */
+extern void reactor_wait(int timeout_ms);
+
+/*
+ * Interrupt reactor_wait().
+ * Can be called from any thread, and from signal handlers.
+ */
+extern void reactor_wakeup(void);
+
+/*
+ * Complete pending requests of file descriptor 'fd' with error EBADF.
+ * epoll does not report that a descriptor was closed, so a request waiting on it
+ * would be completed only when the descriptor number is reused.
+ * Must be called before closing a descriptor that can have pending requests.
+ * Can be called only from the dispatch thread.
+ */
+extern void reactor_close(int fd);
+
+/*
+ * Initialize the reactor.
+ * Returns 0 on success, -1 and errno if epoll() is not available.
+ */
+extern int ini_reactor(void);
+
+#else
+
+#define reactor_close(fd) do {} while (0)
+
+#endif /* ENABLE_EPoll */
+
+#endif /* D_reactor */
@@ -23,11 +23,15 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stddef.h>
+#include <time.h>
 #include <tcf/framework/errors.h>
+#include <tcf/framework/link.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/events.h>
 #include <tcf/framework/trace.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/waitpid.h>
 
 typedef struct WaitPIDListenerInfo {
@@ -175,14 +179,19 @@ void detach_waitpid_process(void) {
 
 #include <sys/wait.h>
 
+#if !defined(USE_WAITPID_MONITOR)
+#  if defined(__linux__)
+#    define USE_WAITPID_MONITOR 1
+#  else
+#    define USE_WAITPID_MONITOR 0
+#  endif
+#endif
+
 static int detach = 0;
 
-static void waitpid_done(void * arg) {
+/* Notify listeners about status change, return 1 if the process does not need to be watched any more */
+static int notify_listeners(pid_t pid, pid_t rval, int status, int error) {
     int i;
-    AsyncReqInfo * req = (AsyncReqInfo *)arg;
-    pid_t pid = req->u.wpid.pid;
-    int status = req->u.wpid.status;
-    int error = req->error;
     int exited = 0;
     int exit_code = 0;
     int signal = 0;
@@ -190,10 +199,10 @@ static void waitpid_done(void * arg) {
     int syscall = 0;
 
     trace(LOG_WAITPID, "waitpid: pid %d status %#x, error %d", pid, status, error);
-    assert(req->u.wpid.rval == -1 || req->u.wpid.rval == pid);
+    assert(rval == -1 || rval == pid);
     detach = 0;
 
-    if (req->u.wpid.rval == -1) {
+    if (rval == -1) {
         assert(error);
         trace(error == ECHILD ? LOG_WAITPID : LOG_ALWAYS, "waitpid error (pid %d): %d %s", pid, error, errno_to_str(error));
         exited = 1;
@@ -222,11 +231,273 @@ static void waitpid_done(void * arg) {
     for (i = 0; i < listener_cnt; i++) {
         listeners[i].listener(pid, exited, exit_code, signal, event_code, syscall, listeners[i].args);
     }
-    if (exited) {
-        loc_free(req);
-    }
-    else if (detach) {
+    if (exited) return 1;
+    if (detach) {
         trace(LOG_WAITPID, "waitpid: pid %d detached", pid);
+        return 1;
+    }
+    return 0;
+}
+
+#if USE_WAITPID_MONITOR
+
+/*
+ * Single monitor thread waits for status changes of children and tracees that are
+ * added by add_waitpid_process(), and posts them to the dispatch thread in batches.
+ * Only added processes are reaped, other code in the agent can wait for its own children.
+ * The thread uses waitid(WNOWAIT) to find a process that has a status change without
+ * reaping it. If the process is not added, e.g. it is a child of other code, or a new
+ * thread that reports its first stop before it is added, status changes of added
+ * processes are polled until the status is consumed by its owner.
+ */
+
+#define MAX_BATCH_SIZE 256
+#define PROCESS_HASH_SIZE (64 * MEM_USAGE_FACTOR - 1)
+#define FOREIGN_STATUS_POLL_DELAY 10 /* ms */
+
+typedef struct WaitPIDStatus {
+    pid_t pid;
+    int status;
+    int error;
+} WaitPIDStatus;
+
+typedef struct WaitPIDBatch {
+    unsigned cnt;
+    WaitPIDStatus buf[MAX_BATCH_SIZE];
+} WaitPIDBatch;
+
+typedef struct WaitPIDProcess {
+    LINK link_hash;
+    pid_t pid;
+    /* Accessed only by the dispatch thread */
+    int notifying;
+    int added_again;        /* add_waitpid_process() was called by a listener */
+} WaitPIDProcess;
+
+#define hash2prs(A) ((WaitPIDProcess *)((char *)(A) - offsetof(WaitPIDProcess, link_hash)))
+
+/* Added processes, protected by monitor_lock */
+static LINK process_hash[PROCESS_HASH_SIZE];
+static unsigned process_cnt = 0;
+static unsigned add_cnt = 0;
+static pthread_mutex_t monitor_lock;
+static pthread_cond_t monitor_cond;
+static pthread_t monitor_thread;
+
+static WaitPIDProcess * find_process(pid_t pid) {
+    LINK * h = process_hash + (unsigned)pid % PROCESS_HASH_SIZE;
+    LINK * l = h->next;
+    while (l != h) {
+        WaitPIDProcess * prs = hash2prs(l);
+        if (prs->pid == pid) return prs;
+        l = l->next;
+    }
+    return NULL;
+}
+
+static WaitPIDProcess * get_process(pid_t pid) {
+    WaitPIDProcess * prs = NULL;
+    check_error(pthread_mutex_lock(&monitor_lock));
+    prs = find_process(pid);
+    check_error(pthread_mutex_unlock(&monitor_lock));
+    return prs;
+}
+
+static void remove_process(WaitPIDProcess * prs) {
+    check_error(pthread_mutex_lock(&monitor_lock));
+    list_remove(&prs->link_hash);
+    process_cnt--;
+    check_error(pthread_mutex_unlock(&monitor_lock));
+    loc_free(prs);
+}
+
+static void waitpid_batch_done(void * args) {
+    unsigned i;
+    WaitPIDBatch * batch = (WaitPIDBatch *)args;
+
+    trace(LOG_WAITPID, "waitpid: batch of %u status changes", batch->cnt);
+    for (i = 0; i < batch->cnt; i++) {
+        WaitPIDStatus * s = batch->buf + i;
+        WaitPIDProcess * prs = get_process(s->pid);
+        if (prs == NULL) {
+            /* Detached while the status was in the batch */
+            trace(LOG_WAITPID, "waitpid: pid %d is not watched, status %#x dropped", s->pid, s->status);
+            continue;
+        }
+        prs->notifying = 1;
+        prs->added_again = 0;
+        if (notify_listeners(s->pid, s->error ? -1 : s->pid, s->status, s->error) && !prs->added_again) {
+            remove_process(prs);
+        }
+        else {
+            prs->notifying = 0;
+        }
+    }
+    loc_free(batch);
+}
+
+static void waitpid_error_done(void * args) {
+    AsyncReqInfo * req = (AsyncReqInfo *)args;
+    notify_listeners(req->u.wpid.pid, -1, 0, req->error);
+    loc_free(req);
+}
+
+/* Reap status change of an added process, return 0 if it has none */
+static int collect_status(WaitPIDBatch * batch, pid_t pid) {
+    int status = 0;
+    pid_t rval = waitpid(pid, &status, __WALL | WNOHANG);
+    WaitPIDStatus * s = NULL;
+    if (rval == 0) return 0;
+    if (rval < 0 && errno == EINTR) return 0;
+    s = batch->buf + batch->cnt++;
+    s->pid = pid;
+    s->status = status;
+    s->error = rval < 0 ? errno : 0;
+    return 1;
+}
+
+static WaitPIDBatch * post_batch(WaitPIDBatch * batch) {
+    if (batch->cnt == 0) return batch;
+    post_event(waitpid_batch_done, batch);
+    return (WaitPIDBatch *)loc_alloc(sizeof(WaitPIDBatch));
+}
+
+/* Poll all added processes, used while a status change of a not added process blocks waitid() */
+static WaitPIDBatch * poll_processes(WaitPIDBatch * batch) {
+    unsigned i;
+    unsigned cnt = 0;
+    pid_t * pids = NULL;
+
+    check_error(pthread_mutex_lock(&monitor_lock));
+    if (process_cnt > 0) {
+        pids = (pid_t *)loc_alloc(sizeof(pid_t) * process_cnt);
+        for (i = 0; i < PROCESS_HASH_SIZE; i++) {
+            LINK * h = process_hash + i;
+            LINK * l = h->next;
+            while (l != h) {
+                pids[cnt++] = hash2prs(l)->pid;
+                l = l->next;
+            }
+        }
+    }
+    check_error(pthread_mutex_unlock(&monitor_lock));
+    for (i = 0; i < cnt; i++) {
+        if (batch->cnt >= MAX_BATCH_SIZE) batch = post_batch(batch);
+        collect_status(batch, pids[i]);
+    }
+    loc_free(pids);
+    return batch;
+}
+
+static void wait_process_added(unsigned cnt, int timeout) {
+    check_error(pthread_mutex_lock(&monitor_lock));
+    if (timeout) {
+        struct timespec time;
+        int error = 0;
+        clock_gettime(CLOCK_REALTIME, &time);
+        time.tv_nsec += FOREIGN_STATUS_POLL_DELAY * 1000000;
+        if (time.tv_nsec >= 1000000000) {
+            time.tv_nsec -= 1000000000;
+            time.tv_sec++;
+        }
+        while (cnt == add_cnt && error == 0) error = pthread_cond_timedwait(&monitor_cond, &monitor_lock, &time);
+        if (error && error != ETIMEDOUT) check_error(error);
+    }
+    else {
+        while (cnt == add_cnt) check_error(pthread_cond_wait(&monitor_cond, &monitor_lock));
+    }
+    check_error(pthread_mutex_unlock(&monitor_lock));
+}
+
+static void * monitor_thread_func(void * x) {
+    WaitPIDBatch * batch = (WaitPIDBatch *)loc_alloc(sizeof(WaitPIDBatch));
+    for (;;) {
+        unsigned cnt = 0;
+        siginfo_t info;
+
+        check_error(pthread_mutex_lock(&monitor_lock));
+        cnt = add_cnt;
+        check_error(pthread_mutex_unlock(&monitor_lock));
+
+        batch->cnt = 0;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | __WALL) < 0) {
+            int error = errno;
+            if (error == EINTR) continue;
+            if (error != ECHILD) check_error(error);
+            /* No children, wait until a process is added */
+            wait_process_added(cnt, 0);
+            continue;
+        }
+        /* Collect all status changes that are already available */
+        while (info.si_pid != 0 && get_process(info.si_pid) != NULL) {
+            if (!collect_status(batch, info.si_pid)) break;
+            if (batch->cnt >= MAX_BATCH_SIZE) break;
+            memset(&info, 0, sizeof(info));
+            if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | WNOHANG | __WALL) < 0) break;
+        }
+        if (batch->cnt == 0) {
+            /* The status change belongs to a process that is not added */
+            batch = poll_processes(batch);
+            if (batch->cnt == 0) wait_process_added(cnt, 1);
+        }
+        batch = post_batch(batch);
+    }
+    return NULL;
+}
+
+void add_waitpid_process(int pid) {
+    siginfo_t info;
+    WaitPIDProcess * prs = NULL;
+
+    assert(listener_cnt > 0);
+    assert(is_dispatch_thread());
+    trace(LOG_WAITPID, "waitpid: add pid %d", pid);
+    prs = get_process(pid);
+    if (prs != NULL) {
+        if (prs->notifying) prs->added_again = 1;
+        return;
+    }
+    /* The process is not reaped by the monitor until it is added, so the check cannot lose its status */
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PID, pid, &info, WEXITED | WSTOPPED | WNOHANG | WNOWAIT | __WALL) < 0) {
+        /* Not a child or tracee of the agent */
+        AsyncReqInfo * req = (AsyncReqInfo *)loc_alloc_zero(sizeof(AsyncReqInfo));
+        req->type = AsyncReqWaitpid;
+        req->u.wpid.pid = pid;
+        req->u.wpid.rval = -1;
+        req->error = errno;
+        post_event(waitpid_error_done, req);
+        return;
+    }
+    prs = (WaitPIDProcess *)loc_alloc_zero(sizeof(WaitPIDProcess));
+    prs->pid = pid;
+    check_error(pthread_mutex_lock(&monitor_lock));
+    list_add_last(&prs->link_hash, process_hash + (unsigned)pid % PROCESS_HASH_SIZE);
+    process_cnt++;
+    add_cnt++;
+    check_error(pthread_cond_signal(&monitor_cond));
+    check_error(pthread_mutex_unlock(&monitor_lock));
+}
+
+void detach_waitpid_process(void) {
+    detach = 1;
+}
+
+static void init(void) {
+    int i;
+    for (i = 0; i < PROCESS_HASH_SIZE; i++) list_init(process_hash + i);
+    check_error(pthread_mutex_init(&monitor_lock, NULL));
+    check_error(pthread_cond_init(&monitor_cond, NULL));
+    check_error(pthread_create(&monitor_thread, &pthread_create_attr, monitor_thread_func, NULL));
+}
+
+#else /* USE_WAITPID_MONITOR */
+
+static void waitpid_done(void * arg) {
+    AsyncReqInfo * req = (AsyncReqInfo *)arg;
+
+    if (notify_listeners(req->u.wpid.pid, req->u.wpid.rval, req->u.wpid.status, req->error)) {
         loc_free(req);
     }
     else {
@@ -256,5 +527,7 @@ void detach_waitpid_process(void) {
 static void init(void) {
 }
 
+#endif /* USE_WAITPID_MONITOR */
+
 #endif
 #endif
@@ -0,0 +1,968 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Zstandard decompressor, implements RFC 8878: https://www.rfc-editor.org/rfc/rfc8878.txt
+ *
+ * A frame is a sequence of blocks, a compressed block contains Huffman coded literals
+ * and FSE coded sequences - triples of literals length, match offset and match length.
+ * Output is decoded directly into the destination buffer, so matches can reference
+ * any data of the current frame, window size is not checked.
+ */
+
+#include <tcf/config.h>
+
+#include <assert.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/zstd.h>
+
+#define ZSTD_MAGIC          0xFD2FB528u
+#define SKIPPABLE_MAGIC     0x184D2A50u
+#define MAX_BLOCK_SIZE      (1 << 17)
+
+#define HUF_MAX_BITS        11
+#define HUF_MAX_SYMBOLS     256
+#define HUF_WEIGHTS_LOG     6
+
+#define FSE_MAX_LOG         9
+#define FSE_MAX_SYMBOLS     256
+
+#define LL_MAX_LOG          9
+#define ML_MAX_LOG          9
+#define OF_MAX_LOG          8
+#define LL_MAX_CODE         35
+#define ML_MAX_CODE         52
+#define OF_MAX_CODE         31
+
+#define MODE_PREDEFINED     0
+#define MODE_RLE            1
+#define MODE_COMPRESSED     2
+#define MODE_REPEAT         3
+
+typedef struct FSETable {
+    int valid;
+    unsigned log;
+    uint8_t symbol[1 << FSE_MAX_LOG];
+    uint8_t bits[1 << FSE_MAX_LOG];
+    uint16_t base[1 << FSE_MAX_LOG];
+} FSETable;
+
+typedef struct HufTable {
+    unsigned max_bits;      /* 0 if there is no table */
+    uint8_t symbol[1 << HUF_MAX_BITS];
+    uint8_t bits[1 << HUF_MAX_BITS];
+} HufTable;
+
+/* Backward bit stream, bits are read from the end of the buffer towards the beginning */
+typedef struct BitStream {
+    const uint8_t * buf;
+    size_t size;
+    int64_t pos;
+} BitStream;
+
+typedef struct ZstdState {
+    uint8_t * out_buf;
+    size_t out_size;
+    size_t out_pos;
+    size_t frame_pos;
+    uint32_t rep[3];
+    HufTable huf;
+    FSETable ll;
+    FSETable of;
+    FSETable ml;
+    size_t lit_size;
+    uint8_t literals[MAX_BLOCK_SIZE];
+} ZstdState;
+
+static const int16_t ll_default_norm[LL_MAX_CODE + 1] = {
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+    -1, -1, -1, -1
+};
+static const int16_t ml_default_norm[ML_MAX_CODE + 1] = {
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+    -1, -1, -1, -1, -1
+};
+static const int16_t of_default_norm[29] = {
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+static const uint32_t ll_base[LL_MAX_CODE + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+    8192, 16384, 32768, 65536
+};
+static const uint8_t ll_bits[LL_MAX_CODE + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+    13, 14, 15, 16
+};
+static const uint32_t ml_base[ML_MAX_CODE + 1] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+    19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+    35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+    4099, 8195, 16387, 32771, 65539
+};
+static const uint8_t ml_bits[ML_MAX_CODE + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16
+};
+
+static unsigned highest_bit(uint32_t v) {
+    unsigned n = 0;
+    assert(v != 0);
+    while (v >>= 1) n++;
+    return n;
+}
+
+static uint32_t read_le32(const uint8_t * p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_le64(const uint8_t * p) {
+    return (uint64_t)read_le32(p) | (uint64_t)read_le32(p + 4) << 32;
+}
+
+/* Get 'n' (at most 56) bits of little-endian bit stream starting at bit 'pos', bits outside of the buffer are zeros */
+static uint32_t get_bits_at(const uint8_t * buf, size_t size, int64_t pos, unsigned n) {
+    uint64_t v = 0;
+    size_t i;
+    if (n == 0) return 0;
+    if (pos < 0) {
+        if (pos + (int64_t)n <= 0) return 0;
+        return get_bits_at(buf, size, 0, (unsigned)(pos + n)) << (unsigned)-pos;
+    }
+    i = (size_t)(pos >> 3);
+    if (i + 8 <= size) {
+        v = read_le64(buf + i);
+    }
+    else {
+        unsigned k;
+        for (k = 0; k < 8 && i + k < size; k++) v |= (uint64_t)buf[i + k] << (k * 8);
+    }
+    v >>= (unsigned)(pos & 7);
+    return (uint32_t)(v & (((uint64_t)1 << n) - 1));
+}
+
+static int init_bit_stream(BitStream * bs, const uint8_t * buf, size_t size) {
+    if (size == 0 || buf[size - 1] == 0) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    bs->buf = buf;
+    bs->size = size;
+    /* Last byte contains end mark - highest set bit */
+    bs->pos = (int64_t)(size - 1) * 8 + highest_bit(buf[size - 1]);
+    return 0;
+}
+
+static uint32_t read_bits(BitStream * bs, unsigned n) {
+    bs->pos -= n;
+    return get_bits_at(bs->buf, bs->size, bs->pos, n);
+}
+
+/*************************************************************************************************/
+/* FSE tables */
+
+static int build_fse_table(FSETable * t, const int16_t * norm, unsigned symbols_cnt, unsigned log) {
+    unsigned size = 1u << log;
+    unsigned high = size;
+    unsigned step = (size >> 1) + (size >> 3) + 3;
+    unsigned pos = 0;
+    uint16_t next[FSE_MAX_SYMBOLS];
+    unsigned s, i;
+
+    assert(log <= FSE_MAX_LOG);
+    assert(symbols_cnt <= FSE_MAX_SYMBOLS);
+    t->valid = 0;
+    t->log = log;
+    for (s = 0; s < symbols_cnt; s++) {
+        if (norm[s] == -1) {
+            t->symbol[--high] = (uint8_t)s;
+            next[s] = 1;
+        }
+    }
+    for (s = 0; s < symbols_cnt; s++) {
+        int n;
+        if (norm[s] <= 0) continue;
+        next[s] = (uint16_t)norm[s];
+        for (n = 0; n < norm[s]; n++) {
+            t->symbol[pos] = (uint8_t)s;
+            do pos = (pos + step) & (size - 1);
+            while (pos >= high);
+        }
+    }
+    if (pos != 0) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    for (i = 0; i < size; i++) {
+        unsigned state = next[t->symbol[i]]++;
+        unsigned bits = log - highest_bit(state);
+        t->bits[i] = (uint8_t)bits;
+        t->base[i] = (uint16_t)((state << bits) - size);
+    }
+    t->valid = 1;
+    return 0;
+}
+
+static void build_rle_table(FSETable * t, unsigned symbol) {
+    t->log = 0;
+    t->symbol[0] = (uint8_t)symbol;
+    t->bits[0] = 0;
+    t->base[0] = 0;
+    t->valid = 1;
+}
+
+/* Read FSE table description, returns number of bytes used, or -1 on error */
+static int read_fse_table(FSETable * t, const uint8_t * buf, size_t size, unsigned max_log, unsigned max_symbols, size_t * used) {
+    int16_t norm[FSE_MAX_SYMBOLS];
+    int64_t pos = 0;
+    unsigned symbols_cnt = 0;
+    unsigned log = 0;
+    int remaining = 0;
+
+    assert(max_symbols <= FSE_MAX_SYMBOLS);
+    log = get_bits_at(buf, size, pos, 4) + 5;
+    pos += 4;
+    if (log > max_log) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    remaining = 1 << log;
+    while (remaining > 0 && symbols_cnt < max_symbols) {
+        unsigned bits = highest_bit((uint32_t)remaining + 1) + 1;
+        uint32_t val = get_bits_at(buf, size, pos, bits);
+        uint32_t lower_mask = (1u << (bits - 1)) - 1;
+        uint32_t threshold = (1u << bits) - 1 - ((uint32_t)remaining + 1);
+        int prob;
+        if ((val & lower_mask) < threshold) {
+            val &= lower_mask;
+            pos += bits - 1;
+        }
+        else {
+            if (val > lower_mask) val -= threshold;
+            pos += bits;
+        }
+        prob = (int)val - 1;
+        remaining -= prob < 0 ? -prob : prob;
+        norm[symbols_cnt++] = (int16_t)prob;
+        if (prob == 0) {
+            /* Zero probability is followed by 2 bits repeat count */
+            for (;;) {
+                unsigned repeat = get_bits_at(buf, size, pos, 2);
+                unsigned i;
+                pos += 2;
+                for (i = 0; i < repeat && symbols_cnt < max_symbols; i++) norm[symbols_cnt++] = 0;
+                if (repeat != 3) break;
+            }
+        }
+    }
+    if (remaining != 0 || (uint64_t)(pos + 7) / 8 > size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    *used = (size_t)((pos + 7) / 8);
+    return build_fse_table(t, norm, symbols_cnt, log);
+}
+
+/*************************************************************************************************/
+/* Huffman coded literals */
+
+static int build_huf_table(HufTable * t, uint8_t * weights, unsigned weights_cnt) {
+    uint32_t rank_idx[HUF_MAX_BITS + 1];
+    uint32_t rank_cnt[HUF_MAX_BITS + 1];
+    uint8_t bits[HUF_MAX_SYMBOLS];
+    uint32_t sum = 0;
+    uint32_t rest = 0;
+    unsigned max_bits;
+    unsigned i;
+
+    t->max_bits = 0;
+    for (i = 0; i < weights_cnt; i++) {
+        if (weights[i] > HUF_MAX_BITS) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (weights[i] > 0) sum += 1u << (weights[i] - 1);
+    }
+    if (sum == 0 || weights_cnt >= HUF_MAX_SYMBOLS) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    /* Weight of last symbol is implied: total must be a power of 2 */
+    max_bits = highest_bit(sum) + 1;
+    rest = (1u << max_bits) - sum;
+    if (max_bits > HUF_MAX_BITS || (rest & (rest - 1)) != 0) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    weights[weights_cnt++] = (uint8_t)(highest_bit(rest) + 1);
+
+    memset(rank_cnt, 0, sizeof(rank_cnt));
+    for (i = 0; i < weights_cnt; i++) {
+        bits[i] = (uint8_t)(weights[i] > 0 ? max_bits + 1 - weights[i] : 0);
+        rank_cnt[bits[i]]++;
+    }
+    /* Longest codes are placed first */
+    rank_idx[max_bits] = 0;
+    for (i = max_bits; i >= 1; i--) {
+        rank_idx[i - 1] = rank_idx[i] + rank_cnt[i] * (1u << (max_bits - i));
+        memset(t->bits + rank_idx[i], (int)i, rank_idx[i - 1] - rank_idx[i]);
+    }
+    if (rank_idx[0] != (1u << max_bits)) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    for (i = 0; i < weights_cnt; i++) {
+        if (bits[i] > 0) {
+            uint32_t len = 1u << (max_bits - bits[i]);
+            memset(t->symbol + rank_idx[bits[i]], (int)i, len);
+            rank_idx[bits[i]] += len;
+        }
+    }
+    t->max_bits = max_bits;
+    return 0;
+}
+
+static int read_huf_table(HufTable * t, const uint8_t * buf, size_t size, size_t * used) {
+    uint8_t weights[HUF_MAX_SYMBOLS];
+    unsigned weights_cnt = 0;
+    unsigned hdr;
+
+    if (size < 1) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    hdr = buf[0];
+    if (hdr >= 128) {
+        /* Weights are stored as 4 bits numbers */
+        unsigned i;
+        weights_cnt = hdr - 127;
+        if (1 + (weights_cnt + 1) / 2 > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        for (i = 0; i < weights_cnt; i++) {
+            unsigned b = buf[1 + i / 2];
+            weights[i] = (uint8_t)(i % 2 == 0 ? b >> 4 : b & 0xf);
+        }
+        *used = 1 + (weights_cnt + 1) / 2;
+    }
+    else {
+        /* Weights are FSE compressed, two interleaved states share one bit stream */
+        FSETable * fse = (FSETable *)loc_alloc(sizeof(FSETable));
+        BitStream bs;
+        size_t table_size = 0;
+        unsigned s1, s2;
+        int error = 0;
+        if (1 + hdr > size) error = ERR_INV_FORMAT;
+        if (!error && read_fse_table(fse, buf + 1, hdr, HUF_WEIGHTS_LOG, HUF_MAX_SYMBOLS, &table_size) < 0) error = errno;
+        if (!error && init_bit_stream(&bs, buf + 1 + table_size, hdr - table_size) < 0) error = errno;
+        if (!error) {
+            s1 = read_bits(&bs, fse->log);
+            s2 = read_bits(&bs, fse->log);
+            for (;;) {
+                if (weights_cnt + 2 > HUF_MAX_SYMBOLS - 1) {
+                    error = ERR_INV_FORMAT;
+                    break;
+                }
+                weights[weights_cnt++] = fse->symbol[s1];
+                s1 = fse->base[s1] + read_bits(&bs, fse->bits[s1]);
+                if (bs.pos < 0) {
+                    weights[weights_cnt++] = fse->symbol[s2];
+                    break;
+                }
+                weights[weights_cnt++] = fse->symbol[s2];
+                s2 = fse->base[s2] + read_bits(&bs, fse->bits[s2]);
+                if (bs.pos < 0) {
+                    weights[weights_cnt++] = fse->symbol[s1];
+                    break;
+                }
+            }
+        }
+        loc_free(fse);
+        if (error) {
+            errno = error;
+            return -1;
+        }
+        *used = 1 + hdr;
+    }
+    return build_huf_table(t, weights, weights_cnt);
+}
+
+static int decode_huf_stream(HufTable * t, const uint8_t * buf, size_t size, uint8_t * out, size_t cnt) {
+    BitStream bs;
+    unsigned max_bits = t->max_bits;
+    size_t i;
+
+    if (init_bit_stream(&bs, buf, size) < 0) return -1;
+    for (i = 0; i < cnt; i++) {
+        unsigned idx = get_bits_at(bs.buf, bs.size, bs.pos - max_bits, max_bits);
+        out[i] = t->symbol[idx];
+        bs.pos -= t->bits[idx];
+        if (bs.pos < 0) break;
+    }
+    if (i < cnt || bs.pos != 0) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    return 0;
+}
+
+static int decode_literals(ZstdState * s, const uint8_t * buf, size_t size, size_t * used) {
+    unsigned type = 0;
+    unsigned format = 0;
+    size_t hdr_size = 0;
+    size_t lit_size = 0;
+
+    if (size < 1) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    type = buf[0] & 3;
+    format = (buf[0] >> 2) & 3;
+    if (type < 2) {
+        /* Raw or RLE literals */
+        switch (format) {
+        case 1: hdr_size = 2; break;
+        case 3: hdr_size = 3; break;
+        default: hdr_size = 1; break;
+        }
+        if (hdr_size + (type == 1) > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        switch (hdr_size) {
+        case 1: lit_size = buf[0] >> 3; break;
+        case 2: lit_size = (buf[0] >> 4) + ((size_t)buf[1] << 4); break;
+        default: lit_size = (buf[0] >> 4) + ((size_t)buf[1] << 4) + ((size_t)buf[2] << 12); break;
+        }
+        if (lit_size > MAX_BLOCK_SIZE) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (type == 0) {
+            if (hdr_size + lit_size > size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            memcpy(s->literals, buf + hdr_size, lit_size);
+            *used = hdr_size + lit_size;
+        }
+        else {
+            memset(s->literals, buf[hdr_size], lit_size);
+            *used = hdr_size + 1;
+        }
+    }
+    else {
+        /* Huffman coded literals, type 3 reuses the table of previous block */
+        unsigned streams = format == 0 ? 1 : 4;
+        unsigned bits = 0;
+        size_t comp_size = 0;
+        uint64_t hdr = 0;
+        const uint8_t * p = NULL;
+        size_t p_size = 0;
+        unsigned i;
+
+        switch (format) {
+        case 0: case 1: hdr_size = 3; bits = 10; break;
+        case 2: hdr_size = 4; bits = 14; break;
+        default: hdr_size = 5; bits = 18; break;
+        }
+        if (hdr_size > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        for (i = 0; i < hdr_size; i++) hdr |= (uint64_t)buf[i] << (i * 8);
+        lit_size = (size_t)((hdr >> 4) & ((1u << bits) - 1));
+        comp_size = (size_t)((hdr >> (4 + bits)) & ((1u << bits) - 1));
+        if (lit_size > MAX_BLOCK_SIZE || hdr_size + comp_size > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        p = buf + hdr_size;
+        p_size = comp_size;
+        if (type == 2) {
+            size_t n = 0;
+            if (read_huf_table(&s->huf, p, p_size, &n) < 0) return -1;
+            p += n;
+            p_size -= n;
+        }
+        else if (s->huf.max_bits == 0) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (streams == 1) {
+            if (decode_huf_stream(&s->huf, p, p_size, s->literals, lit_size) < 0) return -1;
+        }
+        else {
+            size_t sizes[4];
+            size_t seg = (lit_size + 3) / 4;
+            size_t out_pos = 0;
+            if (p_size < 6 || seg * 3 > lit_size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            sizes[0] = p[0] | (size_t)p[1] << 8;
+            sizes[1] = p[2] | (size_t)p[3] << 8;
+            sizes[2] = p[4] | (size_t)p[5] << 8;
+            if (6 + sizes[0] + sizes[1] + sizes[2] > p_size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            sizes[3] = p_size - 6 - sizes[0] - sizes[1] - sizes[2];
+            p += 6;
+            for (i = 0; i < 4; i++) {
+                size_t cnt = i < 3 ? seg : lit_size - seg * 3;
+                if (decode_huf_stream(&s->huf, p, sizes[i], s->literals + out_pos, cnt) < 0) return -1;
+                p += sizes[i];
+                out_pos += cnt;
+            }
+        }
+        *used = hdr_size + comp_size;
+    }
+    s->lit_size = lit_size;
+    return 0;
+}
+
+/*************************************************************************************************/
+/* Sequences */
+
+static int read_seq_table(FSETable * t, unsigned mode, const uint8_t * buf, size_t size, size_t * used,
+        const int16_t * default_norm, unsigned default_cnt, unsigned default_log, unsigned max_log, unsigned max_code) {
+    *used = 0;
+    switch (mode) {
+    case MODE_PREDEFINED:
+        return build_fse_table(t, default_norm, default_cnt, default_log);
+    case MODE_RLE:
+        if (size < 1 || buf[0] > max_code) break;
+        build_rle_table(t, buf[0]);
+        *used = 1;
+        return 0;
+    case MODE_COMPRESSED:
+        return read_fse_table(t, buf, size, max_log, max_code + 1, used);
+    case MODE_REPEAT:
+        if (!t->valid) break;
+        return 0;
+    }
+    errno = ERR_INV_FORMAT;
+    return -1;
+}
+
+static int decode_sequences(ZstdState * s, const uint8_t * buf, size_t size) {
+    uint8_t * out_buf = s->out_buf;
+    size_t out_pos = s->out_pos;
+    size_t lit_pos = 0;
+    size_t seq_cnt = 0;
+    size_t pos = 0;
+    size_t n = 0;
+    unsigned modes = 0;
+    unsigned ll_state, of_state, ml_state;
+    BitStream bs;
+    size_t i;
+
+    if (size < 1) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    seq_cnt = buf[pos++];
+    if (seq_cnt == 255) {
+        if (pos + 2 > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        seq_cnt = buf[pos] + ((size_t)buf[pos + 1] << 8) + 0x7F00;
+        pos += 2;
+    }
+    else if (seq_cnt >= 128) {
+        if (pos + 1 > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        seq_cnt = ((seq_cnt - 128) << 8) + buf[pos++];
+    }
+
+    if (seq_cnt > 0) {
+        if (pos >= size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        modes = buf[pos++];
+        if (modes & 3) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (read_seq_table(&s->ll, (modes >> 6) & 3, buf + pos, size - pos, &n,
+            ll_default_norm, LL_MAX_CODE + 1, 6, LL_MAX_LOG, LL_MAX_CODE) < 0) return -1;
+        pos += n;
+        if (read_seq_table(&s->of, (modes >> 4) & 3, buf + pos, size - pos, &n,
+            of_default_norm, 29, 5, OF_MAX_LOG, OF_MAX_CODE) < 0) return -1;
+        pos += n;
+        if (read_seq_table(&s->ml, (modes >> 2) & 3, buf + pos, size - pos, &n,
+            ml_default_norm, ML_MAX_CODE + 1, 6, ML_MAX_LOG, ML_MAX_CODE) < 0) return -1;
+        pos += n;
+
+        if (init_bit_stream(&bs, buf + pos, size - pos) < 0) return -1;
+        ll_state = read_bits(&bs, s->ll.log);
+        of_state = read_bits(&bs, s->of.log);
+        ml_state = read_bits(&bs, s->ml.log);
+
+        for (i = 0; i < seq_cnt; i++) {
+            unsigned ll_code = s->ll.symbol[ll_state];
+            unsigned of_code = s->of.symbol[of_state];
+            unsigned ml_code = s->ml.symbol[ml_state];
+            uint32_t offset = 0;
+            uint32_t ll = 0;
+            uint32_t ml = 0;
+            uint8_t * p = NULL;
+
+            if (ll_code > LL_MAX_CODE || ml_code > ML_MAX_CODE || of_code > OF_MAX_CODE) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            offset = (1u << of_code) + read_bits(&bs, of_code);
+            ml = ml_base[ml_code] + read_bits(&bs, ml_bits[ml_code]);
+            ll = ll_base[ll_code] + read_bits(&bs, ll_bits[ll_code]);
+
+            if (offset > 3) {
+                offset -= 3;
+                s->rep[2] = s->rep[1];
+                s->rep[1] = s->rep[0];
+                s->rep[0] = offset;
+            }
+            else {
+                /* Repeat offset, with zero literals length the codes are shifted by one */
+                unsigned idx = offset - 1 + (ll == 0);
+                if (idx == 0) {
+                    offset = s->rep[0];
+                }
+                else {
+                    offset = idx < 3 ? s->rep[idx] : s->rep[0] - 1;
+                    if (idx > 1) s->rep[2] = s->rep[1];
+                    s->rep[1] = s->rep[0];
+                    s->rep[0] = offset;
+                }
+            }
+
+            if (i + 1 < seq_cnt) {
+                ll_state = s->ll.base[ll_state] + read_bits(&bs, s->ll.bits[ll_state]);
+                ml_state = s->ml.base[ml_state] + read_bits(&bs, s->ml.bits[ml_state]);
+                of_state = s->of.base[of_state] + read_bits(&bs, s->of.bits[of_state]);
+            }
+
+            if (lit_pos + ll > s->lit_size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            if (out_pos + ll + ml > s->out_size) {
+                errno = ERR_BUFFER_OVERFLOW;
+                return -1;
+            }
+            memcpy(out_buf + out_pos, s->literals + lit_pos, ll);
+            lit_pos += ll;
+            out_pos += ll;
+            if (offset == 0 || offset > out_pos - s->frame_pos) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            p = out_buf + out_pos;
+            out_pos += ml;
+            if (offset >= ml) {
+                memcpy(p, p - offset, ml);
+            }
+            else {
+                while (ml > 0) {
+                    *p = *(p - offset);
+                    p++;
+                    ml--;
+                }
+            }
+        }
+        if (bs.pos != 0) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+    }
+    else if (pos != size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+
+    if (out_pos + s->lit_size - lit_pos > s->out_size) {
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
+    }
+    memcpy(out_buf + out_pos, s->literals + lit_pos, s->lit_size - lit_pos);
+    out_pos += s->lit_size - lit_pos;
+    s->out_pos = out_pos;
+    return 0;
+}
+
+/*************************************************************************************************/
+/* Frames */
+
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = ROTL64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+/* XXH64 hash with seed 0, used for frame content checksum */
+static uint64_t xxh64(const uint8_t * p, size_t size) {
+    const uint8_t * end = p + size;
+    uint64_t h = 0;
+
+    if (size >= 32) {
+        uint64_t v1 = PRIME64_1 + PRIME64_2;
+        uint64_t v2 = PRIME64_2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - PRIME64_1;
+        while (p + 32 <= end) {
+            v1 = xxh64_round(v1, read_le64(p));
+            v2 = xxh64_round(v2, read_le64(p + 8));
+            v3 = xxh64_round(v3, read_le64(p + 16));
+            v4 = xxh64_round(v4, read_le64(p + 24));
+            p += 32;
+        }
+        h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    }
+    else {
+        h = PRIME64_5;
+    }
+    h += size;
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, read_le64(p));
+        h = ROTL64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read_le32(p) * PRIME64_1;
+        h = ROTL64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= *p++ * PRIME64_5;
+        h = ROTL64(h, 11) * PRIME64_1;
+    }
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static int decode_frame(ZstdState * s, const uint8_t * buf, size_t size, size_t * used) {
+    static const unsigned dict_id_size[4] = { 0, 1, 2, 4 };
+    static const unsigned content_size_size[4] = { 0, 2, 4, 8 };
+    size_t pos = 4;
+    unsigned fhd = 0;
+    unsigned single_segment = 0;
+    unsigned checksum_flag = 0;
+    unsigned fcs_size = 0;
+    unsigned did_size = 0;
+    uint64_t content_size = 0;
+    uint32_t dict_id = 0;
+    unsigned i;
+
+    if (pos + 1 > size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    fhd = buf[pos++];
+    single_segment = (fhd >> 5) & 1;
+    checksum_flag = (fhd >> 2) & 1;
+    did_size = dict_id_size[fhd & 3];
+    fcs_size = content_size_size[fhd >> 6];
+    if (fcs_size == 0 && single_segment) fcs_size = 1;
+    if (fhd & 0x08) {
+        /* Reserved bit must be zero */
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    if (!single_segment) pos++; /* Window descriptor is not used */
+    if (pos + did_size + fcs_size > size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    for (i = 0; i < did_size; i++) dict_id |= (uint32_t)buf[pos++] << (i * 8);
+    for (i = 0; i < fcs_size; i++) content_size |= (uint64_t)buf[pos++] << (i * 8);
+    if (fcs_size == 2) content_size += 256;
+    if (dict_id != 0) {
+        errno = ERR_UNSUPPORTED;
+        return -1;
+    }
+    if (fcs_size > 0 && content_size > s->out_size - s->out_pos) {
+        errno = ERR_BUFFER_OVERFLOW;
+        return -1;
+    }
+
+    s->frame_pos = s->out_pos;
+    s->rep[0] = 1;
+    s->rep[1] = 4;
+    s->rep[2] = 8;
+    s->huf.max_bits = 0;
+    s->ll.valid = 0;
+    s->of.valid = 0;
+    s->ml.valid = 0;
+
+    for (;;) {
+        uint32_t hdr = 0;
+        unsigned last = 0;
+        unsigned type = 0;
+        size_t block_size = 0;
+
+        if (pos + 3 > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        hdr = buf[pos] | (uint32_t)buf[pos + 1] << 8 | (uint32_t)buf[pos + 2] << 16;
+        pos += 3;
+        last = hdr & 1;
+        type = (hdr >> 1) & 3;
+        block_size = hdr >> 3;
+        switch (type) {
+        case 0:
+            if (pos + block_size > size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            if (s->out_pos + block_size > s->out_size) {
+                errno = ERR_BUFFER_OVERFLOW;
+                return -1;
+            }
+            memcpy(s->out_buf + s->out_pos, buf + pos, block_size);
+            s->out_pos += block_size;
+            pos += block_size;
+            break;
+        case 1:
+            if (pos + 1 > size) {
+                errno = ERR_INV_FORMAT;
+                return -1;
+            }
+            if (s->out_pos + block_size > s->out_size) {
+                errno = ERR_BUFFER_OVERFLOW;
+                return -1;
+            }
+            memset(s->out_buf + s->out_pos, buf[pos], block_size);
+            s->out_pos += block_size;
+            pos += 1;
+            break;
+        case 2:
+            {
+                size_t n = 0;
+                if (block_size > MAX_BLOCK_SIZE || pos + block_size > size) {
+                    errno = ERR_INV_FORMAT;
+                    return -1;
+                }
+                if (decode_literals(s, buf + pos, block_size, &n) < 0) return -1;
+                if (decode_sequences(s, buf + pos + n, block_size - n) < 0) return -1;
+                pos += block_size;
+            }
+            break;
+        default:
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        if (last) break;
+    }
+
+    if (fcs_size > 0 && s->out_pos - s->frame_pos != content_size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    if (checksum_flag) {
+        uint32_t checksum = 0;
+        if (pos + 4 > size) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+        checksum = read_le32(buf + pos);
+        pos += 4;
+        if (checksum != (uint32_t)xxh64(s->out_buf + s->frame_pos, s->out_pos - s->frame_pos)) {
+            errno = ERR_INV_FORMAT;
+            return -1;
+        }
+    }
+    *used = pos;
+    return 0;
+}
+
+int zstd_decompress(const void * src_buf, size_t src_size, void * dst_buf, size_t dst_size, size_t * dst_used) {
+    const uint8_t * buf = (const uint8_t *)src_buf;
+    ZstdState * s = (ZstdState *)loc_alloc(sizeof(ZstdState));
+    size_t pos = 0;
+    int error = 0;
+
+    s->out_buf = (uint8_t *)dst_buf;
+    s->out_size = dst_size;
+    s->out_pos = 0;
+    while (pos < src_size) {
+        uint32_t magic = 0;
+        if (pos + 4 > src_size) {
+            error = ERR_INV_FORMAT;
+            break;
+        }
+        magic = read_le32(buf + pos);
+        if (magic == ZSTD_MAGIC) {
+            size_t n = 0;
+            if (decode_frame(s, buf + pos, src_size - pos, &n) < 0) {
+                error = errno;
+                break;
+            }
+            pos += n;
+        }
+        else if ((magic & 0xFFFFFFF0u) == SKIPPABLE_MAGIC && pos + 8 <= src_size &&
+                read_le32(buf + pos + 4) <= src_size - pos - 8) {
+            pos += 8 + read_le32(buf + pos + 4);
+        }
+        else {
+            error = ERR_INV_FORMAT;
+            break;
+        }
+    }
+    if (dst_used != NULL) *dst_used = s->out_pos;
+    loc_free(s);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
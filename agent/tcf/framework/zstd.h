@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Zstandard decompressor, implements RFC 8878: https://www.rfc-editor.org/rfc/rfc8878.txt
+ *
+ * Decodes complete frames from a memory buffer into a memory buffer.
+ * Dictionaries are not supported.
+ */
+
+#ifndef D_zstd
+#define D_zstd
+
+#include <tcf/config.h>
+
+/*
+ * Decode a sequence of Zstandard frames.
+ * The function does not use exceptions and static data, it can be called from any thread.
+ * Number of bytes produced is returned in 'dst_used', if not NULL.
+ * Returns 0 on success, or -1 and sets errno.
+ */
+extern int zstd_decompress(const void * src_buf, size_t src_size, void * dst_buf, size_t dst_size, size_t * dst_used);
+
+#endif /* D_zstd */
@@ -34,6 +34,7 @@
 #include <tcf/framework/channel_tcp.h>
 #include <tcf/framework/plugins.h>
 #include <tcf/services/discovery.h>
+#include <tcf/services/dwarfindexcache.h>
 #include <tcf/http/http.h>
 #include <tcf/main/test.h>
 #include <tcf/main/cmdline.h>
@@ -233,6 +234,9 @@ static const char * help_text[] = {
 #endif
 #if ENABLE_SSL
     "  -c               generate SSL certificate and exit",
+#endif
+#if ENABLE_DWARF_INDEX_CACHE
+    "  -C<dir>          enable persistent cache of DWARF indices in the directory",
 #endif
     HELP_TEXT_HOOK
     NULL
@@ -360,6 +364,9 @@ int main(int argc, char ** argv) {
 #endif
 #if ENABLE_HttpServer
             case 'H':
+#endif
+#if ENABLE_DWARF_INDEX_CACHE
+            case 'C':
 #endif
                 if (*s == '\0') {
                     if (++ind >= argc) {
@@ -417,6 +424,11 @@ int main(int argc, char ** argv) {
                         free(fnm);
                     }
                     break;
+#endif
+#if ENABLE_DWARF_INDEX_CACHE
+                case 'C':
+                    dwarf_index_cache_path = s;
+                    break;
 #endif
                 }
                 s = NULL;
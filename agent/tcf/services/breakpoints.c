@@ -54,6 +54,13 @@
 #  define ENABLE_SkipPrologueWhenPlanting 0
 #endif
 
+/* ENABLE_CompiledConditions: compile breakpoint conditions once per symbols context and address,
+ * instead of parsing the condition text on every breakpoint hit.
+ */
+#if !defined(ENABLE_CompiledConditions)
+#  define ENABLE_CompiledConditions (ENABLE_Expressions && ENABLE_Symbols)
+#endif
+
 typedef struct BreakpointRef BreakpointRef;
 typedef struct InstructionRef InstructionRef;
 typedef struct BreakInstruction BreakInstruction;
@@ -63,6 +70,7 @@ typedef struct LocationEvaluationRequest LocationEvaluationRequest;
 typedef struct ConditionEvaluationRequest ConditionEvaluationRequest;
 typedef struct ContextExtensionBP ContextExtensionBP;
 typedef struct BreakpointHitCount BreakpointHitCount;
+typedef struct CompiledCondition CompiledCondition;
 
 struct BreakpointRef {
     LINK link_inp;
@@ -108,6 +116,7 @@ struct BreakpointInfo {
     int attrs_changed;
     int status_changed;
     LINK link_hit_count;
+    LINK link_compiled;
 };
 
 struct BreakpointHitCount {
@@ -117,6 +126,16 @@ struct BreakpointHitCount {
     unsigned count;
 };
 
+struct CompiledCondition {
+    LINK link_bp;
+    LINK link_ctx;
+    Context * ctx; /* "symbols" group context, see CONTEXT_GROUP_SYMBOLS */
+    ContextAddress addr;
+#if ENABLE_CompiledConditions
+    CompiledExpression * expr; /* NULL if the condition cannot be compiled */
+#endif
+};
+
 struct InstructionRef {
     BreakpointInfo * bp;
     Context * ctx; /* "breakpoint" group context, see CONTEXT_GROUP_BREAKPOINT */
@@ -198,6 +217,7 @@ struct ContextExtensionBP {
     int empty_bp_grp;
     int instruction_cnt;
     LINK link_hit_count;
+    LINK link_compiled;
 };
 
 static const char * BREAKPOINTS = "Breakpoints";
@@ -240,6 +260,8 @@ static unsigned listener_max = 0;
 
 #define link_bp2hcnt(A)  ((BreakpointHitCount *)((char *)(A) - offsetof(BreakpointHitCount, link_bp)))
 #define link_ctx2hcnt(A)  ((BreakpointHitCount *)((char *)(A) - offsetof(BreakpointHitCount, link_ctx)))
+#define link_bp2ccnd(A)  ((CompiledCondition *)((char *)(A) - offsetof(CompiledCondition, link_bp)))
+#define link_ctx2ccnd(A)  ((CompiledCondition *)((char *)(A) - offsetof(CompiledCondition, link_ctx)))
 
 #if ENABLE_SkipPrologueWhenPlanting
 #  define suspend_by_bp(ctx, trigger, bp, skip_prologue) suspend_by_breakpoint(ctx, trigger, bp, 0)
@@ -252,6 +274,7 @@ static LINK id2bp[ID2BP_HASH_SIZE];
 
 static LINK instructions = TCF_LIST_INIT(instructions);
 static LINK addr2instr[ADDR2INSTR_HASH_SIZE];
+static MemPool * instruction_pool = NULL;
 
 static LINK inp2br[INP2BR_HASH_SIZE];
 
@@ -476,7 +499,7 @@ static BreakInstruction * find_instruction(Context * ctx, int virtual_addr,
 static BreakInstruction * add_instruction(Context * ctx, int virtual_addr,
         ContextAddress address, unsigned access_types, ContextAddress access_size) {
     int hash = addr2instr_hash(ctx, address);
-    BreakInstruction * bi = (BreakInstruction *)loc_alloc_zero(sizeof(BreakInstruction));
+    BreakInstruction * bi = (BreakInstruction *)mem_pool_alloc_zero(instruction_pool);
     assert(find_instruction(ctx, virtual_addr, address, access_types, access_size) == NULL);
     list_add_last(&bi->link_all, &instructions);
     list_add_last(&bi->link_adr, addr2instr + hash);
@@ -747,6 +770,72 @@ static void reset_bp_hit_count(BreakpointInfo * bp) {
     }
 }
 
+static void free_compiled_condition(CompiledCondition * c) {
+    list_remove(&c->link_bp);
+    list_remove(&c->link_ctx);
+#if ENABLE_CompiledConditions
+    free_compiled_expression(c->expr);
+#endif
+    loc_free(c);
+}
+
+static void reset_bp_compiled_conditions(BreakpointInfo * bp) {
+    LINK * l = bp->link_compiled.next;
+    while (l != &bp->link_compiled) {
+        CompiledCondition * c = link_bp2ccnd(l);
+        l = l->next;
+        free_compiled_condition(c);
+    }
+}
+
+static void reset_ctx_compiled_conditions(Context * ctx) {
+    LINK * l = EXT(ctx)->link_compiled.next;
+    assert(l != NULL);
+    while (l != &EXT(ctx)->link_compiled) {
+        CompiledCondition * c = link_ctx2ccnd(l);
+        l = l->next;
+        free_compiled_condition(c);
+    }
+}
+
+#if ENABLE_CompiledConditions
+static int evaluate_compiled_condition(BreakpointInfo * bp, Context * ctx, int * res) {
+    Context * grp = context_get_group(ctx, CONTEXT_GROUP_SYMBOLS);
+    CompiledCondition * c = NULL;
+    ContextAddress addr = 0;
+    int64_t n = 0;
+    LINK * l = NULL;
+
+    if (get_PC(ctx, &addr) < 0) return -1;
+    l = bp->link_compiled.next;
+    while (l != &bp->link_compiled) {
+        CompiledCondition * x = link_bp2ccnd(l);
+        if (x->ctx == grp && x->addr == addr) {
+            c = x;
+            break;
+        }
+        l = l->next;
+    }
+    if (c == NULL) {
+        CompiledExpression * expr = NULL;
+        if (compile_expression(ctx, STACK_TOP_FRAME, 0, bp->condition, &expr) < 0) {
+            if (cache_miss_count() > 0) return -1;
+            trace(LOG_CONTEXT, "Breakpoint %s: condition is not compiled: %s", bp->id, errno_to_str(errno));
+        }
+        c = (CompiledCondition *)loc_alloc_zero(sizeof(CompiledCondition));
+        list_add_first(&c->link_bp, &bp->link_compiled);
+        list_add_first(&c->link_ctx, &EXT(grp)->link_compiled);
+        c->ctx = grp;
+        c->addr = addr;
+        c->expr = expr;
+    }
+    if (c->expr == NULL) return -1;
+    if (evaluate_compiled_expression(ctx, STACK_TOP_FRAME, c->expr, &n) < 0) return -1;
+    *res = n != 0;
+    return 0;
+}
+#endif /* ENABLE_CompiledConditions */
+
 void clone_breakpoints_on_process_fork(Context * parent, Context * child) {
     Context * mem = context_get_group(parent, CONTEXT_GROUP_PROCESS);
     LINK * l = instructions.next;
@@ -1182,7 +1271,7 @@ static BreakInstruction * link_breakpoint_instruction(
             }
             l = l->next;
         }
-        bi = (BreakInstruction *)loc_alloc_zero(sizeof(BreakInstruction));
+        bi = (BreakInstruction *)mem_pool_alloc_zero(instruction_pool);
         list_add_last(&bi->link_all, &instructions);
         list_add_last(&bi->link_adr, addr2instr + hash);
         context_lock(ctx);
@@ -1424,6 +1513,7 @@ static void free_bp(BreakpointInfo * bp) {
     assert(bp->instruction_cnt == 0);
     assert(bp->client_cnt == 0);
     reset_bp_hit_count(bp);
+    reset_bp_compiled_conditions(bp);
     list_remove(&bp->link_all);
     if (*bp->id) list_remove(&bp->link_id);
     if (bp->ctx) context_unlock(bp->ctx);
@@ -1853,6 +1943,12 @@ static void evaluate_condition(void * x) {
 #if ENABLE_Expressions
                 Value v;
                 int b = 0;
+#if ENABLE_CompiledConditions
+                if (evaluate_compiled_condition(bp, ctx, &b) == 0) {
+                    if (b) ce->condition_ok = 1;
+                }
+                else
+#endif
                 if (evaluate_expression(ctx, STACK_TOP_FRAME, 0, bp->condition, 1, &v) < 0 ||
                         (v.size > 0 && value_to_boolean(&v, &b) < 0)) {
                     int error = errno;
@@ -2263,6 +2359,7 @@ static int set_breakpoint_attributes(BreakpointInfo * bp, BreakpointAttribute *
             else if (strcmp(name, BREAKPOINT_CONDITION) == 0) {
                 loc_free(bp->condition);
                 bp->condition = json_read_alloc_string(buf_inp);
+                reset_bp_compiled_conditions(bp);
             }
             else if (strcmp(name, BREAKPOINT_CONTEXTIDS) == 0) {
                 loc_free(bp->context_ids);
@@ -2343,6 +2440,7 @@ static int set_breakpoint_attributes(BreakpointInfo * bp, BreakpointAttribute *
         else if (strcmp(name, BREAKPOINT_CONDITION) == 0) {
             loc_free(bp->condition);
             bp->condition = NULL;
+            reset_bp_compiled_conditions(bp);
         }
         else if (strcmp(name, BREAKPOINT_CONTEXTIDS) == 0) {
             loc_free(bp->context_ids);
@@ -2495,6 +2593,7 @@ static BreakpointInfo * add_breakpoint(Channel * c, BreakpointAttribute * attrs)
         bp = (BreakpointInfo *)loc_alloc_zero(sizeof(BreakpointInfo));
         list_init(&bp->link_clients);
         list_init(&bp->link_hit_count);
+        list_init(&bp->link_compiled);
         list_add_last(&bp->link_all, &breakpoints);
         list_add_last(&bp->link_id, id2bp + hash);
         set_breakpoint_attributes(bp, attrs);
@@ -3169,6 +3268,7 @@ BreakpointInfo * create_eventpoint_ext(BreakpointAttribute * attrs, Context * ct
     bp->event_callback_args = callback_args;
     list_init(&bp->link_clients);
     list_init(&bp->link_hit_count);
+    list_init(&bp->link_compiled);
     list_add_last(&bp->link_all, &breakpoints);
     set_breakpoint_attributes(bp, attrs);
     replant_breakpoint(bp);
@@ -3214,9 +3314,11 @@ void destroy_eventpoint(BreakpointInfo * bp) {
 static void event_context_created(Context * ctx, void * args) {
     post_location_evaluation_request(ctx, NULL);
     list_init(&EXT(ctx)->link_hit_count);
+    list_init(&EXT(ctx)->link_compiled);
 }
 
 static void event_context_changed(Context * ctx, void * args) {
+    reset_ctx_compiled_conditions(context_get_group(ctx, CONTEXT_GROUP_SYMBOLS));
     if (ctx->mem_access && context_get_group(ctx, CONTEXT_GROUP_PROCESS) == ctx) {
         /* If the context is a memory space, we need to update
          * breakpoints on all members of the group */
@@ -3258,6 +3360,7 @@ static void event_context_disposed(Context * ctx, void * args) {
             list_remove(&c->link_ctx);
             loc_free(c);
         }
+        reset_ctx_compiled_conditions(ctx);
     }
 }
 
@@ -3267,6 +3370,7 @@ static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddre
      * This function udates service data structure to reflect that.
      */
     int cnt = 0;
+    reset_ctx_compiled_conditions(context_get_group(ctx, CONTEXT_GROUP_SYMBOLS));
     while (size > 0) {
         ContextAddress sz = size;
         LINK * l = instructions.next;
@@ -3349,6 +3453,7 @@ void ini_breakpoints_service(Protocol * proto, TCFBroadcastGroup * bcg) {
             add_path_map_event_listener(&listener, NULL);
         }
 #endif
+        instruction_pool = mem_pool_create("BreakInstruction", sizeof(BreakInstruction));
         for (i = 0; i < ADDR2INSTR_HASH_SIZE; i++) list_init(addr2instr + i);
         for (i = 0; i < ID2BP_HASH_SIZE; i++) list_init(id2bp + i);
         for (i = 0; i < INP2BR_HASH_SIZE; i++) list_init(inp2br + i);
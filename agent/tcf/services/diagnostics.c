@@ -22,11 +22,15 @@
 #include <signal.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <tcf/framework/json.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/cache.h>
+#include <tcf/framework/trace.h>
+#include <tcf/framework/eventstats.h>
+#include <tcf/framework/events.h>
 #if ENABLE_Symbols
 #  include <tcf/services/symbols.h>
 #endif
@@ -39,8 +43,26 @@
 #endif
 #include <tcf/services/diagnostics.h>
 
+#if ENABLE_EventStatistics && ENABLE_ELF && !ENABLE_ContextProxy && defined(__linux__)
+#  define ENABLE_EventStatisticsSymbols 1
+#  include <sys/auxv.h>
+#  include <tcf/services/tcf_elf.h>
+#else
+#  define ENABLE_EventStatisticsSymbols 0
+#endif
+
 static const char * DIAGNOSTICS = "Diagnostics";
 
+typedef struct StatisticsProvider {
+    const char * name;
+    DiagnosticsStatisticsCallBack * call_back;
+    void * args;
+} StatisticsProvider;
+
+static StatisticsProvider * stat_providers = NULL;
+static unsigned stat_providers_cnt = 0;
+static unsigned stat_providers_max = 0;
+
 #if ENABLE_RCBP_TEST
 
 typedef struct ContextExtensionDiag {
@@ -468,6 +490,481 @@ static void command_dispose_test_stream(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
+static void command_get_statistics(char * token, Channel * c) {
+    unsigned i;
+
+    json_test_char(&c->inp, MARKER_EOM);
+
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, 0);
+    write_stream(&c->out, '{');
+    for (i = 0; i < stat_providers_cnt; i++) {
+        StatisticsProvider * p = stat_providers + i;
+        if (i > 0) write_stream(&c->out, ',');
+        json_write_string(&c->out, p->name);
+        write_stream(&c->out, ':');
+        p->call_back(&c->out, p->args);
+    }
+    write_stream(&c->out, '}');
+    write_stream(&c->out, 0);
+    write_stream(&c->out, MARKER_EOM);
+}
+
+static void write_channel_statistics(OutputStream * out, void * args) {
+    LINK * l;
+    write_stream(out, '[');
+    for (l = channel_root.next; l != &channel_root; l = l->next) {
+        Channel * c = chanlink2channelp(l);
+        if (l != channel_root.next) write_stream(out, ',');
+        write_stream(out, '{');
+        json_write_string(out, "Peer");
+        write_stream(out, ':');
+        json_write_string(out, c->peer_name);
+        write_stream(out, ',');
+        json_write_string(out, "QueuedBytes");
+        write_stream(out, ':');
+        json_write_uint64(out, c->out_queue_size);
+        write_stream(out, ',');
+        json_write_string(out, "PeakQueuedBytes");
+        write_stream(out, ':');
+        json_write_uint64(out, c->out_queue_peak);
+        write_stream(out, ',');
+        json_write_string(out, "CongestionLevel");
+        write_stream(out, ':');
+        json_write_long(out, c->congestion_level);
+        write_stream(out, ',');
+        json_write_string(out, "Congested");
+        write_stream(out, ':');
+        json_write_boolean(out, is_channel_congested(c));
+        write_stream(out, '}');
+    }
+    write_stream(out, ']');
+}
+
+#if ENABLE_SlabAlloc
+typedef struct MemPoolStatisticsArgs {
+    OutputStream * out;
+    unsigned cnt;
+} MemPoolStatisticsArgs;
+
+static void write_mem_pool(MemPoolStatistics * stats, const char ** pools, unsigned pools_cnt, void * args) {
+    MemPoolStatisticsArgs * a = (MemPoolStatisticsArgs *)args;
+    OutputStream * out = a->out;
+    unsigned i;
+    if (a->cnt++ > 0) write_stream(out, ',');
+    write_stream(out, '{');
+    json_write_string(out, "Size");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->size);
+    write_stream(out, ',');
+    json_write_string(out, "Slabs");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->slabs);
+    write_stream(out, ',');
+    json_write_string(out, "Used");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->used);
+    write_stream(out, ',');
+    json_write_string(out, "PeakUsed");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->used_max);
+    write_stream(out, ',');
+    json_write_string(out, "Allocs");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->allocs);
+    write_stream(out, ',');
+    json_write_string(out, "Frees");
+    write_stream(out, ':');
+    json_write_uint64(out, stats->frees);
+    if (pools_cnt > 0) {
+        write_stream(out, ',');
+        json_write_string(out, "Pools");
+        write_stream(out, ':');
+        write_stream(out, '[');
+        for (i = 0; i < pools_cnt; i++) {
+            if (i > 0) write_stream(out, ',');
+            json_write_string(out, pools[i]);
+        }
+        write_stream(out, ']');
+    }
+    write_stream(out, '}');
+}
+
+static void write_mem_pool_statistics(OutputStream * out, void * args) {
+    MemPoolStatisticsArgs a;
+    a.out = out;
+    a.cnt = 0;
+    write_stream(out, '[');
+    mem_pool_statistics(write_mem_pool, &a);
+    write_stream(out, ']');
+}
+#endif /* ENABLE_SlabAlloc */
+
+#if ENABLE_EventStatistics
+
+typedef struct HandlerStatisticsInfo {
+    void * handler;
+    const char * service;
+    const char * name;
+    LatencyStatistics * stats;
+} HandlerStatisticsInfo;
+
+typedef struct HandlerStatisticsList {
+    HandlerStatisticsInfo * arr;
+    unsigned cnt;
+    unsigned max;
+} HandlerStatisticsList;
+
+static char * event_stats_file = NULL;
+static unsigned long event_stats_period = 60;
+
+static void write_latency_statistics(OutputStream * out, LatencyStatistics * s) {
+    unsigned i;
+    unsigned n = LATENCY_HISTOGRAM_SIZE;
+    while (n > 0 && s->histogram[n - 1] == 0) n--;
+    json_write_string(out, "Count");
+    write_stream(out, ':');
+    json_write_uint64(out, s->count);
+    write_stream(out, ',');
+    json_write_string(out, "TotalTime");
+    write_stream(out, ':');
+    json_write_uint64(out, s->total_ns / 1000);
+    write_stream(out, ',');
+    json_write_string(out, "MaxTime");
+    write_stream(out, ':');
+    json_write_uint64(out, s->max_ns / 1000);
+    write_stream(out, ',');
+    json_write_string(out, "Histogram");
+    write_stream(out, ':');
+    write_stream(out, '[');
+    for (i = 0; i < n; i++) {
+        if (i > 0) write_stream(out, ',');
+        json_write_ulong(out, s->histogram[i]);
+    }
+    write_stream(out, ']');
+}
+
+static HandlerStatisticsInfo * add_statistics_info(HandlerStatisticsList * list, LatencyStatistics * s) {
+    HandlerStatisticsInfo * info = NULL;
+    if (list->cnt >= list->max) {
+        list->max = list->max ? list->max * 2 : 64;
+        list->arr = (HandlerStatisticsInfo *)loc_realloc(list->arr, sizeof(HandlerStatisticsInfo) * list->max);
+    }
+    info = list->arr + list->cnt++;
+    memset(info, 0, sizeof(HandlerStatisticsInfo));
+    info->stats = s;
+    return info;
+}
+
+static void add_handler_statistics(void * handler, LatencyStatistics * s, void * args) {
+    add_statistics_info((HandlerStatisticsList *)args, s)->handler = handler;
+}
+
+static void add_command_statistics(const char * service, const char * name, LatencyStatistics * s, void * args) {
+    HandlerStatisticsInfo * info = add_statistics_info((HandlerStatisticsList *)args, s);
+    info->service = service;
+    info->name = name;
+}
+
+static int cmp_handler_statistics(const void * x, const void * y) {
+    const HandlerStatisticsInfo * a = (const HandlerStatisticsInfo *)x;
+    const HandlerStatisticsInfo * b = (const HandlerStatisticsInfo *)y;
+    if (a->stats->total_ns > b->stats->total_ns) return -1;
+    if (a->stats->total_ns < b->stats->total_ns) return +1;
+    return 0;
+}
+
+#if ENABLE_EventStatisticsSymbols
+
+typedef struct HandlerName {
+    void * handler;
+    char * name;    /* NULL if the handler has no symbol */
+} HandlerName;
+
+/* Open addressing table of handler names, handlers are never unloaded */
+static HandlerName * handler_names = NULL;
+static unsigned handler_names_size = 0;
+static unsigned handler_names_cnt = 0;
+
+static unsigned hash_handler(void * handler) {
+    return (unsigned)(((uint64_t)(uintptr_t)handler * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+static HandlerName * find_handler_name(void * handler) {
+    unsigned mask = handler_names_size - 1;
+    unsigned h = hash_handler(handler) & mask;
+    for (;;) {
+        HandlerName * n = handler_names + h;
+        if (n->handler == NULL || n->handler == handler) return n;
+        h = (h + 1) & mask;
+    }
+}
+
+static HandlerName * add_handler_name(void * handler) {
+    HandlerName * n = NULL;
+    if ((handler_names_cnt + 1) * 2 > handler_names_size) {
+        HandlerName * old = handler_names;
+        unsigned old_size = handler_names_size;
+        unsigned i;
+        handler_names_size = old_size ? old_size * 2 : 256;
+        handler_names = (HandlerName *)loc_alloc_zero(sizeof(HandlerName) * handler_names_size);
+        for (i = 0; i < old_size; i++) {
+            if (old[i].handler != NULL) *find_handler_name(old[i].handler) = old[i];
+        }
+        loc_free(old);
+    }
+    n = find_handler_name(handler);
+    assert(n->handler == NULL);
+    n->handler = handler;
+    handler_names_cnt++;
+    return n;
+}
+
+/* Find name of a function in the agent executable */
+static char * read_handler_name(ELF_File * file, uint64_t bias, void * handler) {
+    Trap trap;
+    char * name = NULL;
+    uint64_t addr = (uintptr_t)handler - bias;
+    if (set_trap(&trap)) {
+        unsigned i;
+        for (i = 1; i < file->section_cnt; i++) {
+            ELF_Section * sec = file->sections + i;
+            if ((sec->flags & SHF_EXECINSTR) == 0) continue;
+            if (addr < sec->addr || addr >= sec->addr + sec->size) continue;
+            {
+                ELF_SymbolInfo info;
+                elf_find_symbol_by_address(sec, addr, &info);
+                if (info.type == STT_FUNC && info.name != NULL) name = loc_strdup(info.name);
+            }
+            break;
+        }
+        clear_trap(&trap);
+    }
+    return name;
+}
+
+static ELF_File * open_agent_file(uint64_t * bias) {
+    ELF_File * file = elf_open("/proc/self/exe");
+    unsigned i;
+    *bias = 0;
+    if (file == NULL) return NULL;
+    for (i = 0; i < file->pheader_cnt; i++) {
+        ELF_PHeader * p = file->pheaders + i;
+        if (p->type == PT_PHDR) {
+            *bias = getauxval(AT_PHDR) - p->address;
+            break;
+        }
+    }
+    return file;
+}
+
+/* Symbolize handlers once, the agent executable is opened only if there are new handlers */
+static const char * get_handler_name(ELF_File ** file, uint64_t * bias, int * opened, void * handler) {
+    HandlerName * n = NULL;
+    if (handler_names_size > 0) n = find_handler_name(handler);
+    if (n != NULL && n->handler == handler) return n->name;
+    if (!*opened) {
+        *file = open_agent_file(bias);
+        *opened = 1;
+    }
+    n = add_handler_name(handler);
+    if (*file != NULL) n->name = read_handler_name(*file, *bias, handler);
+    return n->name;
+}
+#endif
+
+static void write_event_statistics(OutputStream * out) {
+    EventLoopStatistics * e = &event_loop_stats;
+    HandlerStatisticsList list;
+    unsigned i;
+#if ENABLE_EventStatisticsSymbols
+    uint64_t bias = 0;
+    ELF_File * file = NULL;
+    int file_opened = 0;
+#endif
+
+    write_stream(out, '{');
+    json_write_string(out, "Time");
+    write_stream(out, ':');
+    json_write_uint64(out, (event_stats_time() - e->reset_time_ns) / 1000);
+    write_stream(out, ',');
+    json_write_string(out, "Enabled");
+    write_stream(out, ':');
+    json_write_boolean(out, event_stats_enabled);
+    write_stream(out, ',');
+    json_write_string(out, "Events");
+    write_stream(out, ':');
+    json_write_uint64(out, e->events);
+    write_stream(out, ',');
+    json_write_string(out, "QueueDepth");
+    write_stream(out, ':');
+    json_write_ulong(out, e->queue_depth);
+    write_stream(out, ',');
+    json_write_string(out, "QueueDepthMax");
+    write_stream(out, ':');
+    json_write_ulong(out, e->queue_depth_max);
+    write_stream(out, ',');
+    json_write_string(out, "QueueDepthAvg");
+    write_stream(out, ':');
+    json_write_double(out, e->events ? (double)e->queue_depth_sum / e->events : 0);
+    write_stream(out, ',');
+    json_write_string(out, "Timers");
+    write_stream(out, ':');
+    json_write_ulong(out, e->timers);
+    write_stream(out, ',');
+    json_write_string(out, "TimersMax");
+    write_stream(out, ':');
+    json_write_ulong(out, e->timers_max);
+    write_stream(out, ',');
+    json_write_string(out, "PostedBatchMax");
+    write_stream(out, ':');
+    json_write_ulong(out, e->posted_batch_max);
+    write_stream(out, ',');
+    json_write_string(out, "Lag");
+    write_stream(out, ':');
+    write_stream(out, '{');
+    write_latency_statistics(out, &e->lag);
+    write_stream(out, '}');
+    write_stream(out, ',');
+
+    memset(&list, 0, sizeof(list));
+    event_stats_iterate_handlers(add_handler_statistics, &list);
+    qsort(list.arr, list.cnt, sizeof(HandlerStatisticsInfo), cmp_handler_statistics);
+    json_write_string(out, "Handlers");
+    write_stream(out, ':');
+    write_stream(out, '[');
+    for (i = 0; i < list.cnt; i++) {
+        HandlerStatisticsInfo * h = list.arr + i;
+        char addr[32];
+        if (i > 0) write_stream(out, ',');
+        write_stream(out, '{');
+        snprintf(addr, sizeof(addr), "%#" PRIxPTR, (uintptr_t)h->handler);
+        json_write_string(out, "Address");
+        write_stream(out, ':');
+        json_write_string(out, addr);
+        write_stream(out, ',');
+#if ENABLE_EventStatisticsSymbols
+        {
+            const char * name = get_handler_name(&file, &bias, &file_opened, h->handler);
+            if (name != NULL) {
+                json_write_string(out, "Name");
+                write_stream(out, ':');
+                json_write_string(out, name);
+                write_stream(out, ',');
+            }
+        }
+#endif
+        write_latency_statistics(out, h->stats);
+        write_stream(out, '}');
+    }
+    write_stream(out, ']');
+    write_stream(out, ',');
+
+    list.cnt = 0;
+    event_stats_iterate_commands(add_command_statistics, &list);
+    qsort(list.arr, list.cnt, sizeof(HandlerStatisticsInfo), cmp_handler_statistics);
+    json_write_string(out, "Commands");
+    write_stream(out, ':');
+    write_stream(out, '[');
+    for (i = 0; i < list.cnt; i++) {
+        HandlerStatisticsInfo * h = list.arr + i;
+        if (i > 0) write_stream(out, ',');
+        write_stream(out, '{');
+        json_write_string(out, "Service");
+        write_stream(out, ':');
+        json_write_string(out, h->service);
+        write_stream(out, ',');
+        json_write_string(out, "Command");
+        write_stream(out, ':');
+        json_write_string(out, h->name);
+        write_stream(out, ',');
+        write_latency_statistics(out, h->stats);
+        write_stream(out, '}');
+    }
+    write_stream(out, ']');
+    write_stream(out, '}');
+    loc_free(list.arr);
+}
+
+static void command_get_event_statistics(char * token, Channel * c) {
+    int reset = json_read_boolean(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, 0);
+    write_event_statistics(&c->out);
+    write_stream(&c->out, 0);
+    write_stream(&c->out, MARKER_EOM);
+    if (reset) event_stats_reset();
+}
+
+static void command_set_event_statistics(char * token, Channel * c) {
+    int enable = json_read_boolean(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+
+    event_stats_enable(enable);
+
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, 0);
+    write_stream(&c->out, MARKER_EOM);
+}
+
+static void dump_event_statistics(void * args) {
+    ByteArrayOutputStream buf;
+    OutputStream * out = create_byte_array_output_stream(&buf);
+    char tmp[FILE_PATH_SIZE];
+    char * data = NULL;
+    size_t size = 0;
+    int error = 0;
+    FILE * f = NULL;
+
+    write_event_statistics(out);
+    write_stream(out, '\n');
+    get_byte_array_output_stream_data(&buf, &data, &size);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", event_stats_file);
+    f = fopen(tmp, "w");
+    if (f == NULL) error = errno;
+    if (!error && fwrite(data, 1, size, f) != size) error = errno;
+    if (f != NULL && fclose(f) != 0 && !error) error = errno;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    if (!error) remove(event_stats_file);
+#endif
+    if (!error && rename(tmp, event_stats_file) != 0) error = errno;
+    if (error) trace(LOG_ALWAYS, "Cannot write event statistics file %s: %s", event_stats_file, errno_to_str(error));
+    loc_free(data);
+    post_event_with_delay(dump_event_statistics, NULL, event_stats_period * 1000000);
+}
+
+static void ini_event_statistics_dump(void) {
+    const char * file = getenv("TCF_EVENT_STATS_FILE");
+    const char * period = getenv("TCF_EVENT_STATS_PERIOD");
+    if (event_stats_file != NULL || file == NULL || *file == 0) return;
+    event_stats_file = loc_strdup(file);
+    if (period != NULL && atol(period) > 0) event_stats_period = (unsigned long)atol(period);
+    /* Periodic dump is requested when the agent starts, so timing is collected from the start */
+    event_stats_enable(1);
+    post_event_with_delay(dump_event_statistics, NULL, event_stats_period * 1000000);
+}
+
+#endif /* ENABLE_EventStatistics */
+
+void add_diagnostics_statistics(const char * name, DiagnosticsStatisticsCallBack * call_back, void * args) {
+    StatisticsProvider * p = NULL;
+    if (stat_providers_cnt >= stat_providers_max) {
+        stat_providers_max += 8;
+        stat_providers = (StatisticsProvider *)loc_realloc(stat_providers, sizeof(StatisticsProvider) * stat_providers_max);
+    }
+    p = stat_providers + stat_providers_cnt++;
+    p->name = name;
+    p->call_back = call_back;
+    p->args = args;
+}
+
 void ini_diagnostics_service(Protocol * proto) {
     add_command_handler(proto, DIAGNOSTICS, "echo", command_echo);
     add_command_handler(proto, DIAGNOSTICS, "echoFP", command_echo_fp);
@@ -479,6 +976,16 @@ void ini_diagnostics_service(Protocol * proto) {
     add_command_handler(proto, DIAGNOSTICS, "getSymbol", command_get_symbol);
     add_command_handler(proto, DIAGNOSTICS, "createTestStreams", command_create_test_streams);
     add_command_handler(proto, DIAGNOSTICS, "disposeTestStream", command_dispose_test_stream);
+    add_command_handler(proto, DIAGNOSTICS, "getStatistics", command_get_statistics);
+    add_diagnostics_statistics("Channels", write_channel_statistics, NULL);
+#if ENABLE_SlabAlloc
+    add_diagnostics_statistics("MemoryPools", write_mem_pool_statistics, NULL);
+#endif
+#if ENABLE_EventStatistics
+    add_command_handler(proto, DIAGNOSTICS, "getEventStatistics", command_get_event_statistics);
+    add_command_handler(proto, DIAGNOSTICS, "setEventStatistics", command_set_event_statistics);
+    ini_event_statistics_dump();
+#endif
 #if ENABLE_RCBP_TEST
     context_extension_offset = context_extension(sizeof(ContextExtensionDiag));
     add_channel_close_listener(channel_close_listener);
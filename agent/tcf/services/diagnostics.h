@@ -39,6 +39,19 @@ extern void test_process_done(Context * ctx);
 
 #endif /* ENABLE_RCBP_TEST */
 
+/*
+ * Statistics call back: write statistics of a module as JSON object.
+ */
+typedef void DiagnosticsStatisticsCallBack(OutputStream * out, void * args);
+
+/*
+ * Register module statistics.
+ * The statistics are reported by Diagnostics.getStatistics command.
+ * The command result is JSON object that has a property for each registered module,
+ * 'name' is the property name, and the value is written by 'call_back'.
+ */
+extern void add_diagnostics_statistics(const char * name, DiagnosticsStatisticsCallBack * call_back, void * args);
+
 extern void ini_diagnostics_service(Protocol *);
 
 #endif /* D_diagnostics */
@@ -52,6 +52,7 @@
 #include <tcf/framework/peer.h>
 #include <tcf/framework/ip_ifc.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
 #include <tcf/services/discovery.h>
 #include <tcf/services/discovery_udp.h>
 
@@ -268,7 +269,10 @@ static int create_server_socket(void) {
         return set_fmt_errno(error, "Socket %s error", reason);
     }
 
-    if (udp_server_socket >= 0) closesocket(udp_server_socket);
+    if (udp_server_socket >= 0) {
+        reactor_close(udp_server_socket);
+        closesocket(udp_server_socket);
+    }
     udp_server_port = ntohs(local_addr.sin_port);
     udp_server_socket = sock;
     udp_server_generation++;
@@ -24,12 +24,22 @@
 #if ENABLE_ELF && ENABLE_DebugContext
 
 #include <assert.h>
+#include <stddef.h>
+#include <tcf/framework/asyncreq.h>
+#include <tcf/framework/cache.h>
+#include <tcf/framework/events.h>
 #include <tcf/framework/exceptions.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/trace.h>
 #include <tcf/services/dwarf.h>
 #include <tcf/services/dwarfcache.h>
+#include <tcf/services/dwarfreloc.h>
+#include <tcf/services/dwarfindexcache.h>
+#include <tcf/services/dwarfnames.h>
 #include <tcf/services/dwarfexpr.h>
+#include <tcf/services/diagnostics.h>
 #include <tcf/services/stacktrace.h>
 
 #define OBJ_HASH(HashTable,ID) (((U4_T)(ID) + ((U4_T)(ID) >> 8)) % HashTable->mObjectHashSize)
@@ -63,6 +73,97 @@ static U4_T sObjRefsMax = 0;
 
 static int sCloseListenerOK = 0;
 
+/* Process-wide index of source files that have line number information */
+static FileInfo ** sSourceIndex = NULL;
+static unsigned sSourceIndexSize = 0;
+static unsigned sSourceIndexCnt = 0;
+
+#if ENABLE_DWARF_LAZY_LOAD
+/* LRU list of lazily loaded compilation units, most recently used first */
+static LINK sUnitLRU = TCF_LIST_INIT(sUnitLRU);
+static size_t sUnitLRUObjectCnt = 0;
+/* Objects of disposed units that are kept in free lists of DWARF caches */
+static size_t sObjectFreeCnt = 0;
+
+#define cachelink2unit(A) ((CompUnit *)((char *)(A) - offsetof(CompUnit, mCacheLink)))
+#endif
+
+/* LRU lists of line number states and frame info search indexes, most recently used first */
+static LINK sLineStatesLRU = TCF_LIST_INIT(sLineStatesLRU);
+static LINK sFrameInfoLRU = TCF_LIST_INIT(sFrameInfoLRU);
+static size_t sLineStatesSize = 0;
+static size_t sFrameInfoSize = 0;
+
+/* Memory limit for disposable parts of DWARF caches, see DWARF_CACHE_MEMORY_LIMIT */
+static size_t sMemoryLimit = DWARF_CACHE_MEMORY_LIMIT;
+static unsigned sUseClock = 0;
+static int sEvictPosted = 0;
+static unsigned sEvictCnt = 0;
+static uint64_t sEvictedSize = 0;
+
+/* List of all DWARF caches */
+static LINK sCacheList = TCF_LIST_INIT(sCacheList);
+
+#define item2unit(A) ((CompUnit *)((char *)(A) - offsetof(CompUnit, mLineStatesItem)))
+#define item2frame(A) ((FrameInfoIndex *)((char *)(A) - offsetof(FrameInfoIndex, mItem)))
+#define link2cache(A) ((DWARFCache *)((char *)(A) - offsetof(DWARFCache, mLink)))
+
+static void evict_cache_event(void * args);
+
+static size_t get_disposable_size(void) {
+    size_t size = sLineStatesSize + sFrameInfoSize;
+#if ENABLE_DWARF_LAZY_LOAD
+    size += (sUnitLRUObjectCnt + sObjectFreeCnt) * sizeof(ObjectInfo);
+#endif
+    return size;
+}
+
+static void check_memory_limit(void) {
+    if (sEvictPosted || sMemoryLimit == 0) return;
+    if (get_disposable_size() <= sMemoryLimit) return;
+    /* Cached data must stay in memory until end of the current event dispatch cycle */
+    post_event(evict_cache_event, NULL);
+    sEvictPosted = 1;
+}
+
+static void add_cache_item(LINK * lru, DWARFCacheItem * item, size_t * lru_size) {
+    assert(item->mLink.next == NULL);
+    list_add_first(&item->mLink, lru);
+    item->mLastUse = ++sUseClock;
+    *lru_size += item->mSize;
+    check_memory_limit();
+}
+
+static void touch_cache_item(LINK * lru, DWARFCacheItem * item) {
+    item->mLastUse = ++sUseClock;
+    if (lru->next == &item->mLink) return;
+    list_remove(&item->mLink);
+    list_add_first(&item->mLink, lru);
+}
+
+static void remove_cache_item(DWARFCacheItem * item, size_t * lru_size) {
+    if (item->mLink.next == NULL) return;
+    list_remove(&item->mLink);
+    item->mLink.next = item->mLink.prev = NULL;
+    *lru_size -= item->mSize;
+}
+
+#if ENABLE_DWARF_LAZY_LOAD
+static void touch_unit(CompUnit * Unit) {
+    if (Unit->mCacheLink.next == NULL) return;
+    Unit->mLastUse = ++sUseClock;
+    if (sUnitLRU.next == &Unit->mCacheLink) return;
+    list_remove(&Unit->mCacheLink);
+    list_add_first(&Unit->mCacheLink, &sUnitLRU);
+}
+
+static void add_unit_object(CompUnit * Unit) {
+    Unit->mObjectCnt++;
+    sUnitLRUObjectCnt++;
+    check_memory_limit();
+}
+#endif
+
 unsigned calc_file_name_hash(const char * s) {
     unsigned h = 0;
     if (s != NULL) {
@@ -92,13 +193,24 @@ static ObjectInfo * add_object_info(ContextAddress ID) {
         if (ID < sDebugSection->addr) str_exception(ERR_INV_DWARF, "Invalid entry reference");
         if (ID > sDebugSection->addr + sDebugSection->size) str_exception(ERR_INV_DWARF, "Invalid entry reference");
     }
-    if (sCache->mObjectArrayPos >= OBJECT_ARRAY_SIZE) {
-        ObjectArray * Buf = (ObjectArray *)loc_alloc_zero(sizeof(ObjectArray));
-        Buf->mNext = sCache->mObjectList;
-        sCache->mObjectList = Buf;
-        sCache->mObjectArrayPos = 0;
+    if (sCache->mObjectFree != NULL) {
+        Info = sCache->mObjectFree;
+        sCache->mObjectFree = Info->mHashNext;
+        sCache->mObjectFreeCnt--;
+#if ENABLE_DWARF_LAZY_LOAD
+        sObjectFreeCnt--;
+#endif
+        memset(Info, 0, sizeof(ObjectInfo));
+    }
+    else {
+        if (sCache->mObjectArrayPos >= OBJECT_ARRAY_SIZE) {
+            ObjectArray * Buf = (ObjectArray *)loc_alloc_zero(sizeof(ObjectArray));
+            Buf->mNext = sCache->mObjectList;
+            sCache->mObjectList = Buf;
+            sCache->mObjectArrayPos = 0;
+        }
+        Info = sCache->mObjectList->mArray + sCache->mObjectArrayPos++;
     }
-    Info = sCache->mObjectList->mArray + sCache->mObjectArrayPos++;
     Info->mHashNext = HashTable->mObjectHash[Hash];
     HashTable->mObjectHash[Hash] = Info;
     Info->mID = ID;
@@ -196,7 +308,12 @@ ObjectInfo * find_object(ELF_Section * Section, ContextAddress ID) {
     ObjectHashTable * HashTable = Cache->mObjectHashTable + Section->index;
     ObjectInfo * Info = HashTable->mObjectHash[OBJ_HASH(HashTable, ID)];
     while (Info != NULL) {
-        if (Info->mID == ID) return Info;
+        if (Info->mID == ID) {
+#if ENABLE_DWARF_LAZY_LOAD
+            if (Info->mCompUnit != NULL) touch_unit(Info->mCompUnit);
+#endif
+            return Info;
+        }
         Info = Info->mHashNext;
     }
 #if ENABLE_DWARF_LAZY_LOAD
@@ -206,6 +323,7 @@ ObjectInfo * find_object(ELF_Section * Section, ContextAddress ID) {
         sCompUnit = find_comp_unit(Section, ID);
         if (sCompUnit != NULL) {
             Trap trap;
+            touch_unit(sCompUnit);
             sUnitDesc = sCompUnit->mDesc;
             sDebugSection = sUnitDesc.mSection;
             sParentObject = NULL;
@@ -559,6 +677,9 @@ static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
             }
             Info->mTag = Tag;
             Info->mCompUnit = sCompUnit;
+#if ENABLE_DWARF_LAZY_LOAD
+            if (sCompUnit->mCacheLink.next != NULL) add_unit_object(sCompUnit);
+#endif
         }
         else {
             /* Finalization: executed after debug entry processing */
@@ -651,6 +772,12 @@ static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
                     sCache->lazy_loaded = 1;
                     dio_SetPos(Sibling);
                     return;
+                case TAG_compile_unit:
+                    /* Unit children are loaded on first access, and can be disposed when not used */
+                    list_add_first(&sCompUnit->mCacheLink, &sUnitLRU);
+                    sCache->lazy_loaded = 1;
+                    dio_SetPos(Sibling);
+                    return;
                 }
             }
 #endif
@@ -1172,8 +1299,7 @@ static void load_addr_ranges(ELF_Section * debug_info) {
             {
                 /* Workaround for GCC bug - certain ranges are missing in both ".debug_aranges" and the unit info.
                  * Add address ranges of the underlying scopes. */
-                ObjectInfo * obj = info->mChildren;
-                assert(info->mFlags & DOIF_children_loaded);
+                ObjectInfo * obj = get_dwarf_children(info);
                 while (obj != NULL) {
                     if (obj->mFlags & DOIF_low_pc) add_object_addr_ranges(obj);
                     obj = obj->mSibling;
@@ -1215,6 +1341,88 @@ static void load_addr_ranges(ELF_Section * debug_info) {
     }
 }
 
+static void build_addr_ranges_search_index(void) {
+    unsigned i;
+    uint64_t * keys = addr_index_alloc(&sCache->mAddrRangesIndex, sCache->mAddrRangesCnt);
+    for (i = 0; i < sCache->mAddrRangesCnt; i++) keys[i] = sCache->mAddrRanges[i].mAddr;
+    addr_index_build(&sCache->mAddrRangesIndex);
+}
+
+#if ENABLE_DWARF_INDEX_CACHE
+
+/* Unit address range record in the persistent index */
+typedef struct AddrRangeRecord {
+    U8_T mUnitID;
+    U4_T mUnitSection;
+    U4_T mSection;
+    U8_T mAddr;
+    U8_T mSize;
+} AddrRangeRecord;
+
+typedef struct AddrRangesHeader {
+    U8_T mMaxSize;
+    U4_T mCnt;
+    U4_T mRelocatable;
+} AddrRangesHeader;
+
+static int load_addr_ranges_index(void) {
+    size_t size = 0;
+    unsigned i;
+    const AddrRangesHeader * hdr = (const AddrRangesHeader *)dwarf_index_find(sCache, DWARF_INDEX_ADDR_RANGES, &size);
+    const AddrRangeRecord * recs = NULL;
+    ELF_File * file = sCache->mFile;
+
+    if (hdr == NULL || size < sizeof(AddrRangesHeader)) return 0;
+    if (size != sizeof(AddrRangesHeader) + sizeof(AddrRangeRecord) * hdr->mCnt) return 0;
+    recs = (const AddrRangeRecord *)(hdr + 1);
+    sCache->mAddrRangesMax = hdr->mCnt;
+    sCache->mAddrRanges = (UnitAddressRange *)loc_alloc(sizeof(UnitAddressRange) * (hdr->mCnt ? hdr->mCnt : 1));
+    for (i = 0; i < hdr->mCnt; i++) {
+        const AddrRangeRecord * r = recs + i;
+        UnitAddressRange * range = sCache->mAddrRanges + i;
+        if (r->mUnitSection == 0 || r->mUnitSection >= file->section_cnt || r->mSection >= file->section_cnt) break;
+        range->mUnit = find_comp_unit(file->sections + r->mUnitSection, (ContextAddress)r->mUnitID);
+        if (range->mUnit == NULL || range->mUnit->mObject->mID != (ContextAddress)r->mUnitID) break;
+        range->mSection = r->mSection;
+        range->mAddr = (ContextAddress)r->mAddr;
+        range->mSize = (ContextAddress)r->mSize;
+    }
+    if (i < hdr->mCnt) {
+        trace(LOG_ELF, "Ignoring invalid DWARF index cache of %s", file->name);
+        loc_free(sCache->mAddrRanges);
+        sCache->mAddrRanges = NULL;
+        sCache->mAddrRangesMax = 0;
+        return 0;
+    }
+    sCache->mAddrRangesCnt = hdr->mCnt;
+    sCache->mAddrRangesMaxSize = (ContextAddress)hdr->mMaxSize;
+    sCache->mAddrRangesRelocatable = hdr->mRelocatable;
+    return 1;
+}
+
+static void save_addr_ranges_index(void) {
+    unsigned i;
+    size_t size = sizeof(AddrRangesHeader) + sizeof(AddrRangeRecord) * sCache->mAddrRangesCnt;
+    AddrRangesHeader * hdr = (AddrRangesHeader *)loc_alloc_zero(size);
+    AddrRangeRecord * recs = (AddrRangeRecord *)(hdr + 1);
+    hdr->mMaxSize = sCache->mAddrRangesMaxSize;
+    hdr->mCnt = sCache->mAddrRangesCnt;
+    hdr->mRelocatable = sCache->mAddrRangesRelocatable;
+    for (i = 0; i < sCache->mAddrRangesCnt; i++) {
+        UnitAddressRange * range = sCache->mAddrRanges + i;
+        AddrRangeRecord * r = recs + i;
+        r->mUnitID = range->mUnit->mObject->mID;
+        r->mUnitSection = range->mUnit->mDesc.mSection->index;
+        r->mSection = range->mSection;
+        r->mAddr = range->mAddr;
+        r->mSize = range->mSize;
+    }
+    dwarf_index_store(sCache, DWARF_INDEX_ADDR_RANGES, hdr, size);
+    loc_free(hdr);
+}
+
+#endif /* ENABLE_DWARF_INDEX_CACHE */
+
 static int cmp_pub_objects(ObjectInfo * x, ObjectInfo * y) {
     static const U4_T flags =
         DOIF_declaration |
@@ -1265,6 +1473,10 @@ static int cmp_pub_objects(ObjectInfo * x, ObjectInfo * y) {
 static void add_pub_name(PubNamesTable * tbl, ObjectInfo * obj) {
     PubNamesInfo * info = NULL;
     unsigned h = calc_symbol_name_hash(obj->mName) % tbl->mHashSize;
+#if ENABLE_DWARF_NAMES
+    /* The name is found by the accelerator table */
+    if (sCache->mNameIndex != NULL && dwarf_names_covers_unit(sCache, obj->mCompUnit)) return;
+#endif
     obj->mFlags |= DOIF_pub_mark;
     switch (obj->mTag) {
     case TAG_base_type:
@@ -1280,9 +1492,12 @@ static void add_pub_name(PubNamesTable * tbl, ObjectInfo * obj) {
             /* Check for duplicates */
             unsigned n = tbl->mHash[h];
             while (n != 0) {
-                ObjectInfo * pub = tbl->mNext[n].mObject;
-                if (pub->mTag == obj->mTag && cmp_pub_objects(pub, obj)) return;
-                n = tbl->mNext[n].mNext;
+                PubNamesInfo * pub = tbl->mNext + n;
+                if (strcmp(pub->mName, obj->mName) == 0) {
+                    ObjectInfo * x = find_loaded_object(sCache->mFile->sections + pub->mSection, pub->mID);
+                    if (x->mTag == obj->mTag && cmp_pub_objects(x, obj)) return;
+                }
+                n = pub->mNext;
             }
         }
     }
@@ -1291,7 +1506,9 @@ static void add_pub_name(PubNamesTable * tbl, ObjectInfo * obj) {
         tbl->mNext = (PubNamesInfo *)loc_realloc(tbl->mNext, sizeof(PubNamesInfo) * tbl->mMax);
     }
     info = tbl->mNext + tbl->mCnt;
-    info->mObject = obj;
+    info->mSection = obj->mCompUnit->mDesc.mSection->index;
+    info->mID = obj->mID;
+    info->mName = obj->mName;
     info->mNext = tbl->mHash[h];
     tbl->mHash[h] = tbl->mCnt++;
 }
@@ -1364,6 +1581,12 @@ static void create_pub_names(unsigned idx) {
     ObjectInfo * unit = sCache->mObjectHashTable[idx].mCompUnits;
     PubNamesTable * tbl = &sCache->mPubNames;
     while (unit != NULL) {
+#if ENABLE_DWARF_NAMES
+        if (sCache->mNameIndex != NULL && dwarf_names_covers_unit(sCache, unit->mCompUnit)) {
+            unit = unit->mSibling;
+            continue;
+        }
+#endif
         add_namespace(tbl, unit);
         if ((unit->mFlags & DOIF_pub_mark) == 0 && unit->mName != NULL) {
             add_pub_name(tbl, unit);
@@ -1434,6 +1657,151 @@ static void load_debug_info_section(ELF_Section * sec) {
     read_object_refs(sec);
 }
 
+static void load_pub_names_table(ELF_Section * debug_info) {
+    Trap trap;
+    unsigned idx;
+    ELF_File * file = sCache->mFile;
+    PubNamesTable * tbl = &sCache->mPubNames;
+    tbl->mHashSize = tbl->mMax = (unsigned)(debug_info->size / 151) + 16;
+    tbl->mHash = (unsigned *)loc_alloc_zero(sizeof(unsigned) * tbl->mHashSize);
+    tbl->mNext = (PubNamesInfo *)loc_alloc(sizeof(PubNamesInfo) * tbl->mMax);
+    memset(tbl->mNext + tbl->mCnt++, 0, sizeof(PubNamesInfo));
+    if (set_trap(&trap)) {
+        for (idx = 1; idx < file->section_cnt; idx++) {
+            ELF_Section * sec = file->sections + idx;
+            if (sec->size == 0) continue;
+            if (sec->name == NULL) continue;
+            if (sec->type == SHT_NOBITS) continue;
+            if (strcmp(sec->name, ".debug_pubnames") == 0 || strcmp(sec->name, ".debug_pubtypes") == 0) {
+                load_pub_names(debug_info, sec);
+            }
+        }
+        clear_trap(&trap);
+    }
+    else {
+        trace(LOG_ELF, "Ignoring broken public names sections: %s.", errno_to_str(errno));
+        memset(tbl->mHash, 0, sizeof(unsigned) * tbl->mHashSize);
+        tbl->mCnt = 1;
+    }
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        create_pub_names(idx);
+    }
+}
+
+#if ENABLE_DWARF_INDEX_CACHE
+
+/* Public names table in the persistent index: header, hash, entries, then names */
+typedef struct PubNamesHeader {
+    U4_T mHashSize;
+    U4_T mCnt;
+    U8_T mNamesSize;
+} PubNamesHeader;
+
+typedef struct PubNameRecord {
+    U8_T mID;
+    U8_T mName;             /* Offset in the names */
+    U4_T mSection;
+    U4_T mNext;
+} PubNameRecord;
+
+#define PUB_NAMES_HASH_SIZE(n) (((n) * sizeof(U4_T) + 7) & ~(size_t)7)
+
+static int load_pub_names_index(void) {
+    size_t size = 0;
+    unsigned i;
+    const PubNamesHeader * hdr = (const PubNamesHeader *)dwarf_index_find(sCache, DWARF_INDEX_PUB_NAMES, &size);
+    const U4_T * hash = NULL;
+    const PubNameRecord * recs = NULL;
+    const char * names = NULL;
+    ELF_File * file = sCache->mFile;
+    PubNamesTable * tbl = &sCache->mPubNames;
+    int valid = 1;
+
+    if (hdr == NULL || size < sizeof(PubNamesHeader)) return 0;
+    if (hdr->mHashSize == 0 || hdr->mCnt == 0 || hdr->mNamesSize == 0) return 0;
+    if (size != sizeof(PubNamesHeader) + PUB_NAMES_HASH_SIZE(hdr->mHashSize) +
+        sizeof(PubNameRecord) * hdr->mCnt + hdr->mNamesSize) return 0;
+    hash = (const U4_T *)(hdr + 1);
+    recs = (const PubNameRecord *)((const U1_T *)hash + PUB_NAMES_HASH_SIZE(hdr->mHashSize));
+    names = (const char *)(recs + hdr->mCnt);
+    for (i = 0; i < hdr->mHashSize && valid; i++) {
+        if (hash[i] >= hdr->mCnt) valid = 0;
+    }
+    for (i = 1; i < hdr->mCnt && valid; i++) {
+        const PubNameRecord * r = recs + i;
+        if (r->mSection == 0 || r->mSection >= file->section_cnt) valid = 0;
+        else if (r->mID < file->sections[r->mSection].addr) valid = 0;
+        else if (r->mID - file->sections[r->mSection].addr >= file->sections[r->mSection].size) valid = 0;
+        else if (r->mName >= hdr->mNamesSize) valid = 0;
+        /* Entries are added at the head of hash chains, so a chain link always points to an older entry.
+         * Checking this rejects chains that are out of bounds or cyclic in a corrupted file. */
+        else if (r->mNext >= i) valid = 0;
+    }
+    if (!valid || names[hdr->mNamesSize - 1] != 0) {
+        trace(LOG_ELF, "Ignoring invalid DWARF public names index cache of %s", file->name);
+        return 0;
+    }
+
+    /* The chunk is valid until next store, names are copied */
+    tbl->mHashSize = hdr->mHashSize;
+    tbl->mHash = (unsigned *)loc_alloc(sizeof(unsigned) * tbl->mHashSize);
+    for (i = 0; i < tbl->mHashSize; i++) tbl->mHash[i] = hash[i];
+    tbl->mNamesSize = (size_t)hdr->mNamesSize;
+    tbl->mNames = (char *)loc_alloc(tbl->mNamesSize);
+    memcpy(tbl->mNames, names, tbl->mNamesSize);
+    tbl->mCnt = tbl->mMax = hdr->mCnt;
+    tbl->mNext = (PubNamesInfo *)loc_alloc_zero(sizeof(PubNamesInfo) * tbl->mMax);
+    for (i = 1; i < tbl->mCnt; i++) {
+        const PubNameRecord * r = recs + i;
+        PubNamesInfo * info = tbl->mNext + i;
+        info->mNext = r->mNext;
+        info->mSection = r->mSection;
+        info->mID = (ContextAddress)r->mID;
+        info->mName = tbl->mNames + r->mName;
+    }
+    return 1;
+}
+
+static void save_pub_names_index(void) {
+    unsigned i;
+    size_t size = 0;
+    size_t names_size = 0;
+    size_t pos = 0;
+    PubNamesHeader * hdr = NULL;
+    U4_T * hash = NULL;
+    PubNameRecord * recs = NULL;
+    char * names = NULL;
+    PubNamesTable * tbl = &sCache->mPubNames;
+
+    for (i = 1; i < tbl->mCnt; i++) names_size += strlen(tbl->mNext[i].mName) + 1;
+    if (names_size == 0) return;
+    size = sizeof(PubNamesHeader) + PUB_NAMES_HASH_SIZE(tbl->mHashSize) + sizeof(PubNameRecord) * tbl->mCnt + names_size;
+    hdr = (PubNamesHeader *)loc_alloc_zero(size);
+    hash = (U4_T *)(hdr + 1);
+    recs = (PubNameRecord *)((U1_T *)hash + PUB_NAMES_HASH_SIZE(tbl->mHashSize));
+    names = (char *)(recs + tbl->mCnt);
+    hdr->mHashSize = tbl->mHashSize;
+    hdr->mCnt = tbl->mCnt;
+    hdr->mNamesSize = names_size;
+    for (i = 0; i < tbl->mHashSize; i++) hash[i] = tbl->mHash[i];
+    for (i = 1; i < tbl->mCnt; i++) {
+        PubNamesInfo * info = tbl->mNext + i;
+        PubNameRecord * r = recs + i;
+        size_t len = strlen(info->mName) + 1;
+        r->mID = info->mID;
+        r->mName = pos;
+        r->mSection = info->mSection;
+        r->mNext = info->mNext;
+        memcpy(names + pos, info->mName, len);
+        pos += len;
+    }
+    assert(pos == names_size);
+    dwarf_index_store(sCache, DWARF_INDEX_PUB_NAMES, hdr, size);
+    loc_free(hdr);
+}
+
+#endif /* ENABLE_DWARF_INDEX_CACHE */
+
 static void load_debug_sections(void) {
     unsigned idx;
     ELF_Section * debug_info = NULL;
@@ -1535,39 +1903,42 @@ static void load_debug_sections(void) {
     }
 
     if (debug_info != NULL) {
-        Trap trap;
-        PubNamesTable * tbl = &sCache->mPubNames;
-        tbl->mHashSize = tbl->mMax = (unsigned)(debug_info->size / 151) + 16;
-        tbl->mHash = (unsigned *)loc_alloc_zero(sizeof(unsigned) * tbl->mHashSize);
-        tbl->mNext = (PubNamesInfo *)loc_alloc(sizeof(PubNamesInfo) * tbl->mMax);
-        memset(tbl->mNext + tbl->mCnt++, 0, sizeof(PubNamesInfo));
-        if (set_trap(&trap)) {
-            for (idx = 1; idx < file->section_cnt; idx++) {
-                ELF_Section * sec = file->sections + idx;
-                if (sec->size == 0) continue;
-                if (sec->name == NULL) continue;
-                if (sec->type == SHT_NOBITS) continue;
-                if (strcmp(sec->name, ".debug_pubnames") == 0 || strcmp(sec->name, ".debug_pubtypes") == 0) {
-                    load_pub_names(debug_info, sec);
-                }
-            }
-            clear_trap(&trap);
-        }
-        else {
-            trace(LOG_ELF, "Ignoring broken public names sections: %s.", errno_to_str(errno));
-            memset(tbl->mHash, 0, sizeof(unsigned) * tbl->mHashSize);
-            tbl->mCnt = 1;
+#if ENABLE_DWARF_NAMES
+        /* If the file has an accelerator table, public names table is needed only for units that the table does not list */
+        if (!dwarf_names_open(sCache, debug_info) || !dwarf_names_is_complete(sCache))
+#endif
+#if ENABLE_DWARF_INDEX_CACHE
+        if (!load_pub_names_index()) {
+            load_pub_names_table(debug_info);
+            save_pub_names_index();
         }
-        for (idx = 1; idx < file->section_cnt; idx++) {
-            create_pub_names(idx);
+#else
+        load_pub_names_table(debug_info);
+#endif
+#if ENABLE_DWARF_INDEX_CACHE
+        if (!load_addr_ranges_index()) {
+            load_addr_ranges(debug_info);
+            save_addr_ranges_index();
         }
+#else
         load_addr_ranges(debug_info);
+#endif
+        build_addr_ranges_search_index();
     }
 }
 
+ObjectInfo * get_pub_names_object(DWARFCache * cache, PubNamesInfo * info) {
+    ObjectInfo * obj = find_object(cache->mFile->sections + info->mSection, info->mID);
+    if (obj == NULL) str_exception(ERR_INV_DWARF, "Invalid public names table entry");
+    /* Objects of disposed units are reloaded without parents */
+    get_dwarf_parent(obj);
+    return obj;
+}
+
 #if ENABLE_DWARF_LAZY_LOAD
 ObjectInfo * get_dwarf_children(ObjectInfo * obj) {
     Trap trap;
+    touch_unit(obj->mCompUnit);
     if (obj->mFlags & DOIF_children_loaded) return obj->mChildren;
     sObjRefsCnt = 0;
     sCompUnit = obj->mCompUnit;
@@ -1577,7 +1948,7 @@ ObjectInfo * get_dwarf_children(ObjectInfo * obj) {
     dio_EnterSection(&sCompUnit->mDesc, sDebugSection, obj->mID - sDebugSection->addr);
     if (set_trap(&trap)) {
         U8_T end_pos = sCompUnit->mDesc.mUnitOffs + sCompUnit->mDesc.mUnitSize;
-        if (obj->mSibling != NULL) end_pos = obj->mSibling->mID - sDebugSection->addr;
+        if (obj->mSibling != NULL && obj != sCompUnit->mObject) end_pos = obj->mSibling->mID - sDebugSection->addr;
         dio_ReadEntry(NULL, (U2_T)0xffffu);
         sParentObject = obj;
         sPrevSibling = NULL;
@@ -1970,7 +2341,66 @@ void read_and_evaluate_dwarf_object_property_with_args(
     }
 }
 
+static void link_source_index(FileInfo ** list, FileInfo * file) {
+    file->mNextInIndex = *list;
+    if (*list != NULL) (*list)->mPrevInIndex = &file->mNextInIndex;
+    file->mPrevInIndex = list;
+    *list = file;
+}
+
+static void add_source_index(FileInfo * file) {
+    if (sSourceIndexCnt >= sSourceIndexSize) {
+        unsigned size = sSourceIndexSize == 0 ? 1021 : sSourceIndexSize * 2 + 1;
+        FileInfo ** index = (FileInfo **)loc_alloc_zero(sizeof(FileInfo *) * size);
+        unsigned i;
+        for (i = 0; i < sSourceIndexSize; i++) {
+            FileInfo * f = sSourceIndex[i];
+            while (f != NULL) {
+                FileInfo * next = f->mNextInIndex;
+                link_source_index(index + f->mNameHash % size, f);
+                f = next;
+            }
+        }
+        loc_free(sSourceIndex);
+        sSourceIndex = index;
+        sSourceIndexSize = size;
+    }
+    link_source_index(sSourceIndex + file->mNameHash % sSourceIndexSize, file);
+    sSourceIndexCnt++;
+}
+
+static void remove_source_index(FileInfo * file) {
+    if (file->mPrevInIndex == NULL) return;
+    *file->mPrevInIndex = file->mNextInIndex;
+    if (file->mNextInIndex != NULL) file->mNextInIndex->mPrevInIndex = file->mPrevInIndex;
+    file->mNextInIndex = NULL;
+    file->mPrevInIndex = NULL;
+    assert(sSourceIndexCnt > 0);
+    sSourceIndexCnt--;
+}
+
+FileInfo * get_source_file_index(unsigned hash) {
+    if (sSourceIndex == NULL) return NULL;
+    return sSourceIndex[hash % sSourceIndexSize];
+}
+
+static void free_line_states(CompUnit * Unit) {
+    while (Unit->mStatesCnt > 0) {
+        loc_free(Unit->mStates[--Unit->mStatesCnt].mFileName);
+    }
+    loc_free(Unit->mStates);
+    loc_free(Unit->mStatesIndex);
+    addr_index_dispose(&Unit->mStatesAddrIndex);
+    Unit->mStates = NULL;
+    Unit->mStatesMax = 0;
+    Unit->mStatesIndex = NULL;
+    remove_cache_item(&Unit->mLineStatesItem, &sLineStatesSize);
+    Unit->mLineStatesItem.mSize = 0;
+}
+
 static void free_unit_cache(CompUnit * Unit) {
+    U4_T i;
+    for (i = 0; i < Unit->mFilesCnt; i++) remove_source_index(Unit->mFiles + i);
     Unit->mFilesCnt = 0;
     Unit->mFilesMax = 0;
     loc_free(Unit->mFiles);
@@ -1981,14 +2411,323 @@ static void free_unit_cache(CompUnit * Unit) {
     loc_free(Unit->mDirs);
     Unit->mDirs = NULL;
 
-    while (Unit->mStatesCnt > 0) {
-        loc_free(Unit->mStates[--Unit->mStatesCnt].mFileName);
+    free_line_states(Unit);
+}
+
+#if ENABLE_DWARF_LAZY_LOAD
+static int is_evicted_object(ObjectInfo * obj) {
+    return obj != NULL && obj->mCompUnit != NULL && obj->mCompUnit->mEvict && obj != obj->mCompUnit->mObject;
+}
+
+static void keep_unit(ObjectInfo * obj, int * changed) {
+    if (!is_evicted_object(obj)) return;
+    obj->mCompUnit->mEvict = 0;
+    *changed = 1;
+}
+
+static int object_array_comparator(const void * x, const void * y) {
+    uintptr_t ax = (uintptr_t)*(ObjectArray **)x;
+    uintptr_t ay = (uintptr_t)*(ObjectArray **)y;
+    if (ax < ay) return -1;
+    if (ax > ay) return +1;
+    return 0;
+}
+
+static unsigned find_object_array(ObjectArray ** arr, unsigned cnt, ObjectInfo * obj) {
+    unsigned l = 0;
+    unsigned h = cnt;
+    while (h - l > 1) {
+        unsigned k = (l + h) / 2;
+        if ((uintptr_t)arr[k] <= (uintptr_t)obj) l = k;
+        else h = k;
+    }
+    assert(obj >= arr[l]->mArray && obj < arr[l]->mArray + OBJECT_ARRAY_SIZE);
+    return l;
+}
+
+/* Free object arrays that contain only objects of disposed units */
+static void release_object_arrays(DWARFCache * cache) {
+    ObjectArray ** arr = NULL;
+    unsigned * free_cnt = NULL;
+    ObjectArray ** buf_ref = NULL;
+    ObjectInfo ** ref = NULL;
+    unsigned released = 0;
+    unsigned cnt = 0;
+    unsigned i;
+
+    if (cache->mObjectFree == NULL) return;
+    for (buf_ref = &cache->mObjectList; *buf_ref != NULL; buf_ref = &(*buf_ref)->mNext) cnt++;
+    arr = (ObjectArray **)loc_alloc(sizeof(ObjectArray *) * cnt);
+    free_cnt = (unsigned *)loc_alloc_zero(sizeof(unsigned) * cnt);
+    cnt = 0;
+    for (buf_ref = &cache->mObjectList; *buf_ref != NULL; buf_ref = &(*buf_ref)->mNext) arr[cnt++] = *buf_ref;
+    qsort(arr, cnt, sizeof(ObjectArray *), object_array_comparator);
+    for (ref = &cache->mObjectFree; *ref != NULL; ref = &(*ref)->mHashNext) {
+        free_cnt[find_object_array(arr, cnt, *ref)]++;
+    }
+
+    /* Unlink free objects of empty arrays, the first array is only partially used */
+    for (i = 0; i < cnt; i++) {
+        unsigned used = arr[i] == cache->mObjectList ? cache->mObjectArrayPos : OBJECT_ARRAY_SIZE;
+        if (free_cnt[i] < used) free_cnt[i] = 0;
+    }
+    ref = &cache->mObjectFree;
+    while (*ref != NULL) {
+        if (free_cnt[find_object_array(arr, cnt, *ref)]) {
+            *ref = (*ref)->mHashNext;
+            cache->mObjectFreeCnt--;
+            sObjectFreeCnt--;
+        }
+        else {
+            ref = &(*ref)->mHashNext;
+        }
+    }
+    buf_ref = &cache->mObjectList;
+    while (*buf_ref != NULL) {
+        ObjectArray * buf = *buf_ref;
+        unsigned k = find_object_array(arr, cnt, buf->mArray);
+        if (free_cnt[k]) {
+            if (buf == cache->mObjectList) cache->mObjectArrayPos = OBJECT_ARRAY_SIZE;
+            *buf_ref = buf->mNext;
+            loc_free(buf);
+            released++;
+        }
+        else {
+            buf_ref = &buf->mNext;
+        }
+    }
+    loc_free(free_cnt);
+    loc_free(arr);
+    trace(LOG_ELF, "Released %u object arrays, %u free objects left in %s",
+        released, cache->mObjectFreeCnt, cache->mFile->name);
+}
+
+static void evict_cache_units(DWARFCache * cache) {
+    ELF_File * file = cache->mFile;
+    unsigned obj_cnt = 0;
+    unsigned unit_cnt = 0;
+    int changed = 1;
+    unsigned i;
+
+    /* Keep units that are referenced by objects of other units */
+    while (changed) {
+        changed = 0;
+        for (i = 0; i < file->section_cnt; i++) {
+            ObjectHashTable * Table = cache->mObjectHashTable + i;
+            unsigned h;
+            if (Table->mObjectHash == NULL) continue;
+            for (h = 0; h < Table->mObjectHashSize; h++) {
+                ObjectInfo * obj = Table->mObjectHash[h];
+                while (obj != NULL) {
+                    if (!is_evicted_object(obj)) {
+                        if (is_evicted_object(obj->mDefinition)) obj->mDefinition = NULL;
+                        keep_unit(obj->mType, &changed);
+                        keep_unit(obj->mParent, &changed);
+                        keep_unit(obj->mSibling, &changed);
+                        if (obj->mCompUnit == NULL || obj != obj->mCompUnit->mObject || !obj->mCompUnit->mEvict) {
+                            keep_unit(obj->mChildren, &changed);
+                        }
+                    }
+                    obj = obj->mHashNext;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < file->section_cnt; i++) {
+        ObjectHashTable * Table = cache->mObjectHashTable + i;
+        unsigned h;
+        if (Table->mObjectHash == NULL) continue;
+        for (h = 0; h < Table->mObjectHashSize; h++) {
+            ObjectInfo ** ref = Table->mObjectHash + h;
+            while (*ref != NULL) {
+                ObjectInfo * obj = *ref;
+                if (is_evicted_object(obj)) {
+                    *ref = obj->mHashNext;
+                    obj->mHashNext = cache->mObjectFree;
+                    cache->mObjectFree = obj;
+                    cache->mObjectFreeCnt++;
+                    sObjectFreeCnt++;
+                    obj_cnt++;
+                }
+                else {
+                    ref = &obj->mHashNext;
+                }
+            }
+        }
+        {
+            ObjectInfo * unit = Table->mCompUnits;
+            while (unit != NULL) {
+                CompUnit * Unit = unit->mCompUnit;
+                if (Unit->mEvict) {
+                    unit->mChildren = NULL;
+                    unit->mFlags &= ~DOIF_children_loaded;
+                    sUnitLRUObjectCnt -= Unit->mObjectCnt;
+                    sEvictedSize += (uint64_t)Unit->mObjectCnt * sizeof(ObjectInfo);
+                    Unit->mObjectCnt = 0;
+                    Unit->mEvict = 0;
+                    unit_cnt++;
+                }
+                unit = unit->mSibling;
+            }
+        }
+    }
+    trace(LOG_ELF, "Disposed %u objects of %u compilation units in %s", obj_cnt, unit_cnt, file->name);
+    release_object_arrays(cache);
+}
+
+#endif
+
+static void dispose_line_states(CompUnit * Unit) {
+    sEvictedSize += Unit->mLineStatesItem.mSize;
+    free_line_states(Unit);
+    /* File and directory tables stay loaded: they are referenced by the source file index */
+    Unit->mLineStatesDisposed = 1;
+}
+
+static void dispose_frame_info_index(FrameInfoIndex * index) {
+    sEvictedSize += index->mItem.mSize;
+    remove_cache_item(&index->mItem, &sFrameInfoSize);
+    index->mItem.mSize = 0;
+    loc_free(index->mFrameInfoRanges);
+    index->mFrameInfoRanges = NULL;
+    index->mFrameInfoRangesCnt = 0;
+    index->mFrameInfoRangesMax = 0;
+    index->mRelocatable = 0;
+}
+
+void touch_frame_info_index(FrameInfoIndex * index) {
+    if (index->mItem.mLink.next == NULL) {
+        add_cache_item(&sFrameInfoLRU, &index->mItem, &sFrameInfoSize);
+    }
+    else {
+        touch_cache_item(&sFrameInfoLRU, &index->mItem);
+    }
+}
+
+/*
+ * Relative priority of disposing cached data of same age.
+ * DIE objects are most expensive to reload: a unit is parsed again on first access,
+ * and references between units can keep disposed objects alive.
+ * Frame info indexes are cheap: they are re-created from the persistent index cache if available.
+ * Pub names tables are not disposable: the table is built by walking DIEs of every unit,
+ * so rebuilding it would reload all lazily loaded units. Section data is not disposable either:
+ * names of loaded objects and source file names point into it.
+ */
+#define EVICT_WEIGHT_OBJECTS        1
+#define EVICT_WEIGHT_LINE_STATES    2
+#define EVICT_WEIGHT_FRAME_INFO     4
+
+#define EVICT_OBJECTS       0
+#define EVICT_LINE_STATES   1
+#define EVICT_FRAME_INFO    2
+
+typedef struct EvictCandidate {
+    int kind;
+    void * obj;
+    size_t size;
+    uint64_t score;
+} EvictCandidate;
+
+static EvictCandidate * evict_buf = NULL;
+static unsigned evict_buf_cnt = 0;
+static unsigned evict_buf_max = 0;
+
+static void add_evict_candidate(int kind, void * obj, size_t size, unsigned last_use, unsigned weight) {
+    EvictCandidate * c = NULL;
+    if (size == 0) return;
+    if (evict_buf_cnt >= evict_buf_max) {
+        evict_buf_max = evict_buf_max == 0 ? 256 : evict_buf_max * 2;
+        evict_buf = (EvictCandidate *)loc_realloc(evict_buf, sizeof(EvictCandidate) * evict_buf_max);
+    }
+    c = evict_buf + evict_buf_cnt++;
+    c->kind = kind;
+    c->obj = obj;
+    c->size = size;
+    c->score = (uint64_t)(unsigned)(sUseClock - last_use) * weight;
+}
+
+static int cmp_evict_candidates(const void * x, const void * y) {
+    const EvictCandidate * cx = (const EvictCandidate *)x;
+    const EvictCandidate * cy = (const EvictCandidate *)y;
+    if (cx->score > cy->score) return -1;
+    if (cx->score < cy->score) return +1;
+    if (cx->size > cy->size) return -1;
+    if (cx->size < cy->size) return +1;
+    return 0;
+}
+
+static void evict_cache_event(void * args) {
+    size_t size = get_disposable_size();
+    size_t evicted = 0;
+#if ENABLE_DWARF_LAZY_LOAD
+    int evict_units = 0;
+#endif
+    unsigned i;
+    LINK * l;
+
+    sEvictPosted = 0;
+    if (sMemoryLimit == 0 || size <= sMemoryLimit) return;
+
+    /* Collect disposable items of unlocked files, oldest and cheapest to reload first */
+    evict_buf_cnt = 0;
+#if ENABLE_DWARF_LAZY_LOAD
+    for (l = sUnitLRU.next; l != &sUnitLRU; l = l->next) {
+        CompUnit * Unit = cachelink2unit(l);
+        if (Unit->mFile->lock_cnt > 0) continue;
+        add_evict_candidate(EVICT_OBJECTS, Unit, Unit->mObjectCnt * sizeof(ObjectInfo),
+            Unit->mLastUse, EVICT_WEIGHT_OBJECTS);
+    }
+#endif
+    for (l = sLineStatesLRU.next; l != &sLineStatesLRU; l = l->next) {
+        CompUnit * Unit = item2unit(l);
+        if (Unit->mFile->lock_cnt > 0) continue;
+        add_evict_candidate(EVICT_LINE_STATES, Unit, Unit->mLineStatesItem.mSize,
+            Unit->mLineStatesItem.mLastUse, EVICT_WEIGHT_LINE_STATES);
+    }
+    for (l = sFrameInfoLRU.next; l != &sFrameInfoLRU; l = l->next) {
+        FrameInfoIndex * index = item2frame(l);
+        if (index->mSection->file->lock_cnt > 0) continue;
+        add_evict_candidate(EVICT_FRAME_INFO, index, index->mItem.mSize,
+            index->mItem.mLastUse, EVICT_WEIGHT_FRAME_INFO);
+    }
+    qsort(evict_buf, evict_buf_cnt, sizeof(EvictCandidate), cmp_evict_candidates);
+
+    /* Leave some room to avoid disposing cached data too often */
+    for (i = 0; i < evict_buf_cnt && size - evicted > sMemoryLimit / 4 * 3; i++) {
+        EvictCandidate * c = evict_buf + i;
+        switch (c->kind) {
+#if ENABLE_DWARF_LAZY_LOAD
+        case EVICT_OBJECTS:
+            ((CompUnit *)c->obj)->mEvict = 1;
+            evict_units = 1;
+            break;
+#endif
+        case EVICT_LINE_STATES:
+            dispose_line_states((CompUnit *)c->obj);
+            break;
+        case EVICT_FRAME_INFO:
+            dispose_frame_info_index((FrameInfoIndex *)c->obj);
+            break;
+        }
+        evicted += c->size;
+    }
+#if ENABLE_DWARF_LAZY_LOAD
+    if (evict_units) {
+        for (l = sUnitLRU.next; l != &sUnitLRU; l = l->next) {
+            CompUnit * Unit = cachelink2unit(l);
+            if (Unit->mEvict) evict_cache_units((DWARFCache *)Unit->mFile->dwarf_dt_cache);
+        }
+    }
+#endif
+    sEvictCnt++;
+    trace(LOG_ELF, "DWARF cache memory: used %lu, limit %lu, disposed %u items",
+        (unsigned long)get_disposable_size(), (unsigned long)sMemoryLimit, i);
+    if (evict_buf_max > 0x1000) {
+        loc_free(evict_buf);
+        evict_buf = NULL;
+        evict_buf_max = 0;
     }
-    loc_free(Unit->mStates);
-    loc_free(Unit->mStatesIndex);
-    Unit->mStates = NULL;
-    Unit->mStatesMax = 0;
-    Unit->mStatesIndex = NULL;
 }
 
 static void free_dwarf_cache(ELF_File * file) {
@@ -1997,17 +2736,27 @@ static void free_dwarf_cache(ELF_File * file) {
         unsigned i;
         assert(Cache->magic == DWARF_CACHE_MAGIC);
         Cache->magic = 0;
+        list_remove(&Cache->mLink);
         for (i = 0; i < file->section_cnt; i++) {
             ObjectHashTable * Table = Cache->mObjectHashTable + i;
             while (Table->mCompUnits != NULL) {
                 CompUnit * Unit = Table->mCompUnits->mCompUnit;
                 Table->mCompUnits = Table->mCompUnits->mSibling;
+#if ENABLE_DWARF_LAZY_LOAD
+                if (Unit->mCacheLink.next != NULL) {
+                    list_remove(&Unit->mCacheLink);
+                    sUnitLRUObjectCnt -= Unit->mObjectCnt;
+                }
+#endif
                 free_unit_cache(Unit);
                 loc_free(Unit);
             }
             loc_free(Table->mObjectHash);
             loc_free(Table->mCompUnitsIndex);
         }
+#if ENABLE_DWARF_LAZY_LOAD
+        sObjectFreeCnt -= Cache->mObjectFreeCnt;
+#endif
         while (Cache->mObjectList != NULL) {
             ObjectArray * Buf = Cache->mObjectList;
             Cache->mObjectList = Buf->mNext;
@@ -2016,15 +2765,24 @@ static void free_dwarf_cache(ELF_File * file) {
         while (Cache->mFrameInfo != NULL) {
             FrameInfoIndex * idx = Cache->mFrameInfo;
             Cache->mFrameInfo = idx->mNext;
+            remove_cache_item(&idx->mItem, &sFrameInfoSize);
             loc_free(idx->mFrameInfoRanges);
             loc_free(idx);
         }
         loc_free(Cache->mObjectHashTable);
         loc_free(Cache->mAddrRanges);
+        addr_index_dispose(&Cache->mAddrRangesIndex);
         loc_free(Cache->mPubNames.mHash);
         loc_free(Cache->mPubNames.mNext);
+        loc_free(Cache->mPubNames.mNames);
         loc_free(Cache->mFileInfoHash);
         loc_free(Cache->mTypeUnitHash);
+#if ENABLE_DWARF_INDEX_CACHE
+        dwarf_index_close(Cache);
+#endif
+#if ENABLE_DWARF_NAMES
+        dwarf_names_dispose(Cache);
+#endif
         loc_free(Cache);
         file->dwarf_dt_cache = NULL;
     }
@@ -2039,16 +2797,19 @@ DWARFCache * get_dwarf_cache(ELF_File * file) {
             sCloseListenerOK = 1;
         }
         if (file->dwz_file_name != NULL) {
-            file->dwz_file = elf_open(file->dwz_file_name);
             if (file->dwz_file == NULL) {
-                str_exception(errno, "Cannot open DWZ file");
+                file->dwz_file = elf_open(file->dwz_file_name);
+                if (file->dwz_file == NULL) {
+                    str_exception(errno, "Cannot open DWZ file");
+                }
+                file->dwz_file->lock_cnt++;
             }
-            file->dwz_file->lock_cnt++;
             get_dwarf_cache(file->dwz_file);
         }
         sCache = Cache = (DWARFCache *)(file->dwarf_dt_cache = loc_alloc_zero(sizeof(DWARFCache)));
         sCache->magic = DWARF_CACHE_MAGIC;
         sCache->mFile = file;
+        list_add_last(&sCache->mLink, &sCacheList);
         sCache->mObjectArrayPos = OBJECT_ARRAY_SIZE;
         sCache->mObjectHashTable = (ObjectHashTable *)loc_alloc_zero(sizeof(ObjectHashTable) * file->section_cnt);
         if (set_trap(&trap)) {
@@ -2056,6 +2817,12 @@ DWARFCache * get_dwarf_cache(ELF_File * file) {
             load_debug_sections();
             clear_trap(&trap);
         }
+        else if (get_error_code(trap.error) == ERR_CACHE_MISS) {
+            /* Section data is not available yet, e.g. it is being decompressed, the client will retry */
+            sCache = NULL;
+            free_dwarf_cache(file);
+            exception(trap.error);
+        }
         else {
             sCache->mErrorReport = get_error_report(trap.error);
         }
@@ -2164,8 +2931,10 @@ static int state_text_pos_comparator(const void * x1, const void * x2) {
     return 0;
 }
 
-static void compute_reverse_lookup_indices(DWARFCache * Cache, CompUnit * Unit) {
+static void sort_line_states(CompUnit * Unit) {
     U4_T i;
+    /* Can be called by a worker thread, the size is added to the cache LRU list by the dispatch thread */
+    Unit->mLineStatesItem.mSize = sizeof(LineNumbersState) * Unit->mStatesMax + sizeof(LineNumbersState *) * Unit->mStatesCnt;
     qsort(Unit->mStates, Unit->mStatesCnt, sizeof(LineNumbersState), state_address_comparator);
     Unit->mStatesIndex = (LineNumbersState **)loc_alloc(sizeof(LineNumbersState *) * Unit->mStatesCnt);
     for (i = 0; i < Unit->mStatesCnt; i++) {
@@ -2183,10 +2952,32 @@ static void compute_reverse_lookup_indices(DWARFCache * Cache, CompUnit * Unit)
     }
     qsort(Unit->mStatesIndex, Unit->mStatesCnt, sizeof(LineNumbersState *), state_text_pos_comparator);
     for (i = 0; i < Unit->mStatesCnt; i++) Unit->mStatesIndex[i]->mStatesIndexPos = i;
+    if (Unit->mStatesCnt >= 2 && Unit->mStates[0].mSection == Unit->mStates[Unit->mStatesCnt - 1].mSection) {
+        /* States are sorted by section, then by address, so the keys are sorted too */
+        uint64_t * keys = addr_index_alloc(&Unit->mStatesAddrIndex, Unit->mStatesCnt);
+        for (i = 0; i < Unit->mStatesCnt; i++) keys[i] = Unit->mStates[i].mAddress;
+        addr_index_build(&Unit->mStatesAddrIndex);
+        Unit->mLineStatesItem.mSize += addr_index_memory_size(&Unit->mStatesAddrIndex);
+    }
+}
+
+static void set_file_states_range(CompUnit * Unit) {
+    U4_T i;
+    /* mStatesIndex is sorted by file index, states of a file are contiguous */
+    for (i = 0; i < Unit->mStatesCnt; i++) {
+        FileInfo * file = Unit->mFiles + Unit->mStatesIndex[i]->mFile;
+        if (file->mStatesEnd <= file->mStatesPos) file->mStatesPos = i;
+        file->mStatesEnd = i + 1;
+    }
+}
+
+static void add_file_info_hash(DWARFCache * Cache, CompUnit * Unit) {
+    U4_T i;
     if (Cache->mFileInfoHash == NULL) {
         Cache->mFileInfoHashSize = 251;
         Cache->mFileInfoHash = (FileInfo **)loc_alloc_zero(sizeof(FileInfo *) * Cache->mFileInfoHashSize);
     }
+    set_file_states_range(Unit);
     for (i = 0; i < Unit->mFilesCnt; i++) {
         FileInfo * file = Unit->mFiles + i;
         unsigned h = file->mNameHash % Cache->mFileInfoHashSize;
@@ -2205,6 +2996,7 @@ static void compute_reverse_lookup_indices(DWARFCache * Cache, CompUnit * Unit)
         if (list == NULL) {
             file->mNextInHash = Cache->mFileInfoHash[h];
             Cache->mFileInfoHash[h] = file;
+            add_source_index(file);
         }
     }
 }
@@ -2232,76 +3024,47 @@ static void load_line_numbers_v1(CompUnit * Unit, U4_T unit_size) {
     }
 }
 
-static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
-    U2_T version = 0;
-    U8_T header_pos = 0;
-    U1_T opcode_base = 0;
-    U1_T opcode_size[256];
-    U8_T header_size = 0;
-    U1_T min_instruction_length = 0;
-    U1_T max_ops_per_instruction = 1;
-    U1_T is_stmt_default = 0;
-    I1_T line_base = 0;
-    U1_T line_range = 0;
-    LineNumbersState state;
-
-    version = dio_ReadU2();
-    if (version < 2 || version > 4) str_exception(ERR_INV_DWARF, "Invalid line number info version");
-    header_size = dwarf64 ? dio_ReadU8() : (U8_T)dio_ReadU4();
-    header_pos = dio_GetPos();
-    min_instruction_length = dio_ReadU1();
-    if (version >= 4) max_ops_per_instruction = dio_ReadU1();
-    is_stmt_default = dio_ReadU1() != 0;
-    line_base = (I1_T)dio_ReadU1();
-    line_range = dio_ReadU1();
-    opcode_base = dio_ReadU1();
-    memset(opcode_size, 0, sizeof(opcode_size));
-    dio_Read(opcode_size + 1, opcode_base - 1);
-
-    /* Read directory names */
-    for (;;) {
-        char * name = dio_ReadString();
-        if (name == NULL) break;
-        add_dir(Unit, name);
-    }
-
-    /* Read source files info */
-    for (;;) {
-        U4_T dir = 0;
-        FileInfo file;
-        memset(&file, 0, sizeof(file));
-        file.mName = dio_ReadString();
-        if (file.mName == NULL) break;
-        dir = dio_ReadULEB128();
-        if (dir > 0 && dir <= Unit->mDirsCnt) file.mDir = Unit->mDirs[dir - 1];
-        file.mCompUnit = Unit;
-        file.mModTime = dio_ReadULEB128();
-        file.mSize = dio_ReadULEB128();
-        add_file(&file);
-    }
+static ELF_Section * get_line_info_section(CompUnit * Unit) {
+    DWARFCache * Cache = (DWARFCache *)Unit->mFile->dwarf_dt_cache;
+    ELF_Section * LineInfoSection = Unit->mLineInfoSection;
+    if (LineInfoSection == NULL) LineInfoSection = Unit->mDesc.mVersion <= 1 ? Cache->mDebugLineV1 : Cache->mDebugLineV2;
+    return LineInfoSection;
+}
 
-    if (header_pos + header_size != dio_GetPos()) {
-        if (dwarf64 && header_pos + header_size == dio_GetPos() + 12) {
-            /* OK - bug in GCC for MIPS64. */
-            /* GCC generates prologue header_length field with a value which is exactly 12 too large. */
-        }
-        else {
-            str_exception(ERR_INV_DWARF, "Invalid line info header");
-        }
-    }
+/*
+ * Line number program parameters, read from the program header by the dispatch thread.
+ * The program is run by run_line_program() with DIO in the line info section.
+ * If ENABLE_DWARF_PARALLEL_LOAD, it can be run by a worker thread, see dwarfio.h.
+ */
+typedef struct LineProgram {
+    CompUnit * mUnit;
+    ELF_Section * mSection;
+    U8_T mPos;
+    U8_T mEnd;
+    U1_T mMinInstructionLength;
+    U1_T mMaxOpsPerInstruction;
+    U1_T mIsStmtDefault;
+    I1_T mLineBase;
+    U1_T mLineRange;
+    U1_T mOpcodeBase;
+    int mError;
+} LineProgram;
+
+static void run_line_program(LineProgram * prog) {
+    CompUnit * Unit = prog->mUnit;
+    LineNumbersState state;
 
-    /* Run the program */
     memset(&state, 0, sizeof(state));
     state.mFile = 1;
     state.mLine = 1;
-    if (is_stmt_default) state.mFlags |= LINE_IsStmt;
-    while (dio_GetPos() < Unit->mLineInfoOffs + unit_size) {
+    if (prog->mIsStmtDefault) state.mFlags |= LINE_IsStmt;
+    while (dio_GetPos() < prog->mEnd) {
         U1_T opcode = dio_ReadU1();
-        if (opcode >= opcode_base) {
-            unsigned op_advance = (opcode - opcode_base) / line_range;
-            state.mLine += (U4_T)((int)((opcode - opcode_base) % line_range) + line_base);
-            state.mAddress += (state.mOpIndex + op_advance) / max_ops_per_instruction * min_instruction_length;
-            state.mOpIndex = (state.mOpIndex + op_advance) % max_ops_per_instruction;
+        if (opcode >= prog->mOpcodeBase) {
+            unsigned op_advance = (opcode - prog->mOpcodeBase) / prog->mLineRange;
+            state.mLine += (U4_T)((int)((opcode - prog->mOpcodeBase) % prog->mLineRange) + prog->mLineBase);
+            state.mAddress += (state.mOpIndex + op_advance) / prog->mMaxOpsPerInstruction * prog->mMinInstructionLength;
+            state.mOpIndex = (state.mOpIndex + op_advance) % prog->mMaxOpsPerInstruction;
             add_state(Unit, &state);
             state.mFlags &= ~(LINE_BasicBlock | LINE_PrologueEnd | LINE_EpilogueBegin);
             state.mDiscriminator = 0;
@@ -2330,7 +3093,7 @@ static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
                 memset(&state, 0, sizeof(state));
                 state.mFile = 1;
                 state.mLine = 1;
-                if (is_stmt_default) state.mFlags |= LINE_IsStmt;
+                if (prog->mIsStmtDefault) state.mFlags |= LINE_IsStmt;
                 break;
             case DW_LNE_set_address:
                 state.mAddress = (ContextAddress)dio_ReadAddress(&sec);
@@ -2344,7 +3107,7 @@ static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
                 break;
             }
             if (dio_GetPos() != op_pos + op_size)
-                str_exception(ERR_INV_DWARF, "Invalid line info op size");
+                dio_Error(ERR_INV_DWARF, "Invalid line info op size");
         }
         else {
             switch (opcode) {
@@ -2353,7 +3116,7 @@ static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
                 state.mFlags &= ~(LINE_BasicBlock | LINE_PrologueEnd | LINE_EpilogueBegin);
                 break;
             case DW_LNS_advance_pc:
-                state.mAddress += (ContextAddress)(dio_ReadU8LEB128() * min_instruction_length);
+                state.mAddress += (ContextAddress)(dio_ReadU8LEB128() * prog->mMinInstructionLength);
                 break;
             case DW_LNS_advance_line:
                 state.mLine += dio_ReadSLEB128();
@@ -2371,7 +3134,7 @@ static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
                 state.mFlags |= LINE_BasicBlock;
                 break;
             case DW_LNS_const_add_pc:
-                state.mAddress += (255 - opcode_base) / line_range * min_instruction_length;
+                state.mAddress += (255 - prog->mOpcodeBase) / prog->mLineRange * prog->mMinInstructionLength;
                 break;
             case DW_LNS_fixed_advance_pc:
                 state.mAddress += dio_ReadAddressX(NULL, 2);
@@ -2386,52 +3149,174 @@ static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64) {
                 state.mISA = (U1_T)dio_ReadULEB128();
                 break;
             default:
-                str_exception(ERR_INV_DWARF, "Invalid line info op code");
+                dio_Error(ERR_INV_DWARF, "Invalid line info op code");
                 break;
             }
         }
     }
 }
 
-void load_line_numbers(CompUnit * Unit) {
-    Trap trap;
-    DWARFCache * Cache = (DWARFCache *)Unit->mFile->dwarf_dt_cache;
-    ELF_Section * LineInfoSection = Unit->mLineInfoSection;
-    if (LineInfoSection == NULL) LineInfoSection = Unit->mDesc.mVersion <= 1 ? Cache->mDebugLineV1 : Cache->mDebugLineV2;
-    if (LineInfoSection == NULL) return;
-    if (Unit->mLineInfoLoaded) return;
-    if (elf_load(LineInfoSection)) exception(errno);
-    dio_EnterSection(&Unit->mDesc, LineInfoSection, Unit->mLineInfoOffs);
-    if (set_trap(&trap)) {
-        U8_T unit_size = 0;
+static void load_line_numbers_v2(CompUnit * Unit, U8_T unit_size, int dwarf64, LineProgram * prog) {
+    U2_T version = 0;
+    U8_T header_pos = 0;
+    U1_T opcode_size[256];
+    U8_T header_size = 0;
+
+    version = dio_ReadU2();
+    if (version < 2 || version > 4) str_exception(ERR_INV_DWARF, "Invalid line number info version");
+    header_size = dwarf64 ? dio_ReadU8() : (U8_T)dio_ReadU4();
+    header_pos = dio_GetPos();
+    prog->mMinInstructionLength = dio_ReadU1();
+    prog->mMaxOpsPerInstruction = 1;
+    if (version >= 4) prog->mMaxOpsPerInstruction = dio_ReadU1();
+    prog->mIsStmtDefault = dio_ReadU1() != 0;
+    prog->mLineBase = (I1_T)dio_ReadU1();
+    prog->mLineRange = dio_ReadU1();
+    prog->mOpcodeBase = dio_ReadU1();
+    memset(opcode_size, 0, sizeof(opcode_size));
+    dio_Read(opcode_size + 1, prog->mOpcodeBase - 1);
+
+    /* Read directory names */
+    for (;;) {
+        char * name = dio_ReadString();
+        if (name == NULL) break;
+        add_dir(Unit, name);
+    }
+
+    /* Read source files info */
+    for (;;) {
+        U4_T dir = 0;
         FileInfo file;
         memset(&file, 0, sizeof(file));
+        file.mName = dio_ReadString();
+        if (file.mName == NULL) break;
+        dir = dio_ReadULEB128();
+        if (dir > 0 && dir <= Unit->mDirsCnt) file.mDir = Unit->mDirs[dir - 1];
         file.mCompUnit = Unit;
-        file.mDir = Unit->mDir;
-        file.mName = Unit->mObject->mName;
+        file.mModTime = dio_ReadULEB128();
+        file.mSize = dio_ReadULEB128();
         add_file(&file);
-        /* Read header */
-        unit_size = dio_ReadU4();
-        if (Unit->mDesc.mVersion <= 1) {
-            /* DWARF 1.1 */
-            load_line_numbers_v1(Unit, (U4_T)unit_size);
+    }
+
+    if (header_pos + header_size != dio_GetPos()) {
+        if (dwarf64 && header_pos + header_size == dio_GetPos() + 12) {
+            /* OK - bug in GCC for MIPS64. */
+            /* GCC generates prologue header_length field with a value which is exactly 12 too large. */
         }
         else {
-            /* DWARF 2+ */
-            int dwarf64 = 0;
-            if (unit_size == 0xffffffffu) {
-                unit_size = dio_ReadU8();
-                unit_size += 12;
-                dwarf64 = 1;
-            }
-            else {
-                unit_size += 4;
-            }
-            load_line_numbers_v2(Unit, unit_size, dwarf64);
+            str_exception(ERR_INV_DWARF, "Invalid line info header");
+        }
+    }
+
+    prog->mUnit = Unit;
+    prog->mSection = get_line_info_section(Unit);
+    prog->mPos = dio_GetPos();
+    prog->mEnd = Unit->mLineInfoOffs + unit_size;
+    if (prog->mEnd > prog->mSection->size) exception(ERR_EOF);
+}
+
+/* Read line number info header, and line number table if DWARF 1.1. Must be called with DIO in line info section. */
+static void read_line_numbers_header(CompUnit * Unit, LineProgram * prog) {
+    U8_T unit_size = 0;
+    FileInfo file;
+    memset(prog, 0, sizeof(LineProgram));
+    memset(&file, 0, sizeof(file));
+    file.mCompUnit = Unit;
+    file.mDir = Unit->mDir;
+    file.mName = Unit->mObject->mName;
+    add_file(&file);
+    /* Read header */
+    unit_size = dio_ReadU4();
+    if (Unit->mDesc.mVersion <= 1) {
+        /* DWARF 1.1 */
+        load_line_numbers_v1(Unit, (U4_T)unit_size);
+    }
+    else {
+        /* DWARF 2+ */
+        int dwarf64 = 0;
+        if (unit_size == 0xffffffffu) {
+            unit_size = dio_ReadU8();
+            unit_size += 12;
+            dwarf64 = 1;
         }
+        else {
+            unit_size += 4;
+        }
+        load_line_numbers_v2(Unit, unit_size, dwarf64, prog);
+    }
+}
+
+static void run_line_numbers_program(CompUnit * Unit) {
+    LineProgram prog;
+    read_line_numbers_header(Unit, &prog);
+    if (prog.mUnit != NULL) run_line_program(&prog);
+    dio_ExitSection();
+    sort_line_states(Unit);
+}
+
+/* Load line number states that were disposed by evict_cache_event() */
+static void reload_line_states(CompUnit * Unit, ELF_Section * LineInfoSection) {
+    Trap trap;
+    U4_T i;
+    FileInfo * Files = Unit->mFiles;
+    U4_T FilesCnt = Unit->mFilesCnt;
+    U4_T FilesMax = Unit->mFilesMax;
+    char ** Dirs = Unit->mDirs;
+    U4_T DirsCnt = Unit->mDirsCnt;
+    U4_T DirsMax = Unit->mDirsMax;
+
+    if (elf_load(LineInfoSection)) exception(errno);
+    /* Loaded FileInfo entries are referenced by the source file index and must not move,
+     * the header is read again into temporary file and directory tables */
+    Unit->mFiles = NULL;
+    Unit->mFilesCnt = Unit->mFilesMax = 0;
+    Unit->mDirs = NULL;
+    Unit->mDirsCnt = Unit->mDirsMax = 0;
+    dio_EnterSection(&Unit->mDesc, LineInfoSection, Unit->mLineInfoOffs);
+    if (set_trap(&trap)) {
+        run_line_numbers_program(Unit);
+        if (Unit->mFilesCnt != FilesCnt) str_exception(ERR_INV_DWARF, "Invalid line info file table");
+        clear_trap(&trap);
+    }
+    else {
         dio_ExitSection();
-        compute_reverse_lookup_indices(Cache, Unit);
+    }
+    loc_free(Unit->mFiles);
+    loc_free(Unit->mDirs);
+    Unit->mFiles = Files;
+    Unit->mFilesCnt = FilesCnt;
+    Unit->mFilesMax = FilesMax;
+    Unit->mDirs = Dirs;
+    Unit->mDirsCnt = DirsCnt;
+    Unit->mDirsMax = DirsMax;
+    if (trap.error) {
+        free_line_states(Unit);
+        exception(trap.error);
+    }
+    for (i = 0; i < Unit->mFilesCnt; i++) Unit->mFiles[i].mStatesPos = Unit->mFiles[i].mStatesEnd = 0;
+    set_file_states_range(Unit);
+    Unit->mLineStatesDisposed = 0;
+    add_cache_item(&sLineStatesLRU, &Unit->mLineStatesItem, &sLineStatesSize);
+    trace(LOG_ELF, "Line number states of %s reloaded", Unit->mObject->mName ? Unit->mObject->mName : "<unnamed unit>");
+}
+
+void load_line_numbers(CompUnit * Unit) {
+    Trap trap;
+    DWARFCache * Cache = (DWARFCache *)Unit->mFile->dwarf_dt_cache;
+    ELF_Section * LineInfoSection = get_line_info_section(Unit);
+    if (LineInfoSection == NULL) return;
+    if (Unit->mLineInfoLoaded) {
+        if (Unit->mLineStatesDisposed) reload_line_states(Unit, LineInfoSection);
+        else touch_cache_item(&sLineStatesLRU, &Unit->mLineStatesItem);
+        return;
+    }
+    if (elf_load(LineInfoSection)) exception(errno);
+    dio_EnterSection(&Unit->mDesc, LineInfoSection, Unit->mLineInfoOffs);
+    if (set_trap(&trap)) {
+        run_line_numbers_program(Unit);
+        add_file_info_hash(Cache, Unit);
         Unit->mLineInfoLoaded = 1;
+        add_cache_item(&sLineStatesLRU, &Unit->mLineStatesItem, &sLineStatesSize);
         clear_trap(&trap);
     }
     else {
@@ -2441,10 +3326,206 @@ void load_line_numbers(CompUnit * Unit) {
     }
 }
 
+#if ENABLE_DWARF_PARALLEL_LOAD
+
+/*
+ * Line number programs of a file, run by worker threads.
+ * A program builds line number tables of a private copy of its compilation unit,
+ * the dispatch thread moves the tables into the cache when all workers are done,
+ * and notifies cache clients that are waiting for the job.
+ */
+typedef struct LineProgramJob {
+    AbstractCache mCache;
+    DWARFCache * mDWARFCache;
+    CompUnit ** mUnits;
+    CompUnit * mCopies;
+    LineProgram * mPrograms;
+    unsigned mCnt;
+    unsigned mPos;      /* Next program to run, guarded by mLock */
+    unsigned mBusy;     /* Number of running workers, accessed by the dispatch thread only */
+    pthread_mutex_t mLock;
+} LineProgramJob;
+
+static int line_program_worker(void * args) {
+    LineProgramJob * job = (LineProgramJob *)args;
+    for (;;) {
+        LineProgram * prog = NULL;
+        check_error(pthread_mutex_lock(&job->mLock));
+        if (job->mPos < job->mCnt) prog = job->mPrograms + job->mPos++;
+        check_error(pthread_mutex_unlock(&job->mLock));
+        if (prog == NULL) break;
+        if (prog->mUnit == NULL) continue;
+        if (prog->mPos < prog->mEnd) {
+            dio_EnterSection(&prog->mUnit->mDesc, prog->mSection, prog->mPos);
+            run_line_program(prog);
+            prog->mError = dio_GetError(NULL);
+            dio_ExitSection();
+        }
+        if (prog->mError == 0) sort_line_states(prog->mUnit);
+    }
+    return 0;
+}
+
+static void line_program_job_done(LineProgramJob * job) {
+    DWARFCache * Cache = job->mDWARFCache;
+    unsigned i;
+
+    /* Move results into the cache, same order as serial loading */
+    for (i = 0; i < job->mCnt; i++) {
+        LineProgram * prog = job->mPrograms + i;
+        CompUnit * Unit = job->mUnits[i];
+        CompUnit * Copy = job->mCopies + i;
+        if (prog->mUnit != NULL && prog->mError == 0 && !Unit->mLineInfoLoaded) {
+            U4_T j;
+            Unit->mFiles = Copy->mFiles;
+            Unit->mFilesCnt = Copy->mFilesCnt;
+            Unit->mFilesMax = Copy->mFilesMax;
+            Unit->mDirs = Copy->mDirs;
+            Unit->mDirsCnt = Copy->mDirsCnt;
+            Unit->mDirsMax = Copy->mDirsMax;
+            Unit->mStates = Copy->mStates;
+            Unit->mStatesCnt = Copy->mStatesCnt;
+            Unit->mStatesMax = Copy->mStatesMax;
+            Unit->mStatesIndex = Copy->mStatesIndex;
+            Unit->mStatesAddrIndex = Copy->mStatesAddrIndex;
+            memset(&Copy->mStatesAddrIndex, 0, sizeof(Copy->mStatesAddrIndex));
+            Unit->mLineStatesItem.mSize = Copy->mLineStatesItem.mSize;
+            for (j = 0; j < Unit->mFilesCnt; j++) Unit->mFiles[j].mCompUnit = Unit;
+            add_file_info_hash(Cache, Unit);
+            Unit->mLineInfoLoaded = 1;
+            add_cache_item(&sLineStatesLRU, &Unit->mLineStatesItem, &sLineStatesSize);
+        }
+        else {
+            /* The unit is loaded by load_line_numbers(), which reports errors, if any */
+            free_unit_cache(Copy);
+        }
+    }
+    trace(LOG_ELF, "Line number programs of %u compilation units loaded by worker threads", job->mCnt);
+    Cache->mLineInfoJob = NULL;
+    Cache->mLineInfoJobDone = 1;
+    assert(Cache->mFile->lock_cnt > 0);
+    Cache->mFile->lock_cnt--;
+    cache_notify(&job->mCache);
+    cache_dispose(&job->mCache);
+    check_error(pthread_mutex_destroy(&job->mLock));
+    loc_free(job->mUnits);
+    loc_free(job->mCopies);
+    loc_free(job->mPrograms);
+    loc_free(job);
+}
+
+static void line_program_worker_done(void * args) {
+    AsyncReqInfo * req = (AsyncReqInfo *)args;
+    LineProgramJob * job = (LineProgramJob *)req->u.user.data;
+    loc_free(req);
+    assert(job->mBusy > 0);
+    if (--job->mBusy == 0) line_program_job_done(job);
+}
+
+static void start_line_programs_job(DWARFCache * Cache, CompUnit ** Units, unsigned Cnt) {
+    LineProgramJob * job = (LineProgramJob *)loc_alloc_zero(sizeof(LineProgramJob));
+    unsigned threads = DWARF_PARALLEL_LOAD_THREADS;
+    unsigned i;
+
+    job->mDWARFCache = Cache;
+    job->mUnits = Units;
+    job->mCopies = (CompUnit *)loc_alloc_zero(sizeof(CompUnit) * Cnt);
+    job->mPrograms = (LineProgram *)loc_alloc_zero(sizeof(LineProgram) * Cnt);
+    job->mCnt = Cnt;
+
+    /* Headers and file tables are read by the dispatch thread */
+    for (i = 0; i < Cnt; i++) {
+        Trap trap;
+        CompUnit * Unit = Units[i];
+        CompUnit * Copy = job->mCopies + i;
+        Copy->mObject = Unit->mObject;
+        Copy->mFile = Unit->mFile;
+        Copy->mDesc = Unit->mDesc;
+        Copy->mLineInfoSection = Unit->mLineInfoSection;
+        Copy->mLineInfoOffs = Unit->mLineInfoOffs;
+        Copy->mDir = Unit->mDir;
+        if (set_trap(&trap)) {
+            ELF_Section * LineInfoSection = get_line_info_section(Copy);
+            dio_EnterSection(&Copy->mDesc, LineInfoSection, Copy->mLineInfoOffs);
+            read_line_numbers_header(Copy, job->mPrograms + i);
+            clear_trap(&trap);
+        }
+        else {
+            job->mPrograms[i].mUnit = NULL;
+        }
+        dio_ExitSection();
+    }
+
+    if (threads > Cnt) threads = Cnt;
+    check_error(pthread_mutex_init(&job->mLock, NULL));
+    job->mBusy = threads;
+    Cache->mLineInfoJob = job;
+    /* The file cannot be closed and its cache cannot be evicted while the job is running */
+    Cache->mFile->lock_cnt++;
+    for (i = 0; i < threads; i++) {
+        AsyncReqInfo * req = (AsyncReqInfo *)loc_alloc_zero(sizeof(AsyncReqInfo));
+        req->done = line_program_worker_done;
+        req->type = AsyncReqUser;
+        req->u.user.func = line_program_worker;
+        req->u.user.data = job;
+        async_req_post(req);
+    }
+}
+
+#endif /* ENABLE_DWARF_PARALLEL_LOAD */
+
+void load_all_line_numbers(DWARFCache * Cache) {
+    ELF_File * File = Cache->mFile;
+    unsigned i;
+
+    if (Cache->mLineInfoLoaded) return;
+#if ENABLE_DWARF_PARALLEL_LOAD
+    if (Cache->mLineInfoJob != NULL) {
+        /* Cache clients wait for the job, other callers load line info serially */
+        if (cache_transaction_id() != 0) cache_wait(&Cache->mLineInfoJob->mCache);
+    }
+    else if (!Cache->mLineInfoJobDone && cache_transaction_id() != 0) {
+        CompUnit ** units = NULL;
+        unsigned units_cnt = 0;
+        unsigned units_max = 0;
+        for (i = 0; i < File->section_cnt; i++) {
+            ObjectInfo * info = Cache->mObjectHashTable[i].mCompUnits;
+            while (info != NULL) {
+                CompUnit * unit = info->mCompUnit;
+                ELF_Section * sec = get_line_info_section(unit);
+                /* Units that need relocation or DWARF 1.1 line info are loaded serially */
+                if (!unit->mLineInfoLoaded && sec != NULL && sec->relocate == NULL && unit->mDesc.mVersion > 1 &&
+                        elf_load(sec) == 0) {
+                    if (units_cnt >= units_max) {
+                        units_max = units_max == 0 ? 64 : units_max * 2;
+                        units = (CompUnit **)loc_realloc(units, sizeof(CompUnit *) * units_max);
+                    }
+                    units[units_cnt++] = unit;
+                }
+                info = info->mSibling;
+            }
+        }
+        if (units_cnt > 1) {
+            start_line_programs_job(Cache, units, units_cnt);
+            cache_wait(&Cache->mLineInfoJob->mCache);
+        }
+        loc_free(units);
+    }
+#endif
+    for (i = 0; i < File->section_cnt; i++) {
+        ObjectInfo * info = Cache->mObjectHashTable[i].mCompUnits;
+        while (info != NULL) {
+            CompUnit * unit = info->mCompUnit;
+            if (!unit->mLineInfoLoaded) load_line_numbers(unit);
+            info = info->mSibling;
+        }
+    }
+    Cache->mLineInfoLoaded = 1;
+}
+
 UnitAddressRange * find_comp_unit_addr_range(DWARFCache * cache, ELF_Section * section,
                                              ContextAddress addr_min, ContextAddress addr_max) {
-    unsigned l = 0;
-    unsigned h = cache->mAddrRangesCnt;
+    unsigned k = 0;
     U4_T s = 0;
 
     if (cache->mAddrRangesRelocatable && section != NULL) {
@@ -2465,27 +3546,132 @@ UnitAddressRange * find_comp_unit_addr_range(DWARFCache * cache, ELF_Section * s
         }
     }
 
-    while (l < h) {
-        unsigned k = (h + l) / 2;
+    /* Skip ranges that end before 'addr_min' even if they have max size */
+    if (addr_min >= cache->mAddrRangesMaxSize) {
+        k = addr_index_rank(&cache->mAddrRangesIndex, addr_min - cache->mAddrRangesMaxSize);
+    }
+    for (; k < cache->mAddrRangesCnt; k++) {
         UnitAddressRange * rk = cache->mAddrRanges + k;
-        if (rk->mAddr > addr_max) h = k;
-        else if (rk->mAddr + cache->mAddrRangesMaxSize <= addr_min) l = k + 1;
-        else {
-            for (; k > 0; k--) {
-                rk = cache->mAddrRanges + k - 1;
-                if (rk->mAddr + cache->mAddrRangesMaxSize <= addr_min) break;
-            }
-            for (; k < h; k++) {
-                rk = cache->mAddrRanges + k;
-                if (rk->mAddr > addr_max) break;
-                if (rk->mAddr + rk->mSize <= addr_min) continue;
-                if (rk->mSection && s && rk->mSection != s) continue;
-                return rk;
+        if (rk->mAddr > addr_max) break;
+        if (rk->mAddr + rk->mSize <= addr_min) continue;
+        if (rk->mSection && s && rk->mSection != s) continue;
+        return rk;
+    }
+    return NULL;
+}
+
+typedef struct DWARFCacheMemoryUsage {
+    uint64_t mObjects;
+    uint64_t mLineInfo;
+    uint64_t mFrameInfo;
+    uint64_t mPubNames;
+    uint64_t mAddrRanges;
+} DWARFCacheMemoryUsage;
+
+static void get_cache_memory_usage(DWARFCache * Cache, DWARFCacheMemoryUsage * usage) {
+    ELF_File * File = Cache->mFile;
+    ObjectArray * Buf = NULL;
+    FrameInfoIndex * Index = NULL;
+    unsigned i;
+
+    memset(usage, 0, sizeof(DWARFCacheMemoryUsage));
+    usage->mObjects += sizeof(DWARFCache) + sizeof(ObjectHashTable) * File->section_cnt;
+    usage->mObjects += sizeof(CompUnit *) * Cache->mTypeUnitHashSize;
+    for (Buf = Cache->mObjectList; Buf != NULL; Buf = Buf->mNext) usage->mObjects += sizeof(ObjectArray);
+    for (i = 0; i < File->section_cnt; i++) {
+        ObjectHashTable * Table = Cache->mObjectHashTable + i;
+        ObjectInfo * Info = Table->mCompUnits;
+        usage->mObjects += sizeof(ObjectInfo *) * Table->mObjectHashSize;
+        if (Table->mCompUnitsIndex != NULL) usage->mObjects += sizeof(CompUnit *) * Table->mCompUnitsIndexSize;
+        while (Info != NULL) {
+            CompUnit * Unit = Info->mCompUnit;
+            U4_T j;
+            usage->mObjects += sizeof(CompUnit);
+            usage->mLineInfo += sizeof(FileInfo) * Unit->mFilesMax + sizeof(char *) * Unit->mDirsMax;
+            usage->mLineInfo += Unit->mLineStatesItem.mSize;
+            for (j = 0; j < Unit->mStatesCnt; j++) {
+                if (Unit->mStates[j].mFileName != NULL) usage->mLineInfo += strlen(Unit->mStates[j].mFileName) + 1;
             }
-            break;
+            Info = Info->mSibling;
         }
     }
-    return NULL;
+    usage->mLineInfo += sizeof(FileInfo *) * Cache->mFileInfoHashSize;
+    for (Index = Cache->mFrameInfo; Index != NULL; Index = Index->mNext) {
+        usage->mFrameInfo += sizeof(FrameInfoIndex) + Index->mItem.mSize;
+    }
+    if (Cache->mPubNames.mNext != NULL) {
+        usage->mPubNames += sizeof(unsigned) * Cache->mPubNames.mHashSize;
+        usage->mPubNames += sizeof(PubNamesInfo) * Cache->mPubNames.mMax;
+        usage->mPubNames += Cache->mPubNames.mNamesSize;
+    }
+    usage->mAddrRanges += sizeof(UnitAddressRange) * Cache->mAddrRangesMax;
+    usage->mAddrRanges += addr_index_memory_size(&Cache->mAddrRangesIndex);
+}
+
+static void write_statistics_item(OutputStream * out, const char * name, uint64_t value) {
+    write_stream(out, ',');
+    json_write_string(out, name);
+    write_stream(out, ':');
+    json_write_uint64(out, value);
+}
+
+static void write_dwarf_cache_statistics(OutputStream * out, void * args) {
+    LINK * l = NULL;
+    int cnt = 0;
+
+    write_stream(out, '{');
+    json_write_string(out, "MemoryLimit");
+    write_stream(out, ':');
+    json_write_uint64(out, sMemoryLimit);
+    write_statistics_item(out, "MemoryUsed", get_disposable_size());
+#if ENABLE_DWARF_LAZY_LOAD
+    write_statistics_item(out, "Objects", (uint64_t)sUnitLRUObjectCnt * sizeof(ObjectInfo));
+    write_statistics_item(out, "FreeObjects", (uint64_t)sObjectFreeCnt * sizeof(ObjectInfo));
+#endif
+    write_statistics_item(out, "LineStates", sLineStatesSize);
+    write_statistics_item(out, "FrameInfo", sFrameInfoSize);
+    write_statistics_item(out, "Evictions", sEvictCnt);
+    write_statistics_item(out, "EvictedBytes", sEvictedSize);
+    write_stream(out, ',');
+    json_write_string(out, "Files");
+    write_stream(out, ':');
+    write_stream(out, '[');
+    for (l = sCacheList.next; l != &sCacheList; l = l->next) {
+        DWARFCache * Cache = link2cache(l);
+        DWARFCacheMemoryUsage usage;
+        ELF_MemoryUsage elf;
+        get_cache_memory_usage(Cache, &usage);
+        elf_get_memory_usage(Cache->mFile, &elf);
+        if (cnt++ > 0) write_stream(out, ',');
+        write_stream(out, '{');
+        json_write_string(out, "Name");
+        write_stream(out, ':');
+        json_write_string(out, Cache->mFile->name);
+        write_statistics_item(out, "Objects", usage.mObjects);
+        write_statistics_item(out, "LineInfo", usage.mLineInfo);
+        write_statistics_item(out, "FrameInfo", usage.mFrameInfo);
+        write_statistics_item(out, "PubNames", usage.mPubNames);
+        write_statistics_item(out, "AddrRanges", usage.mAddrRanges);
+        write_statistics_item(out, "Sections", elf.heap_sections);
+        write_statistics_item(out, "MappedSections", elf.mapped_sections);
+        write_statistics_item(out, "Symbols", elf.symbols);
+        write_stream(out, '}');
+    }
+    write_stream(out, ']');
+    write_stream(out, '}');
+}
+
+void set_dwarf_cache_memory_limit(size_t limit) {
+    sMemoryLimit = limit;
+    check_memory_limit();
+}
+
+void ini_dwarf_cache(void) {
+    const char * limit = getenv("TCF_DWARF_CACHE_LIMIT");
+    if (limit != NULL && *limit) {
+        set_dwarf_cache_memory_limit((size_t)strtoul(limit, NULL, 10) * 1024 * 1024);
+    }
+    add_diagnostics_statistics("DWARFCache", write_dwarf_cache_statistics, NULL);
 }
 
 #endif /* ENABLE_ELF && ENABLE_DebugContext */
@@ -29,6 +29,8 @@
 #if ENABLE_ELF && ENABLE_DebugContext
 
 #include <tcf/framework/errors.h>
+#include <tcf/framework/link.h>
+#include <tcf/framework/addrindex.h>
 #include <tcf/services/tcf_elf.h>
 #include <tcf/services/dwarfio.h>
 #include <tcf/services/symbols.h>
@@ -37,6 +39,31 @@
 #  define ENABLE_DWARF_LAZY_LOAD 1
 #endif
 
+#ifndef DWARF_CACHE_MEMORY_LIMIT
+/*
+ * Memory limit for disposable parts of DWARF caches, bytes: objects of lazily loaded
+ * compilation units, line number states and frame info search indexes.
+ * Can be overridden at run time by TCF_DWARF_CACHE_LIMIT environment variable, megabytes.
+ * Zero means no limit.
+ * Pub names tables and section data are reported by Diagnostics, but not counted
+ * against the limit: they stay in memory until the ELF file is closed.
+ */
+#  define DWARF_CACHE_MEMORY_LIMIT (128 * 1024 * 1024)
+#endif
+
+#ifndef ENABLE_DWARF_PARALLEL_LOAD
+#  define ENABLE_DWARF_PARALLEL_LOAD DIO_THREAD_SAFE
+#endif
+
+#if ENABLE_DWARF_PARALLEL_LOAD && !defined(DWARF_PARALLEL_LOAD_THREADS)
+/* Max number of worker threads that run line number programs of a file */
+#  define DWARF_PARALLEL_LOAD_THREADS 4
+#endif
+
+#ifndef ENABLE_DWARF_INDEX_CACHE
+#  define ENABLE_DWARF_INDEX_CACHE TARGET_UNIX
+#endif
+
 typedef struct FileInfo FileInfo;
 typedef struct ObjectInfo ObjectInfo;
 typedef struct PubNamesInfo PubNamesInfo;
@@ -51,6 +78,14 @@ typedef struct FrameInfoRange FrameInfoRange;
 typedef struct FrameInfoIndex FrameInfoIndex;
 typedef struct ObjectHashTable ObjectHashTable;
 typedef struct DWARFCache DWARFCache;
+typedef struct DWARFCacheItem DWARFCacheItem;
+
+/* Disposable part of a DWARF cache, see DWARF_CACHE_MEMORY_LIMIT */
+struct DWARFCacheItem {
+    LINK mLink;             /* Link in LRU list, most recently used first */
+    size_t mSize;           /* Memory used by the item, bytes */
+    unsigned mLastUse;      /* Value of the cache use clock at last access */
+};
 
 struct FileInfo {
     const char * mName;
@@ -59,8 +94,12 @@ struct FileInfo {
     U4_T mSize;
     unsigned mNameHash;
     FileInfo * mNextInHash;
+    FileInfo * mNextInIndex;    /* Next entry in the source file index, see get_source_file_index() */
+    FileInfo ** mPrevInIndex;
     CompUnit * mCompUnit;
     unsigned mAreaCnt;
+    U4_T mStatesPos;            /* Line states of the file are mCompUnit->mStatesIndex[mStatesPos..mStatesEnd - 1] */
+    U4_T mStatesEnd;
 };
 
 #define TAG_fund_type           0x2000
@@ -144,7 +183,9 @@ struct ObjectInfo {
 
 struct PubNamesInfo {
     unsigned mNext;
-    ObjectInfo * mObject;
+    unsigned mSection;
+    ContextAddress mID;
+    const char * mName;
 };
 
 struct PubNamesTable {
@@ -153,6 +194,8 @@ struct PubNamesTable {
     PubNamesInfo * mNext;
     unsigned mCnt;
     unsigned mMax;
+    char * mNames;          /* Names of a table loaded from the persistent index cache, see dwarfindexcache.h */
+    size_t mNamesSize;
 };
 
 struct PropertyValue {
@@ -219,12 +262,22 @@ struct CompUnit {
     U4_T mStatesMax;
     LineNumbersState * mStates;
     LineNumbersState ** mStatesIndex;
+    AddressIndex mStatesAddrIndex;  /* Addresses of mStates, built only if all states are in one section */
     U1_T mLineInfoLoaded;
+    U1_T mLineStatesDisposed;   /* mStates and mStatesIndex were disposed to free memory */
+    DWARFCacheItem mLineStatesItem;
 
     CompUnit * mBaseTypes;
     CompUnit * mNextTypeUnit;
 
     ContextAddress mFundTypeID;
+
+#if ENABLE_DWARF_LAZY_LOAD
+    LINK mCacheLink;        /* Link in LRU list of loaded units */
+    unsigned mObjectCnt;    /* Number of loaded objects, not including the unit object */
+    unsigned mLastUse;      /* Value of the cache use clock at last access */
+    int mEvict;
+#endif
 };
 
 /* Address range of a compilation unit. A unit can occupy multiple address ranges. */
@@ -242,6 +295,7 @@ struct FrameInfoIndex {
     unsigned mFrameInfoRangesCnt;
     unsigned mFrameInfoRangesMax;
     FrameInfoIndex * mNext;
+    DWARFCacheItem mItem;
 };
 
 struct ObjectHashTable {
@@ -256,6 +310,7 @@ struct ObjectHashTable {
 
 struct DWARFCache {
     int magic;
+    LINK mLink;             /* Link in the list of all DWARF caches */
     ELF_File * mFile;
     ErrorReport * mErrorReport;
     ELF_Section * mDebugLineV1;
@@ -265,20 +320,27 @@ struct DWARFCache {
     ObjectHashTable * mObjectHashTable; /* per ELF section */
     struct ObjectArray * mObjectList;
     unsigned mObjectArrayPos;
+    ObjectInfo * mObjectFree;
+    unsigned mObjectFreeCnt;
     ContextAddress mFundTypeID;
     UnitAddressRange * mAddrRanges;
     ContextAddress mAddrRangesMaxSize;
     unsigned mAddrRangesCnt;
     unsigned mAddrRangesMax;
     int mAddrRangesRelocatable;
+    AddressIndex mAddrRangesIndex;  /* Search index of mAddrRanges[].mAddr */
     PubNamesTable mPubNames;
     FrameInfoIndex * mFrameInfo;
     unsigned mFileInfoHashSize;
     FileInfo ** mFileInfoHash;
     int mLineInfoLoaded;
+    struct LineProgramJob * mLineInfoJob;   /* Line number programs run by worker threads */
+    int mLineInfoJobDone;
     CompUnit ** mTypeUnitHash;
     unsigned mTypeUnitHashSize;
     int lazy_loaded;
+    struct DWARFIndexFile * mIndexFile; /* Persistent index cache, see dwarfindexcache.h */
+    struct DWARFNames * mNameIndex;     /* Accelerator tables, see dwarfnames.h */
 };
 
 /* Return DWARF cache for given file, create and populate the cache if needed, throw an exception if error */
@@ -294,15 +356,45 @@ extern DWARFCache * get_dwarf_cache(ELF_File * file);
 #  define get_dwarf_parent(obj) ((obj)->mParent)
 #endif
 
+/*
+ * Mark frame info search index as recently used.
+ * Must be called after the index is created and index->mItem.mSize is set,
+ * the index can be disposed later to free memory.
+ */
+extern void touch_frame_info_index(FrameInfoIndex * index);
+
+/* Set memory limit for disposable parts of DWARF caches, bytes, zero means no limit */
+extern void set_dwarf_cache_memory_limit(size_t limit);
+
+/* Initialize DWARF cache module: read the memory limit configuration, register Diagnostics statistics */
+extern void ini_dwarf_cache(void);
+
 /* Return file name hash. The hash is used to search FileInfo. */
 extern unsigned calc_file_name_hash(const char * s);
 
 /* Load line number information for given compilation unit, throw an exception if error */
 extern void load_line_numbers(CompUnit * unit);
 
+/*
+ * Load line number information for all compilation units of the cache, throw an exception if error.
+ * If called by a cache client, line number programs can be run by worker threads,
+ * and the function throws ERR_CACHE_MISS until they are done, see cache.h.
+ */
+extern void load_all_line_numbers(DWARFCache * cache);
+
+/*
+ * Return first entry of the source file index hash chain for given file name hash.
+ * The index contains source files of all loaded line number tables in all DWARF caches,
+ * entries are linked by FileInfo.mNextInIndex. Caller must check FileInfo.mNameHash.
+ */
+extern FileInfo * get_source_file_index(unsigned hash);
+
 /* Find ObjectInfo by ID */
 extern ObjectInfo * find_object(ELF_Section * sec, ContextAddress ID);
 
+/* Return object of a public names table entry, load the object and its parents if needed */
+extern ObjectInfo * get_pub_names_object(DWARFCache * cache, PubNamesInfo * info);
+
 /* Search and return first compilation unit address range in given link-time address range 'addr_min'..'addr_max' (inclusive). */
 extern UnitAddressRange * find_comp_unit_addr_range(DWARFCache * cache, ELF_Section * section,
     ContextAddress addr_min, ContextAddress addr_max);
@@ -726,7 +726,7 @@ static void add_call_sites(ObjectInfo * obj, U8_T addr, U8_T size) {
 }
 
 static void find_call_sites(CompUnit * unit, U8_T addr, U8_T size) {
-    ObjectInfo * obj = unit->mObject->mChildren;
+    ObjectInfo * obj = get_dwarf_children(unit->mObject);
     call_site_cnt = 0;
     call_site_max = 16;
     call_site_buf = (ObjectInfo **)tmp_alloc(sizeof(ObjectInfo *) * call_site_max);
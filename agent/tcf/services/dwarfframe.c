@@ -31,6 +31,7 @@
 #include <tcf/services/dwarf.h>
 #include <tcf/services/dwarfio.h>
 #include <tcf/services/dwarfframe.h>
+#include <tcf/services/dwarfindexcache.h>
 
 #define EH_PE_omit              0xff
 
@@ -1278,6 +1279,38 @@ static void create_search_index(DWARFCache * cache, FrameInfoIndex * index) {
     qsort(index->mFrameInfoRanges, index->mFrameInfoRangesCnt, sizeof(FrameInfoRange), cmp_frame_info_ranges);
 }
 
+#if ENABLE_DWARF_INDEX_CACHE
+
+typedef struct FrameIndexHeader {
+    U4_T mRelocatable;
+    U4_T mCnt;
+} FrameIndexHeader;
+
+static int load_search_index(DWARFCache * cache, FrameInfoIndex * index) {
+    size_t size = 0;
+    const FrameIndexHeader * hdr = (const FrameIndexHeader *)dwarf_index_find(cache,
+        DWARF_INDEX_FRAME_INFO + index->mSection->index, &size);
+    if (hdr == NULL || size < sizeof(FrameIndexHeader)) return 0;
+    if (size != sizeof(FrameIndexHeader) + sizeof(FrameInfoRange) * hdr->mCnt) return 0;
+    index->mRelocatable = hdr->mRelocatable;
+    index->mFrameInfoRangesCnt = index->mFrameInfoRangesMax = hdr->mCnt;
+    index->mFrameInfoRanges = (FrameInfoRange *)loc_alloc(sizeof(FrameInfoRange) * (hdr->mCnt ? hdr->mCnt : 1));
+    memcpy(index->mFrameInfoRanges, hdr + 1, sizeof(FrameInfoRange) * hdr->mCnt);
+    return 1;
+}
+
+static void save_search_index(DWARFCache * cache, FrameInfoIndex * index) {
+    size_t size = sizeof(FrameIndexHeader) + sizeof(FrameInfoRange) * index->mFrameInfoRangesCnt;
+    FrameIndexHeader * hdr = (FrameIndexHeader *)loc_alloc_zero(size);
+    hdr->mRelocatable = index->mRelocatable;
+    hdr->mCnt = index->mFrameInfoRangesCnt;
+    if (hdr->mCnt > 0) memcpy(hdr + 1, index->mFrameInfoRanges, sizeof(FrameInfoRange) * hdr->mCnt);
+    dwarf_index_store(cache, DWARF_INDEX_FRAME_INFO + index->mSection->index, hdr, size);
+    loc_free(hdr);
+}
+
+#endif /* ENABLE_DWARF_INDEX_CACHE */
+
 static void read_frame_info_section(Context * ctx, ELF_Section * text_section,
                                     U8_T IP, DWARFCache * cache, FrameInfoIndex * index) {
     unsigned l, h;
@@ -1310,7 +1343,18 @@ static void read_frame_info_section(Context * ctx, ELF_Section * text_section,
     rules.reg_id_scope.id_type = rules.eh_frame ? REGNUM_EH_FRAME : REGNUM_DWARF;
     rules.cie_pos = ~(U8_T)0;
 
-    if (index->mFrameInfoRanges == NULL) create_search_index(cache, index);
+    if (index->mFrameInfoRanges == NULL) {
+#if ENABLE_DWARF_INDEX_CACHE
+        if (!load_search_index(cache, index)) {
+            create_search_index(cache, index);
+            save_search_index(cache, index);
+        }
+#else
+        create_search_index(cache, index);
+#endif
+        index->mItem.mSize = sizeof(FrameInfoRange) * index->mFrameInfoRangesMax;
+    }
+    touch_frame_info_index(index);
     l = 0;
     h = index->mFrameInfoRangesCnt;
     if (index->mRelocatable && text_section != NULL) sec_idx = text_section->index;
@@ -0,0 +1,506 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Persistent on-disk cache of DWARF search indices.
+ *
+ * Index file layout:
+ *   IndexHeader
+ *   IndexChunk[chunk_cnt]
+ *   chunk data, each chunk is 8 bytes aligned
+ * All values are in the agent host byte order.
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_ELF && ENABLE_DebugContext
+
+#include <tcf/services/dwarfindexcache.h>
+
+#if ENABLE_DWARF_INDEX_CACHE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <utime.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/trace.h>
+
+#define INDEX_MAGIC         "TCFDWIX"
+#define INDEX_VERSION       2
+#define INDEX_BUILD_ID_MAX  64
+
+/* Files smaller than this are parsed fast enough, don't clutter the cache directory */
+#define INDEX_MIN_FILE_SIZE 0x100000
+
+/* Sections smaller than this are decompressed fast enough */
+#define SECTION_MIN_SIZE    0x10000
+
+#ifndef SECTION_CACHE_MAX_SIZE
+/* Total size of cached section data files, least recently used files are deleted when exceeded */
+#  define SECTION_CACHE_MAX_SIZE ((U8_T)0x40000000)
+#endif
+
+typedef struct IndexHeader {
+    char magic[8];
+    U4_T version;
+    U4_T host;              /* Pointer size, address size and byte order of the agent */
+    U8_T dev;
+    U8_T ino;
+    int64_t mtime;
+    int64_t size;
+    U4_T section_cnt;
+    U4_T build_id_size;
+    U1_T build_id[INDEX_BUILD_ID_MAX];
+    U4_T chunk_cnt;
+    U4_T reserved;
+} IndexHeader;
+
+typedef struct IndexChunk {
+    U4_T tag;
+    U4_T reserved;
+    U8_T offs;
+    U8_T size;
+} IndexChunk;
+
+struct DWARFIndexFile {
+    int disabled;
+    int mapped;
+    char * path;
+    IndexHeader key;
+    void * map_addr;
+    size_t map_size;
+    IndexChunk * chunks;
+    unsigned chunk_cnt;
+};
+
+struct DWARFIndexSection {
+    struct DWARFIndexFile file;
+    U4_T tag;
+    int stored;             /* Set by a worker thread, read after the worker is done */
+};
+
+typedef struct SectionCacheFile {
+    char * path;
+    U8_T size;
+    time_t mtime;
+} SectionCacheFile;
+
+const char * dwarf_index_cache_path = NULL;
+
+static char * cache_dir = NULL;
+static int cache_dir_ok = 0;
+
+static int make_dirs(char * path) {
+    char * p = path;
+    while (*p == '/') p++;
+    for (;;) {
+        char ch;
+        while (*p && *p != '/') p++;
+        ch = *p;
+        *p = 0;
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+            *p = ch;
+            return -1;
+        }
+        *p = ch;
+        if (ch == 0) return 0;
+        while (*p == '/') p++;
+        if (*p == 0) return 0;
+    }
+}
+
+static const char * get_cache_dir(void) {
+    if (!cache_dir_ok) {
+        char buf[FILE_PATH_SIZE];
+        const char * dir = dwarf_index_cache_path;
+        cache_dir_ok = 1;
+        if (dir == NULL) dir = getenv("TCF_DWARF_INDEX_CACHE");
+        if (dir == NULL || *dir == 0) return NULL;
+        snprintf(buf, sizeof(buf), "%s", dir);
+        if (make_dirs(buf) < 0) {
+            trace(LOG_ELF, "DWARF index cache disabled: cannot create %s: %s", buf, errno_to_str(errno));
+            return NULL;
+        }
+        cache_dir = loc_strdup(buf);
+    }
+    return cache_dir;
+}
+
+static void get_build_id(ELF_File * file, IndexHeader * key) {
+    unsigned idx;
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        ELF_Section * sec = file->sections + idx;
+        U8_T offs = 0;
+        if (sec->size == 0 || sec->type != SHT_NOTE) continue;
+        if (elf_load(sec) < 0) continue;
+        while (offs + 12 <= sec->size) {
+            U4_T name_sz = *(U4_T *)((U1_T *)sec->data + offs);
+            U4_T desc_sz = *(U4_T *)((U1_T *)sec->data + offs + 4);
+            U4_T type = *(U4_T *)((U1_T *)sec->data + offs + 8);
+            const char * name = NULL;
+            if (file->byte_swap) {
+                SWAP(name_sz);
+                SWAP(desc_sz);
+                SWAP(type);
+            }
+            offs += 12;
+            name = (const char *)sec->data + offs;
+            offs += (name_sz + 3) & ~3u;
+            if (offs + desc_sz > sec->size) break;
+            if (type == 3 && name_sz == 4 && strcmp(name, "GNU") == 0 &&
+                    desc_sz > 0 && desc_sz <= INDEX_BUILD_ID_MAX) {
+                key->build_id_size = desc_sz;
+                memcpy(key->build_id, (U1_T *)sec->data + offs, desc_sz);
+                return;
+            }
+            offs += (desc_sz + 3) & ~3u;
+        }
+    }
+}
+
+/* Set index file key and base name for the ELF file, returns -1 if the file should not be cached */
+static int get_file_key(ELF_File * file, IndexHeader * key, char * name, size_t name_size) {
+    if (file->size < INDEX_MIN_FILE_SIZE || file->mtime_changed) return -1;
+    memset(key, 0, sizeof(IndexHeader));
+    memcpy(key->magic, INDEX_MAGIC, sizeof(key->magic));
+    key->version = INDEX_VERSION;
+    key->host = (U4_T)(sizeof(void *) | sizeof(ContextAddress) << 8 | big_endian_host() << 16);
+    key->dev = (U8_T)file->dev;
+    key->ino = (U8_T)file->ino;
+    key->mtime = file->mtime;
+    key->size = file->size;
+    key->section_cnt = file->section_cnt;
+    get_build_id(file, key);
+    if (key->build_id_size > 0) {
+        /* A stripped file and its separate debug info file have same build ID, but different contents */
+        U4_T i;
+        for (i = 0; i < key->build_id_size; i++) {
+            snprintf(name + i * 2, 3, "%02x", key->build_id[i]);
+        }
+        snprintf(name + i * 2, name_size - i * 2, "-%" PRIx64 "-%x", (U8_T)key->size, (unsigned)key->section_cnt);
+    }
+    else {
+        snprintf(name, name_size, "%" PRIx64 "-%" PRIx64, key->dev, key->ino);
+    }
+    return 0;
+}
+
+static struct DWARFIndexFile * get_index_file(DWARFCache * cache) {
+    struct DWARFIndexFile * f = cache->mIndexFile;
+    if (f == NULL) {
+        const char * dir = get_cache_dir();
+        char name[INDEX_BUILD_ID_MAX * 2 + 64];
+        f = cache->mIndexFile = (struct DWARFIndexFile *)loc_alloc_zero(sizeof(struct DWARFIndexFile));
+        if (dir == NULL || get_file_key(cache->mFile, &f->key, name, sizeof(name)) < 0) {
+            f->disabled = 1;
+        }
+        else {
+            char path[FILE_PATH_SIZE];
+            snprintf(path, sizeof(path), "%s/%s.idx", dir, name);
+            f->path = loc_strdup(path);
+        }
+    }
+    return f;
+}
+
+static int is_valid_header(IndexHeader * key, IndexHeader * hdr) {
+    if (memcmp(hdr->magic, key->magic, sizeof(hdr->magic)) != 0) return 0;
+    if (hdr->version != key->version) return 0;
+    if (hdr->host != key->host) return 0;
+    if (hdr->section_cnt != key->section_cnt) return 0;
+    if (hdr->size != key->size) return 0;
+    if (key->build_id_size > 0) {
+        return hdr->build_id_size == key->build_id_size &&
+            memcmp(hdr->build_id, key->build_id, key->build_id_size) == 0;
+    }
+    return hdr->build_id_size == 0 && hdr->dev == key->dev &&
+        hdr->ino == key->ino && hdr->mtime == key->mtime;
+}
+
+static void unmap_index_file(struct DWARFIndexFile * f) {
+    if (f->map_addr != NULL) munmap(f->map_addr, f->map_size);
+    f->map_addr = NULL;
+    f->map_size = 0;
+    f->chunks = NULL;
+    f->chunk_cnt = 0;
+    f->mapped = 0;
+}
+
+static void map_index_file(struct DWARFIndexFile * f) {
+    int fd = -1;
+    struct stat st;
+    IndexHeader * hdr = NULL;
+    unsigned i;
+
+    f->mapped = 1;
+    if ((fd = open(f->path, O_RDONLY)) < 0) return;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(IndexHeader)) {
+        close(fd);
+        return;
+    }
+    f->map_size = (size_t)st.st_size;
+    f->map_addr = mmap(NULL, f->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (f->map_addr == MAP_FAILED) {
+        f->map_addr = NULL;
+        f->map_size = 0;
+        return;
+    }
+    hdr = (IndexHeader *)f->map_addr;
+    if (!is_valid_header(&f->key, hdr) ||
+            sizeof(IndexHeader) + (U8_T)hdr->chunk_cnt * sizeof(IndexChunk) > f->map_size) {
+        trace(LOG_ELF, "DWARF index cache: ignoring stale file %s", f->path);
+        unmap_index_file(f);
+        f->mapped = 1;
+        return;
+    }
+    f->chunks = (IndexChunk *)(hdr + 1);
+    f->chunk_cnt = hdr->chunk_cnt;
+    for (i = 0; i < f->chunk_cnt; i++) {
+        IndexChunk * c = f->chunks + i;
+        if (c->offs % 8 != 0 || c->offs > f->map_size || c->size > f->map_size - c->offs) {
+            trace(LOG_ELF, "DWARF index cache: ignoring invalid file %s", f->path);
+            unmap_index_file(f);
+            f->mapped = 1;
+            return;
+        }
+    }
+}
+
+const void * dwarf_index_find(DWARFCache * cache, U4_T tag, size_t * size) {
+    struct DWARFIndexFile * f = get_index_file(cache);
+    unsigned i;
+    if (f->disabled) return NULL;
+    if (!f->mapped) map_index_file(f);
+    for (i = 0; i < f->chunk_cnt; i++) {
+        IndexChunk * c = f->chunks + i;
+        if (c->tag == tag) {
+            *size = (size_t)c->size;
+            return (U1_T *)f->map_addr + c->offs;
+        }
+    }
+    return NULL;
+}
+
+static int write_all(int fd, const void * buf, size_t size) {
+    while (size > 0) {
+        ssize_t wr = write(fd, buf, size);
+        if (wr < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf = (const U1_T *)buf + wr;
+        size -= wr;
+    }
+    return 0;
+}
+
+/* Write index file, returns error code. Does not use agent data structures, can be called from any thread. */
+static int write_index_file(const char * path, IndexHeader * hdr, IndexChunk * chunks, const void ** srcs, unsigned cnt) {
+    char tmp[FILE_PATH_SIZE];
+    static const U1_T zeros[8];
+    U8_T offs = 0;
+    unsigned i;
+    int fd = -1;
+    int error = 0;
+
+    hdr->chunk_cnt = cnt;
+    offs = sizeof(IndexHeader) + sizeof(IndexChunk) * cnt;
+    for (i = 0; i < cnt; i++) {
+        offs = (offs + 7) & ~(U8_T)7;
+        chunks[i].offs = offs;
+        offs += chunks[i].size;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return errno;
+    if (write_all(fd, hdr, sizeof(IndexHeader)) < 0) error = errno;
+    if (!error && write_all(fd, chunks, sizeof(IndexChunk) * cnt) < 0) error = errno;
+    offs = sizeof(IndexHeader) + sizeof(IndexChunk) * cnt;
+    for (i = 0; !error && i < cnt; i++) {
+        if (chunks[i].offs > offs && write_all(fd, zeros, (size_t)(chunks[i].offs - offs)) < 0) error = errno;
+        if (!error && write_all(fd, srcs[i], (size_t)chunks[i].size) < 0) error = errno;
+        offs = chunks[i].offs + chunks[i].size;
+    }
+    if (close(fd) < 0 && !error) error = errno;
+    if (!error && rename(tmp, path) < 0) error = errno;
+    if (error) unlink(tmp);
+    return error;
+}
+
+void dwarf_index_store(DWARFCache * cache, U4_T tag, const void * data, size_t size) {
+    struct DWARFIndexFile * f = get_index_file(cache);
+    IndexHeader hdr;
+    IndexChunk * chunks = NULL;
+    const void ** srcs = NULL;
+    unsigned cnt = 0;
+    unsigned i;
+    int error = 0;
+
+    if (f->disabled) return;
+    if (!f->mapped) map_index_file(f);
+
+    /* Keep other chunks of the existing file */
+    chunks = (IndexChunk *)tmp_alloc(sizeof(IndexChunk) * (f->chunk_cnt + 1));
+    srcs = (const void **)tmp_alloc(sizeof(void *) * (f->chunk_cnt + 1));
+    for (i = 0; i < f->chunk_cnt; i++) {
+        if (f->chunks[i].tag == tag) continue;
+        srcs[cnt] = (U1_T *)f->map_addr + f->chunks[i].offs;
+        chunks[cnt++] = f->chunks[i];
+    }
+    srcs[cnt] = data;
+    chunks[cnt].tag = tag;
+    chunks[cnt].reserved = 0;
+    chunks[cnt].size = size;
+    cnt++;
+
+    hdr = f->key;
+    error = write_index_file(f->path, &hdr, chunks, srcs, cnt);
+    if (error) {
+        trace(LOG_ELF, "DWARF index cache: cannot write %s: %s", f->path, errno_to_str(error));
+        return;
+    }
+    trace(LOG_ELF, "DWARF index cache: updated %s", f->path);
+    unmap_index_file(f);
+}
+
+DWARFIndexSection * dwarf_index_section_open(ELF_Section * sec) {
+    DWARFIndexSection * cs = NULL;
+    const char * dir = NULL;
+    char name[INDEX_BUILD_ID_MAX * 2 + 64];
+    char path[FILE_PATH_SIZE];
+
+    if (sec->size < SECTION_MIN_SIZE) return NULL;
+    if ((dir = get_cache_dir()) == NULL) return NULL;
+    cs = (DWARFIndexSection *)loc_alloc_zero(sizeof(DWARFIndexSection));
+    if (get_file_key(sec->file, &cs->file.key, name, sizeof(name)) < 0) {
+        loc_free(cs);
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/%s.%u.sec", dir, name, (unsigned)sec->index);
+    cs->file.path = loc_strdup(path);
+    cs->tag = DWARF_INDEX_SECTION_DATA + sec->index;
+    return cs;
+}
+
+int dwarf_index_section_map(DWARFIndexSection * cs, ELF_Section * sec) {
+    struct DWARFIndexFile * f = &cs->file;
+    if (!f->mapped) map_index_file(f);
+    if (f->chunk_cnt == 1 && f->chunks[0].tag == cs->tag && f->chunks[0].size == sec->size) {
+        /* Modification time of section files is their last use time, see trim_section_cache() */
+        utime(f->path, NULL);
+        sec->mmap_addr = f->map_addr;
+        sec->mmap_size = f->map_size;
+        sec->data = (U1_T *)f->map_addr + f->chunks[0].offs;
+        f->map_addr = NULL;
+        f->map_size = 0;
+        f->chunks = NULL;
+        f->chunk_cnt = 0;
+        return 0;
+    }
+    unmap_index_file(f);
+    f->mapped = 1;
+    return -1;
+}
+
+int dwarf_index_section_store(DWARFIndexSection * cs, const void * data, size_t size) {
+    IndexHeader hdr = cs->file.key;
+    IndexChunk chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.tag = cs->tag;
+    chunk.size = size;
+    cs->stored = 1;
+    return write_index_file(cs->file.path, &hdr, &chunk, &data, 1);
+}
+
+static int section_file_comparator(const void * x, const void * y) {
+    const SectionCacheFile * a = (const SectionCacheFile *)x;
+    const SectionCacheFile * b = (const SectionCacheFile *)y;
+    if (a->mtime < b->mtime) return -1;
+    if (a->mtime > b->mtime) return +1;
+    return 0;
+}
+
+/* Delete least recently used section data files until their total size is within SECTION_CACHE_MAX_SIZE */
+static void trim_section_cache(void) {
+    const char * dir = get_cache_dir();
+    SectionCacheFile * files = NULL;
+    unsigned files_cnt = 0;
+    unsigned files_max = 0;
+    U8_T total = 0;
+    struct dirent * e = NULL;
+    unsigned i;
+    DIR * d = NULL;
+
+    if (dir == NULL || (d = opendir(dir)) == NULL) return;
+    while ((e = readdir(d)) != NULL) {
+        char path[FILE_PATH_SIZE];
+        size_t len = strlen(e->d_name);
+        struct stat st;
+        if (len <= 4 || strcmp(e->d_name + len - 4, ".sec") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (stat(path, &st) < 0 || !S_ISREG(st.st_mode)) continue;
+        if (files_cnt >= files_max) {
+            files_max = files_max == 0 ? 64 : files_max * 2;
+            files = (SectionCacheFile *)loc_realloc(files, sizeof(SectionCacheFile) * files_max);
+        }
+        files[files_cnt].path = loc_strdup(path);
+        files[files_cnt].size = (U8_T)st.st_size;
+        files[files_cnt].mtime = st.st_mtime;
+        total += (U8_T)st.st_size;
+        files_cnt++;
+    }
+    closedir(d);
+    if (total > SECTION_CACHE_MAX_SIZE) {
+        qsort(files, files_cnt, sizeof(SectionCacheFile), section_file_comparator);
+        for (i = 0; i < files_cnt && total > SECTION_CACHE_MAX_SIZE; i++) {
+            if (unlink(files[i].path) < 0) continue;
+            trace(LOG_ELF, "DWARF index cache: deleted %s", files[i].path);
+            total -= files[i].size;
+        }
+    }
+    for (i = 0; i < files_cnt; i++) loc_free(files[i].path);
+    loc_free(files);
+}
+
+void dwarf_index_section_close(DWARFIndexSection * cs) {
+    if (cs == NULL) return;
+    if (cs->stored) trim_section_cache();
+    unmap_index_file(&cs->file);
+    loc_free(cs->file.path);
+    loc_free(cs);
+}
+
+void dwarf_index_close(DWARFCache * cache) {
+    struct DWARFIndexFile * f = cache->mIndexFile;
+    if (f == NULL) return;
+    unmap_index_file(f);
+    loc_free(f->path);
+    loc_free(f);
+    cache->mIndexFile = NULL;
+}
+
+#endif /* ENABLE_DWARF_INDEX_CACHE */
+
+#endif /* ENABLE_ELF && ENABLE_DebugContext */
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Persistent on-disk cache of DWARF search indices.
+ *
+ * Search indices that take a full scan of debug sections to build are saved into
+ * a sidecar file, one file per ELF file, and are memory mapped on next agent start.
+ * The file is validated by GNU build ID, if the ELF file has one, otherwise by
+ * device, inode, modification time and size of the ELF file. The file name includes
+ * size and section count of the ELF file, so a stripped file and its separate debug
+ * info file, which have same build ID, don't share a cache file.
+ *
+ * Decompressed data of compressed ELF sections is cached same way, one file per section.
+ * Total size of section files is limited by SECTION_CACHE_MAX_SIZE, least recently
+ * used files are deleted when the limit is exceeded.
+ *
+ * Address ranges, public names and frame info indices are persisted, other search indices
+ * (types, line numbers) are still built on demand. Compilation units and their top level
+ * entries are still read from debug sections on every load of a file.
+ *
+ * The cache is disabled by default. It is enabled by agent command line option -C<dir>,
+ * or by setting TCF_DWARF_INDEX_CACHE environment variable to the cache directory name.
+ */
+
+#ifndef D_dwarfindexcache
+#define D_dwarfindexcache
+
+#include <tcf/config.h>
+
+#if ENABLE_ELF && ENABLE_DebugContext
+
+#include <tcf/services/dwarfcache.h>
+
+#if ENABLE_DWARF_INDEX_CACHE
+
+/* Index chunk tags */
+#define DWARF_INDEX_ADDR_RANGES     0x00000001
+#define DWARF_INDEX_PUB_NAMES       0x00000002
+#define DWARF_INDEX_FRAME_INFO      0x00010000  /* + frame info section index */
+#define DWARF_INDEX_SECTION_DATA    0x00020000  /* + section index */
+
+typedef struct DWARFIndexSection DWARFIndexSection;
+
+/*
+ * Cache directory name, set by command line option -C.
+ * If NULL, TCF_DWARF_INDEX_CACHE environment variable is used.
+ */
+extern const char * dwarf_index_cache_path;
+
+/*
+ * Find index chunk with given tag.
+ * Returns pointer to chunk data and sets *size, or returns NULL if the chunk is not cached.
+ * The data is 8 bytes aligned, and stays valid until next dwarf_index_store() call.
+ */
+extern const void * dwarf_index_find(DWARFCache * cache, U4_T tag, size_t * size);
+
+/*
+ * Add or replace index chunk, and write the index file.
+ * Errors are traced and otherwise ignored.
+ */
+extern void dwarf_index_store(DWARFCache * cache, U4_T tag, const void * data, size_t size);
+
+/*
+ * Release index file resources, called when the DWARF cache is disposed.
+ */
+extern void dwarf_index_close(DWARFCache * cache);
+
+/*
+ * Get cache file handle for decompressed data of ELF section 'sec'.
+ * Returns NULL if the section should not be cached.
+ */
+extern DWARFIndexSection * dwarf_index_section_open(ELF_Section * sec);
+
+/*
+ * Map cached section data. On success sets section 'data', 'mmap_addr' and 'mmap_size' fields
+ * and returns 0, the mapping is released when the ELF file is disposed.
+ * Returns -1 if the data is not cached.
+ */
+extern int dwarf_index_section_map(DWARFIndexSection * cs, ELF_Section * sec);
+
+/*
+ * Write section data into the cache, returns 0 or error code.
+ * The function does not use agent data structures, it can be called from any thread.
+ */
+extern int dwarf_index_section_store(DWARFIndexSection * cs, const void * data, size_t size);
+
+/*
+ * Release the cache file handle.
+ * If section data was stored, least recently used section files are deleted to keep
+ * the cache size within the limit. Must be called on the dispatch thread.
+ */
+extern void dwarf_index_section_close(DWARFIndexSection * cs);
+
+#endif /* ENABLE_DWARF_INDEX_CACHE */
+
+#endif /* ENABLE_ELF && ENABLE_DebugContext */
+
+#endif /* D_dwarfindexcache */
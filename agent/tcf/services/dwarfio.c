@@ -26,6 +26,7 @@
 #include <assert.h>
 #include <string.h>
 #include <tcf/framework/myalloc.h>
+#include <tcf/framework/events.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/services/dwarfio.h>
 #include <tcf/services/dwarfreloc.h>
@@ -68,14 +69,27 @@ size_t dio_gFormDataSize = 0;
 void * dio_gFormDataAddr = NULL;
 ELF_Section * dio_gFormSection = NULL;
 
-static ELF_Section * sSection;
-static int sBigEndian;
-static int sAddressSize;
-static int sRefAddressSize;
-static U1_T * sData;
-static U8_T sDataPos;
-static U8_T sDataLen;
-static DIO_UnitDescriptor * sUnit;
+#if DIO_THREAD_SAFE
+#  if defined(_MSC_VER)
+#    define DIO_THREAD_LOCAL __declspec(thread)
+#  else
+#    define DIO_THREAD_LOCAL __thread
+#  endif
+#else
+#  define DIO_THREAD_LOCAL
+#endif
+
+/* Reader state, see DIO_THREAD_SAFE */
+static DIO_THREAD_LOCAL ELF_Section * sSection;
+static DIO_THREAD_LOCAL int sBigEndian;
+static DIO_THREAD_LOCAL int sAddressSize;
+static DIO_THREAD_LOCAL int sRefAddressSize;
+static DIO_THREAD_LOCAL U1_T * sData;
+static DIO_THREAD_LOCAL U8_T sDataPos;
+static DIO_THREAD_LOCAL U8_T sDataLen;
+static DIO_THREAD_LOCAL DIO_UnitDescriptor * sUnit;
+static DIO_THREAD_LOCAL int sError;
+static DIO_THREAD_LOCAL const char * sErrorMsg;
 
 static void dio_CloseELF(ELF_File * File) {
     U4_T n, m;
@@ -115,7 +129,26 @@ static DIO_Cache * dio_GetCache(ELF_File * File) {
     return Cache;
 }
 
+void dio_Error(int Error, const char * Msg) {
+    if (is_dispatch_thread()) {
+        if (Msg == NULL) exception(Error);
+        str_exception(Error, Msg);
+    }
+    if (sError == 0) {
+        sError = Error;
+        sErrorMsg = Msg;
+    }
+    sDataPos = sDataLen;
+}
+
+int dio_GetError(const char ** Msg) {
+    if (Msg != NULL) *Msg = sErrorMsg;
+    return sError;
+}
+
 void dio_EnterSection(DIO_UnitDescriptor * Unit, ELF_Section * Section, U8_T Offset) {
+    /* Other threads can only read sections that are already loaded */
+    assert(is_dispatch_thread() || Section->data != NULL);
     if (elf_load(Section)) exception(errno);
     if (Offset > Section->size) {
         if (Section->name == NULL) exception(ERR_INV_DWARF);
@@ -140,7 +173,9 @@ void dio_EnterSection(DIO_UnitDescriptor * Unit, ELF_Section * Section, U8_T Off
         sRefAddressSize = 4;
     }
     sUnit = Unit;
-    dio_gEntryPos = 0;
+    sError = 0;
+    sErrorMsg = NULL;
+    if (is_dispatch_thread()) dio_gEntryPos = 0;
     assert(sData != NULL);
     assert(sDataPos < sDataLen);
 }
@@ -162,23 +197,30 @@ U1_T * dio_GetDataPtr(void) {
 }
 
 void dio_Skip(I8_T Bytes) {
-    if (sDataPos + Bytes > sDataLen) exception(ERR_EOF);
-    sDataPos += Bytes;
+    if (sDataPos + Bytes > sDataLen) dio_Error(ERR_EOF, NULL);
+    else sDataPos += Bytes;
 }
 
 void dio_SetPos(U8_T Pos) {
-    if (Pos > sDataLen) exception(ERR_EOF);
-    sDataPos = Pos;
+    if (Pos > sDataLen) dio_Error(ERR_EOF, NULL);
+    else sDataPos = Pos;
 }
 
 void dio_Read(U1_T * Buf, U4_T Size) {
-    if (sDataPos + Size > sDataLen) exception(ERR_EOF);
+    if (sDataPos + Size > sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        memset(Buf, 0, Size);
+        return;
+    }
     memcpy(Buf, sData + sDataPos, Size);
     sDataPos += Size;
 }
 
 static U1_T dio_ReadU1F(void) {
-    if (sDataPos >= sDataLen) exception(ERR_EOF);
+    if (sDataPos >= sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        return 0;
+    }
     return sData[sDataPos++];
 }
 
@@ -190,7 +232,10 @@ U1_T dio_ReadU1(void) {
 
 U2_T dio_ReadU2(void) {
     U2_T x0, x1;
-    if (sDataPos + 2 > sDataLen) exception(ERR_EOF);
+    if (sDataPos + 2 > sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        return 0;
+    }
     x0 = sData[sDataPos++];
     x1 = sData[sDataPos++];
     return sBigEndian ? (x0 << 8) | x1 : x0 | (x1 << 8);
@@ -199,14 +244,20 @@ U2_T dio_ReadU2(void) {
 U4_T dio_ReadU4(void) {
 #if defined(__BYTE_ORDER__)
     U4_T x;
-    if (sDataPos + 4 > sDataLen) exception(ERR_EOF);
+    if (sDataPos + 4 > sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        return 0;
+    }
     x = *(U4_T *)(sData + sDataPos);
     if ((sBigEndian == 0) != (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) SWAP(x);
     sDataPos += 4;
     return x;
 #else
     U4_T x0, x1, x2, x3;
-    if (sDataPos + 4 > sDataLen) exception(ERR_EOF);
+    if (sDataPos + 4 > sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        return 0;
+    }
     x0 = sData[sDataPos++];
     x1 = sData[sDataPos++];
     x2 = sData[sDataPos++];
@@ -220,7 +271,10 @@ U4_T dio_ReadU4(void) {
 U8_T dio_ReadU8(void) {
 #if defined(__BYTE_ORDER__) && !defined(__arm__)
     U8_T x;
-    if (sDataPos + 8 > sDataLen) exception(ERR_EOF);
+    if (sDataPos + 8 > sDataLen) {
+        dio_Error(ERR_EOF, NULL);
+        return 0;
+    }
     x = *(U8_T *)(sData + sDataPos);
     if ((sBigEndian == 0) != (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) SWAP(x);
     sDataPos += 8;
@@ -301,7 +355,7 @@ U8_T dio_ReadAddressX(ELF_Section ** s, int size) {
         return x;
     }
     default:
-        str_exception(ERR_INV_DWARF, "Invalid data size");
+        dio_Error(ERR_INV_DWARF, "Invalid data size");
         return 0;
     }
 }
@@ -314,7 +368,7 @@ char * dio_ReadString(void) {
     char * Res = (char *)(sData + sDataPos);
     U4_T Length = 0;
     while (dio_ReadU1() != 0) Length++;
-    if (Length == 0) return NULL;
+    if (Length == 0 || sError) return NULL;
     return Res;
 }
 
@@ -17,6 +17,11 @@
  * This module implements low-level functions for reading DWARF debug information.
  *
  * Functions in this module use exceptions to report errors, see exceptions.h
+ *
+ * If DIO_THREAD_SAFE, the reader state is thread local, and threads other than the dispatch thread
+ * can use dio_EnterSection(), dio_ExitSection() and data reading functions to read a section that is
+ * already loaded and does not need relocation. Such threads cannot use exceptions, a read error is
+ * recorded instead, see dio_GetError(). Entries and attributes are read by the dispatch thread only.
  */
 #ifndef D_dwarfio
 #define D_dwarfio
@@ -27,6 +32,14 @@
 
 #include <tcf/services/tcf_elf.h>
 
+#ifndef DIO_THREAD_SAFE
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#    define DIO_THREAD_SAFE 1
+#  else
+#    define DIO_THREAD_SAFE 0
+#  endif
+#endif
+
 typedef struct DIO_UnitDescriptor {
     ELF_Section * mSection;
     U2_T mVersion;
@@ -51,6 +64,19 @@ extern ELF_Section * dio_gFormSection;
 extern void dio_EnterSection(DIO_UnitDescriptor * Unit, ELF_Section * Section, U8_T Offset);
 extern void dio_ExitSection(void);
 
+/*
+ * Report a read error. On the dispatch thread, throw an exception.
+ * On other threads, record the error and move the read position to the end of the section,
+ * subsequent reads return zeros.
+ */
+extern void dio_Error(int Error, const char * Msg);
+
+/*
+ * Return first error recorded since dio_EnterSection() by current thread, or 0 if no errors.
+ * If 'Msg' is not NULL, it is set to the error message, or NULL if the error has no message.
+ */
+extern int dio_GetError(const char ** Msg);
+
 extern void dio_Skip(I8_T Bytes);
 extern void dio_SetPos(U8_T Pos);
 extern void dio_Read(U1_T * Buf, U4_T Size);
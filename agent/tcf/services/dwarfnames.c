@@ -0,0 +1,694 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements name lookup using DWARF 5 .debug_names and GDB .gdb_index
+ * accelerator tables.
+ *
+ * .debug_names maps a name to DIE offsets, the DIEs are loaded on demand by find_object().
+ * .gdb_index maps a name to a list of compilation units, the units are searched for the name.
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_ELF && ENABLE_DebugContext
+
+#include <tcf/services/dwarfnames.h>
+
+#if ENABLE_DWARF_NAMES
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <tcf/framework/exceptions.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/trace.h>
+#include <tcf/services/dwarf.h>
+
+#define IDX_compile_unit    1
+#define IDX_type_unit       2
+#define IDX_die_offset      3
+
+#ifndef FORM_DATA16
+#  define FORM_DATA16       0x001e
+#endif
+
+typedef struct NamesAbbrev {
+    U8_T mCode;
+    U4_T mAttrCnt;
+    U4_T * mAttrs;          /* Pairs of index attribute and form */
+} NamesAbbrev;
+
+/* Name index of .debug_names section, the section can contain multiple indices */
+typedef struct NamesIndex {
+    struct NamesIndex * mNext;
+    unsigned mOffsSize;
+    U4_T mCUCnt;
+    U4_T mLocalTUCnt;
+    U4_T mBucketCnt;
+    U4_T mNameCnt;
+    U1_T * mCUList;
+    U1_T * mLocalTUList;
+    U1_T * mBuckets;
+    U1_T * mHashes;
+    U1_T * mStrOffs;
+    U1_T * mEntryOffs;
+    U1_T * mEntryPool;
+    U1_T * mEnd;
+    NamesAbbrev * mAbbrevs;
+    unsigned mAbbrevCnt;
+} NamesIndex;
+
+struct DWARFNames {
+    DWARFCache * mCache;
+    ELF_File * mFile;
+    ELF_Section * mDebugInfo;
+    ELF_Section * mDebugStr;
+
+    /* .debug_names */
+    NamesIndex * mNames;
+
+    /* .gdb_index */
+    U4_T mGdbVersion;
+    U1_T * mGdbCUList;
+    U4_T mGdbCUCnt;
+    U1_T * mGdbSymbols;
+    U4_T mGdbSymbolsCnt;
+    U1_T * mGdbPool;
+    U1_T * mGdbEnd;
+    U4_T mGdbTUCnt;
+    U1_T * mGdbTUList;
+
+    /* Sorted .debug_info offsets of units listed in the table, NULL if the table covers all units */
+    U8_T * mUnits;
+    unsigned mUnitsCnt;
+};
+
+typedef struct LookupArgs {
+    DWARFNamesCallBack * call_back;
+    void * args;
+    const char * name;
+} LookupArgs;
+
+static U2_T read_u2(struct DWARFNames * n, U1_T * p) {
+    U2_T x;
+    memcpy(&x, p, 2);
+    if (n->mFile->byte_swap) SWAP(x);
+    return x;
+}
+
+static U4_T read_u4(struct DWARFNames * n, U1_T * p) {
+    U4_T x;
+    memcpy(&x, p, 4);
+    if (n->mFile->byte_swap) SWAP(x);
+    return x;
+}
+
+static U8_T read_offs(struct DWARFNames * n, NamesIndex * idx, U1_T * p) {
+    U8_T x;
+    if (idx->mOffsSize == 4) return read_u4(n, p);
+    memcpy(&x, p, 8);
+    if (n->mFile->byte_swap) SWAP(x);
+    return x;
+}
+
+static U8_T read_uleb128(U1_T ** pp, U1_T * end) {
+    U8_T res = 0;
+    unsigned i = 0;
+    U1_T * p = *pp;
+    for (;;) {
+        U1_T b;
+        if (p >= end) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+        b = *p++;
+        if (i < 64) res |= (U8_T)(b & 0x7f) << i;
+        i += 7;
+        if ((b & 0x80) == 0) break;
+    }
+    *pp = p;
+    return res;
+}
+
+/* GDB index is always little endian */
+static U4_T read_le4(U1_T * p) {
+    return (U4_T)p[0] | (U4_T)p[1] << 8 | (U4_T)p[2] << 16 | (U4_T)p[3] << 24;
+}
+
+static U8_T read_le8(U1_T * p) {
+    return (U8_T)read_le4(p) | (U8_T)read_le4(p + 4) << 32;
+}
+
+static ELF_Section * find_section(ELF_File * file, const char * name) {
+    unsigned i;
+    for (i = 1; i < file->section_cnt; i++) {
+        ELF_Section * sec = file->sections + i;
+        if (sec->size == 0) continue;
+        if (sec->name == NULL) continue;
+        if (sec->type == SHT_NOBITS) continue;
+        if (strcmp(sec->name, name) == 0) return sec;
+    }
+    return NULL;
+}
+
+static void read_names_abbrevs(NamesIndex * idx, U1_T * p, U1_T * end) {
+    unsigned max = 0;
+    for (;;) {
+        NamesAbbrev * abbr = NULL;
+        U8_T code = read_uleb128(&p, end);
+        unsigned attr_max = 0;
+        if (code == 0) break;
+        if (idx->mAbbrevCnt >= max) {
+            max = max == 0 ? 16 : max * 2;
+            idx->mAbbrevs = (NamesAbbrev *)loc_realloc(idx->mAbbrevs, sizeof(NamesAbbrev) * max);
+        }
+        abbr = idx->mAbbrevs + idx->mAbbrevCnt++;
+        memset(abbr, 0, sizeof(NamesAbbrev));
+        abbr->mCode = code;
+        read_uleb128(&p, end); /* Tag */
+        for (;;) {
+            U4_T attr = (U4_T)read_uleb128(&p, end);
+            U4_T form = (U4_T)read_uleb128(&p, end);
+            if (attr == 0 && form == 0) break;
+            if (abbr->mAttrCnt >= attr_max) {
+                attr_max = attr_max == 0 ? 4 : attr_max * 2;
+                abbr->mAttrs = (U4_T *)loc_realloc(abbr->mAttrs, sizeof(U4_T) * 2 * attr_max);
+            }
+            abbr->mAttrs[abbr->mAttrCnt * 2] = attr;
+            abbr->mAttrs[abbr->mAttrCnt * 2 + 1] = form;
+            abbr->mAttrCnt++;
+        }
+    }
+}
+
+static void free_names_index(NamesIndex * idx) {
+    unsigned i;
+    for (i = 0; i < idx->mAbbrevCnt; i++) loc_free(idx->mAbbrevs[i].mAttrs);
+    loc_free(idx->mAbbrevs);
+    loc_free(idx);
+}
+
+static int open_debug_names(struct DWARFNames * n, ELF_Section * sec) {
+    Trap trap;
+    NamesIndex * last = NULL;
+    U1_T * p = (U1_T *)sec->data;
+    U1_T * end = p + sec->size;
+    if (set_trap(&trap)) {
+        while (p + 4 <= end) {
+            NamesIndex * idx = NULL;
+            U8_T size = read_u4(n, p);
+            unsigned offs_size = 4;
+            U1_T * next = NULL;
+            U4_T abbrev_size = 0;
+            U4_T aug_size = 0;
+            U4_T foreign_tu_cnt = 0;
+            p += 4;
+            if (size == 0xffffffffu) {
+                if (p + 8 > end) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+                memcpy(&size, p, 8);
+                if (n->mFile->byte_swap) SWAP(size);
+                offs_size = 8;
+                p += 8;
+            }
+            if (size < 36 || size > (U8_T)(end - p)) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+            next = p + size;
+            if (read_u2(n, p) != 5) {
+                trace(LOG_ELF, "Ignoring .debug_names: unsupported version");
+                p = next;
+                continue;
+            }
+            idx = (NamesIndex *)loc_alloc_zero(sizeof(NamesIndex));
+            if (last == NULL) n->mNames = idx;
+            else last->mNext = idx;
+            last = idx;
+            idx->mOffsSize = offs_size;
+            idx->mCUCnt = read_u4(n, p + 4);
+            idx->mLocalTUCnt = read_u4(n, p + 8);
+            foreign_tu_cnt = read_u4(n, p + 12);
+            idx->mBucketCnt = read_u4(n, p + 16);
+            idx->mNameCnt = read_u4(n, p + 20);
+            abbrev_size = read_u4(n, p + 24);
+            aug_size = read_u4(n, p + 28);
+            p += 32 + ((aug_size + 3) & ~3u);
+            idx->mCUList = p;
+            p += (U8_T)idx->mCUCnt * offs_size;
+            idx->mLocalTUList = p;
+            p += (U8_T)idx->mLocalTUCnt * offs_size;
+            p += (U8_T)foreign_tu_cnt * 8;
+            idx->mBuckets = p;
+            p += (U8_T)idx->mBucketCnt * 4;
+            idx->mHashes = p;
+            if (idx->mBucketCnt > 0) p += (U8_T)idx->mNameCnt * 4;
+            idx->mStrOffs = p;
+            p += (U8_T)idx->mNameCnt * offs_size;
+            idx->mEntryOffs = p;
+            p += (U8_T)idx->mNameCnt * offs_size;
+            if (p > next || abbrev_size > (U8_T)(next - p)) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+            read_names_abbrevs(idx, p, p + abbrev_size);
+            idx->mEntryPool = p + abbrev_size;
+            idx->mEnd = next;
+            p = next;
+        }
+        clear_trap(&trap);
+    }
+    else {
+        trace(LOG_ELF, "Ignoring .debug_names: %s", errno_to_str(trap.error));
+        while (n->mNames != NULL) {
+            NamesIndex * idx = n->mNames;
+            n->mNames = idx->mNext;
+            free_names_index(idx);
+        }
+    }
+    return n->mNames != NULL;
+}
+
+static int open_gdb_index(struct DWARFNames * n, ELF_Section * sec) {
+    U1_T * p = (U1_T *)sec->data;
+    U4_T cu_offs, tu_offs, addr_offs, sym_offs, pool_offs;
+    if (sec->size < 24) return 0;
+    n->mGdbVersion = read_le4(p);
+    if (n->mGdbVersion != 7 && n->mGdbVersion != 8) {
+        trace(LOG_ELF, "Ignoring .gdb_index: unsupported version %d", n->mGdbVersion);
+        return 0;
+    }
+    cu_offs = read_le4(p + 4);
+    tu_offs = read_le4(p + 8);
+    addr_offs = read_le4(p + 12);
+    sym_offs = read_le4(p + 16);
+    pool_offs = read_le4(p + 20);
+    if (cu_offs > tu_offs || tu_offs > addr_offs || sym_offs > pool_offs || pool_offs > sec->size) {
+        trace(LOG_ELF, "Ignoring .gdb_index: invalid header");
+        return 0;
+    }
+    n->mGdbCUList = p + cu_offs;
+    n->mGdbCUCnt = (tu_offs - cu_offs) / 16;
+    n->mGdbTUList = p + tu_offs;
+    n->mGdbTUCnt = (addr_offs - tu_offs) / 24;
+    n->mGdbSymbols = p + sym_offs;
+    n->mGdbSymbolsCnt = (pool_offs - sym_offs) / 8;
+    n->mGdbPool = p + pool_offs;
+    n->mGdbEnd = p + sec->size;
+    if (n->mGdbSymbolsCnt == 0 || (n->mGdbSymbolsCnt & (n->mGdbSymbolsCnt - 1)) != 0) {
+        trace(LOG_ELF, "Ignoring .gdb_index: invalid symbol table size");
+        return 0;
+    }
+    return 1;
+}
+
+static int unit_offs_comparator(const void * x, const void * y) {
+    U8_T a = *(const U8_T *)x;
+    U8_T b = *(const U8_T *)y;
+    if (a < b) return -1;
+    if (a > b) return +1;
+    return 0;
+}
+
+static void add_unit_offs(struct DWARFNames * n, U8_T offs, unsigned * max) {
+    if (n->mUnitsCnt >= *max) {
+        *max = *max == 0 ? 64 : *max * 2;
+        n->mUnits = (U8_T *)loc_realloc(n->mUnits, sizeof(U8_T) * *max);
+    }
+    n->mUnits[n->mUnitsCnt++] = offs;
+}
+
+static int is_unit_listed(struct DWARFNames * n, U8_T offs) {
+    return bsearch(&offs, n->mUnits, n->mUnitsCnt, sizeof(U8_T), unit_offs_comparator) != NULL;
+}
+
+/*
+ * Tables are built from per object file data, e.g. compiled with -gpubnames,
+ * so a table can list only some of the units. Collect offsets of listed units,
+ * and return number of units in .debug_info that are not listed.
+ */
+static unsigned check_units_coverage(struct DWARFNames * n, unsigned * units_cnt) {
+    ObjectInfo * unit = n->mCache->mObjectHashTable[n->mDebugInfo->index].mCompUnits;
+    unsigned max = 0;
+    unsigned cnt = 0;
+    U4_T i;
+
+    if (n->mNames != NULL) {
+        NamesIndex * idx = n->mNames;
+        while (idx != NULL) {
+            for (i = 0; i < idx->mCUCnt; i++) add_unit_offs(n, read_offs(n, idx, idx->mCUList + i * idx->mOffsSize), &max);
+            for (i = 0; i < idx->mLocalTUCnt; i++) add_unit_offs(n, read_offs(n, idx, idx->mLocalTUList + i * idx->mOffsSize), &max);
+            idx = idx->mNext;
+        }
+    }
+    else {
+        for (i = 0; i < n->mGdbCUCnt; i++) add_unit_offs(n, read_le8(n->mGdbCUList + i * 16), &max);
+        for (i = 0; i < n->mGdbTUCnt; i++) add_unit_offs(n, read_le8(n->mGdbTUList + i * 24), &max);
+    }
+    qsort(n->mUnits, n->mUnitsCnt, sizeof(U8_T), unit_offs_comparator);
+    *units_cnt = 0;
+    while (unit != NULL) {
+        (*units_cnt)++;
+        if (!is_unit_listed(n, unit->mCompUnit->mDesc.mUnitOffs)) cnt++;
+        unit = unit->mSibling;
+    }
+    return cnt;
+}
+
+int dwarf_names_open(DWARFCache * cache, ELF_Section * debug_info) {
+    ELF_File * file = cache->mFile;
+    struct DWARFNames * n = NULL;
+    ELF_Section * names = NULL;
+    ELF_Section * gdb_index = NULL;
+    int ok = 0;
+
+    assert(cache->mNameIndex == NULL);
+    /* Accelerator tables of relocatable files would need relocation of section offsets */
+    if (file->type == ET_REL) return 0;
+    names = find_section(file, ".debug_names");
+    gdb_index = find_section(file, ".gdb_index");
+    if (names == NULL && gdb_index == NULL) return 0;
+
+    n = (struct DWARFNames *)loc_alloc_zero(sizeof(struct DWARFNames));
+    n->mCache = cache;
+    n->mFile = file;
+    n->mDebugInfo = debug_info;
+    n->mDebugStr = find_section(file, ".debug_str");
+    if (names != NULL && n->mDebugStr != NULL && elf_load(names) == 0 && elf_load(n->mDebugStr) == 0) {
+        ok = open_debug_names(n, names);
+    }
+    if (!ok && gdb_index != NULL && elf_load(gdb_index) == 0) {
+        ok = open_gdb_index(n, gdb_index);
+    }
+    if (ok) {
+        unsigned units_cnt = 0;
+        unsigned missing_cnt = check_units_coverage(n, &units_cnt);
+        if (missing_cnt == units_cnt) {
+            trace(LOG_ELF, "Ignoring %s: no units are listed", n->mNames ? ".debug_names" : ".gdb_index");
+            ok = 0;
+        }
+        else if (missing_cnt > 0) {
+            trace(LOG_ELF, "%s does not list %u of %u units in %s, public names table is used for them",
+                n->mNames ? ".debug_names" : ".gdb_index", missing_cnt, units_cnt, file->name);
+        }
+        else {
+            loc_free(n->mUnits);
+            n->mUnits = NULL;
+            n->mUnitsCnt = 0;
+        }
+    }
+    if (!ok) {
+        while (n->mNames != NULL) {
+            NamesIndex * idx = n->mNames;
+            n->mNames = idx->mNext;
+            free_names_index(idx);
+        }
+        loc_free(n->mUnits);
+        loc_free(n);
+        return 0;
+    }
+    trace(LOG_ELF, "Using %s for name lookup in %s", n->mNames ? ".debug_names" : ".gdb_index", file->name);
+    cache->mNameIndex = n;
+    return 1;
+}
+
+int dwarf_names_is_complete(DWARFCache * cache) {
+    struct DWARFNames * n = cache->mNameIndex;
+    return n != NULL && n->mUnits == NULL;
+}
+
+int dwarf_names_covers_unit(DWARFCache * cache, CompUnit * unit) {
+    struct DWARFNames * n = cache->mNameIndex;
+    if (n == NULL) return 0;
+    if (unit->mDesc.mSection != n->mDebugInfo) return 0;
+    if (n->mUnits == NULL) return 1;
+    return is_unit_listed(n, unit->mDesc.mUnitOffs);
+}
+
+/* Return true if the object would be added into the public names table */
+static int is_pub_object(ObjectInfo * obj) {
+    ObjectInfo * p = get_dwarf_parent(obj);
+    if (obj->mName == NULL) return 0;
+    if (p != NULL && p->mTag == TAG_enumeration_type) {
+        p = get_dwarf_parent(p);
+    }
+    else if (obj->mDefinition != NULL) {
+        return 0;
+    }
+    while (p != NULL && p->mTag == TAG_namespace) p = get_dwarf_parent(p);
+    if (p == NULL) return 0;
+    return p->mTag == TAG_compile_unit || p->mTag == TAG_partial_unit || p->mTag == TAG_type_unit;
+}
+
+/* Return unqualified part of a C++ name */
+static const char * get_base_name(const char * name) {
+    const char * s = name;
+    const char * res = name;
+    int level = 0;
+    while (*s) {
+        if (*s == '<' || *s == '(') level++;
+        else if ((*s == '>' || *s == ')') && level > 0) level--;
+        else if (level == 0 && s[0] == ':' && s[1] == ':') res = s + 2;
+        s++;
+    }
+    return res;
+}
+
+/* DWARF 5 section 6.1.1.4.5: DJB hash of case folded name.
+ * Returns 0 if the name has non-ASCII characters, which need Unicode case folding. */
+static int calc_djb_hash(const char * s, U4_T * hash) {
+    U4_T h = 5381;
+    while (*s) {
+        U1_T c = (U1_T)*s++;
+        if (c >= 0x80) return 0;
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        h = h * 33 + c;
+    }
+    *hash = h;
+    return 1;
+}
+
+static U8_T read_entry_form(struct DWARFNames * n, NamesIndex * idx, U1_T ** pp, U4_T form) {
+    U1_T * p = *pp;
+    U8_T v = 0;
+    size_t size = 0;
+    switch (form) {
+    case FORM_FLAG_PRESENT:
+        return 1;
+    case FORM_UDATA:
+    case FORM_REF_UDATA:
+    case FORM_SDATA:
+        return read_uleb128(pp, idx->mEnd);
+    case FORM_DATA1: case FORM_REF1: case FORM_FLAG: size = 1; break;
+    case FORM_DATA2: case FORM_REF2: size = 2; break;
+    case FORM_DATA4: case FORM_REF4: size = 4; break;
+    case FORM_DATA8: case FORM_REF8: case FORM_REF_SIG8: size = 8; break;
+    case FORM_DATA16: size = 16; break;
+    default:
+        str_fmt_exception(ERR_INV_DWARF, "Unsupported form %#x in .debug_names", form);
+    }
+    if (p + size > idx->mEnd) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+    if (size <= 8) {
+        unsigned i;
+        for (i = 0; i < size; i++) {
+            unsigned j = n->mFile->big_endian ? i : (unsigned)size - i - 1;
+            v = (v << 8) | p[j];
+        }
+    }
+    *pp = p + size;
+    return v;
+}
+
+static void read_names_entries(struct DWARFNames * n, NamesIndex * idx, U8_T entry_offs, LookupArgs * args) {
+    U1_T * p = idx->mEntryPool + entry_offs;
+    if (entry_offs >= (U8_T)(idx->mEnd - idx->mEntryPool)) str_exception(ERR_INV_DWARF, "Invalid .debug_names section");
+    for (;;) {
+        unsigned i;
+        NamesAbbrev * abbr = NULL;
+        U8_T code = read_uleb128(&p, idx->mEnd);
+        U8_T cu = idx->mCUCnt == 1 ? 0 : ~(U8_T)0;
+        U8_T tu = ~(U8_T)0;
+        U8_T die = ~(U8_T)0;
+        U8_T unit_offs = 0;
+        if (code == 0) break;
+        for (i = 0; i < idx->mAbbrevCnt; i++) {
+            if (idx->mAbbrevs[i].mCode == code) {
+                abbr = idx->mAbbrevs + i;
+                break;
+            }
+        }
+        if (abbr == NULL) str_exception(ERR_INV_DWARF, "Invalid abbreviation code in .debug_names");
+        for (i = 0; i < abbr->mAttrCnt; i++) {
+            U8_T v = read_entry_form(n, idx, &p, abbr->mAttrs[i * 2 + 1]);
+            switch (abbr->mAttrs[i * 2]) {
+            case IDX_compile_unit: cu = v; break;
+            case IDX_type_unit: tu = v; break;
+            case IDX_die_offset: die = v; break;
+            }
+        }
+        if (die == ~(U8_T)0) continue;
+        if (tu != ~(U8_T)0) {
+            /* Foreign type units are not supported */
+            if (tu >= idx->mLocalTUCnt) continue;
+            unit_offs = read_offs(n, idx, idx->mLocalTUList + tu * idx->mOffsSize);
+        }
+        else if (cu < idx->mCUCnt) {
+            unit_offs = read_offs(n, idx, idx->mCUList + cu * idx->mOffsSize);
+        }
+        else {
+            continue;
+        }
+        if (unit_offs + die < n->mDebugInfo->size) {
+            ObjectInfo * obj = find_object(n->mDebugInfo, (ContextAddress)(n->mDebugInfo->addr + unit_offs + die));
+            if (obj != NULL && is_pub_object(obj)) args->call_back(obj, args->args);
+        }
+    }
+}
+
+static void lookup_debug_names(struct DWARFNames * n, LookupArgs * args) {
+    const char * name = get_base_name(args->name);
+    U4_T h = 0;
+    int hash_ok = calc_djb_hash(name, &h);
+    NamesIndex * idx = n->mNames;
+    while (idx != NULL) {
+        U4_T i = 0;
+        if (idx->mBucketCnt > 0 && hash_ok) {
+            U4_T b = h % idx->mBucketCnt;
+            i = read_u4(n, idx->mBuckets + b * 4);
+            if (i == 0) i = idx->mNameCnt + 1;
+            while (i <= idx->mNameCnt) {
+                U4_T x = read_u4(n, idx->mHashes + (i - 1) * 4);
+                if (x % idx->mBucketCnt != b) break;
+                if (x == h) {
+                    U8_T str = read_offs(n, idx, idx->mStrOffs + (i - 1) * idx->mOffsSize);
+                    if (str < n->mDebugStr->size &&
+                            strcmp((char *)n->mDebugStr->data + str, name) == 0) {
+                        read_names_entries(n, idx, read_offs(n, idx, idx->mEntryOffs + (i - 1) * idx->mOffsSize), args);
+                    }
+                }
+                i++;
+            }
+        }
+        else {
+            /* No hash table or no hash value, linear search */
+            for (i = 0; i < idx->mNameCnt; i++) {
+                U8_T str = read_offs(n, idx, idx->mStrOffs + i * idx->mOffsSize);
+                if (str < n->mDebugStr->size && strcmp((char *)n->mDebugStr->data + str, name) == 0) {
+                    read_names_entries(n, idx, read_offs(n, idx, idx->mEntryOffs + i * idx->mOffsSize), args);
+                }
+            }
+        }
+        idx = idx->mNext;
+    }
+}
+
+static U4_T calc_gdb_hash(U4_T version, const char * s) {
+    U4_T r = 0;
+    while (*s) {
+        U1_T c = (U1_T)*s++;
+        if (version >= 5) c = (U1_T)tolower(c);
+        r = r * 67 + c - 113;
+    }
+    return r;
+}
+
+static void search_unit_scope(ObjectInfo * scope, const char * name, LookupArgs * args) {
+    ObjectInfo * obj = get_dwarf_children(scope);
+    while (obj != NULL) {
+        if (obj->mName != NULL && obj->mDefinition == NULL && strcmp(obj->mName, name) == 0) {
+            args->call_back(obj, args->args);
+        }
+        if (obj->mTag == TAG_enumeration_type) {
+            ObjectInfo * e = get_dwarf_children(obj);
+            while (e != NULL) {
+                if (e->mName != NULL && strcmp(e->mName, name) == 0) args->call_back(e, args->args);
+                e = e->mSibling;
+            }
+        }
+        if (obj->mTag == TAG_namespace) search_unit_scope(obj, name, args);
+        obj = obj->mSibling;
+    }
+}
+
+/* GDB index refers to units by offset of unit header */
+static CompUnit * find_unit(struct DWARFNames * n, U8_T offs) {
+    ObjectHashTable * tbl = n->mCache->mObjectHashTable + n->mDebugInfo->index;
+    unsigned l = 0;
+    unsigned h = tbl->mCompUnitsIndexSize;
+    while (l < h) {
+        unsigned i = (l + h) / 2;
+        CompUnit * unit = tbl->mCompUnitsIndex[i];
+        if (unit->mDesc.mUnitOffs > offs) h = i;
+        else if (unit->mDesc.mUnitOffs < offs) l = i + 1;
+        else return unit;
+    }
+    return NULL;
+}
+
+static void lookup_gdb_index(struct DWARFNames * n, LookupArgs * args) {
+    U4_T mask = n->mGdbSymbolsCnt - 1;
+    U4_T h = calc_gdb_hash(n->mGdbVersion, args->name);
+    U4_T i = h & mask;
+    U4_T step = ((h * 17) & mask) | 1;
+    U4_T cnt = 0;
+    size_t pool_size = n->mGdbEnd - n->mGdbPool;
+
+    for (cnt = 0; cnt <= mask; cnt++) {
+        U4_T name_offs = read_le4(n->mGdbSymbols + i * 8);
+        U4_T vec_offs = read_le4(n->mGdbSymbols + i * 8 + 4);
+        if (name_offs == 0 && vec_offs == 0) break;
+        if (name_offs < pool_size && vec_offs + 4 <= pool_size &&
+                strcmp((char *)n->mGdbPool + name_offs, args->name) == 0) {
+            U4_T j;
+            U4_T vec_cnt = read_le4(n->mGdbPool + vec_offs);
+            const char * base = get_base_name(args->name);
+            if (vec_offs + 4 + (U8_T)vec_cnt * 4 > pool_size) break;
+            for (j = 0; j < vec_cnt; j++) {
+                U4_T k;
+                U4_T cu = read_le4(n->mGdbPool + vec_offs + 4 + j * 4) & 0xffffff;
+                /* Same unit can be listed more than once, with different symbol kinds */
+                for (k = 0; k < j; k++) {
+                    if ((read_le4(n->mGdbPool + vec_offs + 4 + k * 4) & 0xffffff) == cu) break;
+                }
+                if (k < j) continue;
+                if (cu < n->mGdbCUCnt) {
+                    CompUnit * unit = find_unit(n, read_le8(n->mGdbCUList + cu * 16));
+                    if (unit != NULL) search_unit_scope(unit->mObject, base, args);
+                }
+            }
+            break;
+        }
+        i = (i + step) & mask;
+    }
+}
+
+void dwarf_names_lookup(DWARFCache * cache, const char * name, DWARFNamesCallBack * call_back, void * args) {
+    struct DWARFNames * n = cache->mNameIndex;
+    LookupArgs lookup;
+    assert(n != NULL);
+    lookup.call_back = call_back;
+    lookup.args = args;
+    lookup.name = name;
+    if (n->mNames != NULL) lookup_debug_names(n, &lookup);
+    else lookup_gdb_index(n, &lookup);
+}
+
+void dwarf_names_dispose(DWARFCache * cache) {
+    struct DWARFNames * n = cache->mNameIndex;
+    if (n == NULL) return;
+    while (n->mNames != NULL) {
+        NamesIndex * idx = n->mNames;
+        n->mNames = idx->mNext;
+        free_names_index(idx);
+    }
+    loc_free(n->mUnits);
+    loc_free(n);
+    cache->mNameIndex = NULL;
+}
+
+#endif /* ENABLE_DWARF_NAMES */
+
+#endif /* ENABLE_ELF && ENABLE_DebugContext */
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements name lookup using DWARF 5 .debug_names and GDB .gdb_index
+ * accelerator tables.
+ *
+ * When an ELF file has an accelerator table, DWARF cache does not build the public names
+ * table, and name lookup is done by hashing into the accelerator table instead.
+ * If the table does not list all units of the file, e.g. some objects were compiled
+ * without -gpubnames, the public names table is built for the units that are not listed,
+ * and name lookup searches both.
+ *
+ * Functions in this module use exceptions to report errors, see exceptions.h
+ */
+
+#ifndef D_dwarfnames
+#define D_dwarfnames
+
+#include <tcf/config.h>
+
+#if ENABLE_ELF && ENABLE_DebugContext
+
+#include <tcf/services/dwarfcache.h>
+
+#ifndef ENABLE_DWARF_NAMES
+#  define ENABLE_DWARF_NAMES 1
+#endif
+
+#if ENABLE_DWARF_NAMES
+
+typedef void DWARFNamesCallBack(ObjectInfo * obj, void * args);
+
+/*
+ * Check for accelerator tables in DWARF cache file, and prepare them for lookups.
+ * Returns 1 if the file has a usable accelerator table.
+ * Called by DWARF cache when the cache is created.
+ */
+extern int dwarf_names_open(DWARFCache * cache, ELF_Section * debug_info);
+
+/*
+ * Return 1 if the accelerator table lists all units of the file.
+ */
+extern int dwarf_names_is_complete(DWARFCache * cache);
+
+/*
+ * Return 1 if names of the unit are listed in the accelerator table.
+ */
+extern int dwarf_names_covers_unit(DWARFCache * cache, CompUnit * unit);
+
+/*
+ * Call 'call_back' for each global object, namespace member or enumerator with given name.
+ * For members of namespaces, 'name' can be qualified, e.g. "ns::name".
+ * The objects are the same as the public names table would contain, however,
+ * the callback can be called for objects that have the same unqualified name
+ * but belong to a different namespace, callers are expected to check that.
+ */
+extern void dwarf_names_lookup(DWARFCache * cache, const char * name, DWARFNamesCallBack * call_back, void * args);
+
+/*
+ * Dispose accelerator table data, called when DWARF cache is disposed.
+ */
+extern void dwarf_names_dispose(DWARFCache * cache);
+
+#endif /* ENABLE_DWARF_NAMES */
+
+#endif /* ENABLE_ELF && ENABLE_DebugContext */
+
+#endif /* D_dwarfnames */
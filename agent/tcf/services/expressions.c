@@ -50,6 +50,7 @@
 #include <tcf/services/breakpoints.h>
 #include <tcf/services/registers.h>
 #include <tcf/services/expressions.h>
+#include <tcf/services/diagnostics.h>
 #include <tcf/main/test.h>
 
 #define SY_LEQ   256
@@ -163,6 +164,51 @@ static LINK func_call_state = TCF_LIST_INIT(func_call_state);
 
 #endif /* ENABLE_FuncCallInjection */
 
+#ifndef ENABLE_ExpressionCache
+#  define ENABLE_ExpressionCache (SERVICE_Expressions && ENABLE_Symbols)
+#endif
+
+#if ENABLE_ExpressionCache
+/*
+ * Expression cache keeps results of identifier lookups done while evaluating an expression.
+ * When same expression text is evaluated again in same context, stack frame and PC,
+ * the symbols are retrieved by ID instead of searching symbol tables and scopes.
+ * If the expression is a condition that compile_expression() supports, the record also keeps
+ * the compiled program, and Expressions.evaluate runs it without parsing the text.
+ */
+typedef struct ExpressionCacheSymbols {
+    char * name;
+    char * scope;           /* ID of scope symbol, "" for global scope, NULL if not qualified */
+    SYM_FLAGS flags;
+    unsigned cnt;           /* Number of symbols, 0 if the name was not found */
+    char ** ids;
+} ExpressionCacheSymbols;
+
+typedef struct ExpressionCacheRecord {
+    LINK link_hash;
+    LINK link_lru;
+    Context * ctx;
+    int frame;
+    ContextAddress pc;
+    char * script;
+    char * language;
+    int disabled;           /* Cannot be used: symbol IDs are not valid */
+    ExpressionCacheSymbols * syms;
+    unsigned syms_cnt;
+    unsigned syms_max;
+    int compiled;           /* 0 - not tried yet, 1 - 'program' is valid, -1 - cannot be compiled */
+    CompiledExpression * program;
+    char * result_type;     /* Type ID of the program result, NULL if none */
+    int result_class;
+    size_t result_size;
+} ExpressionCacheRecord;
+
+static ExpressionCacheRecord * expression_cache = NULL;
+
+static unsigned expr_cache_name_hits = 0;
+static unsigned expr_cache_name_misses = 0;
+#endif /* ENABLE_ExpressionCache */
+
 static ExpressionIdentifierCallBack ** id_callbacks = NULL;
 static int id_callback_max = 0;
 static int id_callback_cnt = 0;
@@ -1246,6 +1292,75 @@ static int builtin_identifier(int mode, char * name, Value * v) {
     return -1;
 }
 
+#if ENABLE_ExpressionCache
+static const char * get_cache_scope_id(Value * scope, Symbol * scope_sym) {
+    if (scope == NULL) return NULL;
+    if (scope_sym == NULL) return "";
+    return tmp_strdup(symbol2id(scope_sym));
+}
+
+static ExpressionCacheSymbols * find_cached_symbols(const char * scope_id, const char * name, SYM_FLAGS flags) {
+    unsigned i;
+    for (i = 0; i < expression_cache->syms_cnt; i++) {
+        ExpressionCacheSymbols * s = expression_cache->syms + i;
+        if (s->flags != flags) continue;
+        if (strcmp(s->name, name) != 0) continue;
+        if ((s->scope == NULL) != (scope_id == NULL)) continue;
+        if (scope_id != NULL && strcmp(s->scope, scope_id) != 0) continue;
+        return s;
+    }
+    return NULL;
+}
+
+static int get_cached_symbols(const char * scope_id, const char * name, SYM_FLAGS flags, Symbol *** list, unsigned * cnt) {
+    ExpressionCacheSymbols * s = NULL;
+    Symbol ** buf = NULL;
+    unsigned i;
+
+    if (expression_cache == NULL || expression_cache->disabled) return 0;
+    s = find_cached_symbols(scope_id, name, flags);
+    if (s == NULL) return 0;
+    if (s->cnt > 0) {
+        buf = (Symbol **)tmp_alloc(sizeof(Symbol *) * (s->cnt + 1));
+        for (i = 0; i < s->cnt; i++) {
+            if (id2symbol(s->ids[i], buf + i) < 0) {
+                if (get_error_code(errno) == ERR_CACHE_MISS) error(errno, "Cannot read symbol data");
+                expression_cache->disabled = 1;
+                return 0;
+            }
+        }
+        buf[s->cnt] = NULL;
+    }
+    *list = buf;
+    *cnt = s->cnt;
+    expr_cache_name_hits++;
+    return 1;
+}
+
+static void add_cached_symbols(const char * scope_id, const char * name, SYM_FLAGS flags, Symbol ** list, unsigned cnt) {
+    ExpressionCacheRecord * r = expression_cache;
+    ExpressionCacheSymbols * s = NULL;
+    unsigned i;
+
+    if (r == NULL || r->disabled) return;
+    expr_cache_name_misses++;
+    if (r->syms_cnt >= r->syms_max) {
+        r->syms_max += 4;
+        r->syms = (ExpressionCacheSymbols *)loc_realloc(r->syms, sizeof(ExpressionCacheSymbols) * r->syms_max);
+    }
+    s = r->syms + r->syms_cnt++;
+    s->name = loc_strdup(name);
+    s->scope = scope_id ? loc_strdup(scope_id) : NULL;
+    s->flags = flags;
+    s->cnt = cnt;
+    s->ids = NULL;
+    if (cnt > 0) {
+        s->ids = (char **)loc_alloc(sizeof(char *) * cnt);
+        for (i = 0; i < cnt; i++) s->ids[i] = loc_strdup(symbol2id(list[i]));
+    }
+}
+#endif /* ENABLE_ExpressionCache */
+
 static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Value * v) {
     ini_value(v);
     if (scope == NULL) {
@@ -1264,11 +1379,16 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
 #if ENABLE_Symbols
     {
         Symbol * sym = NULL;
-        int n = 0;
+        Symbol * scope_sym = NULL;
+        Symbol ** list = NULL;
+        unsigned cnt = 0;
+#if ENABLE_ExpressionCache
+        const char * scope_id = NULL;
+#endif
 
         if (scope != NULL) {
             int scope_class = 0;
-            Symbol * scope_sym = scope->sym;
+            scope_sym = scope->sym;
             if (scope->type != NULL) {
                 if (scope_sym != NULL && get_symbol_class(scope_sym, &scope_class) < 0) {
                     error(errno, "Cannot retrieve symbol class");
@@ -1277,19 +1397,42 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
                     scope_sym = scope->type;
                 }
             }
-            n = find_symbol_in_scope(expression_context, expression_frame, expression_addr, scope_sym, name, &sym);
-        }
-        else {
-            n = find_symbol_by_name(expression_context, expression_frame, expression_addr, name, &sym);
         }
 
-        if (n < 0) {
-            if (get_error_code(errno) != ERR_SYM_NOT_FOUND) error(errno, "Cannot read symbol data");
+#if ENABLE_ExpressionCache
+        if (expression_cache != NULL) scope_id = get_cache_scope_id(scope, scope_sym);
+        if (!get_cached_symbols(scope_id, name, flags, &list, &cnt))
+#endif
+        {
+            int n = 0;
+
+            if (scope != NULL) {
+                n = find_symbol_in_scope(expression_context, expression_frame, expression_addr, scope_sym, name, &sym);
+            }
+            else {
+                n = find_symbol_by_name(expression_context, expression_frame, expression_addr, name, &sym);
+            }
+
+            if (n < 0) {
+                if (get_error_code(errno) != ERR_SYM_NOT_FOUND) error(errno, "Cannot read symbol data");
+            }
+            else {
+                unsigned max = 8;
+                list = (Symbol **)tmp_alloc(sizeof(Symbol *) * max);
+                list[cnt++] = sym;
+                while (find_next_symbol(&sym) == 0) {
+                    if (cnt + 1 >= max) list = (Symbol **)tmp_realloc(list, sizeof(Symbol *) * (max *= 2));
+                    list[cnt++] = sym;
+                }
+                assert(cnt < max);
+                list[cnt] = NULL;
+            }
+#if ENABLE_ExpressionCache
+            add_cached_symbols(scope_id, name, flags, list, cnt);
+#endif
         }
-        else {
-            unsigned cnt = 0;
-            unsigned max = 8;
-            Symbol ** list = (Symbol **)tmp_alloc(sizeof(Symbol *) * max);
+
+        if (cnt > 0) {
             unsigned val_cnt = 0;
             const SYM_FLAGS cmx_type = SYM_FLAG_STRUCT_TYPE | SYM_FLAG_CLASS_TYPE | SYM_FLAG_UNION_TYPE | SYM_FLAG_ENUM_TYPE;
             const SYM_FLAGS flag_mask = SYM_FLAG_TYPE | SYM_FLAG_CONST_TYPE | SYM_FLAG_VOLATILE_TYPE | cmx_type;
@@ -1297,13 +1440,6 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
             int sym_class;
             unsigned i;
 
-            list[cnt++] = sym;
-            while (find_next_symbol(&sym) == 0) {
-                if (cnt + 1 >= max) list = (Symbol **)tmp_realloc(list, sizeof(Symbol *) * (max *= 2));
-                list[cnt++] = sym;
-            }
-            assert(cnt < max);
-            list[cnt] = NULL;
             /* Count variables. In C, variables eclipse composite types */
             for (i = 0; i < cnt; i++) {
                 if (get_symbol_class(list[i], &sym_class) < 0) error(errno, "Cannot retrieve symbol class");
@@ -2084,6 +2220,68 @@ static void set_complex_type(Value * v) {
 #endif
 }
 
+#if ENABLE_Symbols
+/* Set C type of an integer literal according to its value and suffix flags */
+static void set_int_literal_type(Value * v, int flags) {
+    size_t size = 0;
+    uint64_t n = to_uns(MODE_NORMAL, v);
+    if (flags & VAL_FLAG_C) {
+        Symbol * type = NULL;
+        if (get_std_type(flags & VAL_FLAG_L ? "wchar_t" : "char", TYPE_CLASS_UNKNOWN, &type, &size)) {
+            uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
+            if (n <= m) {
+                v->type = type;
+                get_symbol_type_class(type, &v->type_class);
+            }
+        }
+    }
+    else {
+        if ((flags & (VAL_FLAG_L | VAL_FLAG_U)) == 0) {
+            Symbol * type = NULL;
+            if (get_std_type("int", TYPE_CLASS_INTEGER, &type, &size)) {
+                uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
+                if (n <= m) {
+                    v->type = type;
+                    v->type_class = TYPE_CLASS_INTEGER;
+                }
+            }
+        }
+        if (v->type == NULL && (flags & VAL_FLAG_L) == 0 &&
+                (flags & (VAL_FLAG_X | VAL_FLAG_U)) != 0) {
+            Symbol * type = NULL;
+            if (get_std_type("unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
+                uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
+                if (n <= m) {
+                    v->type = type;
+                    v->type_class = TYPE_CLASS_CARDINAL;
+                }
+            }
+        }
+        if (v->type == NULL && (flags & VAL_FLAG_U) == 0) {
+            Symbol * type = NULL;
+            if (get_std_type("long int", TYPE_CLASS_INTEGER, &type, &size)) {
+                uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
+                if (n <= m) {
+                    v->type = type;
+                    v->type_class = TYPE_CLASS_INTEGER;
+                }
+            }
+        }
+        if (v->type == NULL) {
+            Symbol * type = NULL;
+            if (get_std_type("long unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
+                uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
+                if (n <= m) {
+                    v->type = type;
+                    v->type_class = TYPE_CLASS_CARDINAL;
+                }
+            }
+        }
+    }
+    if (v->type != NULL && size != v->size) set_int_value(v, size, n);
+}
+#endif
+
 static void primary_expression(int mode, Value * v) {
     if (text_sy == '(') {
         next_sy();
@@ -2103,62 +2301,7 @@ static void primary_expression(int mode, Value * v) {
         next_sy();
 #if ENABLE_Symbols
         if (v->type_class == TYPE_CLASS_INTEGER || v->type_class == TYPE_CLASS_CARDINAL) {
-            size_t size = 0;
-            uint64_t n = to_uns(MODE_NORMAL, v);
-            if (flags & VAL_FLAG_C) {
-                Symbol * type = NULL;
-                if (get_std_type(flags & VAL_FLAG_L ? "wchar_t" : "char", TYPE_CLASS_UNKNOWN, &type, &size)) {
-                    uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
-                    if (n <= m) {
-                        v->type = type;
-                        get_symbol_type_class(type, &v->type_class);
-                    }
-                }
-            }
-            else {
-                if ((flags & (VAL_FLAG_L | VAL_FLAG_U)) == 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("int", TYPE_CLASS_INTEGER, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_INTEGER;
-                        }
-                    }
-                }
-                if (v->type == NULL && (flags & VAL_FLAG_L) == 0 &&
-                        (flags & (VAL_FLAG_X | VAL_FLAG_U)) != 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_CARDINAL;
-                        }
-                    }
-                }
-                if (v->type == NULL && (flags & VAL_FLAG_U) == 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("long int", TYPE_CLASS_INTEGER, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_INTEGER;
-                        }
-                    }
-                }
-                if (v->type == NULL) {
-                    Symbol * type = NULL;
-                    if (get_std_type("long unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_CARDINAL;
-                        }
-                    }
-                }
-            }
-            if (v->type != NULL && size != v->size) set_int_value(v, size, n);
+            set_int_literal_type(v, flags);
         }
         else if (v->type_class == TYPE_CLASS_REAL) {
             size_t size = 0;
@@ -3982,6 +4125,449 @@ int value_to_double(Value * v, double *res) {
     return 0;
 }
 
+#if ENABLE_Symbols
+
+/********************** Compiled expressions **************************/
+
+#define CEXP_NUMBER     1
+#define CEXP_LOAD       2
+#define CEXP_NOT        3
+#define CEXP_EQ         4
+#define CEXP_NE         5
+#define CEXP_LT         6
+#define CEXP_GT         7
+#define CEXP_LE         8
+#define CEXP_GE         9
+#define CEXP_LT_U      10
+#define CEXP_GT_U      11
+#define CEXP_LE_U      12
+#define CEXP_GE_U      13
+#define CEXP_AND_THEN  14 /* If top of stack is 0 - jump, otherwise pop */
+#define CEXP_OR_ELSE   15 /* If top of stack is not 0 - jump, otherwise pop */
+
+#define CEXP_STACK_MAX 16
+
+typedef struct CompiledLoad {
+    LocationExpressionCommand * cmds;
+    unsigned cmds_cnt;
+    size_t size;
+    int big_endian;
+    int sign_extend;
+} CompiledLoad;
+
+typedef struct CompiledOp {
+    int op;
+    union {
+        int64_t num;
+        unsigned jump;
+        CompiledLoad load;
+    } args;
+} CompiledOp;
+
+struct CompiledExpression {
+    CompiledOp * ops;
+    unsigned ops_cnt;
+    unsigned ops_max;
+    unsigned stk_pos;
+};
+
+static void compile_unsupported(void) {
+    str_exception(ERR_UNSUPPORTED, "Expression is too complex to compile");
+}
+
+static CompiledOp * add_compiled_op(CompiledExpression * e, int op, int stk_inc) {
+    CompiledOp * c = NULL;
+    if (e->ops_cnt >= e->ops_max) {
+        e->ops_max = e->ops_max == 0 ? 16 : e->ops_max * 2;
+        e->ops = (CompiledOp *)loc_realloc(e->ops, sizeof(CompiledOp) * e->ops_max);
+    }
+    e->stk_pos += stk_inc;
+    if (e->stk_pos > CEXP_STACK_MAX) compile_unsupported();
+    c = e->ops + e->ops_cnt++;
+    memset(c, 0, sizeof(CompiledOp));
+    c->op = op;
+    return c;
+}
+
+static void copy_location_commands(CompiledLoad * load, LocationInfo * loc_info) {
+    unsigned i;
+    load->cmds = (LocationExpressionCommand *)loc_alloc_zero(sizeof(LocationExpressionCommand) * loc_info->value_cmds.cnt);
+    for (i = 0; i < loc_info->value_cmds.cnt; i++) {
+        LocationExpressionCommand * cmd = load->cmds + load->cmds_cnt;
+        *cmd = loc_info->value_cmds.cmds[i];
+        switch (cmd->cmd) {
+        case SFT_CMD_LOCATION:
+            if (cmd->args.loc.code_size > 0) {
+                uint8_t * code = (uint8_t *)loc_alloc(cmd->args.loc.code_size);
+                memcpy(code, cmd->args.loc.code_addr, cmd->args.loc.code_size);
+                cmd->args.loc.code_addr = code;
+            }
+            break;
+        case SFT_CMD_PIECE:
+            if (cmd->args.piece.value != NULL) {
+                size_t size = (cmd->args.piece.bit_offs + cmd->args.piece.bit_size + 7) / 8;
+                void * value = loc_alloc(size);
+                memcpy(value, cmd->args.piece.value, size);
+                cmd->args.piece.value = value;
+            }
+            break;
+        case SFT_CMD_ARG:
+        case SFT_CMD_SET_ARG:
+        case SFT_CMD_FCALL:
+        case SFT_CMD_WR_REG:
+        case SFT_CMD_WR_MEM:
+        case SFT_CMD_LOAD:
+        case SFT_CMD_STORE:
+            compile_unsupported();
+            break;
+        }
+        load->cmds_cnt++;
+    }
+}
+
+static int compile_identifier(CompiledExpression * e) {
+    int i;
+    int n = 0;
+    int sym_class = 0;
+    int type_class = 0;
+    char * name = NULL;
+    Symbol * sym = NULL;
+    Symbol * nxt = NULL;
+    ContextAddress size = 0;
+    LocationInfo * loc_info = NULL;
+    CompiledOp * op = NULL;
+    Value v;
+
+    name = tmp_strdup((char *)text_val.value);
+    if (name[0] == '$') compile_unsupported();
+    for (i = 0; i < id_callback_cnt; i++) {
+        if (id_callbacks[i](expression_context, expression_frame, name, &v)) compile_unsupported();
+    }
+    next_sy();
+    switch (text_sy) {
+    case '.':
+    case '[':
+    case '(':
+    case SY_REF:
+    case SY_INC:
+    case SY_DEC:
+    case SY_SCOPE:
+    case SY_PM_D:
+    case SY_PM_R:
+        compile_unsupported();
+        break;
+    }
+    n = find_symbol_by_name(expression_context, expression_frame, expression_addr, name, &sym);
+    if (n < 0) exception(errno);
+    nxt = sym;
+    if (find_next_symbol(&nxt) == 0) compile_unsupported();
+    if (get_symbol_class(sym, &sym_class) < 0) exception(errno);
+    if (sym_class != SYM_CLASS_REFERENCE) compile_unsupported();
+    if (get_all_symbol_flags(sym) & (SYM_FLAG_INDIRECT | SYM_FLAG_REFERENCE)) compile_unsupported();
+    if (get_symbol_type_class(sym, &type_class) < 0) exception(errno);
+    if (type_class != TYPE_CLASS_INTEGER && type_class != TYPE_CLASS_CARDINAL && type_class != TYPE_CLASS_POINTER) compile_unsupported();
+    if (get_symbol_size(sym, &size) < 0) exception(errno);
+    if (size != 1 && size != 2 && size != 4 && size != 8) compile_unsupported();
+    ini_value(&v);
+    v.type_class = type_class;
+    if (get_symbol_type(sym, &v.type) < 0) exception(errno);
+    set_value_props(&v);
+    if (v.binary_scale != 0 || v.decimal_scale != 0) compile_unsupported();
+    if (get_location_info(sym, &loc_info) < 0) exception(errno);
+    if (loc_info->args_cnt > 0) compile_unsupported();
+    op = add_compiled_op(e, CEXP_LOAD, 1);
+    op->args.load.size = (size_t)size;
+    op->args.load.big_endian = loc_info->big_endian;
+    op->args.load.sign_extend = type_class == TYPE_CLASS_INTEGER;
+    copy_location_commands(&op->args.load, loc_info);
+    return type_class;
+}
+
+static int compile_logical_or(CompiledExpression * e);
+
+static int compile_unary(CompiledExpression * e) {
+    int type_class = 0;
+    Value v;
+    switch (text_sy) {
+    case SY_VAL:
+        v = text_val;
+        if (v.type_class != TYPE_CLASS_INTEGER && v.type_class != TYPE_CLASS_CARDINAL) compile_unsupported();
+        set_int_literal_type(&v, text_val_flags);
+        if (v.size == 0 || v.size > 8) compile_unsupported();
+        add_compiled_op(e, CEXP_NUMBER, 1)->args.num = to_int(MODE_NORMAL, &v);
+        type_class = v.type_class;
+        next_sy();
+        break;
+    case SY_NAME:
+        type_class = compile_identifier(e);
+        break;
+    case '-':
+        next_sy();
+        if (text_sy != SY_VAL) compile_unsupported();
+        v = text_val;
+        if (v.type_class != TYPE_CLASS_INTEGER && v.type_class != TYPE_CLASS_CARDINAL) compile_unsupported();
+        set_int_literal_type(&v, text_val_flags);
+        /* Negation of an unsigned literal is left to the interpreter */
+        if (v.type_class != TYPE_CLASS_INTEGER) compile_unsupported();
+        if (v.size == 0 || v.size > 8) compile_unsupported();
+        add_compiled_op(e, CEXP_NUMBER, 1)->args.num = -to_int(MODE_NORMAL, &v);
+        type_class = TYPE_CLASS_INTEGER;
+        next_sy();
+        break;
+    case '!':
+        next_sy();
+        type_class = compile_unary(e);
+        if (type_class != TYPE_CLASS_INTEGER && type_class != TYPE_CLASS_CARDINAL) compile_unsupported();
+        add_compiled_op(e, CEXP_NOT, 0);
+        type_class = TYPE_CLASS_INTEGER;
+        break;
+    case '(':
+        next_sy();
+        type_class = compile_logical_or(e);
+        if (text_sy != ')') compile_unsupported();
+        next_sy();
+        break;
+    default:
+        compile_unsupported();
+        break;
+    }
+    return type_class;
+}
+
+static int compile_relational(CompiledExpression * e) {
+    int type_class = compile_unary(e);
+    while (text_sy == '<' || text_sy == '>' || text_sy == SY_LEQ || text_sy == SY_GEQ) {
+        int sy = text_sy;
+        int x_class = 0;
+        int op = 0;
+        next_sy();
+        x_class = compile_unary(e);
+        if (type_class == TYPE_CLASS_UNKNOWN || x_class == TYPE_CLASS_UNKNOWN) compile_unsupported();
+        if (type_class == TYPE_CLASS_CARDINAL || x_class == TYPE_CLASS_CARDINAL) {
+            switch (sy) {
+            case '<': op = CEXP_LT_U; break;
+            case '>': op = CEXP_GT_U; break;
+            case SY_LEQ: op = CEXP_LE_U; break;
+            case SY_GEQ: op = CEXP_GE_U; break;
+            }
+        }
+        else {
+            switch (sy) {
+            case '<': op = CEXP_LT; break;
+            case '>': op = CEXP_GT; break;
+            case SY_LEQ: op = CEXP_LE; break;
+            case SY_GEQ: op = CEXP_GE; break;
+            }
+        }
+        add_compiled_op(e, op, -1);
+        type_class = TYPE_CLASS_INTEGER;
+    }
+    return type_class;
+}
+
+static int compile_equality(CompiledExpression * e) {
+    int type_class = compile_relational(e);
+    while (text_sy == SY_EQU || text_sy == SY_NEQ) {
+        int sy = text_sy;
+        int x_class = 0;
+        next_sy();
+        x_class = compile_relational(e);
+        if (type_class == TYPE_CLASS_UNKNOWN || x_class == TYPE_CLASS_UNKNOWN) compile_unsupported();
+        add_compiled_op(e, sy == SY_EQU ? CEXP_EQ : CEXP_NE, -1);
+        type_class = TYPE_CLASS_INTEGER;
+    }
+    return type_class;
+}
+
+/* Result of a logical operation is one of its operands, so its type is not known at compile time */
+
+static int compile_logical_and(CompiledExpression * e) {
+    int type_class = compile_equality(e);
+    while (text_sy == SY_AND) {
+        unsigned pos = e->ops_cnt;
+        next_sy();
+        add_compiled_op(e, CEXP_AND_THEN, -1);
+        compile_equality(e);
+        e->ops[pos].args.jump = e->ops_cnt;
+        type_class = TYPE_CLASS_UNKNOWN;
+    }
+    return type_class;
+}
+
+static int compile_logical_or(CompiledExpression * e) {
+    int type_class = compile_logical_and(e);
+    while (text_sy == SY_OR) {
+        unsigned pos = e->ops_cnt;
+        next_sy();
+        add_compiled_op(e, CEXP_OR_ELSE, -1);
+        compile_logical_and(e);
+        e->ops[pos].args.jump = e->ops_cnt;
+        type_class = TYPE_CLASS_UNKNOWN;
+    }
+    return type_class;
+}
+
+int compile_expression(Context * ctx, int frame, ContextAddress addr, char * s, CompiledExpression ** res) {
+    Trap trap;
+    CompiledExpression * e = (CompiledExpression *)loc_alloc_zero(sizeof(CompiledExpression));
+
+#if !defined(SERVICE_Expressions)
+    big_endian = big_endian_host();
+#endif
+    expression_context = ctx;
+    expression_frame = frame;
+    expression_addr = addr;
+    if (set_trap(&trap)) {
+        if (s == NULL || *s == 0) str_exception(ERR_INV_EXPRESSION, "Empty expression");
+        if (ctx == NULL) exception(ERR_INV_CONTEXT);
+        text = s;
+        text_pos = 0;
+        text_len = strlen(s) + 1;
+        next_ch();
+        next_sy();
+        compile_logical_or(e);
+        if (text_sy != 0) compile_unsupported();
+        assert(e->stk_pos == 1);
+        clear_trap(&trap);
+        *res = e;
+        return 0;
+    }
+    free_compiled_expression(e);
+    errno = trap.error;
+    return -1;
+}
+
+static uint64_t load_compiled_value(Context * ctx, StackFrame * frame, CompiledLoad * load) {
+    LocationExpressionState * state = NULL;
+    uint8_t buf[8];
+    uint8_t * value = buf;
+    uint64_t n = 0;
+    size_t i;
+
+    state = evaluate_location_expression(ctx, frame, load->cmds, load->cmds_cnt, NULL, 0);
+    if (state->stk_pos == 1) {
+        Context * mem = context_get_group(ctx, CONTEXT_GROUP_PROCESS);
+        if ((mem->mem_access & MEM_ACCESS_RD_RUNNING) == 0) {
+            if (!is_all_stopped(ctx)) str_exception(ERR_IS_RUNNING, "Cannot read memory if not stopped");
+        }
+        if (context_read_mem(ctx, (ContextAddress)state->stk[0], buf, load->size) < 0) exception(errno);
+    }
+    else {
+        size_t size = 0;
+        void * data = NULL;
+        read_location_pieces(ctx, frame, state->pieces, state->pieces_cnt, load->big_endian, &data, &size);
+        if (size != load->size) exception(ERR_INV_DATA_SIZE);
+        value = (uint8_t *)data;
+    }
+    for (i = 0; i < load->size; i++) {
+        n = (n << 8) | value[load->big_endian ? i : load->size - i - 1];
+    }
+    if (load->sign_extend && load->size < 8) {
+        uint64_t m = (uint64_t)1 << (load->size * 8 - 1);
+        n = (n ^ m) - m;
+    }
+    return n;
+}
+
+int evaluate_compiled_expression(Context * ctx, int frame, CompiledExpression * e, int64_t * res) {
+    Trap trap;
+    StackFrame * frame_info = NULL;
+    uint64_t stk[CEXP_STACK_MAX];
+    unsigned stk_pos = 0;
+    unsigned pos = 0;
+
+    if (!set_trap(&trap)) return -1;
+    while (pos < e->ops_cnt) {
+        CompiledOp * op = e->ops + pos++;
+        switch (op->op) {
+        case CEXP_NUMBER:
+            stk[stk_pos++] = (uint64_t)op->args.num;
+            break;
+        case CEXP_LOAD:
+            if (frame != STACK_NO_FRAME && frame_info == NULL && get_frame_info(ctx, frame, &frame_info) < 0) exception(errno);
+            stk[stk_pos++] = load_compiled_value(ctx, frame_info, &op->args.load);
+            break;
+        case CEXP_NOT:
+            stk[stk_pos - 1] = stk[stk_pos - 1] == 0;
+            break;
+        case CEXP_EQ:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] == stk[stk_pos];
+            break;
+        case CEXP_NE:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] != stk[stk_pos];
+            break;
+        case CEXP_LT:
+            stk_pos--;
+            stk[stk_pos - 1] = (int64_t)stk[stk_pos - 1] < (int64_t)stk[stk_pos];
+            break;
+        case CEXP_GT:
+            stk_pos--;
+            stk[stk_pos - 1] = (int64_t)stk[stk_pos - 1] > (int64_t)stk[stk_pos];
+            break;
+        case CEXP_LE:
+            stk_pos--;
+            stk[stk_pos - 1] = (int64_t)stk[stk_pos - 1] <= (int64_t)stk[stk_pos];
+            break;
+        case CEXP_GE:
+            stk_pos--;
+            stk[stk_pos - 1] = (int64_t)stk[stk_pos - 1] >= (int64_t)stk[stk_pos];
+            break;
+        case CEXP_LT_U:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] < stk[stk_pos];
+            break;
+        case CEXP_GT_U:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] > stk[stk_pos];
+            break;
+        case CEXP_LE_U:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] <= stk[stk_pos];
+            break;
+        case CEXP_GE_U:
+            stk_pos--;
+            stk[stk_pos - 1] = stk[stk_pos - 1] >= stk[stk_pos];
+            break;
+        case CEXP_AND_THEN:
+            if (stk[stk_pos - 1] == 0) pos = op->args.jump;
+            else stk_pos--;
+            break;
+        case CEXP_OR_ELSE:
+            if (stk[stk_pos - 1] != 0) pos = op->args.jump;
+            else stk_pos--;
+            break;
+        default:
+            assert(0);
+            break;
+        }
+    }
+    assert(stk_pos == 1);
+    clear_trap(&trap);
+    *res = (int64_t)stk[0];
+    return 0;
+}
+
+void free_compiled_expression(CompiledExpression * e) {
+    unsigned i, j;
+    if (e == NULL) return;
+    for (i = 0; i < e->ops_cnt; i++) {
+        CompiledOp * op = e->ops + i;
+        if (op->op != CEXP_LOAD) continue;
+        for (j = 0; j < op->args.load.cmds_cnt; j++) {
+            LocationExpressionCommand * cmd = op->args.load.cmds + j;
+            if (cmd->cmd == SFT_CMD_LOCATION && cmd->args.loc.code_size > 0) loc_free(cmd->args.loc.code_addr);
+            if (cmd->cmd == SFT_CMD_PIECE) loc_free(cmd->args.piece.value);
+        }
+        loc_free(op->args.load.cmds);
+    }
+    loc_free(e->ops);
+    loc_free(e);
+}
+
+#endif /* ENABLE_Symbols */
+
 #if SERVICE_Expressions
 
 /********************** Commands **************************/
@@ -4038,6 +4624,233 @@ static unsigned expr_id_cnt = 0;
 
 #define expression_hash(id) ((unsigned)atoi(id + 4) % ID2EXP_HASH_SIZE)
 
+#if ENABLE_ExpressionCache
+
+#define EXPR_CACHE_HASH_SIZE (16 * MEM_USAGE_FACTOR - 1)
+#define EXPR_CACHE_MAX_RECORDS (64 * MEM_USAGE_FACTOR)
+
+#define link_hash2ecr(A) ((ExpressionCacheRecord *)((char *)(A) - offsetof(ExpressionCacheRecord, link_hash)))
+#define link_lru2ecr(A)  ((ExpressionCacheRecord *)((char *)(A) - offsetof(ExpressionCacheRecord, link_lru)))
+
+static LINK expr_cache_hash[EXPR_CACHE_HASH_SIZE];
+static LINK expr_cache_lru = TCF_LIST_INIT(expr_cache_lru);
+static unsigned expr_cache_cnt = 0;
+
+static unsigned expr_cache_lookups = 0;
+static unsigned expr_cache_hits = 0;
+static unsigned expr_cache_evictions = 0;
+static unsigned expr_cache_invalidations = 0;
+static unsigned expr_cache_program_hits = 0;
+
+static unsigned expression_cache_hash(Context * ctx, int frame, ContextAddress pc, const char * script) {
+    unsigned h = (unsigned)(uintptr_t)ctx + (unsigned)frame * 31 + (unsigned)pc;
+    while (*script) h = h * 31 + (unsigned char)*script++;
+    return h % EXPR_CACHE_HASH_SIZE;
+}
+
+static void free_expression_cache_record(ExpressionCacheRecord * r) {
+    unsigned i, j;
+    list_remove(&r->link_hash);
+    list_remove(&r->link_lru);
+    for (i = 0; i < r->syms_cnt; i++) {
+        ExpressionCacheSymbols * s = r->syms + i;
+        for (j = 0; j < s->cnt; j++) loc_free(s->ids[j]);
+        loc_free(s->ids);
+        loc_free(s->scope);
+        loc_free(s->name);
+    }
+    context_unlock(r->ctx);
+    free_compiled_expression(r->program);
+    loc_free(r->result_type);
+    loc_free(r->syms);
+    loc_free(r->script);
+    loc_free(r->language);
+    loc_free(r);
+    expr_cache_cnt--;
+}
+
+static ExpressionCacheRecord * get_expression_cache(Context * ctx, int frame, Expression * e) {
+    ContextAddress pc = e->addr;
+    ExpressionCacheRecord * r = NULL;
+    unsigned hash = 0;
+    LINK * l = NULL;
+
+    /* Expressions created from symbol IDs don't search symbols */
+    if (e->var_id[0]) return NULL;
+
+    if (frame != STACK_NO_FRAME) {
+        if (!ctx->stopped || ctx->exited) return NULL;
+        if (is_top_frame(ctx, frame)) {
+            if (get_PC(ctx, &pc) < 0) return NULL;
+        }
+        else {
+            uint64_t ip = 0;
+            StackFrame * info = NULL;
+            if (get_frame_info(ctx, frame, &info) < 0) return NULL;
+            if (read_reg_value(info, get_PC_definition(ctx), &ip) < 0) return NULL;
+            pc = (ContextAddress)ip;
+        }
+    }
+
+    expr_cache_lookups++;
+    hash = expression_cache_hash(ctx, frame, pc, e->script);
+    for (l = expr_cache_hash[hash].next; l != expr_cache_hash + hash; l = l->next) {
+        r = link_hash2ecr(l);
+        if (r->ctx == ctx && r->frame == frame && r->pc == pc &&
+                strcmp(r->script, e->script) == 0 && strcmp(r->language, e->language) == 0) {
+            list_remove(&r->link_lru);
+            list_add_first(&r->link_lru, &expr_cache_lru);
+            if (r->disabled) return NULL;
+            expr_cache_hits++;
+            return r;
+        }
+    }
+
+    while (expr_cache_cnt >= EXPR_CACHE_MAX_RECORDS) {
+        free_expression_cache_record(link_lru2ecr(expr_cache_lru.prev));
+        expr_cache_evictions++;
+    }
+    r = (ExpressionCacheRecord *)loc_alloc_zero(sizeof(ExpressionCacheRecord));
+    r->ctx = ctx;
+    r->frame = frame;
+    r->pc = pc;
+    r->script = loc_strdup(e->script);
+    r->language = loc_strdup(e->language);
+    context_lock(ctx);
+    list_add_first(&r->link_hash, expr_cache_hash + hash);
+    list_add_first(&r->link_lru, &expr_cache_lru);
+    expr_cache_cnt++;
+    return r;
+}
+
+static void flush_expression_cache(Context * ctx) {
+    LINK * l = expr_cache_lru.next;
+    while (l != &expr_cache_lru) {
+        ExpressionCacheRecord * r = link_lru2ecr(l);
+        l = l->next;
+        if (ctx == NULL || r->ctx == ctx) {
+            free_expression_cache_record(r);
+            expr_cache_invalidations++;
+        }
+    }
+}
+
+/* Result of the program is a comparison or '!', same as set_bool_value() result of the interpreter */
+static int is_boolean_program(CompiledExpression * e) {
+    unsigned i;
+    if (e->ops_cnt == 0) return 0;
+    switch (e->ops[e->ops_cnt - 1].op) {
+    case CEXP_NUMBER:
+    case CEXP_LOAD:
+    case CEXP_AND_THEN:
+    case CEXP_OR_ELSE:
+        return 0;
+    }
+    /* '&&' and '||' result is one of the operands, it can be a variable */
+    for (i = 0; i < e->ops_cnt; i++) {
+        CompiledOp * op = e->ops + i;
+        if (op->op != CEXP_AND_THEN && op->op != CEXP_OR_ELSE) continue;
+        if (op->args.jump == e->ops_cnt) return 0;
+    }
+    return 1;
+}
+
+/* Called after the interpreter successfully evaluated the record script into 'v' */
+static void compile_cached_expression(ExpressionCacheRecord * r, Value * v) {
+    CompiledExpression * e = NULL;
+    if (r->compiled != 0 || r->disabled) return;
+    if (v->remote || v->loc != NULL || v->sym != NULL || v->value == NULL) {
+        r->compiled = -1;
+        return;
+    }
+    if (v->type_class != TYPE_CLASS_INTEGER && v->type_class != TYPE_CLASS_ENUMERATION) {
+        r->compiled = -1;
+        return;
+    }
+    if (v->size != 1 && v->size != 2 && v->size != 4 && v->size != 8) {
+        r->compiled = -1;
+        return;
+    }
+    if (compile_expression(expression_context, expression_frame, expression_addr, r->script, &e) < 0) {
+        /* Try again when the symbols data is available */
+        if (get_error_code(errno) != ERR_CACHE_MISS) r->compiled = -1;
+        return;
+    }
+    if (!is_boolean_program(e)) {
+        free_compiled_expression(e);
+        r->compiled = -1;
+        return;
+    }
+    r->compiled = 1;
+    r->program = e;
+    r->result_type = v->type != NULL ? loc_strdup(symbol2id(v->type)) : NULL;
+    r->result_class = v->type_class;
+    r->result_size = (size_t)v->size;
+}
+
+/* Evaluate the compiled program of the record, return 0 if the interpreter should be used instead */
+static int evaluate_cached_program(ExpressionCacheRecord * r, Value * v) {
+    int64_t n = 0;
+    Symbol * type = NULL;
+    if (r->compiled <= 0 || r->disabled) return 0;
+    /* Any error is reported by the interpreter */
+    if (evaluate_compiled_expression(expression_context, expression_frame, r->program, &n) < 0) return 0;
+    if (r->result_type != NULL && id2symbol(r->result_type, &type) < 0) return 0;
+    ini_value(v);
+    v->type = type;
+    v->type_class = r->result_class;
+    set_int_value(v, r->result_size, (uint64_t)n);
+    expr_cache_program_hits++;
+    return 1;
+}
+
+static void expression_cache_context_changed(Context * ctx, void * args) {
+    /* Memory map change: symbol files can be different */
+    flush_expression_cache(NULL);
+}
+
+static void expression_cache_context_exited(Context * ctx, void * args) {
+    flush_expression_cache(ctx);
+}
+
+static void write_expression_cache_statistics(OutputStream * out, void * args) {
+    write_stream(out, '{');
+    json_write_string(out, "Records");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Lookups");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_lookups);
+    write_stream(out, ',');
+    json_write_string(out, "Hits");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_hits);
+    write_stream(out, ',');
+    json_write_string(out, "NameHits");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_name_hits);
+    write_stream(out, ',');
+    json_write_string(out, "NameMisses");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_name_misses);
+    write_stream(out, ',');
+    json_write_string(out, "Evictions");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_evictions);
+    write_stream(out, ',');
+    json_write_string(out, "Invalidations");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_invalidations);
+    write_stream(out, ',');
+    json_write_string(out, "ProgramHits");
+    write_stream(out, ':');
+    json_write_ulong(out, expr_cache_program_hits);
+    write_stream(out, '}');
+}
+
+#endif /* ENABLE_ExpressionCache */
+
 #if ENABLE_ExpressionSerialization
 
 typedef struct PendingCommand {
@@ -4428,7 +5241,13 @@ static void command_create_cache_client(void * x) {
             expression_context = ctx;
             expression_frame = frame;
             expression_addr = e->addr;
+#if ENABLE_ExpressionCache
+            expression_cache = get_expression_cache(ctx, frame, e);
+#endif
             if (evaluate_script(MODE_TYPE, e->script, 0, &value) < 0) err = errno;
+#if ENABLE_ExpressionCache
+            expression_cache = NULL;
+#endif
         }
         if (!err) {
             e->can_assign = value.remote || (value.loc != NULL && value.loc->pieces_cnt > 0);
@@ -4530,8 +5349,19 @@ static void command_evaluate_cache_client(void * x) {
         expression_context = ctx;
         expression_frame = frame;
         expression_addr = e->addr;
+#if ENABLE_ExpressionCache
+        expression_cache = get_expression_cache(ctx, frame, e);
+        if (expression_cache != NULL && evaluate_cached_program(expression_cache, &value)) {
+            value_ok = 1;
+        }
+        else
+#endif
         if (evaluate_script(MODE_NORMAL, e->script, 0, &value) < 0) err = errno;
         else value_ok = 1;
+#if ENABLE_ExpressionCache
+        if (value_ok && expression_cache != NULL) compile_cached_expression(expression_cache, &value);
+        expression_cache = NULL;
+#endif
     }
     if (!err && value.remote && value.size <= 0x10000) {
         Context * mem = context_get_group(ctx, CONTEXT_GROUP_PROCESS);
@@ -4942,6 +5772,21 @@ void ini_expressions_service(Protocol * proto) {
         list_init(&cmd_queue);
 #endif
         for (i = 0; i < ID2EXP_HASH_SIZE; i++) list_init(id2exp + i);
+#if ENABLE_ExpressionCache
+        {
+            static ContextEventListener listener = {
+                NULL,
+                expression_cache_context_exited,
+                NULL,
+                NULL,
+                expression_cache_context_changed,
+                expression_cache_context_exited
+            };
+            add_context_event_listener(&listener, NULL);
+        }
+        for (i = 0; i < EXPR_CACHE_HASH_SIZE; i++) list_init(expr_cache_hash + i);
+        add_diagnostics_statistics("ExpressionCache", write_expression_cache_statistics, NULL);
+#endif
         add_channel_close_listener(on_channel_close);
         big_endian = big_endian_host();
         init = 1;
@@ -108,6 +108,35 @@ int value_to_signed(Value * v, int64_t * res);
 int value_to_unsigned(Value * v, uint64_t * res);
 int value_to_double(Value * v, double * res);
 
+#if ENABLE_Symbols
+
+/*
+ * Compiled expression.
+ * Simple expressions - comparisons and logical operations on integer variables and constants -
+ * can be compiled once and then evaluated without parsing and symbols lookup.
+ * A compiled expression is only valid for the symbols context and the instruction address
+ * it was compiled for, and it must be disposed when the context memory map changes.
+ */
+typedef struct CompiledExpression CompiledExpression;
+
+/*
+ * Compile given expression, arguments are same as for evaluate_expression().
+ * Return 0 if no errors, otherwise return -1 and sets errno.
+ * ERR_UNSUPPORTED means the expression is too complex to compile, use evaluate_expression() instead.
+ */
+extern int compile_expression(Context * ctx, int frame, ContextAddress addr, char * s, CompiledExpression ** e);
+
+/*
+ * Evaluate compiled expression, the result is a signed integer.
+ * Return 0 if no errors, otherwise return -1 and sets errno.
+ * The error message can differ from evaluate_expression() error message for the same expression.
+ */
+extern int evaluate_compiled_expression(Context * ctx, int frame, CompiledExpression * e, int64_t * res);
+
+extern void free_compiled_expression(CompiledExpression * e);
+
+#endif /* ENABLE_Symbols */
+
 /*
  * Allocate and fill local data buffer for a value.
  * The buffer is freed automatically at the end of current event dispatch cycle.
@@ -27,12 +27,14 @@
 #include <errno.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <tcf/framework/context.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/cache.h>
 #include <tcf/framework/trace.h>
 #include <tcf/framework/json.h>
+#include <tcf/framework/addrindex.h>
 #include <tcf/framework/protocol.h>
 #include <tcf/services/linenumbers.h>
 #include <tcf/services/tcf_elf.h>
@@ -218,8 +220,8 @@ static void unit_line_to_address(Context * ctx, MemoryRegion * mem, CompUnit * u
                                  unsigned file, unsigned line, unsigned column,
                                  LineNumbersCallBack * client, void * args) {
     if (unit->mStatesCnt >= 2) {
-        unsigned l = 0;
-        unsigned h = unit->mStatesCnt;
+        unsigned l = unit->mFiles[file].mStatesPos;
+        unsigned h = unit->mFiles[file].mStatesEnd;
         while (l < h) {
             unsigned k = (h + l) / 2;
             LineNumbersState * state = unit->mStatesIndex[k];
@@ -279,11 +281,39 @@ static void unit_line_to_address(Context * ctx, MemoryRegion * mem, CompUnit * u
     }
 }
 
+static int is_same_region_file(MemoryRegion * x, MemoryRegion * y) {
+    if (x->dev != y->dev || x->ino != y->ino) return 0;
+    if (x->file_name == y->file_name) return 1;
+    if (x->file_name == NULL || y->file_name == NULL) return 0;
+    return strcmp(x->file_name, y->file_name) == 0;
+}
+
+static int file_ptr_comparator(const void * x1, const void * x2) {
+    uintptr_t p1 = (uintptr_t)*(ELF_File **)x1;
+    uintptr_t p2 = (uintptr_t)*(ELF_File **)x2;
+    if (p1 < p2) return -1;
+    if (p1 > p2) return +1;
+    return 0;
+}
+
+static int file_info_comparator(const void * x1, const void * x2) {
+    FileInfo * f1 = *(FileInfo **)x1;
+    FileInfo * f2 = *(FileInfo **)x2;
+    int r = file_ptr_comparator(&f1->mCompUnit->mFile, &f2->mCompUnit->mFile);
+    if (r != 0) return r;
+    if ((uintptr_t)f1 < (uintptr_t)f2) return -1;
+    if ((uintptr_t)f1 > (uintptr_t)f2) return +1;
+    return 0;
+}
+
 int line_to_address(Context * ctx, const char * file_name, int line, int column,
                     LineNumbersCallBack * client, void * args) {
     int err = 0;
     Channel * chnl = cache_channel();
     static MemoryMap map;
+    ELF_File ** region_files = NULL;
+    ELF_File ** files = NULL;
+    unsigned files_cnt = 0;
     LINE_TO_ADDR_HOOK_0
 
     if (ctx == NULL) err = ERR_INV_CONTEXT;
@@ -292,54 +322,97 @@ int line_to_address(Context * ctx, const char * file_name, int line, int column,
     if (err == 0 && elf_get_map(ctx, 0, ~(ContextAddress)0, &map) < 0) err = errno;
 
     if (err == 0) {
-        unsigned i, j;
-        unsigned h = 0;
-        char * fnm = NULL;
+        /* Find DWARF files of the memory map, make sure their line numbers are in the source file index */
+        unsigned i;
+        MemoryRegion * prev = NULL;
+        region_files = (ELF_File **)tmp_alloc_zero(sizeof(ELF_File *) * (map.region_cnt + 1));
+        files = (ELF_File **)tmp_alloc(sizeof(ELF_File *) * (map.region_cnt + 1));
         for (i = 0; i < map.region_cnt; i++) {
             Trap trap;
             MemoryRegion * r = map.regions + i;
-            ELF_File * file = elf_open_memory_region_file(r, NULL);
+            ELF_File * file = NULL;
+            if (prev != NULL && is_same_region_file(prev, r)) {
+                /* Segments of a file are usually adjacent in the map */
+                region_files[i] = region_files[prev - map.regions];
+                continue;
+            }
+            file = elf_open_memory_region_file(r, NULL);
             if (file == NULL) continue;
             if (set_trap(&trap)) {
                 DWARFCache * cache = get_dwarf_cache(get_dwarf_file(file));
-                if (!cache->mLineInfoLoaded) {
-                    for (j = 0; j < file->section_cnt; j++) {
-                        ObjectInfo * info = cache->mObjectHashTable[j].mCompUnits;
-                        while (info != NULL) {
-                            CompUnit * unit = info->mCompUnit;
-                            if (!unit->mLineInfoLoaded) load_line_numbers(unit);
-                            info = info->mSibling;
-                        }
-                    }
-                    cache->mLineInfoLoaded = 1;
-                }
-                if (cache->mFileInfoHash) {
-                    FileInfo * f = NULL;
-                    if (fnm == NULL) {
-                        fnm = canonic_path_map_file_name(file_name);
-                        LINE_TO_ADDR_HOOK_1
-                        h = calc_file_name_hash(fnm);
-                    }
-                    LINE_TO_ADDR_HOOK_BP
-                    f = cache->mFileInfoHash[h % cache->mFileInfoHashSize];
-                    while (f != NULL) {
-                        if (f->mNameHash == h && compare_path(chnl, ctx, fnm, f->mCompUnit->mDir, f->mDir, f->mName)) {
-                            CompUnit * unit = f->mCompUnit;
-                            unsigned j = f - unit->mFiles;
-                            LINE_TO_ADDR_HOOK_2
-                            unit_line_to_address(ctx, r, unit, j, line, column, client, args);
-                        }
-                        f = f->mNextInHash;
-                    }
-                }
+                load_all_line_numbers(cache);
+                region_files[i] = cache->mFile;
+                files[files_cnt++] = cache->mFile;
+                prev = r;
                 clear_trap(&trap);
             }
             else {
                 err = trap.error;
-                trace(LOG_ALWAYS, "Cannot load DWARF line numbers section: %s", errno_to_str(err));
+                if (err != ERR_CACHE_MISS) trace(LOG_ALWAYS, "Cannot load DWARF line numbers section: %s", errno_to_str(err));
                 break;
             }
         }
+        qsort(files, files_cnt, sizeof(ELF_File *), file_ptr_comparator);
+    }
+
+    if (err == 0 && files_cnt > 0) {
+        unsigned i;
+        unsigned h = 0;
+        char * fnm = NULL;
+        FileInfo * f = NULL;
+        FileInfo ** match = NULL;
+        unsigned match_cnt = 0;
+        unsigned match_max = 0;
+
+        fnm = canonic_path_map_file_name(file_name);
+        LINE_TO_ADDR_HOOK_1
+        h = calc_file_name_hash(fnm);
+        LINE_TO_ADDR_HOOK_BP
+        for (f = get_source_file_index(h); f != NULL; f = f->mNextInIndex) {
+            if (f->mNameHash != h) continue;
+            if (bsearch(&f->mCompUnit->mFile, files, files_cnt, sizeof(ELF_File *), file_ptr_comparator) == NULL) continue;
+            if (!compare_path(chnl, ctx, fnm, f->mCompUnit->mDir, f->mDir, f->mName)) continue;
+            if (match_cnt >= match_max) {
+                match_max = match_max == 0 ? 16 : match_max * 2;
+                match = (FileInfo **)tmp_realloc(match, sizeof(FileInfo *) * match_max);
+            }
+            match[match_cnt++] = f;
+        }
+        if (match_cnt > 1) qsort(match, match_cnt, sizeof(FileInfo *), file_info_comparator);
+
+        if (match_cnt > 0) {
+            /* Line number states of matching units could be disposed to free memory, load them back */
+            Trap trap;
+            if (set_trap(&trap)) {
+                for (i = 0; i < match_cnt; i++) load_line_numbers(match[i]->mCompUnit);
+                clear_trap(&trap);
+            }
+            else {
+                err = trap.error;
+                match_cnt = 0;
+            }
+        }
+
+        for (i = 0; i < map.region_cnt && match_cnt > 0; i++) {
+            MemoryRegion * r = map.regions + i;
+            ELF_File * file = region_files[i];
+            unsigned l = 0;
+            unsigned k = match_cnt;
+            if (file == NULL) continue;
+            /* Binary search for the first matching source file of the region DWARF file */
+            while (l < k) {
+                unsigned m = (l + k) / 2;
+                if (file_ptr_comparator(&match[m]->mCompUnit->mFile, &file) < 0) l = m + 1;
+                else k = m;
+            }
+            while (l < match_cnt && match[l]->mCompUnit->mFile == file) {
+                CompUnit * unit = match[l]->mCompUnit;
+                unsigned j = match[l] - unit->mFiles;
+                LINE_TO_ADDR_HOOK_2
+                unit_line_to_address(ctx, r, unit, j, line, column, client, args);
+                l++;
+            }
+        }
     }
 
     if (err != 0) {
@@ -349,6 +422,41 @@ int line_to_address(Context * ctx, const char * file_name, int line, int column,
     return 0;
 }
 
+static void unit_states_to_line(Context * ctx, CompUnit * unit, unsigned k,
+                                UnitAddressRange * range, ContextAddress range_rt_addr,
+                                ContextAddress addr_min, ContextAddress addr_max,
+                                LineNumbersCallBack * client, void * args) {
+    /* unit->mStates[k] is in the range section, and its address is less or equal to 'addr_max' */
+    LineNumbersState * state = unit->mStates + k;
+    while (k > 0) {
+        LineNumbersState * prev = unit->mStates + k - 1;
+        if (state->mAddress <= addr_min) break;
+        if (prev->mAddress > addr_max) break;
+        state = prev;
+        k--;
+    }
+    for (;;) {
+        LineNumbersState * code_next = get_next_in_code(unit, state);
+        if (code_next != NULL) {
+            if (state->mAddress < code_next->mAddress) {
+                LineNumbersState * text_next = get_next_in_text(unit, state);
+                ADDR_TO_LINE_HOOK
+                {
+                call_client(ctx, unit, state, code_next, text_next, state->mAddress - range->mAddr + range_rt_addr, client, args);
+                }
+            }
+            assert(code_next > state);
+            k = code_next - unit->mStates;
+        }
+        else {
+            k++;
+        }
+        if (k >= unit->mStatesCnt) break;
+        state = unit->mStates + k;
+        if (state->mAddress > addr_max) break;
+    }
+}
+
 int address_to_line(Context * ctx, ContextAddress addr0, ContextAddress addr1, LineNumbersCallBack * client, void * args) {
     Trap trap;
 
@@ -368,63 +476,47 @@ int address_to_line(Context * ctx, ContextAddress addr0, ContextAddress addr1, L
         assert(range_rt_addr + range->mSize > range_rt_addr || range_rt_addr + range->mSize == 0);
         assert(addr1 >= range_rt_addr);
         assert(addr0 <= range_rt_addr + range->mSize - 1);
-        if (!range->mUnit->mLineInfoLoaded) load_line_numbers(range->mUnit);
+        load_line_numbers(range->mUnit);
         if (range->mUnit->mStatesCnt >= 2) {
             CompUnit * unit = range->mUnit;
-            unsigned l = 0;
-            unsigned h = unit->mStatesCnt;
             ContextAddress addr_min = range->mAddr;
             ContextAddress addr_max = range->mAddr + range->mSize - 1;
             if (addr0 > range_rt_addr) addr_min = addr0 - range_rt_addr + range->mAddr;
             if (addr1 < range_rt_addr + range->mSize - 1) addr_max = addr1 - range_rt_addr + range->mAddr;
             assert(addr_min >= range->mAddr);
             assert(addr_max <= range->mAddr + range->mSize - 1);
-            while (l < h) {
-                unsigned k = (h + l) / 2;
-                LineNumbersState * state = unit->mStates + k;
-                if (state->mSection > range->mSection) {
-                    h = k;
-                }
-                else if (state->mSection < range->mSection) {
-                    l = k + 1;
+            if (unit->mStatesAddrIndex.keys != NULL) {
+                /* All states are in one section: start from the last state at or below 'addr_max' */
+                unsigned k = 0;
+                if (unit->mStates->mSection == range->mSection) {
+                    k = addr_index_rank(&unit->mStatesAddrIndex, addr_max);
                 }
-                else if (state->mAddress > addr_max) {
-                    h = k;
-                }
-                else {
-                    LineNumbersState * next = get_next_in_code(unit, state);
-                    if (next == NULL || next->mAddress <= addr_min) {
+                if (k > 0) unit_states_to_line(ctx, unit, k - 1, range, range_rt_addr, addr_min, addr_max, client, args);
+            }
+            else {
+                unsigned l = 0;
+                unsigned h = unit->mStatesCnt;
+                while (l < h) {
+                    unsigned k = (h + l) / 2;
+                    LineNumbersState * state = unit->mStates + k;
+                    if (state->mSection > range->mSection) {
+                        h = k;
+                    }
+                    else if (state->mSection < range->mSection) {
                         l = k + 1;
                     }
+                    else if (state->mAddress > addr_max) {
+                        h = k;
+                    }
                     else {
-                        while (k > 0) {
-                            LineNumbersState * prev = unit->mStates + k - 1;
-                            if (state->mAddress <= addr_min) break;
-                            if (prev->mAddress > addr_max) break;
-                            state = prev;
-                            k--;
+                        LineNumbersState * next = get_next_in_code(unit, state);
+                        if (next == NULL || next->mAddress <= addr_min) {
+                            l = k + 1;
                         }
-                        for (;;) {
-                            LineNumbersState * code_next = get_next_in_code(unit, state);
-                            if (code_next != NULL) {
-                                if (state->mAddress < code_next->mAddress) {
-                                    LineNumbersState * text_next = get_next_in_text(unit, state);
-                                    ADDR_TO_LINE_HOOK
-                                    {
-                                    call_client(ctx, unit, state, code_next, text_next, state->mAddress - range->mAddr + range_rt_addr, client, args);
-                                    }
-                                }
-                                assert(code_next > state);
-                                k = code_next - unit->mStates;
-                            }
-                            else {
-                                k++;
-                            }
-                            if (k >= unit->mStatesCnt) break;
-                            state = unit->mStates + k;
-                            if (state->mAddress > addr_max) break;
+                        else {
+                            unit_states_to_line(ctx, unit, k, range, range_rt_addr, addr_min, addr_max, client, args);
+                            break;
                         }
-                        break;
                     }
                 }
             }
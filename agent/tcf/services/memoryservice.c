@@ -49,6 +49,30 @@ static TCFBroadcastGroup * broadcast_group = NULL;
 
 #define BUF_SIZE    (512 * MEM_USAGE_FACTOR)
 
+typedef struct MemoryChangedRange {
+    ContextAddress addr;
+    unsigned long size;
+} MemoryChangedRange;
+
+/* memoryChanged event data that is postponed while a channel is congested */
+typedef struct PendingMemoryChanged {
+    LINK link;
+    Context * ctx;
+    MemoryChangedRange * ranges;
+    unsigned cnt;
+    unsigned max;
+} PendingMemoryChanged;
+
+typedef struct ChannelExtensionMem {
+    LINK pending;
+    int wait_posted;
+} ChannelExtensionMem;
+
+static size_t channel_extension_offset = 0;
+
+#define EXT(c) ((ChannelExtensionMem *)((char *)(c) + channel_extension_offset))
+#define link2pending(A) ((PendingMemoryChanged *)((char *)(A) - offsetof(PendingMemoryChanged, link)))
+
 typedef struct MemoryCommandArgs {
     char token[256];
     char ctx_id[256];
@@ -379,8 +403,8 @@ static MemoryCommandArgs * read_command_args(char * token, Channel * c, int cmd)
     return &buf;
 }
 
-void send_event_memory_changed(Context * ctx, ContextAddress addr, unsigned long size) {
-    OutputStream * out = &broadcast_group->out;
+static void write_event_memory_changed(OutputStream * out, Context * ctx, MemoryChangedRange * ranges, unsigned cnt) {
+    unsigned i;
 
     write_stringz(out, "E");
     write_stringz(out, MEMORY);
@@ -391,25 +415,133 @@ void send_event_memory_changed(Context * ctx, ContextAddress addr, unsigned long
 
     /* <array of addres ranges> */
     write_stream(out, '[');
-    write_stream(out, '{');
+    for (i = 0; i < cnt; i++) {
+        if (i > 0) write_stream(out, ',');
+        write_stream(out, '{');
 
-    json_write_string(out, "addr");
-    write_stream(out, ':');
-    json_write_uint64(out, addr);
+        json_write_string(out, "addr");
+        write_stream(out, ':');
+        json_write_uint64(out, ranges[i].addr);
 
-    write_stream(out, ',');
+        write_stream(out, ',');
 
-    json_write_string(out, "size");
-    write_stream(out, ':');
-    json_write_ulong(out, size);
+        json_write_string(out, "size");
+        write_stream(out, ':');
+        json_write_ulong(out, ranges[i].size);
 
-    write_stream(out, '}');
+        write_stream(out, '}');
+    }
     write_stream(out, ']');
     write_stream(out, 0);
 
     write_stream(out, MARKER_EOM);
 }
 
+static void free_pending_memory_changed(PendingMemoryChanged * p) {
+    list_remove(&p->link);
+    context_unlock(p->ctx);
+    loc_free(p->ranges);
+    loc_free(p);
+}
+
+static void send_pending_memory_changed(Channel * c) {
+    LINK * list = &EXT(c)->pending;
+    if (list->next == NULL) return;
+    while (!list_is_empty(list)) {
+        PendingMemoryChanged * p = link2pending(list->next);
+        write_event_memory_changed(&c->out, p->ctx, p->ranges, p->cnt);
+        free_pending_memory_changed(p);
+    }
+}
+
+static void channel_output_ready(Channel * c, void * args) {
+    ChannelExtensionMem * ext = EXT(c);
+    ext->wait_posted = 0;
+    if (is_channel_closed(c)) return;
+    send_pending_memory_changed(c);
+}
+
+static void add_pending_memory_changed(Channel * c, Context * ctx, ContextAddress addr, unsigned long size) {
+    ChannelExtensionMem * ext = EXT(c);
+    PendingMemoryChanged * p = NULL;
+    unsigned i;
+    LINK * l;
+
+    if (ext->pending.next == NULL) list_init(&ext->pending);
+    for (l = ext->pending.next; l != &ext->pending; l = l->next) {
+        PendingMemoryChanged * x = link2pending(l);
+        if (x->ctx == ctx) {
+            p = x;
+            break;
+        }
+    }
+    if (p == NULL) {
+        p = (PendingMemoryChanged *)loc_alloc_zero(sizeof(PendingMemoryChanged));
+        p->ctx = ctx;
+        context_lock(ctx);
+        list_add_last(&p->link, &ext->pending);
+    }
+    /* Merge overlapping and adjacent ranges */
+    for (i = 0; i < p->cnt; i++) {
+        MemoryChangedRange * r = p->ranges + i;
+        if (addr <= r->addr + r->size && r->addr <= addr + size) {
+            ContextAddress end = r->addr + r->size;
+            if (end < addr + size) end = addr + size;
+            if (r->addr > addr) r->addr = addr;
+            r->size = (unsigned long)(end - r->addr);
+            break;
+        }
+    }
+    if (i >= p->cnt) {
+        if (p->cnt >= p->max) {
+            p->max += 8;
+            p->ranges = (MemoryChangedRange *)loc_realloc(p->ranges, sizeof(MemoryChangedRange) * p->max);
+        }
+        p->ranges[p->cnt].addr = addr;
+        p->ranges[p->cnt].size = size;
+        p->cnt++;
+    }
+    if (!ext->wait_posted) {
+        ext->wait_posted = 1;
+        channel_wait_output(c, channel_output_ready, NULL);
+    }
+}
+
+void send_event_memory_changed(Context * ctx, ContextAddress addr, unsigned long size) {
+    MemoryChangedRange range;
+    int postpone = 0;
+    LINK * l;
+
+    range.addr = addr;
+    range.size = size;
+
+    for (l = broadcast_group->channels.next; l != &broadcast_group->channels; l = l->next) {
+        Channel * c = bclink2channelp(l);
+        if (!is_channel_broadcast_ok(c)) continue;
+        if (is_channel_congested(c) || EXT(c)->wait_posted) {
+            postpone = 1;
+            break;
+        }
+    }
+
+    if (!postpone) {
+        write_event_memory_changed(&broadcast_group->out, ctx, &range, 1);
+        return;
+    }
+
+    /* Some channels are congested: postpone the event for those channels only */
+    for (l = broadcast_group->channels.next; l != &broadcast_group->channels; l = l->next) {
+        Channel * c = bclink2channelp(l);
+        if (!is_channel_broadcast_ok(c)) continue;
+        if (is_channel_congested(c) || EXT(c)->wait_posted) {
+            add_pending_memory_changed(c, ctx, addr, size);
+        }
+        else {
+            write_event_memory_changed(&c->out, ctx, &range, 1);
+        }
+    }
+}
+
 static void memory_set_cache_client(void * parm) {
     MemoryCommandArgs * args = (MemoryCommandArgs *)parm;
     Channel * c = cache_channel();
@@ -756,10 +888,27 @@ static void event_context_changed(Context * ctx, void * args) {
 }
 
 static void event_context_exited(Context * ctx, void * args) {
+    LINK * l;
+    for (l = channel_root.next; l != &channel_root; l = l->next) {
+        LINK * list = &EXT(chanlink2channelp(l))->pending;
+        LINK * p = list->next;
+        if (p == NULL) continue;
+        while (p != list) {
+            PendingMemoryChanged * x = link2pending(p);
+            p = p->next;
+            if (x->ctx == ctx) free_pending_memory_changed(x);
+        }
+    }
     if (ctx->mem_access == 0) return;
     send_event_context_removed(ctx);
 }
 
+static void channel_close_listener(Channel * c) {
+    LINK * list = &EXT(c)->pending;
+    if (list->next == NULL) return;
+    while (!list_is_empty(list)) free_pending_memory_changed(link2pending(list->next));
+}
+
 void ini_memory_service(Protocol * proto, TCFBroadcastGroup * bcg) {
     static ContextEventListener listener = {
         event_context_created,
@@ -769,7 +918,9 @@ void ini_memory_service(Protocol * proto, TCFBroadcastGroup * bcg) {
         event_context_changed
     };
     broadcast_group = bcg;
+    channel_extension_offset = channel_extension(sizeof(ChannelExtensionMem));
     add_context_event_listener(&listener, NULL);
+    add_channel_close_listener(channel_close_listener);
     add_command_handler(proto, MEMORY, "getContext", command_get_context);
     add_command_handler(proto, MEMORY, "getChildren", command_get_children);
     add_command_handler(proto, MEMORY, "set", command_set);
@@ -110,14 +110,49 @@ struct PathMapRule {
     char * ctx;
 };
 
+/* Node of the trie of canonic rule source prefixes */
+typedef struct PathMapNode {
+    unsigned child;     /* First child node index, 0 if none */
+    unsigned sibling;   /* Next sibling node index, 0 if none */
+    int rule;           /* First rule that has source ending at this node, -1 if none */
+    char ch;
+} PathMapNode;
+
 struct PathMap {
     LINK maps;
     Channel * channel;
     PathMapRule * rules;
     unsigned rules_cnt;
     unsigned rules_max;
+
+    /* Rules compiled into a prefix trie, rebuilt after the rules are changed */
+    int compiled;
+    int ctx_rules;      /* Some rules depend on the context */
+    PathMapNode * nodes;
+    unsigned nodes_cnt;
+    unsigned nodes_max;
+    int * rules_next;   /* Next rule with same source, in rule order */
 };
 
+/* Rule which source is a prefix of the file name */
+typedef struct PathMapMatch {
+    unsigned rule;
+    unsigned len;
+} PathMapMatch;
+
+/* Memoized result of apply_path_map() */
+typedef struct PathMapCacheEntry {
+    struct PathMapCacheEntry * next;
+    Channel * channel;
+    Context * ctx;
+    int mode;
+    char * dst;         /* NULL if the file name is not mapped */
+    char src[1];
+} PathMapCacheEntry;
+
+#define CACHE_HASH_SIZE 1021
+#define CACHE_MAX_SIZE 0x4000
+
 #define maps2map(x) ((PathMap *)((char *)(x) - offsetof(PathMap, maps)))
 
 static const char PATH_MAP[] = "PathMap";
@@ -131,6 +166,99 @@ static unsigned listener_max = 0;
 
 static TCFBroadcastGroup * broadcast_group = NULL;
 
+static PathMapCacheEntry * cache_hash[CACHE_HASH_SIZE];
+static unsigned cache_cnt = 0;
+static unsigned cache_ctx_cnt = 0;
+
+static void remove_cache_entry(PathMapCacheEntry ** ref) {
+    PathMapCacheEntry * e = *ref;
+    *ref = e->next;
+    if (e->ctx != NULL) cache_ctx_cnt--;
+    cache_cnt--;
+    loc_free(e->dst);
+    loc_free(e);
+}
+
+static void flush_cache(int ctx_only) {
+    unsigned i;
+    if (ctx_only && cache_ctx_cnt == 0) return;
+    for (i = 0; i < CACHE_HASH_SIZE; i++) {
+        PathMapCacheEntry ** ref = cache_hash + i;
+        while (*ref != NULL) {
+            if (ctx_only && (*ref)->ctx == NULL) {
+                ref = &(*ref)->next;
+                continue;
+            }
+            remove_cache_entry(ref);
+        }
+    }
+    assert(cache_ctx_cnt == 0);
+    assert(ctx_only || cache_cnt == 0);
+}
+
+/* Entries are keyed by channel pointer, they must not outlive the channel */
+static void flush_channel_cache(Channel * c) {
+    unsigned i;
+    if (cache_cnt == 0) return;
+    for (i = 0; i < CACHE_HASH_SIZE; i++) {
+        PathMapCacheEntry ** ref = cache_hash + i;
+        while (*ref != NULL) {
+            if ((*ref)->channel != c) {
+                ref = &(*ref)->next;
+                continue;
+            }
+            remove_cache_entry(ref);
+        }
+    }
+}
+
+static unsigned calc_cache_hash(Channel * c, Context * ctx, int mode, const char * fnm) {
+    unsigned h = (unsigned)(((uintptr_t)c >> 4) + ((uintptr_t)ctx >> 4) * 31 + mode);
+    while (*fnm) h = h * 31 + (unsigned char)*fnm++;
+    return h % CACHE_HASH_SIZE;
+}
+
+static PathMapCacheEntry * find_cache_entry(Channel * c, Context * ctx, int mode, const char * fnm) {
+    PathMapCacheEntry * e = cache_hash[calc_cache_hash(c, ctx, mode, fnm)];
+    while (e != NULL) {
+        if (e->channel == c && e->ctx == ctx && e->mode == mode && strcmp(e->src, fnm) == 0) return e;
+        e = e->next;
+    }
+    return NULL;
+}
+
+static void add_cache_entry(Channel * c, Context * ctx, int mode, const char * fnm, const char * dst) {
+    size_t len = strlen(fnm);
+    PathMapCacheEntry * e = NULL;
+    unsigned h = calc_cache_hash(c, ctx, mode, fnm);
+    if (cache_cnt >= CACHE_MAX_SIZE) flush_cache(0);
+    e = (PathMapCacheEntry *)loc_alloc(sizeof(PathMapCacheEntry) + len);
+    e->channel = c;
+    e->ctx = ctx;
+    e->mode = mode;
+    e->dst = dst ? loc_strdup(dst) : NULL;
+    memcpy(e->src, fnm, len + 1);
+    e->next = cache_hash[h];
+    cache_hash[h] = e;
+    if (ctx != NULL) cache_ctx_cnt++;
+    cache_cnt++;
+}
+
+/* Must be called after any change of path map rules */
+static void invalidate_path_maps(void) {
+    LINK * l;
+    for (l = maps.next; l != &maps; l = l->next) {
+        PathMap * m = maps2map(l);
+        m->compiled = 0;
+    }
+    flush_cache(0);
+}
+
+static void context_changed(Context * ctx, void * args) {
+    /* Context query and name based rules might give different results now */
+    flush_cache(1);
+}
+
 static void event_path_map_changed(void) {
     OutputStream * out = &broadcast_group->out;
 
@@ -215,6 +343,13 @@ static void free_rule(PathMapRule * r) {
     memset(r, 0, sizeof(PathMapRule));
 }
 
+static void free_map(PathMap * m) {
+    loc_free(m->rules);
+    loc_free(m->nodes);
+    loc_free(m->rules_next);
+    loc_free(m);
+}
+
 static int update_rule(PathMapRule * r, PathMapRuleAttribute * new_attrs) {
     int diff = 0;
     PathMapRuleAttribute * old_attrs = r->attrs;
@@ -324,45 +459,125 @@ static int update_rule(PathMapRule * r, PathMapRuleAttribute * new_attrs) {
     return diff;
 }
 
-static char * map_file_name(Context * ctx, PathMap * m, char * fnm, int mode) {
-    unsigned i, k;
+static unsigned get_trie_child(PathMap * m, unsigned n, char ch) {
+    unsigned c = m->nodes[n].child;
+    while (c != 0) {
+        if (m->nodes[c].ch == ch) return c;
+        c = m->nodes[c].sibling;
+    }
+    if (m->nodes_cnt >= m->nodes_max) {
+        m->nodes_max *= 2;
+        m->nodes = (PathMapNode *)loc_realloc(m->nodes, sizeof(PathMapNode) * m->nodes_max);
+    }
+    c = m->nodes_cnt++;
+    m->nodes[c].child = 0;
+    m->nodes[c].sibling = m->nodes[n].child;
+    m->nodes[c].rule = -1;
+    m->nodes[c].ch = ch;
+    m->nodes[n].child = c;
+    return c;
+}
 
+static void compile_map(PathMap * m) {
+    unsigned i;
+    if (m->nodes_max == 0) {
+        m->nodes_max = 64;
+        m->nodes = (PathMapNode *)loc_alloc(sizeof(PathMapNode) * m->nodes_max);
+    }
+    memset(m->nodes, 0, sizeof(PathMapNode));
+    m->nodes[0].rule = -1;
+    m->nodes_cnt = 1;
+    m->rules_next = (int *)loc_realloc(m->rules_next, sizeof(int) * (m->rules_cnt + 1));
+    m->ctx_rules = 0;
     for (i = 0; i < m->rules_cnt; i++) {
         PathMapRule * r = m->rules + i;
+        unsigned n = 0;
+        int * ref = NULL;
         char * src;
-        char * buf;
-        struct stat st;
+        m->rules_next[i] = -1;
         if (r->src == NULL) continue;
         if (r->dst == NULL) continue;
         if (r->prot != NULL && strcasecmp(r->prot, "file")) continue;
-        switch (mode) {
-        case PATH_MAP_TO_LOCAL:
-            if (r->host != NULL && !is_my_host(r->host)) continue;
-            break;
-        }
-        if (r->ctx != NULL) {
-            int ok = 0;
+        if (r->ctx != NULL || r->query != NULL) m->ctx_rules = 1;
+        src = canonic_path_map_file_name(r->src);
+        while (*src) n = get_trie_child(m, n, *src++);
+        ref = &m->nodes[n].rule;
+        while (*ref >= 0) ref = m->rules_next + *ref;
+        *ref = (int)i;
+    }
+    m->compiled = 1;
+}
+
+static int map_rule_context(Context * ctx, PathMapRule * r) {
+    if (r->ctx != NULL) {
+        int ok = 0;
 #if ENABLE_DebugContext
-            if (ctx != NULL) {
-                Context * syms = context_get_group(ctx, CONTEXT_GROUP_SYMBOLS);
-                if (syms != NULL) {
-                    ok = strcmp(r->ctx, syms->id) == 0;
-                    if (!ok && syms->name != NULL) {
-                        ok = strcmp(r->ctx, syms->name) == 0;
-                        if (!ok) ok = strcmp(r->ctx, context_full_name(syms)) == 0;
-                    }
+        if (ctx != NULL) {
+            Context * syms = context_get_group(ctx, CONTEXT_GROUP_SYMBOLS);
+            if (syms != NULL) {
+                ok = strcmp(r->ctx, syms->id) == 0;
+                if (!ok && syms->name != NULL) {
+                    ok = strcmp(r->ctx, syms->name) == 0;
+                    if (!ok) ok = strcmp(r->ctx, context_full_name(syms)) == 0;
                 }
             }
+        }
 #endif
-            if (!ok) continue;
+        if (!ok) return 0;
+    }
+    if (r->query != NULL) {
+        if (ctx == NULL) return 0;
+        if (!context_query(ctx, r->query)) return 0;
+    }
+    return 1;
+}
+
+/* Set '*fs_dep' if the result depends on file system state */
+static char * map_file_name(Context * ctx, PathMap * m, char * fnm, int mode, int * fs_dep) {
+    unsigned i, k;
+    unsigned n = 0;
+    PathMapMatch * match = NULL;
+    unsigned match_cnt = 0;
+    unsigned match_max = 0;
+    char * p = fnm;
+
+    /* Collect rules with source being a prefix of the file name, sorted in rule order */
+    assert(m->compiled);
+    for (;;) {
+        int rule = m->nodes[n].rule;
+        while (rule >= 0) {
+            unsigned j = match_cnt;
+            if (match_cnt >= match_max) {
+                match_max = match_max ? match_max * 2 : 8;
+                match = (PathMapMatch *)tmp_realloc(match, sizeof(PathMapMatch) * match_max);
+            }
+            while (j > 0 && match[j - 1].rule > (unsigned)rule) {
+                match[j] = match[j - 1];
+                j--;
+            }
+            match[j].rule = (unsigned)rule;
+            match[j].len = (unsigned)(p - fnm);
+            match_cnt++;
+            rule = m->rules_next[rule];
         }
-        if (r->query != NULL) {
-            if (ctx == NULL) continue;
-            if (!context_query(ctx, r->query)) continue;
+        if (*p == 0) break;
+        n = m->nodes[n].child;
+        while (n != 0 && m->nodes[n].ch != *p) n = m->nodes[n].sibling;
+        if (n == 0) break;
+        p++;
+    }
+
+    for (i = 0; i < match_cnt; i++) {
+        PathMapRule * r = m->rules + match[i].rule;
+        char * buf;
+        struct stat st;
+        switch (mode) {
+        case PATH_MAP_TO_LOCAL:
+            if (r->host != NULL && !is_my_host(r->host)) continue;
+            break;
         }
-        src = canonic_path_map_file_name(r->src);
-        k = (unsigned)strlen(src);
-        if (strncmp(src, fnm, k)) continue;
+        if (!map_rule_context(ctx, r)) continue;
+        k = match[i].len;
 
         if (fnm[k] == 0) {
             /* perfect match */
@@ -388,7 +603,9 @@ static char * map_file_name(Context * ctx, PathMap * m, char * fnm, int mode) {
             buf = tmp_strdup2(r->dst, fnm + k);
         }
 
-        if (mode != PATH_MAP_TO_LOCAL || stat(buf, &st) == 0) return buf;
+        if (mode != PATH_MAP_TO_LOCAL) return buf;
+        *fs_dep = 1;
+        if (stat(buf, &st) == 0) return buf;
     }
 
     return fnm;
@@ -396,14 +613,20 @@ static char * map_file_name(Context * ctx, PathMap * m, char * fnm, int mode) {
 
 char * apply_path_map(Channel * c, Context * ctx, char * fnm, int mode) {
     char * cnm = canonic_path_map_file_name(fnm);
+    PathMap * list[2];
+    PathMap ** lst = list;
+    unsigned cnt = 0;
+    unsigned i;
+    int ctx_dep = 0;
+    int fs_dep = 0;
+    PathMapCacheEntry * e = NULL;
+
     if (c == NULL) {
-        LINK * l = maps.next;
-        while (l != &maps) {
-            PathMap * m = maps2map(l);
-            char * lnm = map_file_name(ctx, m, cnm, mode);
-            if (lnm != cnm) return lnm;
-            l = l->next;
-        }
+        LINK * l;
+        for (l = maps.next; l != &maps; l = l->next) cnt++;
+        if (cnt > 2) lst = (PathMap **)tmp_alloc(sizeof(PathMap *) * cnt);
+        cnt = 0;
+        for (l = maps.next; l != &maps; l = l->next) lst[cnt++] = maps2map(l);
     }
     else {
         PathMap * m;
@@ -411,18 +634,31 @@ char * apply_path_map(Channel * c, Context * ctx, char * fnm, int mode) {
         Channel * h = proxy_get_host_channel(c);
         if (h != NULL) {
             m = find_map(h);
-            if (m != NULL) {
-                char * lnm = map_file_name(ctx, m, cnm, mode);
-                if (lnm != cnm) return lnm;
-            }
+            if (m != NULL) lst[cnt++] = m;
         }
 #endif
         m = find_map(c);
-        if (m != NULL) {
-            char * lnm = map_file_name(ctx, m, cnm, mode);
-            if (lnm != cnm) return lnm;
+        if (m != NULL) lst[cnt++] = m;
+    }
+    if (cnt == 0) return fnm;
+
+    for (i = 0; i < cnt; i++) {
+        if (!lst[i]->compiled) compile_map(lst[i]);
+        if (lst[i]->ctx_rules) ctx_dep = 1;
+    }
+    if (!ctx_dep) ctx = NULL;
+
+    e = find_cache_entry(c, ctx, mode, cnm);
+    if (e != NULL) return e->dst != NULL ? tmp_strdup(e->dst) : fnm;
+
+    for (i = 0; i < cnt; i++) {
+        char * lnm = map_file_name(ctx, lst[i], cnm, mode, &fs_dep);
+        if (lnm != cnm) {
+            if (!fs_dep) add_cache_entry(c, ctx, mode, cnm, lnm);
+            return lnm;
         }
     }
+    if (!fs_dep) add_cache_entry(c, ctx, mode, cnm, NULL);
     return fnm;
 }
 
@@ -455,12 +691,16 @@ PathMapRule * create_path_mapping(PathMapRuleAttribute * attrs) {
 
     r = m->rules + m->rules_cnt++;
     memset(r, 0, sizeof(*r));
+    invalidate_path_maps();
     if (update_rule(r, attrs)) path_map_event_mapping_changed(NULL);
     return r;
 }
 
 void change_path_mapping_attributes(PathMapRule * r, PathMapRuleAttribute * attrs) {
-    if (update_rule(r, attrs)) path_map_event_mapping_changed(NULL);
+    if (update_rule(r, attrs)) {
+        invalidate_path_maps();
+        path_map_event_mapping_changed(NULL);
+    }
 }
 
 void delete_path_mapping(PathMapRule * r) {
@@ -471,6 +711,7 @@ void delete_path_mapping(PathMapRule * r) {
             free_rule(r);
             memmove(r, r + 1, (m->rules_cnt - (r - m->rules) - 1) * sizeof(PathMapRule));
             m->rules_cnt--;
+            invalidate_path_maps();
             path_map_event_mapping_changed(NULL);
             break;
         }
@@ -487,6 +728,7 @@ void delete_all_path_mappings(void) {
                 free_rule(m->rules + i);
             }
             m->rules_cnt = 0;
+            invalidate_path_maps();
             path_map_event_mapping_changed(NULL);
             break;
         }
@@ -570,13 +812,15 @@ void set_path_map(Channel * c, InputStream * inp) {
         s.map->rules_cnt = s.cnt;
         if (s.cnt == 0) {
             list_remove(&s.map->maps);
-            loc_free(s.map->rules);
-            loc_free(s.map);
+            free_map(s.map);
             s.map = NULL;
         }
         s.diff = 1;
     }
-    if (s.diff) path_map_event_mapping_changed(c);
+    if (s.diff) {
+        invalidate_path_maps();
+        path_map_event_mapping_changed(c);
+    }
 }
 
 static void command_get(char * token, Channel * c) {
@@ -619,22 +863,27 @@ static void command_set(char * token, Channel * c) {
 static void channel_close_listener(Channel * c) {
     unsigned i;
     PathMap * m;
+    flush_channel_cache(c);
     /* Keep path map over channel redirection */
     if (c->state == ChannelStateHelloReceived) return;
     m = find_map(c);
     if (m == NULL) return;
     list_remove(&m->maps);
+    invalidate_path_maps();
     if (m->rules_cnt > 0) path_map_event_mapping_changed(c);
     for (i = 0; i < m->rules_cnt; i++) free_rule(m->rules + i);
-    loc_free(m->rules);
-    loc_free(m);
+    free_map(m);
 }
 
 void ini_path_map_service(Protocol * proto, TCFBroadcastGroup * bcg) {
     static int ini_done = 0;
     if (!ini_done) {
+        static ContextEventListener listener = {
+            NULL, NULL, NULL, NULL, context_changed, context_changed
+        };
         ini_done = 1;
         add_channel_close_listener(channel_close_listener);
+        add_context_event_listener(&listener, NULL);
         broadcast_group = bcg;
     }
     assert(broadcast_group == bcg);
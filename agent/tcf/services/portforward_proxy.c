@@ -29,6 +29,7 @@
 #include <tcf/framework/channel.h>
 #include <tcf/framework/mdep-inet.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
 #include <tcf/framework/trace.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/services/streamsservice.h>
@@ -547,6 +548,7 @@ static int port_connection_unbind(PortConnection * conn) {
      * will be closed when the server is closed. */
     if (conn->fd != -1 && conn->server->is_udp == 0) {
         shutdown(conn->fd, SHUT_RDWR);
+        reactor_close(conn->fd);
         closesocket(conn->fd);
     }
     conn->fd = -1;
@@ -799,6 +801,7 @@ static void port_server_shutdown(PortServer * server) {
     /* It seems we need to use shutdown to unblock threads blocked on recv/send */
     if (server->sock != -1) {
         shutdown(server->sock, SHUT_RDWR);
+        reactor_close(server->sock);
         if (closesocket(server->sock) == -1) perror("closesocket");
         server->sock = -1;
         list_remove(&server->link);
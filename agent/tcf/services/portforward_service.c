@@ -34,6 +34,7 @@
 #include <tcf/framework/trace.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
 #include <tcf/services/streamsservice.h>
 
 #if SERVICE_PortForward
@@ -472,6 +473,7 @@ static void disconnect_port(PortFwConfig * config) {
     if (config->port_info.sock != -1) {
         /* It seems we need to use shutdown to unblock threads blocked on recv/send */
         if (config->connected) shutdown(config->port_info.sock, SHUT_RDWR);
+        reactor_close(config->port_info.sock);
         if (closesocket(config->port_info.sock) == -1) perror ("closesocket");
         config->port_info.sock = -1;
         if (config->verbose) fprintf(stderr, "Connection with %s closed\n", config->port_config);
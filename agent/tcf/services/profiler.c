@@ -168,9 +168,23 @@ static void read_cfg_param(InputStream * inp, const char * name, void * x) {
         inp = create_byte_array_input_stream(&buf, p->value, strlen(p->value));
         cfg->params.max_samples = json_read_ulong(inp);
     }
+    else if (strcmp(name, "SampleFreq") == 0) {
+        inp = create_byte_array_input_stream(&buf, p->value, strlen(p->value));
+        cfg->params.sample_freq = json_read_ulong(inp);
+    }
+    else if (strcmp(name, "Sampler") == 0) {
+        inp = create_byte_array_input_stream(&buf, p->value, strlen(p->value));
+        cfg->params.sampler = json_read_alloc_string(inp);
+    }
+    else if (strcmp(name, "Incremental") == 0) {
+        inp = create_byte_array_input_stream(&buf, p->value, strlen(p->value));
+        cfg->params.incremental = json_read_boolean(inp);
+    }
 }
 
 static void free_params(ProfilerParams * params) {
+    loc_free(params->sampler);
+    params->sampler = NULL;
     while (params->list != NULL) {
         ProfilerParameter * p = params->list;
         params->list = p->next;
@@ -36,6 +36,9 @@ typedef struct ProfilerParams {
     Channel * channel;
     unsigned frame_cnt;     /* Value of FrameCnt parameter */
     unsigned max_samples;   /* Value of MaxSamples parameter */
+    unsigned sample_freq;   /* Value of SampleFreq parameter, samples per second, 0 - default */
+    char * sampler;         /* Value of Sampler parameter, NULL - default */
+    int incremental;        /* Value of Incremental parameter */
     ProfilerParameter * list; /* List of all parameters */
 } ProfilerParams;
 
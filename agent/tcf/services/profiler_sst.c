@@ -21,6 +21,7 @@
 #if ENABLE_ProfilerSST
 
 #include <assert.h>
+#include <stdlib.h>
 #include <tcf/framework/link.h>
 #include <tcf/framework/json.h>
 #include <tcf/framework/cache.h>
@@ -31,7 +32,8 @@
 #include <tcf/services/profiler_sst.h>
 
 typedef struct SampleStackTrace {
-    struct SampleStackTrace * next;
+    unsigned id;
+    unsigned hash;
     unsigned len;
     ContextAddress pc[1];
 } SampleStackTrace;
@@ -40,25 +42,37 @@ typedef struct {
     ContextAddress pc;
     SampleStackTrace * stk;
     unsigned cnt;
+    unsigned used;
 } ProfilerSample;
 
-typedef struct {
-    ProfilerSample * buf;
-    unsigned buf_pos;
-    unsigned buf_max;
-} ProfilerSampleArray;
-
-#define PSAMPLE_HASH_SIZE 511
-#define STRACE_HASH_SIZE 511
+#define PSAMPLE_TABLE_MIN   0x100
+#define STRACE_TABLE_MIN    0x100
+/* In incremental mode, stack traces are kept until the table reaches this size */
+#define PROFILER_TABLE_MAX  0x40000
+
+struct ProfilerSamples {
+    int incremental;
+    /* Open addressing table of (pc, stack trace) samples */
+    ProfilerSample * samples;
+    unsigned samples_size;
+    unsigned samples_cnt;
+    /* Stack traces by id, and open addressing table of stack trace ids + 1 */
+    SampleStackTrace ** stacks;
+    unsigned stacks_cnt;
+    unsigned stacks_max;
+    unsigned * stacks_index;
+    unsigned stacks_index_size;
+    /* Number of stack traces already sent to the client */
+    unsigned stacks_sent;
+    int reset;
+};
 
 typedef struct ProfilerSST {
     LINK link_core;
     Context * ctx;
     Channel * channel;
     unsigned frame_cnt;
-    ProfilerSampleArray psample_hash[PSAMPLE_HASH_SIZE];
-    unsigned psample_cnt;
-    SampleStackTrace * strace_hash[STRACE_HASH_SIZE];
+    ProfilerSamples * samples;
     int stop_pending;
     ContextAddress pc;
     int disposed;
@@ -102,54 +116,343 @@ static void get_stack_trace(ProfilerSST * prf) {
     }
 }
 
-static SampleStackTrace * find_stack_trace(ProfilerSST * prf) {
-    SampleStackTrace * stk = NULL;
-    if (stk_buf_pos > 0) {
-        unsigned i = 0;
+static unsigned hash_stack(ContextAddress * stk, unsigned len) {
+    unsigned i;
+    uint64_t h = len;
+    for (i = 0; i < len; i++) {
+        h = (h ^ (uint64_t)stk[i]) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    return (unsigned)h;
+}
+
+static unsigned hash_sample(ContextAddress pc, SampleStackTrace * stk) {
+    uint64_t h = ((uint64_t)pc ^ (stk != NULL ? (uint64_t)stk->hash << 20 : 0)) * 0x9e3779b97f4a7c15ull;
+    return (unsigned)(h >> 32);
+}
+
+static void rehash_stacks(ProfilerSamples * ps, unsigned size) {
+    unsigned i;
+    unsigned mask = size - 1;
+    loc_free(ps->stacks_index);
+    ps->stacks_index = (unsigned *)loc_alloc_zero(sizeof(unsigned) * size);
+    ps->stacks_index_size = size;
+    for (i = 0; i < ps->stacks_cnt; i++) {
+        unsigned h = ps->stacks[i]->hash & mask;
+        while (ps->stacks_index[h] != 0) h = (h + 1) & mask;
+        ps->stacks_index[h] = i + 1;
+    }
+}
+
+static void rehash_samples(ProfilerSamples * ps, unsigned size) {
+    unsigned i;
+    unsigned mask = size - 1;
+    ProfilerSample * old = ps->samples;
+    unsigned old_size = ps->samples_size;
+    ps->samples = (ProfilerSample *)loc_alloc_zero(sizeof(ProfilerSample) * size);
+    ps->samples_size = size;
+    for (i = 0; i < old_size; i++) {
+        ProfilerSample * s = old + i;
+        if (s->used) {
+            unsigned h = hash_sample(s->pc, s->stk) & mask;
+            while (ps->samples[h].used) h = (h + 1) & mask;
+            ps->samples[h] = *s;
+        }
+    }
+    loc_free(old);
+}
+
+static SampleStackTrace * find_stack_trace(ProfilerSamples * ps, ContextAddress * stk, unsigned len) {
+    SampleStackTrace * trace = NULL;
+    if (len > 0) {
+        unsigned hash = hash_stack(stk, len);
+        unsigned mask = 0;
         unsigned h = 0;
-        for (i = 0; i < stk_buf_pos; i++) {
-            h = (h + (unsigned)(stk_buf[i] >> 4)) % STRACE_HASH_SIZE;
+        if ((ps->stacks_cnt + 1) * 2 > ps->stacks_index_size) {
+            rehash_stacks(ps, ps->stacks_index_size ? ps->stacks_index_size * 2 : STRACE_TABLE_MIN);
         }
-        stk = prf->strace_hash[h];
-        while (stk != NULL) {
-            if (stk->len == stk_buf_pos && memcmp(stk->pc, stk_buf, stk_buf_pos * sizeof(ContextAddress)) == 0) {
-                return stk;
+        mask = ps->stacks_index_size - 1;
+        h = hash & mask;
+        while (ps->stacks_index[h] != 0) {
+            trace = ps->stacks[ps->stacks_index[h] - 1];
+            if (trace->hash == hash && trace->len == len && memcmp(trace->pc, stk, len * sizeof(ContextAddress)) == 0) {
+                return trace;
             }
-            stk = stk->next;
+            h = (h + 1) & mask;
+        }
+        trace = (SampleStackTrace *)loc_alloc(sizeof(SampleStackTrace) + sizeof(ContextAddress) * (len - 1));
+        memcpy(trace->pc, stk, len * sizeof(ContextAddress));
+        trace->len = len;
+        trace->hash = hash;
+        trace->id = ps->stacks_cnt;
+        if (ps->stacks_cnt >= ps->stacks_max) {
+            ps->stacks_max = ps->stacks_max ? ps->stacks_max * 2 : STRACE_TABLE_MIN;
+            ps->stacks = (SampleStackTrace **)loc_realloc(ps->stacks, sizeof(SampleStackTrace *) * ps->stacks_max);
         }
-        stk = (SampleStackTrace *)loc_alloc_zero(sizeof(SampleStackTrace) + sizeof(ContextAddress) * (stk_buf_pos - 1));
-        memcpy(stk->pc, stk_buf, stk_buf_pos * sizeof(ContextAddress));
-        stk->next = prf->strace_hash[h];
-        prf->strace_hash[h] = stk;
-        stk->len = stk_buf_pos;
+        ps->stacks[ps->stacks_cnt++] = trace;
+        ps->stacks_index[h] = ps->stacks_cnt;
     }
-    return stk;
+    return trace;
 }
 
-static void add_to_sample_array(ProfilerSST * prf, ContextAddress pc, SampleStackTrace * stk) {
-    unsigned i;
-    unsigned h = (unsigned)(pc >> 4) % PSAMPLE_HASH_SIZE;
-    ProfilerSampleArray * a = prf->psample_hash + h;
+static void add_to_sample_array(ProfilerSamples * ps, ContextAddress pc, SampleStackTrace * stk) {
+    unsigned mask = 0;
+    unsigned h = 0;
     ProfilerSample * s = NULL;
-    for (i = 0; i < a->buf_pos; i++) {
-        ProfilerSample * p = a->buf + i;
-        if (p->pc == pc && p->stk == stk) {
-            s = p;
+    if ((ps->samples_cnt + 1) * 2 > ps->samples_size) {
+        rehash_samples(ps, ps->samples_size ? ps->samples_size * 2 : PSAMPLE_TABLE_MIN);
+    }
+    mask = ps->samples_size - 1;
+    h = hash_sample(pc, stk) & mask;
+    for (;;) {
+        s = ps->samples + h;
+        if (!s->used) break;
+        if (s->pc == pc && s->stk == stk) {
+            s->cnt++;
+            return;
+        }
+        h = (h + 1) & mask;
+    }
+    s->used = 1;
+    s->pc = pc;
+    s->stk = stk;
+    s->cnt = 1;
+    ps->samples_cnt++;
+}
+
+ProfilerSamples * profiler_samples_create(int incremental) {
+    ProfilerSamples * ps = (ProfilerSamples *)loc_alloc_zero(sizeof(ProfilerSamples));
+    ps->incremental = incremental;
+    return ps;
+}
+
+void profiler_samples_add(ProfilerSamples * ps, ContextAddress pc, ContextAddress * stk, unsigned len) {
+    add_to_sample_array(ps, pc, find_stack_trace(ps, stk, len));
+}
+
+void profiler_samples_clear(ProfilerSamples * ps) {
+    unsigned i;
+    loc_free(ps->samples);
+    ps->samples = NULL;
+    ps->samples_size = 0;
+    ps->samples_cnt = 0;
+    for (i = 0; i < ps->stacks_cnt; i++) loc_free(ps->stacks[i]);
+    loc_free(ps->stacks);
+    ps->stacks = NULL;
+    ps->stacks_cnt = 0;
+    ps->stacks_max = 0;
+    loc_free(ps->stacks_index);
+    ps->stacks_index = NULL;
+    ps->stacks_index_size = 0;
+    if (ps->stacks_sent > 0) ps->reset = 1;
+    ps->stacks_sent = 0;
+}
+
+void profiler_samples_dispose(ProfilerSamples * ps) {
+    profiler_samples_clear(ps);
+    loc_free(ps);
+}
+
+static void add_num(uint8_t * buf, unsigned * pos, unsigned size, ContextAddress v) {
+    unsigned n;
+    for (n = 0; n < size; n++) {
+        buf[(*pos)++] = (uint8_t)(v >> (n * 8));
+    }
+}
+
+static void add_uleb(uint8_t * buf, unsigned * pos, uint64_t v) {
+    for (;;) {
+        uint8_t b = (uint8_t)(v & 0x7f);
+        v >>= 7;
+        if (v == 0) {
+            buf[(*pos)++] = b;
             break;
         }
+        buf[(*pos)++] = b | 0x80;
+    }
+}
+
+static void add_sleb(uint8_t * buf, unsigned * pos, int64_t v) {
+    /* Zigzag encoding */
+    add_uleb(buf, pos, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static unsigned uleb_size(uint64_t v) {
+    unsigned n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static unsigned sleb_size(int64_t v) {
+    return uleb_size(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static int cmp_samples(const void * x, const void * y) {
+    ProfilerSample * a = *(ProfilerSample **)x;
+    ProfilerSample * b = *(ProfilerSample **)y;
+    unsigned ia = a->stk ? a->stk->id + 1 : 0;
+    unsigned ib = b->stk ? b->stk->id + 1 : 0;
+    if (a->pc != b->pc) return a->pc < b->pc ? -1 : 1;
+    if (ia != ib) return ia < ib ? -1 : 1;
+    return 0;
+}
+
+static void write_samples_full(ProfilerSamples * ps, RegisterDefinition * pc_def, OutputStream * out) {
+    unsigned i;
+    unsigned buf_max = 3;
+    unsigned data_cnt = 0;
+    uint8_t * buf = NULL;
+    JsonWriteBinaryState state;
+
+    /* A sample is count, number of PCs, PC, then the stack trace */
+    for (i = 0; i < ps->stacks_cnt; i++) {
+        if (ps->stacks[i]->len + 3 > buf_max) buf_max = ps->stacks[i]->len + 3;
+    }
+    for (i = 0; i < ps->samples_size; i++) {
+        ProfilerSample * s = ps->samples + i;
+        if (s->used) data_cnt += 3 + (s->stk != NULL ? s->stk->len : 0);
     }
-    if (s == NULL) {
-        if (a->buf_pos >= a->buf_max) {
-            a->buf = (ProfilerSample *)loc_realloc(a->buf, sizeof(ProfilerSample) * (a->buf_max += 64));
+    buf = (uint8_t *)tmp_alloc(pc_def->size * buf_max);
+    write_stream(out, ',');
+    json_write_string(out, "Data");
+    write_stream(out, ':');
+    json_write_binary_start(&state, out, data_cnt * pc_def->size);
+    for (i = 0; i < ps->samples_size; i++) {
+        unsigned p = 0;
+        unsigned n = 1;
+        unsigned m = 1;
+        ProfilerSample * s = ps->samples + i;
+        if (!s->used) continue;
+        add_num(buf, &p, pc_def->size, s->cnt);
+        if (s->stk != NULL) m += s->stk->len;
+        add_num(buf, &p, pc_def->size, m);
+        add_num(buf, &p, pc_def->size, s->pc);
+        while (n < m) {
+            add_num(buf, &p, pc_def->size, s->stk->pc[n++ - 1]);
         }
-        s = a->buf + a->buf_pos++;
-        prf->psample_cnt += 3;
-        if (stk != NULL) prf->psample_cnt += stk->len;
-        s->pc = pc;
-        s->stk = stk;
-        s->cnt = 0;
+        assert(p <= pc_def->size * buf_max);
+        json_write_binary_data(&state, buf, p);
     }
-    s->cnt++;
+    json_write_binary_end(&state);
+}
+
+static void write_samples_delta(ProfilerSamples * ps, OutputStream * out) {
+    unsigned i, j;
+    unsigned cnt = 0;
+    size_t size = 0;
+    unsigned buf_max = 10 * 3;
+    uint8_t * buf = NULL;
+    ProfilerSample ** arr = NULL;
+    ContextAddress prev = 0;
+    JsonWriteBinaryState state;
+
+    if (ps->reset) {
+        write_stream(out, ',');
+        json_write_string(out, "Reset");
+        write_stream(out, ':');
+        json_write_boolean(out, 1);
+        ps->reset = 0;
+    }
+
+    /* New stack traces: length, then PCs, each PC is delta from previous PC in the trace.
+     * Encoded size is computed first, so ZeroCopy channels can send the data as binary. */
+    for (i = ps->stacks_sent; i < ps->stacks_cnt; i++) {
+        SampleStackTrace * stk = ps->stacks[i];
+        if ((stk->len + 1) * 10 > buf_max) buf_max = (stk->len + 1) * 10;
+        size += uleb_size(stk->len);
+        prev = 0;
+        for (j = 0; j < stk->len; j++) {
+            size += sleb_size((int64_t)(stk->pc[j] - prev));
+            prev = stk->pc[j];
+        }
+    }
+    buf = (uint8_t *)tmp_alloc(buf_max);
+    if (ps->stacks_sent < ps->stacks_cnt) {
+        write_stream(out, ',');
+        json_write_string(out, "Stacks");
+        write_stream(out, ':');
+        json_write_binary_start(&state, out, size);
+        for (i = ps->stacks_sent; i < ps->stacks_cnt; i++) {
+            SampleStackTrace * stk = ps->stacks[i];
+            unsigned p = 0;
+            add_uleb(buf, &p, stk->len);
+            prev = 0;
+            for (j = 0; j < stk->len; j++) {
+                add_sleb(buf, &p, (int64_t)(stk->pc[j] - prev));
+                prev = stk->pc[j];
+            }
+            assert(p <= buf_max);
+            json_write_binary_data(&state, buf, p);
+        }
+        json_write_binary_end(&state);
+        ps->stacks_sent = ps->stacks_cnt;
+    }
+
+    /* Changed samples, sorted by PC: PC delta, stack trace id + 1 (0 - none), count */
+    arr = (ProfilerSample **)tmp_alloc(sizeof(ProfilerSample *) * (ps->samples_cnt + 1));
+    for (i = 0; i < ps->samples_size; i++) {
+        ProfilerSample * s = ps->samples + i;
+        if (s->used) arr[cnt++] = s;
+    }
+    if (cnt > 0) {
+        qsort(arr, cnt, sizeof(ProfilerSample *), cmp_samples);
+        size = 0;
+        prev = 0;
+        for (i = 0; i < cnt; i++) {
+            ProfilerSample * s = arr[i];
+            size += sleb_size((int64_t)(s->pc - prev));
+            size += uleb_size(s->stk != NULL ? s->stk->id + 1 : 0);
+            size += uleb_size(s->cnt);
+            prev = s->pc;
+        }
+        write_stream(out, ',');
+        json_write_string(out, "Data");
+        write_stream(out, ':');
+        json_write_binary_start(&state, out, size);
+        prev = 0;
+        for (i = 0; i < cnt; i++) {
+            ProfilerSample * s = arr[i];
+            unsigned p = 0;
+            add_sleb(buf, &p, (int64_t)(s->pc - prev));
+            add_uleb(buf, &p, s->stk != NULL ? s->stk->id + 1 : 0);
+            add_uleb(buf, &p, s->cnt);
+            assert(p <= buf_max);
+            json_write_binary_data(&state, buf, p);
+            prev = s->pc;
+        }
+        json_write_binary_end(&state);
+        /* All samples are sent, drop them instead of keeping entries with zero count */
+        memset(ps->samples, 0, sizeof(ProfilerSample) * ps->samples_size);
+        ps->samples_cnt = 0;
+    }
+}
+
+void profiler_samples_write(ProfilerSamples * ps, Context * ctx, OutputStream * out) {
+    RegisterDefinition * pc_def = get_PC_definition(ctx);
+
+    json_write_string(out, "Format");
+    write_stream(out, ':');
+    json_write_string(out, ps->incremental ? "StackTracesDelta" : "StackTraces");
+    if (pc_def != NULL && (ps->incremental || ps->samples_cnt > 0)) {
+        assert(pc_def->size <= sizeof(ContextAddress));
+        write_stream(out, ',');
+        json_write_string(out, "AddrSize");
+        write_stream(out, ':');
+        json_write_long(out, pc_def->size);
+        if (ps->incremental) {
+            write_samples_delta(ps, out);
+            /* Bound memory used by the tables, the client is notified by "Reset" */
+            if (ps->stacks_cnt >= PROFILER_TABLE_MAX) {
+                profiler_samples_clear(ps);
+            }
+            return;
+        }
+        write_samples_full(ps, pc_def, out);
+    }
+    profiler_samples_clear(ps);
 }
 
 static void add_sample_cache_client(void * x) {
@@ -171,8 +474,7 @@ static void add_sample_cache_client(void * x) {
     }
     cache_exit();
     if (error == 0 && !prf->disposed && !prf->stop_pending) {
-        SampleStackTrace * stk = find_stack_trace(prf);
-        add_to_sample_array(prf, prf->pc, stk);
+        profiler_samples_add(prf->samples, prf->pc, stk_buf, stk_buf_pos);
     }
     prf->lock--;
     if (prf->disposed && prf->lock == 0) loc_free(prf);
@@ -203,7 +505,7 @@ void profiler_sst_sample(Context * ctx, ContextAddress pc) {
         ProfilerSST * prf = link_core2prf(l);
         if (prf->frame_cnt <= 1) {
             /* Shortcut for non-hierarchical profiling */
-            if (prf->frame_cnt > 0) add_to_sample_array(prf, pc, NULL);
+            if (prf->frame_cnt > 0) profiler_samples_add(prf->samples, pc, NULL, 0);
             continue;
         }
         prf->pc = pc;
@@ -211,29 +513,11 @@ void profiler_sst_sample(Context * ctx, ContextAddress pc) {
     }
 }
 
-static void free_buffers(ProfilerSST * prf) {
-    unsigned i;
-    assert(!prf->disposed);
-    for (i = 0; i < PSAMPLE_HASH_SIZE; i++) {
-        loc_free(prf->psample_hash[i].buf);
-    }
-    memset(prf->psample_hash, 0, sizeof(prf->psample_hash));
-    prf->psample_cnt = 0;
-    for (i = 0; i < STRACE_HASH_SIZE; i++) {
-        SampleStackTrace * s = prf->strace_hash[i];
-        while (s != NULL) {
-            prf->strace_hash[i] = s->next;
-            loc_free(s);
-            s = prf->strace_hash[i];
-        }
-    }
-}
-
 void profiler_sst_reset(Context * ctx) {
     LINK * l;
     ContextExtensionPrfSST * ext = EXT(ctx);
     for (l = ext->list.next; l != &ext->list; l = l->next) {
-        free_buffers(link_core2prf(l));
+        profiler_samples_clear(link_core2prf(l)->samples);
     }
 }
 
@@ -241,7 +525,8 @@ static void profiler_dispose(void * args) {
     ProfilerSST * prf = (ProfilerSST *)args;
     assert(!prf->disposed);
     list_remove(&prf->link_core);
-    free_buffers(prf);
+    profiler_samples_dispose(prf->samples);
+    prf->samples = NULL;
     prf->disposed = 1;
     if (prf->lock == 0) loc_free(prf);
 }
@@ -254,6 +539,9 @@ static char * profiler_capabilities(Context * ctx) {
     json_write_string(out, "StackTraces");
     write_stream(out, ':');
     write_stream(out, '{');
+    json_write_string(out, "Incremental");
+    write_stream(out, ':');
+    json_write_boolean(out, 1);
     write_stream(out, '}');
     write_stream(out, 0);
 
@@ -264,10 +552,11 @@ static char * profiler_capabilities(Context * ctx) {
 static void * profiler_configure(void * args, Context * ctx, ProfilerParams * params) {
     ProfilerSST * prf = (ProfilerSST *)args;
     ContextExtensionPrfSST * ext = EXT(ctx);
-    if (params->frame_cnt > 0) {
+    if (params->frame_cnt > 0 && (params->sampler == NULL || strcmp(params->sampler, "StopAndTrace") == 0)) {
         /* Enabled */
         if (prf == NULL) {
             prf = (ProfilerSST *)loc_alloc_zero(sizeof(ProfilerSST));
+            prf->samples = profiler_samples_create(params->incremental);
             if (list_is_empty(&ext->list)) list_init(&ext->list);
             list_add_last(&prf->link_core, &ext->list);
             prf->channel = params->channel;
@@ -275,7 +564,8 @@ static void * profiler_configure(void * args, Context * ctx, ProfilerParams * pa
         }
         else {
             assert(!prf->disposed);
-            free_buffers(prf);
+            profiler_samples_dispose(prf->samples);
+            prf->samples = profiler_samples_create(params->incremental);
         }
         prf->frame_cnt = params->frame_cnt;
     }
@@ -289,56 +579,13 @@ static void * profiler_configure(void * args, Context * ctx, ProfilerParams * pa
     return prf;
 }
 
-static void add_num(uint8_t * buf, unsigned * pos, unsigned size, ContextAddress v) {
-    unsigned n;
-    for (n = 0; n < size; n++) {
-        buf[(*pos)++] = (uint8_t)(v >> (n * 8));
-    }
-}
-
 static void profiler_read(void * args, OutputStream * out) {
     ProfilerSST * prf = (ProfilerSST *)args;
-    RegisterDefinition * pc_def = get_PC_definition(prf->ctx);
 
     assert(!prf->disposed);
     write_stream(out, '{');
-    json_write_string(out, "Format");
-    write_stream(out, ':');
-    json_write_string(out, "StackTraces");
-    if (prf->psample_cnt > 0 && pc_def != NULL) {
-        unsigned i, j;
-        uint8_t * buf = (uint8_t *)tmp_alloc(pc_def->size * (prf->frame_cnt + 2));
-        JsonWriteBinaryState state;
-        assert(pc_def->size <= sizeof(ContextAddress));
-        write_stream(out, ',');
-        json_write_string(out, "AddrSize");
-        write_stream(out, ':');
-        json_write_long(out, pc_def->size);
-        write_stream(out, ',');
-        json_write_string(out, "Data");
-        write_stream(out, ':');
-        json_write_binary_start(&state, out, prf->psample_cnt * pc_def->size);
-        for (i = 0; i < PSAMPLE_HASH_SIZE; i++) {
-            ProfilerSampleArray * arr = prf->psample_hash + i;
-            for (j = 0; j < arr->buf_pos; j++) {
-                unsigned p = 0;
-                unsigned n = 1;
-                unsigned m = 1;
-                ProfilerSample * s = arr->buf + j;
-                add_num(buf, &p, pc_def->size, s->cnt);
-                if (s->stk != NULL) m += s->stk->len;
-                add_num(buf, &p, pc_def->size, m);
-                add_num(buf, &p, pc_def->size, s->pc);
-                while (n < m) {
-                    add_num(buf, &p, pc_def->size, s->stk->pc[n++ - 1]);
-                }
-                json_write_binary_data(&state, buf, p);
-            }
-        }
-        json_write_binary_end(&state);
-    }
+    profiler_samples_write(prf->samples, prf->ctx, out);
     write_stream(out, '}');
-    free_buffers(prf);
 }
 
 void profiler_sst_add(Context * ctx) {
@@ -23,6 +23,7 @@
 #include <tcf/config.h>
 
 #include <tcf/framework/context.h>
+#include <tcf/framework/streams.h>
 
 /* Add profiling support for debug context 'ctx' */
 extern void profiler_sst_add(Context * ctx);
@@ -36,6 +37,29 @@ extern void profiler_sst_sample(Context * ctx, ContextAddress pc);
 /* Reset (clear) profilng data */
 extern void profiler_sst_reset(Context * ctx);
 
+/*
+ * Sample store: aggregates samples by PC and stack trace, and writes them in "StackTraces" format.
+ * Used by the generic profiler, and by other sampling back-ends, which provide their own stack traces.
+ * 'stk' is an array of 'len' return addresses, starting from the caller of the sampled function.
+ *
+ * If 'incremental' is set, the store writes "StackTracesDelta" format instead:
+ * stack traces are kept between reads and each one is sent only once, "Stacks" contains new stack traces,
+ * "Data" contains only samples that changed since the last read. All numbers are LEB128 encoded:
+ *   Stacks: { length, { PC delta from previous PC in the trace (zigzag) } * length } *
+ *   Data: { PC delta from previous sample PC (zigzag), stack trace index + 1 (0 - none), count } *
+ * Stack trace indices are assigned in order of appearance in "Stacks", starting from 0.
+ * "Reset": true means the client must discard previously received stack traces.
+ */
+typedef struct ProfilerSamples ProfilerSamples;
+
+extern ProfilerSamples * profiler_samples_create(int incremental);
+extern void profiler_samples_add(ProfilerSamples * ps, ContextAddress pc, ContextAddress * stk, unsigned len);
+extern void profiler_samples_clear(ProfilerSamples * ps);
+extern void profiler_samples_dispose(ProfilerSamples * ps);
+
+/* Write "Format", "AddrSize" and sample data properties of Profiler.read result, and reset sample counts */
+extern void profiler_samples_write(ProfilerSamples * ps, Context * ctx, OutputStream * out);
+
 extern void ini_profiler_sst(void);
 
 #endif /* D_profiler_sst */
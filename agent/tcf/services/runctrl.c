@@ -142,6 +142,11 @@ static int safe_event_pid_count = 0;
 static int run_ctrl_lock_cnt = 0;
 static int stop_all_timer_cnt = 0;
 static int stop_all_timer_posted = 0;
+static struct timespec stop_all_time;
+static int stop_all_time_valid = 0;
+static int stop_report_timer_posted = 0;
+static int stop_report_timeout = 0;
+static RunControlStopStats stop_all_stats;
 static int run_safe_events_posted = 0;
 static int sync_run_state_event_posted = 0;
 
@@ -1279,6 +1284,15 @@ static void send_event_context_removed(Context * ctx) {
     write_stream(out, MARKER_EOM);
 }
 
+/* Stop-all latency must not be affected by changes of the system time */
+static void get_stop_all_clock(struct timespec * t) {
+#if defined(CLOCK_MONOTONIC)
+    if (clock_gettime(CLOCK_MONOTONIC, t)) check_error(errno);
+#else
+    if (clock_gettime(CLOCK_REALTIME, t)) check_error(errno);
+#endif
+}
+
 static void send_event_context_suspended(void) {
     LINK p0; /* List of contexts intercepted by breakpoint or exception */
     LINK p1; /* List of all other intercepted contexts */
@@ -1308,14 +1322,35 @@ static void send_event_context_suspended(void) {
         }
     }
 
+    if (stop_all_time_valid && (!list_is_empty(&p0) || !list_is_empty(&p1))) {
+        struct timespec now;
+        uint64_t ns = 0;
+        unsigned cnt = 0;
+        for (l = p0.next; l != &p0; l = l->next) cnt++;
+        for (l = p1.next; l != &p1; l = l->next) cnt++;
+        get_stop_all_clock(&now);
+        ns = (uint64_t)(now.tv_sec - stop_all_time.tv_sec) * 1000000000 + now.tv_nsec - stop_all_time.tv_nsec;
+        stop_all_stats.count++;
+        stop_all_stats.contexts += cnt;
+        stop_all_stats.last_ns = ns;
+        stop_all_stats.total_ns += ns;
+        if (ns > stop_all_stats.max_ns) stop_all_stats.max_ns = ns;
+        stop_all_time_valid = 0;
+        trace(LOG_CONTEXT, "Stop all: %u contexts stopped in %" PRIu64 " us", cnt, ns / 1000);
+    }
+
+    /* Contexts intercepted by breakpoints or exceptions are reported individually,
+     * except the last one, which is reported together with all other intercepted contexts
+     * in a single containerSuspended event */
     while (!list_is_empty(&p0) || !list_is_empty(&p1)) {
         OutputStream * out = &broadcast_group->out;
         LINK * n = !list_is_empty(&p0) ? p0.next : p1.next;
         Context * ctx = link2ctx(n);
-        int container = list_is_empty(&p0) && p1.next != p1.prev;
+        int container = 0;
 
         list_remove(n);
         list_add_last(n, &p2);
+        container = list_is_empty(&p0) && !list_is_empty(&p1);
 
         write_stringz(out, "E");
         write_stringz(out, RUN_CONTROL);
@@ -2366,6 +2401,10 @@ static void sync_run_state(void) {
             ctx->pending_intercept = 1;
             if (!ctx->stopped && !ctx->exiting) {
                 assert(!ext->safe_single_step);
+                if (!stop_all_time_valid) {
+                    get_stop_all_clock(&stop_all_time);
+                    stop_all_time_valid = 1;
+                }
                 context_stop(ctx);
                 ext->pending_safe_event = 1;
                 safe_event_pid_count++;
@@ -2414,12 +2453,33 @@ static void sync_run_state(void) {
     }
 }
 
+static void stop_report_timer(void * args) {
+    stop_report_timer_posted = 0;
+    stop_report_timeout = 1;
+    run_safe_events_posted++;
+    post_event(run_safe_events, NULL);
+}
+
 static void sync_run_state_cache_client(void * args) {
     sync_run_state();
     cache_exit();
     assert(sync_run_state_event_posted > 0);
     sync_run_state_event_posted--;
     if (run_safe_events_posted || sync_run_state_event_posted > 0 || run_ctrl_lock_cnt > 0) return;
+    if (safe_event_pid_count > 0 && !stop_report_timeout) {
+        /* Wait until all contexts of the intercept group are stopped, and report them in one event.
+         * If some contexts don't stop in time, report the ones that are already stopped. */
+        if (!stop_report_timer_posted) {
+            stop_report_timer_posted = 1;
+            post_event_with_delay(stop_report_timer, NULL, STOP_ALL_TIMEOUT);
+        }
+        return;
+    }
+    stop_report_timeout = 0;
+    if (stop_report_timer_posted && safe_event_pid_count == 0) {
+        cancel_event(stop_report_timer, NULL, 0);
+        stop_report_timer_posted = 0;
+    }
     send_event_context_suspended();
 }
 
@@ -2565,6 +2625,34 @@ static void check_safe_events(Context * ctx) {
     }
 }
 
+void get_run_ctrl_stop_stats(RunControlStopStats * stats) {
+    *stats = stop_all_stats;
+}
+
+static void write_stop_statistics(OutputStream * out, void * args) {
+    write_stream(out, '{');
+    json_write_string(out, "Count");
+    write_stream(out, ':');
+    json_write_ulong(out, stop_all_stats.count);
+    write_stream(out, ',');
+    json_write_string(out, "Contexts");
+    write_stream(out, ':');
+    json_write_ulong(out, stop_all_stats.contexts);
+    write_stream(out, ',');
+    json_write_string(out, "LastNs");
+    write_stream(out, ':');
+    json_write_uint64(out, stop_all_stats.last_ns);
+    write_stream(out, ',');
+    json_write_string(out, "MaxNs");
+    write_stream(out, ':');
+    json_write_uint64(out, stop_all_stats.max_ns);
+    write_stream(out, ',');
+    json_write_string(out, "TotalNs");
+    write_stream(out, ':');
+    json_write_uint64(out, stop_all_stats.total_ns);
+    write_stream(out, '}');
+}
+
 void post_safe_event(Context * ctx, EventCallBack * done, void * arg) {
     SafeEvent * i = (SafeEvent *)loc_alloc_zero(sizeof(SafeEvent));
     run_ctrl_lock();
@@ -2781,6 +2869,7 @@ static void clear_context_proxy_cache(Context * ctx) {
 
 static void event_context_stopped(Context * ctx, void * args) {
     ContextExtensionRC * ext = EXT(ctx);
+    int pending = 0;
     assert(ctx->stopped);
     assert(!ctx->exited);
     assert(!ext->intercepted);
@@ -2800,9 +2889,13 @@ static void event_context_stopped(Context * ctx, void * args) {
 #if SERVICE_Breakpoints
     if (ctx->stopped_by_bp || ctx->stopped_by_cb) evaluate_breakpoint(ctx);
 #endif
-    if (ext->pending_safe_event) check_safe_events(ctx);
+    if (ext->pending_safe_event) {
+        /* Stop of a group member: check_safe_events() resyncs when the last member stops */
+        check_safe_events(ctx);
+        pending = safe_event_pid_count > 0;
+    }
     if (ctx->stopped_by_exception) send_event_context_exception(ctx);
-    if (run_ctrl_lock_cnt == 0 && run_safe_events_posted < 4) {
+    if (!pending && run_ctrl_lock_cnt == 0 && run_safe_events_posted < 4) {
         /* Lazily continue execution of temporary stopped contexts */
         run_safe_events_posted++;
         post_event(run_safe_events, NULL);
@@ -2926,6 +3019,7 @@ void ini_run_ctrl_service(Protocol * proto, TCFBroadcastGroup * bcg) {
     add_context_event_listener(&listener, NULL);
     add_channel_close_listener(channel_closed);
     add_channel_open_listener(channel_opened);
+    add_diagnostics_statistics("RunControlStopAll", write_stop_statistics, NULL);
     context_extension_offset = context_extension(sizeof(ContextExtensionRC));
     channel_extension_offset = channel_extension(sizeof(ChannelExtensionRC));
     add_command_handler(proto, RUN_CONTROL, "getContext", command_get_context);
@@ -207,6 +207,22 @@ extern const char * get_context_state_name(Context * ctx);
  */
 extern int is_run_ctrl_idle(void);
 
+/*
+ * Stop-all latency statistics.
+ * The latency is measured from the first context_stop() call issued to stop an intercept group
+ * until all contexts of the group are stopped and reported to clients.
+ * The statistics are also reported as "RunControlStopAll" by Diagnostics.getStatistics.
+ */
+typedef struct RunControlStopStats {
+    unsigned long count;        /* Number of group stops */
+    unsigned long contexts;     /* Total number of contexts reported by group stops */
+    uint64_t last_ns;           /* Latency of the last group stop */
+    uint64_t max_ns;            /* Maximum latency */
+    uint64_t total_ns;          /* Sum of latencies */
+} RunControlStopStats;
+
+extern void get_run_ctrl_stop_stats(RunControlStopStats * stats);
+
 /* RunControl event listener */
 typedef struct RunControlEventListener {
     void (*context_intercepted)(Context * ctx, void * args);
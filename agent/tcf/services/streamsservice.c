@@ -83,6 +83,7 @@ struct StreamClient {
     VirtualStream * stream;
     Channel * channel;
     uint64_t pos;
+    int output_wait;        /* Read replies are postponed until the channel is not congested */
 };
 
 struct ReadRequest {
@@ -455,6 +456,39 @@ VirtualStream * virtual_stream_find(char * id) {
     return NULL;
 }
 
+static void channel_output_ready(Channel * c, void * args);
+
+static void send_pending_read_replies(StreamClient * client, int ready) {
+    VirtualStream * stream = client->stream;
+    while (!list_is_empty(&client->read_requests) && (client->pos < stream->pos || stream->eos_inp)) {
+        ReadRequest * r = client2read_request(client->read_requests.next);
+        if (!ready && is_channel_congested(client->channel)) {
+            if (!client->output_wait) {
+                client->output_wait = 1;
+                channel_wait_output(client->channel, channel_output_ready, NULL);
+            }
+            break;
+        }
+        list_remove(&r->link_client);
+        send_read_reply(client, r->token, r->size);
+        loc_free(r);
+        ready = 0;
+    }
+}
+
+static void channel_output_ready(Channel * c, void * args) {
+    LINK * l = clients.next;
+    while (l != &clients) {
+        StreamClient * client = all2client(l);
+        l = l->next;
+        if (client->channel == c && client->output_wait) {
+            client->output_wait = 0;
+            send_pending_read_replies(client, 1);
+            advance_stream_buffer(client->stream);
+        }
+    }
+}
+
 int virtual_stream_add_data(VirtualStream * stream, char * buf, size_t buf_size, size_t * data_size, int eos) {
     int err = 0;
 
@@ -484,13 +518,7 @@ int virtual_stream_add_data(VirtualStream * stream, char * buf, size_t buf_size,
         if (!err && (stream->eos_inp || *data_size > 0)) {
             LINK * l;
             for (l = stream->clients.next; l != &stream->clients; l = l->next) {
-                StreamClient * client = stream2client(l);
-                while (!list_is_empty(&client->read_requests) && (client->pos < stream->pos || stream->eos_inp)) {
-                    ReadRequest * r = client2read_request(client->read_requests.next);
-                    list_remove(&r->link_client);
-                    send_read_reply(client, r->token, r->size);
-                    loc_free(r);
-                }
+                send_pending_read_replies(stream2client(l), 0);
             }
             advance_stream_buffer(stream);
         }
@@ -671,13 +699,16 @@ int virtual_stream_read(Channel * c, char * token, char * id, size_t size) {
 
     if (err == 0) {
         VirtualStream * stream = client->stream;
-        if (client->pos == stream->pos && !stream->eos_inp) {
+        if ((client->pos == stream->pos && !stream->eos_inp) ||
+                !list_is_empty(&client->read_requests) || is_channel_congested(c)) {
             ReadRequest * r = (ReadRequest *)loc_alloc_zero(sizeof(ReadRequest));
             list_init(&r->link_client);
             r->client = client;
             r->size = size;
             strlcpy(r->token, token, sizeof(r->token));
             list_add_last(&r->link_client, &client->read_requests);
+            send_pending_read_replies(client, 0);
+            advance_stream_buffer(stream);
         }
         else {
             assert(list_is_empty(&client->read_requests));
@@ -39,6 +39,7 @@
 #include <tcf/services/dwarfexpr.h>
 #include <tcf/services/dwarfecomp.h>
 #include <tcf/services/dwarfframe.h>
+#include <tcf/services/dwarfnames.h>
 #include <tcf/services/dwarfreloc.h>
 #include <tcf/services/stacktrace.h>
 #include <tcf/services/memorymap.h>
@@ -1228,12 +1229,14 @@ static void sort_find_symbol_buf(void) {
 }
 
 static int same_namespace(ObjectInfo * x, ObjectInfo * y) {
-    int xn = x->mParent != NULL && x->mParent->mTag == TAG_namespace;
-    int yn = y->mParent != NULL && y->mParent->mTag == TAG_namespace;
+    ObjectInfo * px = get_dwarf_parent(x);
+    ObjectInfo * py = get_dwarf_parent(y);
+    int xn = px != NULL && px->mTag == TAG_namespace;
+    int yn = py != NULL && py->mTag == TAG_namespace;
     if (xn != yn) return 0;
     if (!xn) return 1;
-    x = x->mParent;
-    y = y->mParent;
+    x = px;
+    y = py;
     if (x->mName == y->mName) return 1;
     if (x->mName == NULL) return 0;
     if (y->mName == NULL) return 0;
@@ -1241,6 +1244,60 @@ static int same_namespace(ObjectInfo * x, ObjectInfo * y) {
     return same_namespace(x, y);
 }
 
+static int is_definition_of(ObjectInfo * obj, ObjectInfo * decl, int search_ext_only) {
+    if (obj == decl) return 0;
+    if (obj->mTag != decl->mTag) return 0;
+    if (obj->mFlags & DOIF_declaration) return 0;
+    if (obj->mFlags & DOIF_specification) return 0;
+    if (search_ext_only && (obj->mFlags & DOIF_external) == 0) return 0;
+    if (!equ_symbol_names(obj->mName, decl->mName)) return 0;
+    if (!cmp_object_profiles(decl, obj)) return 0;
+    if (!cmp_object_linkage_names(decl, obj)) return 0;
+    if (!same_namespace(decl, obj)) return 0;
+    return 1;
+}
+
+#if ENABLE_DWARF_NAMES
+typedef struct FindDefinitionArgs {
+    ObjectInfo * decl;
+    ObjectInfo * def;
+    int search_ext_only;
+} FindDefinitionArgs;
+
+static void find_definition_call_back(ObjectInfo * obj, void * x) {
+    FindDefinitionArgs * args = (FindDefinitionArgs *)x;
+    if (args->def != NULL) return;
+    if (is_definition_of(obj, args->decl, args->search_ext_only)) args->def = obj;
+}
+
+/* Accelerator tables use namespace qualified names, e.g. "ns::name" */
+static size_t get_namespace_prefix(ObjectInfo * obj, char * buf) {
+    size_t len = 0;
+    ObjectInfo * ns = get_dwarf_parent(obj);
+    if (ns == NULL || ns->mTag != TAG_namespace) return 0;
+    len = get_namespace_prefix(ns, buf);
+    if (ns->mName == NULL) return len;
+    if (buf != NULL) {
+        strcpy(buf + len, ns->mName);
+        strcpy(buf + len + strlen(ns->mName), "::");
+    }
+    return len + strlen(ns->mName) + 2;
+}
+
+static ObjectInfo * find_definition_in_name_index(DWARFCache * cache, ObjectInfo * decl, int search_ext_only) {
+    FindDefinitionArgs args;
+    size_t len = get_namespace_prefix(decl, NULL);
+    char * name = (char *)tmp_alloc(len + strlen(decl->mName) + 1);
+    get_namespace_prefix(decl, name);
+    strcpy(name + len, decl->mName);
+    args.decl = decl;
+    args.def = NULL;
+    args.search_ext_only = search_ext_only;
+    dwarf_names_lookup(cache, name, find_definition_call_back, &args);
+    return args.def;
+}
+#endif
+
 /* If 'decl' represents a declaration, replace it with definition - if possible */
 static ObjectInfo * find_definition(ObjectInfo * decl) {
     while (decl != NULL) {
@@ -1268,20 +1325,20 @@ static ObjectInfo * find_definition(ObjectInfo * decl) {
             ObjectInfo * def = NULL;
             DWARFCache * cache = get_dwarf_cache(get_dwarf_file(decl->mCompUnit->mFile));
             PubNamesTable * tbl = &cache->mPubNames;
-            if (tbl->mHash != NULL) {
+#if ENABLE_DWARF_NAMES
+            if (cache->mNameIndex != NULL) {
+                def = find_definition_in_name_index(cache, decl, search_ext_only);
+            }
+#endif
+            if (def == NULL && tbl->mHash != NULL) {
                 unsigned n = tbl->mHash[calc_symbol_name_hash(decl->mName) % tbl->mHashSize];
                 while (n != 0) {
-                    ObjectInfo * obj = tbl->mNext[n].mObject;
-                    n = tbl->mNext[n].mNext;
-                    if (obj == decl) continue;
-                    if (obj->mTag != decl->mTag) continue;
-                    if (obj->mFlags & DOIF_declaration) continue;
-                    if (obj->mFlags & DOIF_specification) continue;
-                    if (search_ext_only && (obj->mFlags & DOIF_external) == 0) continue;
-                    if (!equ_symbol_names(obj->mName, decl->mName)) continue;
-                    if (!cmp_object_profiles(decl, obj)) continue;
-                    if (!cmp_object_linkage_names(decl, obj)) continue;
-                    if (!same_namespace(decl, obj)) continue;
+                    PubNamesInfo * info = tbl->mNext + n;
+                    ObjectInfo * obj = NULL;
+                    n = info->mNext;
+                    if (!equ_symbol_names(info->mName, decl->mName)) continue;
+                    obj = get_pub_names_object(cache, info);
+                    if (!is_definition_of(obj, decl, search_ext_only)) continue;
                     def = obj;
                     break;
                 }
@@ -1297,17 +1354,36 @@ static ObjectInfo * find_definition(ObjectInfo * decl) {
     return decl;
 }
 
+#if ENABLE_DWARF_NAMES
+static void find_by_name_call_back(ObjectInfo * obj, void * args) {
+    const char * name = (const char *)args;
+    ObjectInfo * parent = get_dwarf_parent(obj);
+    int ns = parent != NULL && parent->mTag == TAG_namespace;
+    if (!ns && equ_symbol_names(obj->mName, name)) {
+        add_obj_to_find_symbol_buf(obj, 1);
+    }
+}
+#endif
+
 static void find_by_name_in_pub_names(DWARFCache * cache, const char * name) {
     PubNamesTable * tbl = &cache->mPubNames;
+#if ENABLE_DWARF_NAMES
+    if (cache->mNameIndex != NULL) {
+        dwarf_names_lookup(cache, name, find_by_name_call_back, (void *)name);
+    }
+#endif
+    /* If the accelerator table does not list all units, names of other units are in the public names table */
     if (tbl->mHash != NULL) {
         unsigned n = tbl->mHash[calc_symbol_name_hash(name) % tbl->mHashSize];
         while (n != 0) {
-            ObjectInfo * obj = tbl->mNext[n].mObject;
-            int ns = obj->mParent != NULL && obj->mParent->mTag == TAG_namespace;
-            if (!ns && equ_symbol_names(obj->mName, name)) {
-                add_obj_to_find_symbol_buf(obj, 1);
+            PubNamesInfo * info = tbl->mNext + n;
+            if (equ_symbol_names(info->mName, name)) {
+                ObjectInfo * obj = get_pub_names_object(cache, info);
+                ObjectInfo * parent = get_dwarf_parent(obj);
+                int ns = parent != NULL && parent->mTag == TAG_namespace;
+                if (!ns) add_obj_to_find_symbol_buf(obj, 1);
             }
-            n = tbl->mNext[n].mNext;
+            n = info->mNext;
         }
     }
     if (cache->mFile->dwz_file != NULL) {
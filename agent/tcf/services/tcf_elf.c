@@ -29,9 +29,13 @@
 #include <errno.h>
 #include <stdio.h>
 #include <tcf/framework/mdep-fs.h>
+#include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/compression.h>
+#include <tcf/framework/zstd.h>
+#include <tcf/framework/addrindex.h>
+#include <tcf/framework/asyncreq.h>
 #include <tcf/framework/events.h>
 #include <tcf/framework/cache.h>
 #include <tcf/framework/trace.h>
@@ -39,6 +43,7 @@
 #include <tcf/services/tcf_elf.h>
 #include <tcf/services/memorymap.h>
 #include <tcf/services/dwarfcache.h>
+#include <tcf/services/dwarfindexcache.h>
 #include <tcf/services/dwarfreloc.h>
 #include <tcf/services/pathmap.h>
 
@@ -55,9 +60,16 @@
 #  define USE_MMAP 1
 #endif
 
+#if ENABLE_DebugContext && ENABLE_DWARF_INDEX_CACHE && USE_MMAP && !defined(__CYGWIN__)
+#  define USE_SECTION_CACHE 1
+#else
+#  define USE_SECTION_CACHE 0
+#endif
+
 #define MIN_FILE_AGE 3
 #define MAX_FILE_AGE 60
 #define MAX_FILE_CNT 100
+#define FILES_HASH_SIZE 511
 
 #ifndef SHF_COMPRESSED
 #define SHF_COMPRESSED 0x00000800
@@ -65,6 +77,9 @@
 #ifndef ELFCOMPRESS_ZLIB
 #define ELFCOMPRESS_ZLIB 1
 #endif
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD 2
+#endif
 #ifndef ARCH_SHF_SMALL
 #define ARCH_SHF_SMALL 0
 #endif
@@ -97,6 +112,7 @@ typedef struct KernelModuleAddress {
 } KernelModuleAddress;
 
 static ELF_File * files = NULL;
+static ELF_File * files_hash[FILES_HASH_SIZE];
 static FileINode * inodes = NULL;
 static ELFOpenListener * openlisteners = NULL;
 static unsigned openlisteners_cnt = 0;
@@ -108,6 +124,31 @@ static int elf_cleanup_posted = 0;
 static ino_t elf_ino_cnt = 0;
 static ElfListState * elf_list_state = NULL;
 
+#if ENABLE_ELF_PARALLEL_DECOMPRESS
+
+typedef struct ElfDecompressJob {
+    AsyncReqInfo req;
+    AbstractCache clients;      /* Cache clients waiting for the job */
+    ELF_Section * sec;          /* NULL if the section has taken the result or is disposed */
+    U4_T type;
+    uint8_t * src;
+    size_t src_size;
+    void * dst;
+    size_t dst_size;
+#if USE_SECTION_CACHE
+    DWARFIndexSection * cache;
+    int cache_error;
+#endif
+    int error;
+    int done;                   /* Protected by decompress_lock */
+    int req_done;               /* The request done callback has been called, the worker is done */
+} ElfDecompressJob;
+
+static pthread_mutex_t decompress_lock;
+static pthread_cond_t decompress_cond;
+
+#endif
+
 #if ENABLE_DebugContext
 
 static MemoryMap elf_map;
@@ -115,6 +156,9 @@ static MemoryMap elf_map;
 #endif
 
 static ELF_File * find_open_file_by_name(const char * name);
+#if ENABLE_ELF_PARALLEL_DECOMPRESS
+static void release_decompress_job(ELF_Section * s);
+#endif
 
 void elf_add_open_listener(ELFOpenListener listener) {
     if (openlisteners_cnt >= openlisteners_max) {
@@ -132,10 +176,17 @@ void elf_add_close_listener(ELFCloseListener listener) {
     closelisteners[closelisteners_cnt++] = listener;
 }
 
+static unsigned calc_inode_hash(dev_t dev, ino_t ino) {
+    return (unsigned)(((uint64_t)ino * 31 + (uint64_t)dev) % FILES_HASH_SIZE);
+}
+
 static void elf_dispose(ELF_File * file) {
     unsigned n;
+    ELF_File ** ref = files_hash + calc_inode_hash(file->dev, file->ino);
     assert(file->lock_cnt == 0);
     trace(LOG_ELF, "Dispose ELF file cache %s", file->name);
+    while (*ref != file) ref = &(*ref)->next_in_hash;
+    *ref = file->next_in_hash;
     for (n = 0; n < closelisteners_cnt; n++) {
         closelisteners[n](file);
     }
@@ -148,6 +199,9 @@ static void elf_dispose(ELF_File * file) {
     if (file->sections != NULL) {
         for (n = 0; n < file->section_cnt; n++) {
             ELF_Section * s = file->sections + n;
+#if ENABLE_ELF_PARALLEL_DECOMPRESS
+            if (s->decompress_job != NULL) release_decompress_job(s);
+#endif
 #if !USE_MMAP
             loc_free(s->data);
 #elif defined(_WIN32) || defined(__CYGWIN__)
@@ -158,6 +212,7 @@ static void elf_dispose(ELF_File * file) {
             else munmap(s->mmap_addr, s->mmap_size);
 #endif
             loc_free(s->sym_addr_table);
+            addr_index_dispose(&s->sym_addr_index);
             loc_free(s->sym_names_hash);
             loc_free(s->sym_names_next);
             loc_free(s->reloc_zones_bondaries);
@@ -397,21 +452,14 @@ static ELF_File * find_open_file_by_name(const char * name) {
 }
 
 static ELF_File * find_open_file_by_inode(dev_t dev, ino_t ino, int64_t mtime) {
-    ELF_File * prev = NULL;
-    ELF_File * file = files;
+    ELF_File * file = files_hash[calc_inode_hash(dev, ino)];
     while (file != NULL) {
         if (file->dev == dev && file->ino == ino &&
             (mtime ? file->mtime == mtime : !file->mtime_changed)) {
-            if (prev != NULL) {
-                prev->next = file->next;
-                file->next = files;
-                files = file;
-            }
             file->age = 0;
             return file;
         }
-        prev = file;
-        file = file->next;
+        file = file->next_in_hash;
     }
     return NULL;
 }
@@ -1040,6 +1088,8 @@ static ELF_File * create_elf_cache(const char * file_name) {
         elf_cleanup_posted = 1;
     }
     free(real_name);
+    file->next_in_hash = files_hash[calc_inode_hash(file->dev, file->ino)];
+    files_hash[calc_inode_hash(file->dev, file->ino)] = file;
     file->next = files;
     return files = file;
 }
@@ -1056,6 +1106,216 @@ ELF_File * elf_open(const char * file_name) {
     return NULL;
 }
 
+/* Decompress section data. Does not use exceptions and agent data structures, can be called from any thread */
+static int decompress_section_data(U4_T type, const uint8_t * src, size_t src_size, void * dst, size_t dst_size) {
+    size_t used = 0;
+    switch (type) {
+    case ELFCOMPRESS_ZLIB:
+        if (inflate_zlib(src, src_size, dst, dst_size, &used) < 0) return -1;
+        break;
+    case ELFCOMPRESS_ZSTD:
+        if (zstd_decompress(src, src_size, dst, dst_size, &used) < 0) return -1;
+        break;
+    default:
+        errno = ERR_UNSUPPORTED;
+        return -1;
+    }
+    if (used != dst_size) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    return 0;
+}
+
+static uint8_t * read_compressed_data(ELF_Section * s) {
+    ELF_File * file = s->file;
+    uint8_t * buf = (uint8_t *)loc_alloc((size_t)s->compressed_size);
+    if (lseek(file->fd, s->compressed_offset, SEEK_SET) == (off_t)-1 ||
+            read_fully(file->fd, buf, (size_t)s->compressed_size) < 0) {
+        int error = errno;
+        loc_free(buf);
+        set_errno(error, "Cannot read symbol file");
+        return NULL;
+    }
+    return buf;
+}
+
+#if ENABLE_ELF_PARALLEL_DECOMPRESS
+
+static void free_decompress_job(ElfDecompressJob * job) {
+    cache_dispose(&job->clients);
+#if USE_SECTION_CACHE
+    dwarf_index_section_close(job->cache);
+#endif
+    loc_free(job->src);
+    loc_free(job->dst);
+    loc_free(job);
+}
+
+/* Detach decompression job from the section, the job is disposed when both the section and the worker are done with it */
+static void release_decompress_job(ELF_Section * s) {
+    ElfDecompressJob * job = s->decompress_job;
+    assert(job->sec == s);
+    job->sec = NULL;
+    s->decompress_job = NULL;
+    if (job->req_done) free_decompress_job(job);
+}
+
+static int decompress_worker(void * args) {
+    ElfDecompressJob * job = (ElfDecompressJob *)args;
+    int error = 0;
+    if (decompress_section_data(job->type, job->src, job->src_size, job->dst, job->dst_size) < 0) error = errno;
+#if USE_SECTION_CACHE
+    /* Written before the job is marked done: after that the section can take and dispose the data */
+    if (!error && job->cache != NULL) job->cache_error = dwarf_index_section_store(job->cache, job->dst, job->dst_size);
+#endif
+    check_error(pthread_mutex_lock(&decompress_lock));
+    job->error = error;
+    job->done = 1;
+    check_error(pthread_cond_broadcast(&decompress_cond));
+    check_error(pthread_mutex_unlock(&decompress_lock));
+    return 0;
+}
+
+static void decompress_worker_done(void * args) {
+    ElfDecompressJob * job = (ElfDecompressJob *)((AsyncReqInfo *)args)->client_data;
+#if USE_SECTION_CACHE
+    if (job->cache_error) {
+        trace(LOG_ELF, "Cannot write section cache file: %s", errno_to_str(job->cache_error));
+        job->cache_error = 0;
+    }
+#endif
+    job->req_done = 1;
+    /* Clients are resumed later, they take the result and can dispose the job */
+    cache_notify_later(&job->clients);
+    if (job->sec == NULL) free_decompress_job(job);
+}
+
+static int start_decompress_job(ELF_Section * s) {
+    ElfDecompressJob * job = NULL;
+    uint8_t * src = NULL;
+#if USE_SECTION_CACHE
+    DWARFIndexSection * cache = dwarf_index_section_open(s);
+    if (cache != NULL && dwarf_index_section_map(cache, s) == 0) {
+        dwarf_index_section_close(cache);
+        trace(LOG_ELF, "Section %s in ELF file %s is mapped from section cache", s->name, s->file->name);
+        return 0;
+    }
+#endif
+    src = read_compressed_data(s);
+    if (src == NULL) {
+#if USE_SECTION_CACHE
+        dwarf_index_section_close(cache);
+#endif
+        return -1;
+    }
+    job = (ElfDecompressJob *)loc_alloc_zero(sizeof(ElfDecompressJob));
+    job->sec = s;
+    job->type = s->compressed_type;
+    job->src = src;
+    job->src_size = (size_t)s->compressed_size;
+    job->dst = loc_alloc((size_t)s->size);
+    job->dst_size = (size_t)s->size;
+#if USE_SECTION_CACHE
+    job->cache = cache;
+#endif
+    job->req.done = decompress_worker_done;
+    job->req.client_data = job;
+    job->req.type = AsyncReqUser;
+    job->req.u.user.func = decompress_worker;
+    job->req.u.user.data = job;
+    s->decompress_job = job;
+    async_req_post(&job->req);
+    return 0;
+}
+
+static int is_debug_section(ELF_Section * s) {
+    return s->name != NULL && strncmp(s->name, ".debug_", 7) == 0;
+}
+
+static int load_compressed_section(ELF_Section * s) {
+    ElfDecompressJob * job = s->decompress_job;
+    if (job == NULL) {
+        /* Debug sections are usually needed together, decompress all of them concurrently */
+        unsigned i;
+        if (start_decompress_job(s) < 0) return -1;
+        if (is_debug_section(s)) {
+            ELF_File * file = s->file;
+            for (i = 1; i < file->section_cnt; i++) {
+                ELF_Section * sec = file->sections + i;
+                if (sec == s || sec->data != NULL || sec->decompress_job != NULL) continue;
+                if ((sec->flags & SHF_COMPRESSED) == 0 || sec->size == 0 || !is_debug_section(sec)) continue;
+                start_decompress_job(sec);
+            }
+        }
+        if (s->data != NULL) return 0;
+        job = s->decompress_job;
+    }
+    if (!job->req_done) {
+        if (cache_transaction_id() != 0) {
+            /* Don't block the dispatch thread, the client is restarted when the job is done */
+            Trap trap;
+            if (set_trap(&trap)) cache_wait(&job->clients);
+            errno = trap.error;
+            return -1;
+        }
+        /* Not a cache client, the caller needs the data now */
+        check_error(pthread_mutex_lock(&decompress_lock));
+        while (!job->done) check_error(pthread_cond_wait(&decompress_cond, &decompress_lock));
+        check_error(pthread_mutex_unlock(&decompress_lock));
+    }
+    if (job->error) {
+        int error = job->error;
+        release_decompress_job(s);
+        set_errno(error, "Cannot decompress section");
+        return -1;
+    }
+    s->data = job->dst;
+    job->dst = NULL;
+    release_decompress_job(s);
+    trace(LOG_ELF, "Section %s in ELF file %s is decompressed", s->name, s->file->name);
+    return 0;
+}
+
+#else
+
+static int load_compressed_section(ELF_Section * s) {
+    uint8_t * src = NULL;
+#if USE_SECTION_CACHE
+    DWARFIndexSection * cache = dwarf_index_section_open(s);
+    if (cache != NULL && dwarf_index_section_map(cache, s) == 0) {
+        dwarf_index_section_close(cache);
+        trace(LOG_ELF, "Section %s in ELF file %s is mapped from section cache", s->name, s->file->name);
+        return 0;
+    }
+#endif
+    src = read_compressed_data(s);
+    if (src != NULL) {
+        void * dst = loc_alloc((size_t)s->size);
+        if (decompress_section_data(s->compressed_type, src, (size_t)s->compressed_size, dst, (size_t)s->size) == 0) {
+            s->data = dst;
+#if USE_SECTION_CACHE
+            if (cache != NULL) {
+                int error = dwarf_index_section_store(cache, dst, (size_t)s->size);
+                if (error) trace(LOG_ELF, "Cannot write section cache file: %s", errno_to_str(error));
+            }
+#endif
+            trace(LOG_ELF, "Section %s in ELF file %s is decompressed", s->name, s->file->name);
+        }
+        else {
+            set_errno(errno, "Cannot decompress section");
+            loc_free(dst);
+        }
+        loc_free(src);
+    }
+#if USE_SECTION_CACHE
+    dwarf_index_section_close(cache);
+#endif
+    return s->data != NULL ? 0 : -1;
+}
+
+#endif /* ENABLE_ELF_PARALLEL_DECOMPRESS */
+
 int elf_load(ELF_Section * s) {
 
     if (s->data != NULL) return 0;
@@ -1132,46 +1392,7 @@ int elf_load(ELF_Section * s) {
             set_error_report_errno(file->error);
             return -1;
         }
-        if (s->flags & SHF_COMPRESSED) {
-            if (s->compressed_type == ELFCOMPRESS_ZLIB && s->compressed_size > 6) {
-                uint8_t * buf = (uint8_t *)loc_alloc((size_t)s->compressed_size);
-                if (lseek(file->fd, s->compressed_offset, SEEK_SET) == (off_t)-1 ||
-                    read_fully(file->fd, buf, (size_t)s->compressed_size) < 0) {
-                    int error = errno;
-                    loc_free(buf);
-                    set_errno(error, "Cannot read symbol file");
-                    return -1;
-                }
-                else {
-                    unsigned pos = 0;
-                    unsigned cmf = buf[pos++];
-                    unsigned flg = buf[pos++];
-                    if ((cmf & 0xf) != 0x08) {
-                        loc_free(buf);
-                        set_errno(ERR_INV_DWARF, "Unsupported compression type");
-                        return -1;
-                    }
-                    if ((cmf * 256 + flg) % 31 == 0 && (flg & 0x20) == 0) {
-                        Trap trap;
-                        s->data = loc_alloc_zero((size_t)s->size);
-                        if (set_trap(&trap)) {
-                            pos += decompress(buf + pos, (size_t)(s->compressed_size - pos), s->data, (size_t)s->size);
-                            if (pos + 4 <= s->compressed_size) {
-                                /* TODO: checksum verification */
-                                clear_trap(&trap);
-                                loc_free(buf);
-                                return 0;
-                            }
-                        }
-                        loc_free(s->data);
-                        s->data = NULL;
-                    }
-                }
-                loc_free(buf);
-            }
-            set_errno(ERR_INV_DWARF, "Corrupted compressed section");
-            return -1;
-        }
+        if (s->flags & SHF_COMPRESSED) return load_compressed_section(s);
         s->data = loc_alloc((size_t)s->size);
         if (lseek(file->fd, s->offset, SEEK_SET) == (off_t)-1 ||
                 read_fully(file->fd, s->data, (size_t)s->size) < 0) {
@@ -2130,9 +2351,19 @@ static int create_symbol_names_hash(ELF_Section * tbl) {
     return 0;
 }
 
+/* Symbol address record, used while building symbol by address search index */
+typedef struct SymAddrRecord {
+    U8_T address;
+    ELF_Section * section;
+    unsigned index;
+} SymAddrRecord;
+
+static SymAddrRecord * sym_addr_buf = NULL;
+static unsigned sym_addr_buf_max = 0;
+
 static int section_symbol_comparator(const void * x, const void * y) {
-    ELF_SecSymbol * rx = (ELF_SecSymbol *)x;
-    ELF_SecSymbol * ry = (ELF_SecSymbol *)y;
+    SymAddrRecord * rx = (SymAddrRecord *)x;
+    SymAddrRecord * ry = (SymAddrRecord *)y;
     if (rx->address < ry->address) return -1;
     if (rx->address > ry->address) return +1;
     if (rx->index < ry->index) return -1;
@@ -2145,7 +2376,9 @@ static void create_symbol_addr_search_index(ELF_Section * sec) {
     int elf64 = file->elf64;
     int swap = file->byte_swap;
     int rel = file->type == ET_REL;
+    unsigned cnt = 0;
     unsigned m = 0;
+    U8_T * keys = NULL;
 
     for (m = 1; m < file->section_cnt; m++) {
         unsigned n = 1;
@@ -2224,18 +2457,12 @@ static void create_symbol_addr_search_index(ELF_Section * sec) {
                 }
             }
             if (add) {
-                ELF_SecSymbol * s = NULL;
-                if (sec->sym_addr_cnt >= sec->sym_addr_max) {
-                    if (sec->sym_addr_table == NULL) {
-                        sec->sym_addr_max = (unsigned)(tbl->sym_count / 2) + 16;
-                        if (sec->sym_addr_max > 0x10000) sec->sym_addr_max = 0x10000;
-                    }
-                    else {
-                        sec->sym_addr_max = sec->sym_addr_max * 3 / 2;
-                    }
-                    sec->sym_addr_table = (ELF_SecSymbol *)loc_realloc(sec->sym_addr_table, sec->sym_addr_max * sizeof(ELF_SecSymbol));
+                SymAddrRecord * s = NULL;
+                if (cnt >= sym_addr_buf_max) {
+                    sym_addr_buf_max = sym_addr_buf_max == 0 ? 0x1000 : sym_addr_buf_max * 2;
+                    sym_addr_buf = (SymAddrRecord *)loc_realloc(sym_addr_buf, sym_addr_buf_max * sizeof(SymAddrRecord));
                 }
-                s = sec->sym_addr_table + sec->sym_addr_cnt++;
+                s = sym_addr_buf + cnt++;
                 s->address = addr;
                 s->section = tbl;
                 s->index = n;
@@ -2243,38 +2470,42 @@ static void create_symbol_addr_search_index(ELF_Section * sec) {
             n++;
         }
     }
+    if (cnt == 0) return;
 
-    qsort(sec->sym_addr_table, sec->sym_addr_cnt, sizeof(ELF_SecSymbol), section_symbol_comparator);
+    qsort(sym_addr_buf, cnt, sizeof(SymAddrRecord), section_symbol_comparator);
+    sec->sym_addr_table = (ELF_SecSymbol *)loc_alloc(cnt * sizeof(ELF_SecSymbol));
+    keys = addr_index_alloc(&sec->sym_addr_index, cnt);
+    for (m = 0; m < cnt; m++) {
+        SymAddrRecord * s = sym_addr_buf + m;
+        sec->sym_addr_table[m].section = s->section;
+        sec->sym_addr_table[m].index = s->index;
+        keys[m] = s->address;
+    }
+    addr_index_build(&sec->sym_addr_index);
+    sec->sym_addr_cnt = cnt;
+    if (sym_addr_buf_max > 0x10000) {
+        /* Don't keep a large buffer after indexing a big symbol table */
+        loc_free(sym_addr_buf);
+        sym_addr_buf = NULL;
+        sym_addr_buf_max = 0;
+    }
 }
 
 void elf_find_symbol_by_address(ELF_Section * sec, ContextAddress addr, ELF_SymbolInfo * sym_info) {
-    unsigned l = 0;
-    unsigned h = 0;
+    unsigned k = 0;
+    ELF_SecSymbol * info = NULL;
     memset(sym_info, 0, sizeof(ELF_SymbolInfo));
     if (sec == NULL || addr < sec->addr) return;
     if (sec->sym_addr_table == NULL) create_symbol_addr_search_index(sec);
-    h = sec->sym_addr_cnt;
-    while (l < h) {
-        unsigned k = (h + l) / 2;
-        ELF_SecSymbol * info = sec->sym_addr_table + k;
-        if (info->address > addr) {
-            h = k;
-        }
-        else {
-            ContextAddress next = (ContextAddress)(k < sec->sym_addr_cnt - 1 ?
-                (info + 1)->address : sec->addr + sec->size);
-            assert(next >= info->address);
-            if (next <= addr) {
-                l = k + 1;
-            }
-            else {
-                unpack_elf_symbol_info(info->section, info->index, sym_info);
-                assert(IS_PPC64_FUNC_OPD(info->section->file, sym_info) || sym_info->section == sec);
-                sym_info->addr_index = k;
-                return;
-            }
-        }
-    }
+    /* Last symbol with address less or equal to 'addr' */
+    k = addr_index_rank(&sec->sym_addr_index, addr);
+    if (k == 0) return;
+    k--;
+    if (k == sec->sym_addr_cnt - 1 && (ContextAddress)(sec->addr + sec->size) <= addr) return;
+    info = sec->sym_addr_table + k;
+    unpack_elf_symbol_info(info->section, info->index, sym_info);
+    assert(IS_PPC64_FUNC_OPD(info->section->file, sym_info) || sym_info->section == sec);
+    sym_info->addr_index = k;
 }
 
 void elf_prev_symbol_by_address(ELF_SymbolInfo * sym_info) {
@@ -2476,7 +2707,27 @@ void elf_invalidate(void) {
     }
 }
 
+void elf_get_memory_usage(ELF_File * file, ELF_MemoryUsage * usage) {
+    unsigned n;
+    memset(usage, 0, sizeof(ELF_MemoryUsage));
+    for (n = 0; n < file->section_cnt; n++) {
+        ELF_Section * s = file->sections + n;
+        if (s->mmap_addr != NULL) usage->mapped_sections += s->mmap_size;
+        else if (s->data != NULL) usage->heap_sections += s->size;
+        if (s->sym_addr_table != NULL) usage->symbols += sizeof(ELF_SecSymbol) * s->sym_addr_cnt;
+        usage->symbols += addr_index_memory_size(&s->sym_addr_index);
+        if (s->sym_names_hash != NULL) usage->symbols += sizeof(unsigned) * 2 * s->sym_names_hash_size;
+    }
+}
+
 void ini_elf(void) {
+#if ENABLE_ELF_PARALLEL_DECOMPRESS
+    check_error(pthread_mutex_init(&decompress_lock, NULL));
+    check_error(pthread_cond_init(&decompress_cond, NULL));
+#endif
+#if ENABLE_DebugContext
+    ini_dwarf_cache();
+#endif
 }
 
 #endif /* ENABLE_ELF */
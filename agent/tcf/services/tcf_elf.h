@@ -28,6 +28,12 @@
 #  include <elf.h>
 #endif
 #include <tcf/framework/context.h>
+#include <tcf/framework/addrindex.h>
+
+#ifndef ENABLE_ELF_PARALLEL_DECOMPRESS
+/* Decompress compressed sections on worker threads */
+#  define ENABLE_ELF_PARALLEL_DECOMPRESS 1
+#endif
 
 #ifndef EM_RISCV
 #  define EM_RISCV      243 /* RISC-V */
@@ -432,6 +438,7 @@ typedef struct ELF_PHeader ELF_PHeader;
 /* TODO: fp_abi - value of Tag_GNU_Power_ABI_FP in gnu.attributes section */
 struct ELF_File {
     ELF_File * next;
+    ELF_File * next_in_hash;    /* Next file in the dev/inode hash table */
 
     char * name;
     dev_t dev;
@@ -488,7 +495,6 @@ struct ELF_File {
 struct ELF_SecSymbol {
     ELF_Section * section;
     unsigned index;
-    U8_T address;
 };
 
 struct ELF_SymbolInfo {
@@ -525,6 +531,7 @@ struct ELF_Section {
     U4_T compressed_type;
     U8_T compressed_size;
     U8_T compressed_offset;
+    struct ElfDecompressJob * decompress_job;
 
     void * mmap_addr;
     size_t mmap_size;
@@ -533,10 +540,10 @@ struct ELF_Section {
 
     unsigned sym_count;
 
-    /* Symbol by address search index */
+    /* Symbol by address search index, symbol addresses are kept in sym_addr_index */
     ELF_SecSymbol * sym_addr_table;
     unsigned sym_addr_cnt;
-    unsigned sym_addr_max;
+    AddressIndex sym_addr_index;
 
     /* Symbol by name search index */
     unsigned sym_names_hash_size;
@@ -587,6 +594,18 @@ extern ELF_File * elf_open_memory_region_file(MemoryRegion * module, int * error
  */
 extern int elf_load(ELF_Section * section);
 
+/* Memory used by ELF file data, bytes */
+typedef struct ELF_MemoryUsage {
+    U8_T heap_sections;     /* Section data read or decompressed into heap memory */
+    U8_T mapped_sections;   /* Section data mapped from files */
+    U8_T symbols;           /* Symbol search indexes */
+} ELF_MemoryUsage;
+
+/*
+ * Get memory used by loaded data of ELF file.
+ */
+extern void elf_get_memory_usage(ELF_File * file, ELF_MemoryUsage * usage);
+
 /*
  * Register ELF file close callback.
  * The callback is called each time an ELF file data is about to be disposed.
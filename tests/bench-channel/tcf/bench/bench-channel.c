@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Channel throughput and latency benchmark.
+ *
+ * Opens a number of TCP connections to an agent, and keeps one Diagnostics.echo
+ * command outstanding on each connection. Reports messages per second and
+ * round-trip latency percentiles.
+ *
+ * Usage: bench-channel [-h host] [-p port] [-c connections] [-n messages] [-s payload size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+typedef struct Connection {
+    int sock;
+    int hello;
+    unsigned sent;
+    unsigned done;
+    struct timespec start;
+    char buf[0x10000];
+    size_t buf_len;
+} Connection;
+
+static char * cmd_buf = NULL;
+static size_t cmd_len = 0;
+static double * latency = NULL;
+static unsigned latency_cnt = 0;
+
+static double time_diff(struct timespec * t0, struct timespec * t1) {
+    return (t1->tv_sec - t0->tv_sec) + (t1->tv_nsec - t0->tv_nsec) * 1e-9;
+}
+
+static void write_all(int sock, const char * buf, size_t len) {
+    while (len > 0) {
+        ssize_t wr = send(sock, buf, len, 0);
+        if (wr < 0) {
+            if (errno == EINTR) continue;
+            perror("send");
+            exit(1);
+        }
+        buf += wr;
+        len -= wr;
+    }
+}
+
+static int connect_to(const char * host, const char * port) {
+    int sock = -1;
+    int one = 1;
+    struct addrinfo hints;
+    struct addrinfo * res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        fprintf(stderr, "Cannot resolve %s:%s\n", host, port);
+        exit(1);
+    }
+    sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock < 0 || connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    freeaddrinfo(res);
+    return sock;
+}
+
+static void send_command(Connection * c) {
+    clock_gettime(CLOCK_MONOTONIC, &c->start);
+    write_all(c->sock, cmd_buf, cmd_len);
+    c->sent++;
+}
+
+/* Process complete messages in the input buffer, return number of replies */
+static unsigned read_messages(Connection * c) {
+    unsigned replies = 0;
+    size_t pos = 0;
+    size_t i = 0;
+    for (i = 0; i + 1 < c->buf_len; i++) {
+        if (c->buf[i] == 3 && c->buf[i + 1] == 1) {
+            if (c->buf[pos] == 'E') {
+                if (strncmp(c->buf + pos + 2, "Locator", 7) == 0) c->hello = 1;
+            }
+            else if (c->buf[pos] == 'R') {
+                replies++;
+            }
+            pos = i + 2;
+            i++;
+        }
+    }
+    memmove(c->buf, c->buf + pos, c->buf_len - pos);
+    c->buf_len -= pos;
+    return replies;
+}
+
+static int cmp_double(const void * x, const void * y) {
+    double a = *(const double *)x;
+    double b = *(const double *)y;
+    return a < b ? -1 : a > b;
+}
+
+int main(int argc, char ** argv) {
+    const char * host = "127.0.0.1";
+    const char * port = "1534";
+    unsigned conn_cnt = 16;
+    unsigned msg_cnt = 10000;
+    unsigned payload = 16;
+    unsigned total = 0;
+    unsigned i;
+    int opt;
+    Connection * conns = NULL;
+    struct pollfd * pfds = NULL;
+    struct timespec t0, t1;
+    static const char hello[] = "E\0Locator\0Hello\0[\"Diagnostics\"]\0\3\1";
+
+    while ((opt = getopt(argc, argv, "h:p:c:n:s:")) != -1) {
+        switch (opt) {
+        case 'h': host = optarg; break;
+        case 'p': port = optarg; break;
+        case 'c': conn_cnt = (unsigned)atoi(optarg); break;
+        case 'n': msg_cnt = (unsigned)atoi(optarg); break;
+        case 's': payload = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-h host] [-p port] [-c connections] [-n messages] [-s payload size]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (conn_cnt == 0 || msg_cnt == 0) return 1;
+
+    cmd_buf = (char *)malloc(payload + 64);
+    cmd_len = sprintf(cmd_buf, "C%c1%cDiagnostics%cecho%c\"", 0, 0, 0, 0);
+    memset(cmd_buf + cmd_len, 'x', payload);
+    cmd_len += payload;
+    cmd_len += sprintf(cmd_buf + cmd_len, "\"%c%c%c", 0, 3, 1);
+
+    latency = (double *)malloc(sizeof(double) * msg_cnt);
+    conns = (Connection *)calloc(conn_cnt, sizeof(Connection));
+    pfds = (struct pollfd *)calloc(conn_cnt, sizeof(struct pollfd));
+    for (i = 0; i < conn_cnt; i++) {
+        conns[i].sock = connect_to(host, port);
+        write_all(conns[i].sock, hello, sizeof(hello) - 1);
+        pfds[i].fd = conns[i].sock;
+        pfds[i].events = POLLIN;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < conn_cnt && total < msg_cnt; i++) {
+        send_command(conns + i);
+        total++;
+    }
+    while (latency_cnt < msg_cnt) {
+        if (poll(pfds, conn_cnt, 10000) <= 0) {
+            fprintf(stderr, "Timeout waiting for replies\n");
+            return 1;
+        }
+        for (i = 0; i < conn_cnt; i++) {
+            Connection * c = conns + i;
+            ssize_t rd = 0;
+            unsigned n = 0;
+            if ((pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0) continue;
+            rd = recv(c->sock, c->buf + c->buf_len, sizeof(c->buf) - c->buf_len, 0);
+            if (rd <= 0) {
+                fprintf(stderr, "Connection closed by the agent\n");
+                return 1;
+            }
+            c->buf_len += rd;
+            n = read_messages(c);
+            while (n-- > 0) {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                latency[latency_cnt++] = time_diff(&c->start, &now);
+                c->done++;
+                if (total < msg_cnt) {
+                    send_command(c);
+                    total++;
+                }
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    qsort(latency, latency_cnt, sizeof(double), cmp_double);
+    printf("connections %u, messages %u, payload %u bytes\n", conn_cnt, msg_cnt, payload);
+    printf("throughput  %.0f msg/s\n", msg_cnt / time_diff(&t0, &t1));
+    printf("latency     p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+        latency[latency_cnt / 2] * 1e6,
+        latency[latency_cnt * 9 / 10] * 1e6,
+        latency[latency_cnt * 99 / 100] * 1e6,
+        latency[latency_cnt - 1] * 1e6);
+    for (i = 0; i < conn_cnt; i++) close(conns[i].sock);
+    return 0;
+}
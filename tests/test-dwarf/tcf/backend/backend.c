@@ -36,6 +36,7 @@
 #include <tcf/services/memorymap.h>
 #include <tcf/services/dwarfframe.h>
 #include <tcf/services/dwarfcache.h>
+#include <tcf/services/dwarfnames.h>
 #include <tcf/services/stacktrace.h>
 #include <tcf/services/expressions.h>
 #include <tcf/services/dwarf.h>
@@ -1582,11 +1583,11 @@ static int is_in_segment(U8_T lt_addr) {
 
 static void test_public_names(void) {
     DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
-    unsigned n = 0;
+    unsigned n = 1; /* Entry 0 is reserved as hash chain terminator */
     unsigned m = 0;
     time_t time_start = time(0);
     while (n < cache->mPubNames.mCnt) {
-        ObjectInfo * obj = cache->mPubNames.mNext[n++].mObject;
+        ObjectInfo * obj = get_pub_names_object(cache, cache->mPubNames.mNext + n++);
         if (obj != NULL && (obj->mParent == NULL || obj->mParent->mTag != TAG_namespace)) {
             Symbol * sym1 = NULL;
             Symbol * sym2 = NULL;
@@ -1682,6 +1683,46 @@ static void test_public_names(void) {
     }
 }
 
+#if ENABLE_DWARF_NAMES
+static void accelerator_table_call_back(ObjectInfo * obj, void * args) {
+    ObjectInfo ** ref = (ObjectInfo **)args;
+    if (*ref == obj) *ref = NULL;
+}
+
+static void test_accelerator_table(void) {
+    DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
+    ELF_File * file = cache->mFile;
+    unsigned i;
+
+    /* Public names table is not built when the file has .debug_names or .gdb_index,
+     * check that each defined global function and variable can be found in the table */
+    if (cache->mNameIndex == NULL) return;
+    for (i = 0; i < file->section_cnt; i++) {
+        ObjectInfo * unit = cache->mObjectHashTable[i].mCompUnits;
+        while (unit != NULL) {
+            ObjectInfo * obj = get_dwarf_children(unit);
+            while (obj != NULL) {
+                if (obj->mName != NULL && obj->mDefinition == NULL &&
+                        (obj->mFlags & (DOIF_declaration | DOIF_specification | DOIF_abstract_origin)) == 0 &&
+                        ((obj->mTag == TAG_subprogram && (obj->mFlags & (DOIF_low_pc | DOIF_ranges)) != 0) ||
+                        (obj->mTag == TAG_variable && (obj->mFlags & DOIF_location) != 0))) {
+                    ObjectInfo * ref = obj;
+                    dwarf_names_lookup(cache, obj->mName, accelerator_table_call_back, &ref);
+                    if (ref != NULL) {
+                        set_errno(ERR_OTHER, "Object not found in accelerator table");
+                        printf("Object  : %s\n", obj->mName);
+                        error("dwarf_names_lookup");
+                    }
+                }
+                obj = obj->mSibling;
+            }
+            unit = unit->mSibling;
+        }
+        tmp_gc();
+    }
+}
+#endif
+
 static void check_addr_ranges(void) {
     DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
     if (cache->mAddrRangesCnt > 1) {
@@ -2180,6 +2221,9 @@ static void next_region(void) {
             }
             printf("pub names time: %ld.%06ld\n", (long)time_diff.tv_sec, time_diff.tv_nsec / 1000);
             fflush(stdout);
+#if ENABLE_DWARF_NAMES
+            test_accelerator_table();
+#endif
             check_addr_ranges();
             time_start = time_now;
         }
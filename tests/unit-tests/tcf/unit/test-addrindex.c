@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Address index tests: addr_index_rank() is compared with brute force search
+ * for empty, single entry and multi-level indexes, with duplicate keys,
+ * and for lookup of overlapping address ranges the way DWARF cache does it.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/addrindex.h>
+#include <tcf/unit/unit-tests.h>
+
+typedef struct TestRange {
+    uint64_t addr;
+    uint64_t size;
+} TestRange;
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void) {
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+static unsigned brute_rank(const uint64_t * keys, unsigned cnt, uint64_t key) {
+    unsigned r = 0;
+    while (r < cnt && keys[r] <= key) r++;
+    return r;
+}
+
+static void check_rank(AddressIndex * idx, const uint64_t * keys, unsigned cnt, uint64_t key) {
+    unsigned r = addr_index_rank(idx, key);
+    unsigned n = brute_rank(keys, cnt, key);
+    if (r != n) test_error("%u keys: rank of %#llx is %u, expected %u", cnt, (unsigned long long)key, r, n);
+}
+
+static void build_index(AddressIndex * idx, const uint64_t * keys, unsigned cnt) {
+    uint64_t * buf = addr_index_alloc(idx, cnt);
+    test_check(buf != NULL);
+    if (cnt > 0) memcpy(buf, keys, sizeof(uint64_t) * cnt);
+    addr_index_build(idx);
+    test_check(addr_index_memory_size(idx) >= sizeof(uint64_t) * cnt);
+}
+
+static void test_empty(void) {
+    AddressIndex idx;
+    build_index(&idx, NULL, 0);
+    test_check(addr_index_rank(&idx, 0) == 0);
+    test_check(addr_index_rank(&idx, 0x1000) == 0);
+    test_check(addr_index_rank(&idx, ~(uint64_t)0) == 0);
+    addr_index_dispose(&idx);
+    test_check(idx.keys == NULL);
+    test_check(addr_index_memory_size(&idx) == 0);
+}
+
+static void test_single(void) {
+    static const uint64_t keys[] = { 0, 0x1000, ~(uint64_t)0 };
+    unsigned i;
+    for (i = 0; i < sizeof(keys) / sizeof(uint64_t); i++) {
+        AddressIndex idx;
+        uint64_t k = keys[i];
+        build_index(&idx, &k, 1);
+        check_rank(&idx, &k, 1, 0);
+        check_rank(&idx, &k, 1, k);
+        check_rank(&idx, &k, 1, ~(uint64_t)0);
+        if (k > 0) check_rank(&idx, &k, 1, k - 1);
+        if (k < ~(uint64_t)0) check_rank(&idx, &k, 1, k + 1);
+        addr_index_dispose(&idx);
+    }
+}
+
+static void test_sizes(void) {
+    /* Counts around block and level boundaries */
+    static const unsigned counts[] = {
+        2, 3, ADDR_INDEX_FANOUT - 1, ADDR_INDEX_FANOUT, ADDR_INDEX_FANOUT + 1,
+        ADDR_INDEX_FANOUT * ADDR_INDEX_FANOUT - 1, ADDR_INDEX_FANOUT * ADDR_INDEX_FANOUT,
+        ADDR_INDEX_FANOUT * ADDR_INDEX_FANOUT + 1, 1000, 4097, 70000
+    };
+    unsigned i;
+    for (i = 0; i < sizeof(counts) / sizeof(unsigned); i++) {
+        unsigned cnt = counts[i];
+        uint64_t * keys = (uint64_t *)loc_alloc(sizeof(uint64_t) * cnt);
+        uint64_t addr = i & 1 ? 0 : 0x400000;
+        AddressIndex idx;
+        unsigned j;
+        for (j = 0; j < cnt; j++) {
+            /* Runs of duplicate keys, like ranges that start at same address */
+            if (rnd() % 4 != 0) addr += rnd() % 0x100 + 1;
+            keys[j] = addr;
+        }
+        build_index(&idx, keys, cnt);
+        check_rank(&idx, keys, cnt, 0);
+        check_rank(&idx, keys, cnt, ~(uint64_t)0);
+        for (j = 0; j < cnt; j++) {
+            if (cnt > 1000 && j % 7 != 0) continue;
+            check_rank(&idx, keys, cnt, keys[j]);
+            check_rank(&idx, keys, cnt, keys[j] + 1);
+            if (keys[j] > 0) check_rank(&idx, keys, cnt, keys[j] - 1);
+        }
+        addr_index_dispose(&idx);
+        loc_free(keys);
+    }
+}
+
+/* Same search as find_comp_unit_addr_range() in dwarfcache.c */
+static TestRange * find_range(AddressIndex * idx, TestRange * ranges, unsigned cnt, uint64_t max_size, uint64_t addr) {
+    unsigned k = 0;
+    if (addr >= max_size) k = addr_index_rank(idx, addr - max_size);
+    for (; k < cnt; k++) {
+        TestRange * r = ranges + k;
+        if (r->addr > addr) break;
+        if (r->addr + r->size <= addr) continue;
+        return r;
+    }
+    return NULL;
+}
+
+static TestRange * brute_find_range(TestRange * ranges, unsigned cnt, uint64_t addr) {
+    unsigned k;
+    for (k = 0; k < cnt; k++) {
+        TestRange * r = ranges + k;
+        if (r->addr <= addr && r->addr + r->size > addr) return r;
+    }
+    return NULL;
+}
+
+static void check_ranges(TestRange * ranges, unsigned cnt) {
+    uint64_t * keys = (uint64_t *)loc_alloc(sizeof(uint64_t) * (cnt + 1));
+    uint64_t max_size = 0;
+    AddressIndex idx;
+    unsigned i;
+
+    for (i = 0; i < cnt; i++) {
+        if (i > 0) test_check(ranges[i - 1].addr <= ranges[i].addr);
+        if (ranges[i].size > max_size) max_size = ranges[i].size;
+        keys[i] = ranges[i].addr;
+    }
+    build_index(&idx, keys, cnt);
+    for (i = 0; i < cnt; i++) {
+        static const int64_t deltas[] = { -1, 0, 1 };
+        unsigned j;
+        for (j = 0; j < sizeof(deltas) / sizeof(int64_t); j++) {
+            uint64_t a = ranges[i].addr + deltas[j];
+            uint64_t b = ranges[i].addr + ranges[i].size + deltas[j];
+            if (find_range(&idx, ranges, cnt, max_size, a) != brute_find_range(ranges, cnt, a)) {
+                test_error("Wrong range found for address %#llx", (unsigned long long)a);
+            }
+            if (find_range(&idx, ranges, cnt, max_size, b) != brute_find_range(ranges, cnt, b)) {
+                test_error("Wrong range found for address %#llx", (unsigned long long)b);
+            }
+        }
+    }
+    addr_index_dispose(&idx);
+    loc_free(keys);
+}
+
+static void test_overlapping_ranges(void) {
+    /* A range that contains other ranges, ranges with same start, and adjacent ranges */
+    static TestRange ranges[] = {
+        { 0x1000, 0x1000 },
+        { 0x1000, 0x10 },
+        { 0x1008, 0x100 },
+        { 0x1800, 0x1000 },
+        { 0x1800, 0x800 },
+        { 0x2800, 0x10 },
+        { 0x2810, 0x10 },
+        { 0x3000, 0 },
+        { 0x3000, 0x20 },
+        { 0x10000, 0x100000 },
+    };
+    unsigned cnt = 0;
+    TestRange * buf = NULL;
+    unsigned i;
+
+    check_ranges(ranges, sizeof(ranges) / sizeof(TestRange));
+    check_ranges(ranges, 1);
+
+    /* Many small ranges overlapped by few large ones */
+    cnt = 5000;
+    buf = (TestRange *)loc_alloc(sizeof(TestRange) * cnt);
+    for (i = 0; i < cnt; i++) {
+        buf[i].addr = (i == 0 ? 0x100000 : buf[i - 1].addr) + rnd() % 0x40;
+        buf[i].size = rnd() % 50 == 0 ? rnd() % 0x4000 : rnd() % 0x80 + 1;
+    }
+    check_ranges(buf, cnt);
+    loc_free(buf);
+}
+
+void test_addrindex(void) {
+    test_empty();
+    test_single();
+    test_sizes();
+    test_overlapping_ranges();
+    test_done();
+}
@@ -0,0 +1,365 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Decompression tests: inflate_buf(), inflate_zlib() and zstd_decompress().
+ * The decoders are checked against fixtures created by zlib and zstd reference tools.
+ * Truncated and corrupted input must be rejected without reading or writing out of buffer bounds.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/compression.h>
+#include <tcf/framework/zstd.h>
+#include <tcf/unit/unit-tests.h>
+
+#define TEXT_LINES      64
+#define RANDOM_SIZE     200
+#define RLE_SIZE        3000
+
+/* zlib -9 of the test text: dynamic Huffman block */
+static const uint8_t zlib_text[] = {
+    0x78, 0xda, 0x95, 0xd6, 0xd9, 0x51, 0x04, 0x31, 0x0c, 0x84, 0xe1, 0xf7,
+    0x8e, 0xc2, 0x21, 0x8c, 0x25, 0xcb, 0x07, 0x71, 0x90, 0x00, 0xc7, 0x72,
+    0xc3, 0xc0, 0x2e, 0xcb, 0x15, 0x3d, 0x4a, 0xe1, 0x7f, 0x9e, 0xea, 0xb2,
+    0xe5, 0xcf, 0xee, 0x9a, 0xed, 0xa2, 0x5c, 0x3e, 0x1c, 0xca, 0xc7, 0xf9,
+    0xf1, 0xe6, 0xb9, 0x5c, 0x1f, 0xf7, 0xef, 0xb7, 0x72, 0xb7, 0xff, 0x94,
+    0xa7, 0xf3, 0xeb, 0xfb, 0xa9, 0xec, 0x5f, 0x87, 0x63, 0xf9, 0xcc, 0xcf,
+    0x2f, 0x57, 0x7f, 0xbf, 0xe5, 0x76, 0xbf, 0x2f, 0x9b, 0x2a, 0x0b, 0x54,
+    0x19, 0x0b, 0x34, 0x39, 0x0b, 0x2c, 0x35, 0xb8, 0xa5, 0xae, 0x60, 0x09,
+    0x0b, 0x75, 0x96, 0xf0, 0xae, 0x01, 0xe7, 0x5e, 0x9a, 0x2c, 0xd1, 0x9b,
+    0x16, 0x4b, 0xcc, 0xaa, 0xba, 0xc1, 0x41, 0x54, 0xa1, 0xb8, 0x35, 0x55,
+    0x6a, 0x3e, 0x54, 0xa1, 0xfa, 0x30, 0x55, 0xe8, 0x9e, 0x09, 0xe8, 0xee,
+    0x79, 0x5e, 0x10, 0xbe, 0xe7, 0x2a, 0x50, 0x7e, 0x85, 0x2a, 0xa4, 0xf7,
+    0x64, 0x81, 0xf6, 0x63, 0x93, 0x41, 0xfb, 0x6a, 0x32, 0x88, 0x1f, 0x2e,
+    0x83, 0xf8, 0xab, 0xcb, 0x20, 0x7e, 0x6b, 0x32, 0x88, 0xbf, 0xb2, 0x88,
+    0xa0, 0x7e, 0xcb, 0x59, 0xa0, 0xfe, 0xca, 0x8d, 0x41, 0xfd, 0x48, 0x17,
+    0xa8, 0x3f, 0x65, 0x10, 0xbf, 0x87, 0x1c, 0xe2, 0xdb, 0x90, 0x43, 0xfc,
+    0x39, 0xe5, 0x10, 0x3f, 0xb2, 0xee, 0x21, 0xbe, 0x99, 0x1c, 0xe2, 0xcf,
+    0x25, 0x87, 0xf8, 0xbd, 0xca, 0x69, 0xe7, 0xe7, 0x21, 0x43, 0xfc, 0x9a,
+    0xab, 0x50, 0xfc, 0x2e, 0xa7, 0xfa, 0x5d, 0x0d, 0xea, 0xb7, 0xa9, 0x06,
+    0xf5, 0xdd, 0xd4, 0xa0, 0x7e, 0xcd, 0x55, 0xa0, 0x7e, 0x8e, 0x42, 0x5f,
+    0xbe, 0xab, 0x41, 0xfc, 0x19, 0x6a, 0x10, 0x7f, 0xe4, 0x6f, 0x08, 0xc4,
+    0x1f, 0xb9, 0x0a, 0xc4, 0x1f, 0x39, 0xcb, 0xc2, 0x91, 0xd8, 0xf0, 0xc6,
+    0xa2, 0xe2, 0xf1, 0xc3, 0xf0, 0x21, 0x87, 0x63, 0xca, 0x68, 0xf4, 0xbe,
+    0x44, 0xe0, 0x4b, 0x19, 0x1d, 0x5f, 0xfd, 0x18, 0xf8, 0x81, 0xc5, 0xc4,
+    0xcf, 0x38, 0x16, 0x2e, 0x8b, 0xbe, 0xe1, 0x4a, 0xea, 0x15, 0x17, 0x5f,
+    0x37, 0x5c, 0xaf, 0xdd, 0x71, 0x89, 0xff, 0x03, 0xbf, 0x55, 0x47, 0xee
+};
+
+/* zlib -0 of the test random data: stored block */
+static const uint8_t zlib_stored[] = {
+    0x78, 0x01, 0x01, 0xc8, 0x00, 0x37, 0xff, 0x41, 0x96, 0x27, 0xc4, 0xf9,
+    0x95, 0xd9, 0x9c, 0xbf, 0x0f, 0x0a, 0x31, 0x23, 0xaf, 0x7d, 0xc4, 0xe2,
+    0xd2, 0xe2, 0xe3, 0xe9, 0x93, 0x50, 0x28, 0x2c, 0x75, 0x42, 0xb3, 0x4d,
+    0xe4, 0xf7, 0xef, 0xee, 0x56, 0xe1, 0xca, 0x31, 0xad, 0x99, 0x69, 0xb5,
+    0x3b, 0x7d, 0x10, 0x1b, 0x7a, 0xde, 0xb4, 0xe3, 0x61, 0x7a, 0x83, 0x28,
+    0xe0, 0x9f, 0x4b, 0x85, 0xfa, 0x28, 0x87, 0x38, 0x75, 0x49, 0x8f, 0x48,
+    0x20, 0xbf, 0x1e, 0x3d, 0x33, 0xef, 0x36, 0xad, 0x30, 0x05, 0x14, 0xc2,
+    0x59, 0x0c, 0xb3, 0x62, 0x9f, 0xab, 0x1d, 0xa6, 0xa6, 0xf1, 0x84, 0xd3,
+    0x33, 0x56, 0xdd, 0xf8, 0x1d, 0xeb, 0x7b, 0xe3, 0xb7, 0x56, 0xe7, 0x14,
+    0x23, 0x11, 0xee, 0xe0, 0x1a, 0x11, 0xa5, 0xe6, 0x1c, 0xc8, 0xdb, 0x99,
+    0xfe, 0x20, 0x37, 0x60, 0x6e, 0xf2, 0xfd, 0xb2, 0xb7, 0x10, 0x3a, 0x1e,
+    0xfe, 0xd3, 0xcd, 0x1e, 0xba, 0xe5, 0x8a, 0x3c, 0x13, 0x9f, 0x78, 0xce,
+    0x7e, 0x3d, 0xe6, 0x5f, 0xb0, 0xbd, 0xc3, 0x8c, 0xcc, 0x2c, 0x92, 0xe3,
+    0x5b, 0xb9, 0xda, 0x0c, 0x7b, 0xc6, 0xde, 0x4a, 0x51, 0xe4, 0x18, 0x26,
+    0xa4, 0x57, 0xa5, 0xc8, 0x35, 0xa7, 0xb8, 0x48, 0x3e, 0x4d, 0xb5, 0x10,
+    0x20, 0x84, 0x7d, 0x0e, 0x30, 0xd2, 0x2c, 0x46, 0x2d, 0xc8, 0x3c, 0x14,
+    0xce, 0x16, 0xc7, 0x25, 0x6f, 0xea, 0x6c, 0xf2, 0xcc, 0x45, 0x15, 0x53,
+    0x58, 0xa1, 0x8d, 0xc3, 0x3a, 0x65, 0x35
+};
+
+/* zlib -9 of "hello, hello, hello!": fixed Huffman block */
+static const uint8_t zlib_fixed[] = {
+    0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa2,
+    0x14, 0x01, 0x4b, 0x1e, 0x06, 0xf6
+};
+
+/* zstd -19 --check of the test text: compressed block with Huffman literals and FSE tables */
+static const uint8_t zstd_text[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0x64, 0xad, 0x0b, 0x9d, 0x08, 0x00, 0x16, 0x55,
+    0x34, 0x1c, 0x50, 0x4f, 0x41, 0x73, 0x0f, 0xff, 0x58, 0x6f, 0x3e, 0xe8,
+    0x46, 0x9b, 0xdb, 0x4d, 0xcc, 0xcc, 0xa0, 0x6d, 0x7b, 0x69, 0xc9, 0xd6,
+    0x2d, 0xb8, 0x33, 0x43, 0x31, 0x6b, 0x3b, 0x00, 0x26, 0x00, 0x27, 0x00,
+    0x55, 0x7a, 0xf3, 0x6c, 0x98, 0x1f, 0x33, 0x63, 0xe1, 0x47, 0x37, 0xd6,
+    0x3e, 0xb5, 0xd1, 0xed, 0x85, 0x1c, 0x38, 0x0a, 0x88, 0xc5, 0x85, 0xc0,
+    0x02, 0x61, 0x34, 0x22, 0xc8, 0x83, 0x31, 0xe1, 0x20, 0x10, 0x0e, 0x0c,
+    0x12, 0x09, 0xa4, 0xc2, 0x61, 0x40, 0x1a, 0x28, 0x1c, 0x8f, 0x01, 0xa2,
+    0x40, 0x80, 0x20, 0xf1, 0x40, 0x18, 0x8d, 0x00, 0x02, 0x50, 0x02, 0x97,
+    0x33, 0xb4, 0x1d, 0xa4, 0xcb, 0x8e, 0xee, 0x31, 0xda, 0xac, 0x68, 0x3c,
+    0x44, 0xd7, 0x95, 0xa6, 0x16, 0xba, 0x98, 0xd3, 0xab, 0xb2, 0xdf, 0x31,
+    0x9d, 0x10, 0x7b, 0xeb, 0x3a, 0x59, 0x27, 0x53, 0xdd, 0x18, 0x75, 0xa3,
+    0xf6, 0x67, 0xd7, 0x31, 0x1b, 0xcb, 0xce, 0x92, 0x4d, 0x55, 0x3b, 0xad,
+    0xd8, 0x88, 0xa7, 0xc6, 0xcc, 0xba, 0x35, 0xf5, 0x15, 0xd6, 0xc5, 0xab,
+    0x4f, 0x5a, 0x4d, 0x54, 0xb5, 0x1d, 0xd5, 0x99, 0xad, 0x0d, 0x95, 0xfa,
+    0xf0, 0xd0, 0x99, 0x14, 0x85, 0x17, 0x09, 0xbf, 0x2a, 0xde, 0x16, 0x1c,
+    0xf3, 0xdc, 0x88, 0x79, 0xa7, 0x99, 0x9b, 0x0a, 0xef, 0xec, 0xdd, 0x68,
+    0x77, 0x9d, 0xba, 0x2f, 0xe9, 0x3e, 0xbd, 0xaf, 0xdc, 0xb1, 0x2b, 0xed,
+    0x33, 0xf6, 0x31, 0x68, 0x5f, 0x06, 0x3f, 0xa8, 0x11, 0x24, 0x10, 0x8f,
+    0xdf, 0xff, 0x0e, 0x90, 0x2d, 0xd7, 0x0c, 0x11, 0xfc, 0xff, 0xff, 0xf2,
+    0x07, 0x22, 0x77, 0x6f, 0x37, 0xac, 0x6f, 0x7f, 0x98, 0xa5, 0x41, 0x98,
+    0x80, 0x78, 0xd6, 0x6c, 0xbe, 0xef, 0xdf, 0xff, 0x7b, 0x03, 0xfb, 0xed,
+    0xf7, 0xef, 0xff, 0x58, 0x9d, 0x9d, 0x33, 0xc3, 0xad, 0xfe, 0xac, 0x4d,
+    0x57, 0xb5, 0xbd, 0xd6, 0x40, 0xa6, 0xd6, 0xae, 0x02, 0x6f, 0x73, 0x85,
+    0x50
+};
+
+/* zstd --no-check of 3000 bytes 'a' */
+static const uint8_t zstd_rle[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0x60, 0xb8, 0x0a, 0x4d, 0x00, 0x00, 0x10, 0x61,
+    0x61, 0x01, 0x00, 0xb3, 0xf3, 0x01, 0x16
+};
+
+/* zstd of the test random data: raw block */
+static const uint8_t zstd_raw[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0x24, 0xc8, 0x41, 0x06, 0x00, 0x41, 0x96, 0x27,
+    0xc4, 0xf9, 0x95, 0xd9, 0x9c, 0xbf, 0x0f, 0x0a, 0x31, 0x23, 0xaf, 0x7d,
+    0xc4, 0xe2, 0xd2, 0xe2, 0xe3, 0xe9, 0x93, 0x50, 0x28, 0x2c, 0x75, 0x42,
+    0xb3, 0x4d, 0xe4, 0xf7, 0xef, 0xee, 0x56, 0xe1, 0xca, 0x31, 0xad, 0x99,
+    0x69, 0xb5, 0x3b, 0x7d, 0x10, 0x1b, 0x7a, 0xde, 0xb4, 0xe3, 0x61, 0x7a,
+    0x83, 0x28, 0xe0, 0x9f, 0x4b, 0x85, 0xfa, 0x28, 0x87, 0x38, 0x75, 0x49,
+    0x8f, 0x48, 0x20, 0xbf, 0x1e, 0x3d, 0x33, 0xef, 0x36, 0xad, 0x30, 0x05,
+    0x14, 0xc2, 0x59, 0x0c, 0xb3, 0x62, 0x9f, 0xab, 0x1d, 0xa6, 0xa6, 0xf1,
+    0x84, 0xd3, 0x33, 0x56, 0xdd, 0xf8, 0x1d, 0xeb, 0x7b, 0xe3, 0xb7, 0x56,
+    0xe7, 0x14, 0x23, 0x11, 0xee, 0xe0, 0x1a, 0x11, 0xa5, 0xe6, 0x1c, 0xc8,
+    0xdb, 0x99, 0xfe, 0x20, 0x37, 0x60, 0x6e, 0xf2, 0xfd, 0xb2, 0xb7, 0x10,
+    0x3a, 0x1e, 0xfe, 0xd3, 0xcd, 0x1e, 0xba, 0xe5, 0x8a, 0x3c, 0x13, 0x9f,
+    0x78, 0xce, 0x7e, 0x3d, 0xe6, 0x5f, 0xb0, 0xbd, 0xc3, 0x8c, 0xcc, 0x2c,
+    0x92, 0xe3, 0x5b, 0xb9, 0xda, 0x0c, 0x7b, 0xc6, 0xde, 0x4a, 0x51, 0xe4,
+    0x18, 0x26, 0xa4, 0x57, 0xa5, 0xc8, 0x35, 0xa7, 0xb8, 0x48, 0x3e, 0x4d,
+    0xb5, 0x10, 0x20, 0x84, 0x7d, 0x0e, 0x30, 0xd2, 0x2c, 0x46, 0x2d, 0xc8,
+    0x3c, 0x14, 0xce, 0x16, 0xc7, 0x25, 0x6f, 0xea, 0x6c, 0xf2, 0xcc, 0x45,
+    0x15, 0x53, 0x58, 0xa1, 0x8d, 0xea, 0xd8, 0xc5, 0x75
+};
+static uint8_t text[TEXT_LINES * 64];
+static size_t text_size = 0;
+static uint8_t random_data[RANDOM_SIZE];
+
+static void make_test_data(void) {
+    uint32_t x = 1;
+    unsigned i;
+    text_size = 0;
+    for (i = 0; i < TEXT_LINES; i++) {
+        text_size += snprintf((char *)text + text_size, sizeof(text) - text_size,
+            "%u: The quick brown fox jumps over the lazy dog %u\n", i, i * i % 97);
+    }
+    for (i = 0; i < RANDOM_SIZE; i++) {
+        x = x * 1103515245 + 12345;
+        random_data[i] = (uint8_t)(x >> 24);
+    }
+}
+
+/* Copy input into a buffer of exact size, so that reading past the end can be detected by memory checkers */
+static uint8_t * copy_input(const uint8_t * buf, size_t size) {
+    uint8_t * p = (uint8_t *)loc_alloc(size);
+    memcpy(p, buf, size);
+    return p;
+}
+
+static void check_zlib(const uint8_t * src, size_t src_size, const uint8_t * exp, size_t exp_size) {
+    uint8_t * inp = copy_input(src, src_size);
+    uint8_t * out = (uint8_t *)loc_alloc(exp_size);
+    size_t src_used = 0;
+    size_t dst_used = 0;
+
+    if (inflate_zlib(inp, src_size, out, exp_size, &dst_used) < 0) test_error("inflate_zlib: %s", errno_to_str(errno));
+    test_check(dst_used == exp_size);
+    test_check(memcmp(out, exp, exp_size) == 0);
+
+    /* Raw deflate stream, without zlib header and checksum */
+    memset(out, 0, exp_size);
+    if (inflate_buf(inp + 2, src_size - 2, &src_used, out, exp_size, &dst_used) < 0) test_error("inflate_buf: %s", errno_to_str(errno));
+    test_check(src_used == src_size - 6);
+    test_check(dst_used == exp_size);
+    test_check(memcmp(out, exp, exp_size) == 0);
+
+    /* Output buffer too small */
+    test_check(inflate_zlib(inp, src_size, out, exp_size - 1, NULL) < 0);
+    test_check(errno == ERR_BUFFER_OVERFLOW);
+
+    loc_free(inp);
+    loc_free(out);
+}
+
+static void check_zlib_corrupted(const uint8_t * src, size_t src_size, size_t dst_size) {
+    uint8_t * out = (uint8_t *)loc_alloc(dst_size);
+    size_t i;
+
+    for (i = 0; i < src_size; i++) {
+        uint8_t * inp = copy_input(src, i);
+        if (inflate_zlib(inp, i, out, dst_size, NULL) == 0) test_error("zlib stream truncated to %u bytes is accepted", (unsigned)i);
+        loc_free(inp);
+    }
+    for (i = 0; i < src_size; i++) {
+        uint8_t * inp = copy_input(src, src_size);
+        inp[i] ^= 0xff;
+        if (inflate_zlib(inp, src_size, out, dst_size, NULL) == 0) test_error("zlib stream with byte %u corrupted is accepted", (unsigned)i);
+        loc_free(inp);
+    }
+    loc_free(out);
+}
+
+static void test_inflate(void) {
+    uint8_t buf[64];
+    uint8_t hdr[2];
+
+    check_zlib(zlib_text, sizeof(zlib_text), text, text_size);
+    check_zlib(zlib_stored, sizeof(zlib_stored), random_data, RANDOM_SIZE);
+    check_zlib(zlib_fixed, sizeof(zlib_fixed), (const uint8_t *)"hello, hello, hello!", 20);
+
+    check_zlib_corrupted(zlib_text, sizeof(zlib_text), text_size);
+    check_zlib_corrupted(zlib_stored, sizeof(zlib_stored), RANDOM_SIZE);
+    check_zlib_corrupted(zlib_fixed, sizeof(zlib_fixed), 20);
+
+    /* Bad zlib headers: compression method, header check bits, preset dictionary */
+    memcpy(buf, zlib_fixed, sizeof(zlib_fixed));
+    buf[0] = 0x79;
+    test_check(inflate_zlib(buf, sizeof(zlib_fixed), buf + 32, 32, NULL) < 0);
+    test_check(errno == ERR_UNSUPPORTED);
+    buf[0] = zlib_fixed[0];
+    buf[1] = zlib_fixed[1] + 1;
+    test_check(inflate_zlib(buf, sizeof(zlib_fixed), buf + 32, 32, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+    hdr[0] = 0x78;
+    hdr[1] = 0x20;
+    hdr[1] += 31 - (hdr[0] * 256 + hdr[1]) % 31;
+    buf[0] = hdr[0];
+    buf[1] = hdr[1];
+    test_check(inflate_zlib(buf, sizeof(zlib_fixed), buf + 32, 32, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+
+    /* Reserved block type */
+    buf[0] = 0x07;
+    test_check(inflate_buf(buf, 1, NULL, buf + 32, 32, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+
+    /* Stored block length does not match its complement */
+    buf[0] = 0x01;
+    buf[1] = 0x04;
+    buf[2] = 0x00;
+    buf[3] = 0xfb;
+    buf[4] = 0xfe;
+    test_check(inflate_buf(buf, 9, NULL, buf + 32, 32, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+
+    /* Empty input */
+    test_check(inflate_buf(buf, 0, NULL, buf + 32, 32, NULL) < 0);
+}
+
+static void check_zstd(const uint8_t * src, size_t src_size, const uint8_t * exp, size_t exp_size) {
+    uint8_t * inp = copy_input(src, src_size);
+    uint8_t * out = (uint8_t *)loc_alloc(exp_size);
+    size_t dst_used = 0;
+
+    if (zstd_decompress(inp, src_size, out, exp_size, &dst_used) < 0) test_error("zstd_decompress: %s", errno_to_str(errno));
+    test_check(dst_used == exp_size);
+    test_check(memcmp(out, exp, exp_size) == 0);
+
+    /* Output buffer too small */
+    test_check(zstd_decompress(inp, src_size, out, exp_size - 1, NULL) < 0);
+    test_check(errno == ERR_BUFFER_OVERFLOW);
+    loc_free(inp);
+    loc_free(out);
+}
+
+static void check_zstd_truncated(const uint8_t * src, size_t src_size, size_t dst_size) {
+    uint8_t * out = (uint8_t *)loc_alloc(dst_size);
+    size_t i;
+
+    for (i = 1; i < src_size; i++) {
+        uint8_t * inp = copy_input(src, i);
+        if (zstd_decompress(inp, i, out, dst_size, NULL) == 0) test_error("zstd frame truncated to %u bytes is accepted", (unsigned)i);
+        loc_free(inp);
+    }
+    loc_free(out);
+}
+
+static void check_zstd_corrupted(const uint8_t * src, size_t src_size, size_t dst_size) {
+    uint8_t * out = (uint8_t *)loc_alloc(dst_size);
+    size_t i;
+
+    for (i = 0; i < src_size; i++) {
+        uint8_t * inp = copy_input(src, src_size);
+        inp[i] ^= 0xff;
+        if (zstd_decompress(inp, src_size, out, dst_size, NULL) == 0) test_error("zstd frame with byte %u corrupted is accepted", (unsigned)i);
+        loc_free(inp);
+    }
+    loc_free(out);
+}
+
+static void test_zstd(void) {
+    static const uint8_t skippable[] = { 0x50, 0x2a, 0x4d, 0x18, 0x04, 0x00, 0x00, 0x00, 0xde, 0xad, 0xbe, 0xef };
+    uint8_t * rle = (uint8_t *)loc_alloc(RLE_SIZE);
+    size_t src_size = sizeof(zstd_raw) + sizeof(zstd_text) + sizeof(skippable) + sizeof(zstd_rle);
+    size_t exp_size = RANDOM_SIZE + text_size + RLE_SIZE;
+    uint8_t * src = (uint8_t *)loc_alloc(src_size);
+    uint8_t * exp = (uint8_t *)loc_alloc(exp_size);
+    uint8_t buf[32];
+    size_t pos = 0;
+
+    memset(rle, 'a', RLE_SIZE);
+    check_zstd(zstd_text, sizeof(zstd_text), text, text_size);
+    check_zstd(zstd_raw, sizeof(zstd_raw), random_data, RANDOM_SIZE);
+    check_zstd(zstd_rle, sizeof(zstd_rle), rle, RLE_SIZE);
+
+    check_zstd_truncated(zstd_text, sizeof(zstd_text), text_size);
+    check_zstd_truncated(zstd_raw, sizeof(zstd_raw), RANDOM_SIZE);
+    check_zstd_truncated(zstd_rle, sizeof(zstd_rle), RLE_SIZE);
+
+    /* Frames with content checksum */
+    check_zstd_corrupted(zstd_text, sizeof(zstd_text), text_size);
+    check_zstd_corrupted(zstd_raw, sizeof(zstd_raw), RANDOM_SIZE);
+
+    /* Sequence of frames, including a skippable frame */
+    memcpy(src + pos, zstd_raw, sizeof(zstd_raw));
+    pos += sizeof(zstd_raw);
+    memcpy(src + pos, zstd_text, sizeof(zstd_text));
+    pos += sizeof(zstd_text);
+    memcpy(src + pos, skippable, sizeof(skippable));
+    pos += sizeof(skippable);
+    memcpy(src + pos, zstd_rle, sizeof(zstd_rle));
+    memcpy(exp, random_data, RANDOM_SIZE);
+    memcpy(exp + RANDOM_SIZE, text, text_size);
+    memcpy(exp + RANDOM_SIZE + text_size, rle, RLE_SIZE);
+    check_zstd(src, src_size, exp, exp_size);
+
+    /* Bad magic number */
+    memcpy(buf, zstd_rle, sizeof(zstd_rle));
+    buf[0] ^= 1;
+    test_check(zstd_decompress(buf, sizeof(zstd_rle), rle, RLE_SIZE, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+
+    /* Reserved bit of frame header descriptor */
+    memcpy(buf, zstd_rle, sizeof(zstd_rle));
+    buf[4] |= 0x08;
+    test_check(zstd_decompress(buf, sizeof(zstd_rle), rle, RLE_SIZE, NULL) < 0);
+    test_check(errno == ERR_INV_FORMAT);
+
+    loc_free(rle);
+    loc_free(src);
+    loc_free(exp);
+}
+
+void test_compression(void) {
+    make_test_data();
+    test_inflate();
+    test_zstd();
+    test_done();
+}
@@ -0,0 +1,561 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Deflate stream compressor and compressed channel output tests.
+ *
+ * Output of deflate_stream_block(), mixed with stored blocks of incompressible data,
+ * must decode by inflate_buf() into the original data.
+ *
+ * A raw TCP client announces "Deflate" and "ZeroCopy" in its Hello message to a loopback server,
+ * and decodes everything the agent sends: plain messages up to a message boundary after Hello,
+ * then ESC 4 frames with 7 bits per byte length, which together form one raw deflate stream.
+ * The stream is decoded by inflate_buf() after each received frame. Commands are sent one by one,
+ * so replies are sent in separate flushes: an echo of text, FileSystem.read of random data,
+ * which must fall back to a stored block, and Locator.redirect to the same server.
+ * The proxy created by the redirect must not pass "Deflate" to the target,
+ * so the client channel must remain the only channel with compressed output.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/streams.h>
+#include <tcf/framework/channel.h>
+#include <tcf/framework/outputbuf.h>
+#include <tcf/framework/compression.h>
+#include <tcf/main/server.h>
+#include <tcf/unit/unit-tests.h>
+
+#define TEXT_LINES      64
+#define RANDOM_SIZE     200
+
+static uint8_t text[TEXT_LINES * 64];
+static size_t text_size = 0;
+static uint8_t random_data[RANDOM_SIZE];
+
+static void make_test_data(void) {
+    uint32_t x = 1;
+    unsigned i;
+    text_size = 0;
+    for (i = 0; i < TEXT_LINES; i++) {
+        text_size += snprintf((char *)text + text_size, sizeof(text) - text_size,
+            "%u: The quick brown fox jumps over the lazy dog %u\n", i, i * i % 97);
+    }
+    for (i = 0; i < RANDOM_SIZE; i++) {
+        x = x * 1103515245 + 12345;
+        random_data[i] = (uint8_t)(x >> 24);
+    }
+}
+
+static void test_deflate_round_trip(void) {
+    static const size_t blocks[] = { 1, 100, 1000, 5000, DEFLATE_STREAM_MAX_BLOCK, 3, DEFLATE_STREAM_MAX_BLOCK, 20000 };
+    DeflateStream * s = deflate_stream_alloc();
+    size_t data_size = 0;
+    uint8_t * data = NULL;
+    size_t comp_size = 0;
+    size_t comp_max = 0;
+    uint8_t * comp = NULL;
+    uint8_t * out = NULL;
+    size_t src_used = 0;
+    size_t dst_used = 0;
+    size_t pos = 0;
+    unsigned stored_cnt = 0;
+    unsigned i;
+
+    for (i = 0; i < sizeof(blocks) / sizeof(size_t); i++) data_size += blocks[i];
+    data = (uint8_t *)loc_alloc(data_size);
+    /* Text mixed with incompressible data, text repeats are farther than the window size */
+    while (pos < data_size) {
+        size_t n = pos / RANDOM_SIZE % 5 == 4 ? RANDOM_SIZE : text_size;
+        if (n > data_size - pos) n = data_size - pos;
+        memcpy(data + pos, n == RANDOM_SIZE ? random_data : text, n);
+        pos += n;
+    }
+    for (pos = 0; pos + RANDOM_SIZE <= data_size; pos += 7919) {
+        memcpy(data + pos, random_data, RANDOM_SIZE);
+    }
+
+    comp_max = data_size + data_size / 8 + 64;
+    comp = (uint8_t *)loc_alloc(comp_max);
+    pos = 0;
+    for (i = 0; i < sizeof(blocks) / sizeof(size_t); i++) {
+        size_t n = deflate_stream_block(s, data + pos, blocks[i], comp + comp_size, comp_max - comp_size);
+        if (n == 0) {
+            comp_size += deflate_stream_stored_header(blocks[i], comp + comp_size);
+            memcpy(comp + comp_size, data + pos, blocks[i]);
+            comp_size += blocks[i];
+            stored_cnt++;
+        }
+        else {
+            test_check(n < blocks[i] + 5);
+            comp_size += n;
+        }
+        pos += blocks[i];
+    }
+    test_check(stored_cnt < sizeof(blocks) / sizeof(size_t));
+    test_check(comp_size < data_size);
+    /* Final empty stored block */
+    comp[comp_size++] = 0x01;
+    comp[comp_size++] = 0x00;
+    comp[comp_size++] = 0x00;
+    comp[comp_size++] = 0xff;
+    comp[comp_size++] = 0xff;
+
+    out = (uint8_t *)loc_alloc(data_size);
+    if (inflate_buf(comp, comp_size, &src_used, out, data_size, &dst_used) < 0) test_error("inflate_buf: %s", errno_to_str(errno));
+    test_check(src_used == comp_size);
+    test_check(dst_used == data_size);
+    test_check(memcmp(out, data, data_size) == 0);
+
+    /* A stream without the final block is incomplete */
+    test_check(inflate_buf(comp, comp_size - 5, NULL, out, data_size, NULL) < 0);
+
+    deflate_stream_free(s);
+    loc_free(data);
+    loc_free(comp);
+    loc_free(out);
+}
+
+/* Channel compression is enabled by default when the output queue buffer fits into a deflate block, see channel_tcp.c */
+#if defined(__linux__) && SERVICE_FileSystem && OUTPUT_QUEUE_BUF_SIZE <= DEFLATE_STREAM_MAX_BLOCK && \
+    (!defined(ENABLE_ChannelCompression) || ENABLE_ChannelCompression)
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define FRAME_HDR_SIZE  5
+#define RANDOM_READ     3000
+#define DECODED_MAX     0x100000
+#define POLL_DELAY      10000
+
+/* Commands, in order they are sent, command token is its index */
+enum {
+    CMD_NONE,
+    CMD_ECHO,
+    CMD_OPEN,
+    CMD_READ,
+    CMD_CLOSE,
+    CMD_REDIRECT,
+    CMD_ECHO_PROXY,
+    CMD_CNT
+};
+
+typedef struct Buffer {
+    uint8_t * buf;
+    size_t size;
+    size_t max;
+} Buffer;
+
+typedef struct Reply {
+    char * args;
+    size_t size;
+} Reply;
+
+static ChannelServer * test_server = NULL;
+static int test_sock = -1;
+static char test_port[32];
+static Buffer raw;          /* Bytes received from the socket */
+static size_t raw_pos = 0;  /* Bytes of 'raw' already decoded */
+static int compressed = 0;  /* Set when the first ESC 4 frame is received */
+static Buffer stream;       /* Raw deflate stream: contents of the frames */
+static Buffer decoded;      /* Plain data received before the first frame, followed by the decoded stream */
+static size_t plain_size = 0;
+static uint8_t * inflate_out = NULL;
+static unsigned frame_cnt = 0;
+static unsigned hello_cnt = 0;
+static int cmd = CMD_NONE;
+static Reply replies[CMD_CNT];
+static char file_handle[256];
+static char echo_text[2048];
+
+static void buf_add(Buffer * b, const void * data, size_t size) {
+    if (b->size + size > b->max) {
+        b->max = (b->size + size) * 2;
+        b->buf = (uint8_t *)loc_realloc(b->buf, b->max);
+    }
+    memcpy(b->buf + b->size, data, size);
+    b->size += size;
+}
+
+static void buf_free(Buffer * b) {
+    loc_free(b->buf);
+    memset(b, 0, sizeof(Buffer));
+}
+
+static void send_raw(const void * buf, size_t size) {
+    test_check(send(test_sock, buf, size, 0) == (ssize_t)size);
+}
+
+/* Send a message, 'args' are NULL terminated list of message fields, which must not contain ESC */
+static void send_message(const char ** args) {
+    Buffer b;
+    static const uint8_t eom[] = { ESC, 1 };
+    memset(&b, 0, sizeof(b));
+    while (*args != NULL) {
+        test_check(strchr(*args, ESC) == NULL);
+        buf_add(&b, *args, strlen(*args) + 1);
+        args++;
+    }
+    buf_add(&b, eom, sizeof(eom));
+    send_raw(b.buf, b.size);
+    buf_free(&b);
+}
+
+static void send_command(int n) {
+    char token[16];
+    char str[sizeof(echo_text) + 256];
+    const char * args[8];
+
+    cmd = n;
+    snprintf(token, sizeof(token), "%d", n);
+    args[0] = "C";
+    args[1] = token;
+    switch (n) {
+    case CMD_ECHO:
+    case CMD_ECHO_PROXY:
+        snprintf(str, sizeof(str), "\"%s\"", echo_text);
+        args[2] = "Diagnostics";
+        args[3] = "echo";
+        args[4] = str;
+        args[5] = NULL;
+        break;
+    case CMD_OPEN:
+        args[2] = "FileSystem";
+        args[3] = "open";
+        args[4] = "\"/dev/urandom\"";
+        args[5] = "1";
+        args[6] = "{}";
+        args[7] = NULL;
+        break;
+    case CMD_READ:
+        snprintf(str, sizeof(str), "\"%s\"", file_handle);
+        args[2] = "FileSystem";
+        args[3] = "read";
+        args[4] = str;
+        args[5] = "-1";
+        args[6] = "3000";
+        args[7] = NULL;
+        break;
+    case CMD_CLOSE:
+        snprintf(str, sizeof(str), "\"%s\"", file_handle);
+        args[2] = "FileSystem";
+        args[3] = "close";
+        args[4] = str;
+        args[5] = NULL;
+        break;
+    case CMD_REDIRECT:
+        snprintf(str, sizeof(str), "{\"TransportName\":\"TCP\",\"Host\":\"127.0.0.1\",\"Port\":\"%s\"}", test_port);
+        args[2] = "Locator";
+        args[3] = "redirect";
+        args[4] = str;
+        args[5] = NULL;
+        break;
+    }
+    send_message(args);
+}
+
+static void inflate_stream(void) {
+    static const uint8_t final_block[] = { 0x01, 0x00, 0x00, 0xff, 0xff };
+    uint8_t * src = (uint8_t *)loc_alloc(stream.size + sizeof(final_block));
+    size_t src_used = 0;
+    size_t dst_used = 0;
+
+    /* The channel stream never ends, add the final empty stored block to decode the data received so far */
+    memcpy(src, stream.buf, stream.size);
+    memcpy(src + stream.size, final_block, sizeof(final_block));
+    if (inflate_buf(src, stream.size + sizeof(final_block), &src_used, inflate_out, DECODED_MAX, &dst_used) < 0) {
+        test_error("Cannot decode frame %u: %s", frame_cnt, errno_to_str(errno));
+    }
+    test_check(src_used == stream.size + sizeof(final_block));
+    /* Data decoded from previous frames must not change */
+    test_check(dst_used >= decoded.size - plain_size);
+    test_check(memcmp(inflate_out, decoded.buf + plain_size, decoded.size - plain_size) == 0);
+    decoded.size = plain_size;
+    buf_add(&decoded, inflate_out, dst_used);
+    loc_free(src);
+}
+
+static void decode_input(void) {
+    while (raw_pos < raw.size) {
+        uint8_t * p = raw.buf + raw_pos;
+        size_t avail = raw.size - raw_pos;
+        size_t len = 0;
+        if (!compressed) {
+            if (p[0] != ESC) {
+                buf_add(&decoded, p, 1);
+                raw_pos++;
+                continue;
+            }
+            if (avail < 2) break;
+            if (p[1] == 4) {
+                /* Compression must start at a message boundary */
+                test_check(decoded.size >= 2);
+                test_check(decoded.buf[decoded.size - 2] == ESC && decoded.buf[decoded.size - 1] == 1);
+                plain_size = decoded.size;
+                compressed = 1;
+                continue;
+            }
+            if (p[1] == 3) {
+                /* ZeroCopy block, copied as is: length, 7 bits per byte, then the data */
+                size_t n = 2;
+                unsigned shift = 0;
+                while (n < avail) {
+                    len |= (size_t)(p[n] & 0x7f) << shift;
+                    shift += 7;
+                    if ((p[n++] & 0x80) == 0) break;
+                }
+                if (n == avail || (p[n - 1] & 0x80) != 0 || avail < n + len) break;
+                buf_add(&decoded, p, n + len);
+                raw_pos += n + len;
+                continue;
+            }
+            test_check(p[1] <= 2);
+            buf_add(&decoded, p, 2);
+            raw_pos += 2;
+            continue;
+        }
+        /* Frame header: ESC 4 <length: 3 bytes, 7 bits per byte, LSB first> */
+        if (avail < FRAME_HDR_SIZE) break;
+        test_check(p[0] == ESC && p[1] == 4);
+        test_check((p[2] & 0x80) != 0 && (p[3] & 0x80) != 0 && (p[4] & 0x80) == 0);
+        len = (p[2] & 0x7fu) | (size_t)(p[3] & 0x7fu) << 7 | (size_t)p[4] << 14;
+        test_check(len > 0);
+        if (avail < FRAME_HDR_SIZE + len) break;
+        /* A frame starts with a non-final block header */
+        test_check((p[FRAME_HDR_SIZE] & 1) == 0);
+        if (((p[FRAME_HDR_SIZE] >> 1) & 3) == 3) test_error("Invalid deflate block type");
+        buf_add(&stream, p + FRAME_HDR_SIZE, len);
+        raw_pos += FRAME_HDR_SIZE + len;
+        frame_cnt++;
+        inflate_stream();
+    }
+}
+
+static void message_received(const uint8_t * msg, size_t size) {
+    static const char hello[] = "E\0Locator\0Hello";
+    if (size >= sizeof(hello) && memcmp(msg, hello, sizeof(hello)) == 0) {
+        hello_cnt++;
+    }
+    else if (size >= 2 && msg[0] == 'R' && msg[1] == 0) {
+        const char * token = (const char *)msg + 2;
+        size_t n = strlen(token);
+        int i = atoi(token);
+        if (i > CMD_NONE && i < CMD_CNT && replies[i].args == NULL) {
+            Reply * r = replies + i;
+            r->size = size - 2 - n - 1;
+            r->args = (char *)loc_alloc(r->size + 1);
+            memcpy(r->args, token + n + 1, r->size);
+            r->args[r->size] = 0;
+        }
+    }
+}
+
+/* Split decoded data into messages, un-escape them and collect replies */
+static void parse_messages(void) {
+    Buffer msg;
+    size_t pos = 0;
+    int i;
+
+    hello_cnt = 0;
+    for (i = 0; i < CMD_CNT; i++) {
+        loc_free(replies[i].args);
+        memset(replies + i, 0, sizeof(Reply));
+    }
+    memset(&msg, 0, sizeof(msg));
+    while (pos < decoded.size) {
+        uint8_t ch = decoded.buf[pos++];
+        if (ch != ESC) {
+            buf_add(&msg, &ch, 1);
+            continue;
+        }
+        if (pos >= decoded.size) break;
+        ch = decoded.buf[pos++];
+        if (ch == 0) {
+            uint8_t esc = ESC;
+            buf_add(&msg, &esc, 1);
+        }
+        else if (ch == 1) {
+            message_received(msg.buf, msg.size);
+            msg.size = 0;
+        }
+        else if (ch == 3) {
+            /* ZeroCopy block: length, 7 bits per byte, then the data as is */
+            size_t len = 0;
+            unsigned shift = 0;
+            for (;;) {
+                if (pos >= decoded.size) break;
+                ch = decoded.buf[pos++];
+                len |= (size_t)(ch & 0x7f) << shift;
+                shift += 7;
+                if ((ch & 0x80) == 0) break;
+            }
+            if (pos + len > decoded.size) break;
+            buf_add(&msg, decoded.buf + pos, len);
+            pos += len;
+        }
+        else {
+            test_check(ch == 2);
+        }
+    }
+    buf_free(&msg);
+}
+
+static unsigned get_compressed_channels_cnt(void) {
+    unsigned cnt = 0;
+    LINK * l;
+    for (l = channel_root.next; l != &channel_root; l = l->next) {
+        Channel * c = chanlink2channelp(l);
+        if (!is_channel_closed(c) && c->compress_output) cnt++;
+    }
+    return cnt;
+}
+
+static void check_reply(Reply * r) {
+    char str[sizeof(echo_text) + 8];
+    char * p = NULL;
+    switch (cmd) {
+    case CMD_ECHO:
+    case CMD_ECHO_PROXY:
+        snprintf(str, sizeof(str), "\"%s\"", echo_text);
+        test_check(strcmp(r->args, str) == 0);
+        break;
+    case CMD_OPEN:
+        /* No error, then file handle */
+        test_check(r->args[0] == 0 && r->args[1] == '"');
+        strlcpy(file_handle, r->args + 2, sizeof(file_handle));
+        test_check(strchr(file_handle, '"') != NULL);
+        *strchr(file_handle, '"') = 0;
+        break;
+    case CMD_READ:
+        /* Binary data, then no error and EOF flag */
+        test_check(r->args[0] == '(');
+        test_check(atoi(r->args + 1) == RANDOM_READ);
+        p = strchr(r->args, ')') + 1;
+        test_check(p + RANDOM_READ < r->args + r->size);
+        test_check(p[RANDOM_READ] == 0 && p[RANDOM_READ + 1] == 0);
+        break;
+    case CMD_CLOSE:
+    case CMD_REDIRECT:
+        test_check(r->args[0] == 0);
+        break;
+    }
+}
+
+static void finish_channel_test(void) {
+    int i;
+    /* How the data is split into frames depends on flush timing, check the decoded data only */
+    test_check(frame_cnt > 0);
+    for (i = CMD_NONE + 1; i < CMD_CNT; i++) test_check(replies[i].args != NULL);
+    close(test_sock);
+    test_sock = -1;
+    test_server->close(test_server);
+    test_server = NULL;
+    for (i = 0; i < CMD_CNT; i++) {
+        loc_free(replies[i].args);
+        memset(replies + i, 0, sizeof(Reply));
+    }
+    buf_free(&raw);
+    buf_free(&stream);
+    buf_free(&decoded);
+    loc_free(inflate_out);
+    inflate_out = NULL;
+    test_done();
+}
+
+static void poll_event(void * args) {
+    uint8_t buf[0x1000];
+
+    for (;;) {
+        ssize_t rd = recv(test_sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (rd == 0) test_error("Connection closed by the agent");
+        if (rd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            test_error("recv: %s", errno_to_str(errno));
+        }
+        buf_add(&raw, buf, rd);
+    }
+    decode_input();
+    parse_messages();
+
+    if (cmd == CMD_NONE) {
+        if (hello_cnt > 0) send_command(CMD_ECHO);
+    }
+    else if (replies[cmd].args != NULL) {
+        /* After the redirect, wait for Hello of the proxy */
+        if (cmd != CMD_REDIRECT || hello_cnt > 1) {
+            check_reply(replies + cmd);
+            if (cmd == CMD_ECHO_PROXY) {
+                test_check(compressed);
+                test_check(get_compressed_channels_cnt() == 1);
+                finish_channel_test();
+                return;
+            }
+            send_command(cmd + 1);
+        }
+    }
+    post_event_with_delay(poll_event, NULL, POLL_DELAY);
+}
+
+static void test_channel_compression(void) {
+    static const char * hello[] = { "E", "Locator", "Hello", "[\"ZeroCopy\",\"Deflate\"]", NULL };
+    struct sockaddr_in addr;
+    size_t i;
+
+    if (ini_server("TCP:127.0.0.1:0", test_proto, test_bcg) < 0) {
+        test_error("Cannot start loopback server: %s", errno_to_str(errno));
+    }
+    test_server = servlink2channelserverp(channel_server_root.prev);
+    strlcpy(test_port, peer_server_getprop(test_server->ps, "Port", ""), sizeof(test_port));
+
+    for (i = 0; i + 1 < sizeof(echo_text); i++) echo_text[i] = text[i % text_size] == '\n' ? ' ' : text[i % text_size];
+    echo_text[i] = 0;
+    inflate_out = (uint8_t *)loc_alloc(DECODED_MAX);
+
+    test_sock = socket(AF_INET, SOCK_STREAM, 0);
+    test_check(test_sock >= 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)atoi(test_port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(test_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        test_error("Cannot connect to loopback server: %s", errno_to_str(errno));
+    }
+    send_message(hello);
+    post_event(poll_event, NULL);
+}
+
+#else
+
+static void test_channel_compression(void) {
+    printf("Skipped: no channel compression\n");
+    test_done();
+}
+
+#endif
+
+void test_deflate(void) {
+    make_test_data();
+    test_deflate_round_trip();
+    test_channel_compression();
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * DWARF line number tables of the test runner executable are loaded by load_all_line_numbers(),
+ * which runs line number programs by worker threads. The test checks that the tables,
+ * including the address index of line states, are moved from the worker copies into the cache.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/cache.h>
+#include <tcf/unit/unit-tests.h>
+
+#if ENABLE_ELF && defined(__linux__)
+
+#include <tcf/services/tcf_elf.h>
+#include <tcf/services/dwarfcache.h>
+
+#if ENABLE_DWARF_PARALLEL_LOAD
+
+static void check_unit(CompUnit * unit, unsigned * indexed) {
+    if (!unit->mLineInfoLoaded) test_error("Line info of %s is not loaded", unit->mObject->mName);
+    if (unit->mStatesCnt >= 2 && unit->mStates[0].mSection == unit->mStates[unit->mStatesCnt - 1].mSection) {
+        if (unit->mStatesAddrIndex.keys == NULL) {
+            test_error("Line states address index of %s is not built", unit->mObject->mName);
+        }
+        test_check(unit->mStatesAddrIndex.cnt == unit->mStatesCnt);
+        test_check(unit->mLineStatesItem.mSize >= addr_index_memory_size(&unit->mStatesAddrIndex));
+        (*indexed)++;
+    }
+}
+
+static void load_lines_cache_client(void * args) {
+    ELF_File * file = elf_open("/proc/self/exe");
+    DWARFCache * cache = NULL;
+    unsigned indexed = 0;
+    unsigned i;
+
+    if (file == NULL) test_error("Cannot open test runner executable: %s", errno_to_str(errno));
+    cache = get_dwarf_cache(file);
+    load_all_line_numbers(cache);
+    cache_exit();
+
+    test_check(cache->mLineInfoLoaded);
+    if (!cache->mLineInfoJobDone) test_error("Line number programs were not run by worker threads");
+    for (i = 0; i < file->section_cnt; i++) {
+        ObjectInfo * info = cache->mObjectHashTable[i].mCompUnits;
+        while (info != NULL) {
+            check_unit(info->mCompUnit, &indexed);
+            info = info->mSibling;
+        }
+    }
+    test_check(indexed > 0);
+    test_done();
+}
+
+void test_dwarf_lines(void) {
+    cache_enter(load_lines_cache_client, NULL, NULL, 0);
+}
+
+#else
+
+void test_dwarf_lines(void) {
+    printf("Skipped DWARF line numbers: ENABLE_DWARF_PARALLEL_LOAD is not set\n");
+    test_done();
+}
+
+#endif /* ENABLE_DWARF_PARALLEL_LOAD */
+
+#else
+
+void test_dwarf_lines(void) {
+    printf("Skipped DWARF line numbers: ELF is not supported\n");
+    test_done();
+}
+
+#endif /* ENABLE_ELF */
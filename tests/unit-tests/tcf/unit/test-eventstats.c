@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Event statistics tests, over a loopback channel.
+ * Timing is not collected until Diagnostics.setEventStatistics enables it,
+ * then Diagnostics.echo commands and event handlers are timed,
+ * and Diagnostics.setEventStatistics stops collection again.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/channel.h>
+#include <tcf/framework/protocol.h>
+#include <tcf/framework/eventstats.h>
+#include <tcf/main/server.h>
+#include <tcf/unit/unit-tests.h>
+
+#if ENABLE_EventStatistics && SERVICE_Diagnostics
+
+#define ECHO_CNT 10
+
+enum {
+    STEP_GET_DISABLED,
+    STEP_ENABLE,
+    STEP_ECHO,
+    STEP_GET_ENABLED,
+    STEP_DISABLE,
+    STEP_DONE
+};
+
+typedef struct EventStatisticsData {
+    int enabled;
+    unsigned handlers;
+    unsigned commands;
+    uint64_t echo_cnt;
+    char service[64];
+    char command[64];
+    uint64_t count;
+} EventStatisticsData;
+
+static ChannelServer * test_server = NULL;
+static Channel * test_channel = NULL;
+static int test_finished = 0;
+static int step = STEP_GET_DISABLED;
+static unsigned echo_cnt = 0;
+
+static void next_step(void * args);
+
+static void finish_test(void) {
+    test_finished = 1;
+    channel_close(test_channel);
+    test_server->close(test_server);
+    test_server = NULL;
+    test_done();
+}
+
+static void read_command_props(InputStream * inp, const char * name, void * args) {
+    EventStatisticsData * d = (EventStatisticsData *)args;
+    if (strcmp(name, "Service") == 0) json_read_string(inp, d->service, sizeof(d->service));
+    else if (strcmp(name, "Command") == 0) json_read_string(inp, d->command, sizeof(d->command));
+    else if (strcmp(name, "Count") == 0) d->count = json_read_uint64(inp);
+    else json_skip_object(inp);
+}
+
+static void read_command(InputStream * inp, void * args) {
+    EventStatisticsData * d = (EventStatisticsData *)args;
+    d->service[0] = d->command[0] = 0;
+    d->count = 0;
+    json_read_struct(inp, read_command_props, d);
+    if (strcmp(d->service, "Diagnostics") == 0 && strcmp(d->command, "echo") == 0) d->echo_cnt = d->count;
+    d->commands++;
+}
+
+static void read_handler(InputStream * inp, void * args) {
+    EventStatisticsData * d = (EventStatisticsData *)args;
+    json_skip_object(inp);
+    d->handlers++;
+}
+
+static void read_statistics_props(InputStream * inp, const char * name, void * args) {
+    EventStatisticsData * d = (EventStatisticsData *)args;
+    if (strcmp(name, "Enabled") == 0) d->enabled = json_read_boolean(inp);
+    else if (strcmp(name, "Handlers") == 0) json_read_array(inp, read_handler, d);
+    else if (strcmp(name, "Commands") == 0) json_read_array(inp, read_command, d);
+    else json_skip_object(inp);
+}
+
+static void get_reply(Channel * c, void * args, int error) {
+    EventStatisticsData d;
+
+    if (error) test_error("Diagnostics.getEventStatistics: %s", errno_to_str(error));
+    memset(&d, 0, sizeof(d));
+    error = read_errno(&c->inp);
+    json_read_struct(&c->inp, read_statistics_props, &d);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Diagnostics.getEventStatistics: %s", errno_to_str(error));
+    if (step == STEP_GET_DISABLED) {
+        test_check(!d.enabled);
+        test_check(d.handlers == 0);
+        test_check(d.commands == 0);
+    }
+    else {
+        test_check(d.enabled);
+        test_check(d.handlers > 0);
+        if (d.echo_cnt != ECHO_CNT) test_error("Diagnostics.echo count %u, expected %u", (unsigned)d.echo_cnt, ECHO_CNT);
+    }
+    step++;
+    post_event(next_step, NULL);
+}
+
+static void set_reply(Channel * c, void * args, int error) {
+    if (error) test_error("Diagnostics.setEventStatistics: %s", errno_to_str(error));
+    error = read_errno(&c->inp);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Diagnostics.setEventStatistics: %s", errno_to_str(error));
+    test_check(event_stats_enabled == (step == STEP_ENABLE));
+    step++;
+    post_event(next_step, NULL);
+}
+
+static void echo_reply(Channel * c, void * args, int error) {
+    char str[16];
+    if (error) test_error("Diagnostics.echo: %s", errno_to_str(error));
+    json_read_string(&c->inp, str, sizeof(str));
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    test_check(strcmp(str, "test") == 0);
+    if (++echo_cnt == ECHO_CNT) step++;
+    post_event(next_step, NULL);
+}
+
+static void send_set(int enable) {
+    protocol_send_command(test_channel, "Diagnostics", "setEventStatistics", set_reply, NULL);
+    json_write_boolean(&test_channel->out, enable);
+    write_stream(&test_channel->out, 0);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void send_get(void) {
+    protocol_send_command(test_channel, "Diagnostics", "getEventStatistics", get_reply, NULL);
+    json_write_boolean(&test_channel->out, 0);
+    write_stream(&test_channel->out, 0);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void next_step(void * args) {
+    switch (step) {
+    case STEP_GET_DISABLED:
+    case STEP_GET_ENABLED:
+        send_get();
+        break;
+    case STEP_ENABLE:
+        send_set(1);
+        break;
+    case STEP_ECHO:
+        protocol_send_command(test_channel, "Diagnostics", "echo", echo_reply, NULL);
+        json_write_string(&test_channel->out, "test");
+        write_stream(&test_channel->out, 0);
+        write_stream(&test_channel->out, MARKER_EOM);
+        break;
+    case STEP_DISABLE:
+        send_set(0);
+        break;
+    case STEP_DONE:
+        finish_test();
+        break;
+    }
+}
+
+static void channel_connected(Channel * c) {
+    post_event(next_step, NULL);
+}
+
+static void channel_disconnected(Channel * c) {
+    if (!test_finished) test_error("Loopback channel disconnected");
+    protocol_release(c->protocol);
+    test_channel = NULL;
+}
+
+static void channel_connect_done(void * args, int error, Channel * c) {
+    PeerServer * ps = (PeerServer *)args;
+    if (error) test_error("Cannot connect loopback channel: %s", errno_to_str(error));
+    c->connected = channel_connected;
+    c->disconnected = channel_disconnected;
+    c->protocol = protocol_alloc();
+    channel_start(c);
+    test_channel = c;
+    peer_server_free(ps);
+}
+
+void test_event_statistics(void) {
+    PeerServer * ps = NULL;
+    char url[64];
+
+    if (ini_server("TCP:127.0.0.1:0", test_proto, test_bcg) < 0) {
+        test_error("Cannot start loopback server: %s", errno_to_str(errno));
+    }
+    test_server = servlink2channelserverp(channel_server_root.prev);
+    snprintf(url, sizeof(url), "TCP:127.0.0.1:%s", peer_server_getprop(test_server->ps, "Port", ""));
+    ps = channel_peer_from_url(url);
+    test_check(ps != NULL);
+    channel_connect(ps, channel_connect_done, ps);
+}
+
+#else
+
+void test_event_statistics(void) {
+    printf("Skipped: no event statistics or Diagnostics service\n");
+    test_done();
+}
+
+#endif
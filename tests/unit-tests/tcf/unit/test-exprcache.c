@@ -0,0 +1,454 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Expression cache tests.
+ *
+ * Expressions are created and evaluated by the Expressions service over a loopback channel,
+ * and expression cache hits and misses are observed in "ExpressionCache" diagnostics statistics.
+ * A thread of the agent test process is stopped at tcf_test_func3(), then at tcf_test_func4().
+ * Evaluating an expression again in same context, frame and PC must hit the cache without
+ * searching symbols, while other frame, other context or other PC must add a new cache record.
+ * A condition is compiled on its first evaluation, and later evaluations must run the program.
+ * When the test process exits, all its cache records must be invalidated.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/cache.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/context.h>
+#include <tcf/framework/cpudefs.h>
+#include <tcf/framework/channel.h>
+#include <tcf/framework/protocol.h>
+#include <tcf/framework/exceptions.h>
+#include <tcf/services/runctrl.h>
+#include <tcf/services/stacktrace.h>
+#include <tcf/services/breakpoints.h>
+#include <tcf/main/test.h>
+#include <tcf/main/server.h>
+#include <tcf/unit/unit-tests.h>
+
+#if ENABLE_RCBP_TEST && SERVICE_Expressions && ENABLE_Symbols && \
+    SERVICE_Breakpoints && SERVICE_RunControl && SERVICE_StackTrace
+
+#define TEST_SCRIPT "tcf_test_short + tcf_test_func_call_cnt"
+#define TEST_CONDITION "tcf_test_func_call_cnt >= 0"
+
+typedef struct CacheStatistics {
+    int found;
+    unsigned long records;
+    unsigned long hits;
+    unsigned long name_hits;
+    unsigned long name_misses;
+    unsigned long invalidations;
+    unsigned long program_hits;
+} CacheStatistics;
+
+/* Each step sends a command, then checks the cache statistics after its reply */
+enum {
+    STEP_START,             /* Statistics before the test */
+    STEP_CREATE,            /* Create the expression in the top frame of the stopped thread */
+    STEP_EVALUATE,          /* Evaluate the expression: same context, frame and PC */
+    STEP_CREATE_CONDITION,  /* Create a condition in the top frame of the stopped thread */
+    STEP_COMPILE_CONDITION, /* Evaluate the condition: it is compiled */
+    STEP_EVALUATE_PROGRAM,  /* Evaluate the condition again: the compiled program is used */
+    STEP_CREATE_FRAME,      /* Same script in the caller frame */
+    STEP_CREATE_CONTEXT,    /* Same script in another thread */
+    STEP_EVALUATE_PC,       /* Evaluate the expression after the thread moved to tcf_test_func4() */
+    STEP_EXITED             /* The test process has exited */
+};
+
+static ChannelServer * test_server = NULL;
+static Channel * test_channel = NULL;
+static int test_finished = 0;
+static Context * test_prs = NULL;
+static Context * test_thread = NULL;
+static BreakpointInfo * test_bp = NULL;
+static int test_step = STEP_START;
+static int test_stopped = 0;
+static CacheStatistics stats_start;
+static CacheStatistics stats_prev;
+
+static char caller_frame_id[256];
+static char other_thread_id[256];
+static char expression_id[256];
+static char condition_id[256];
+static uint64_t evaluate_value = 0;
+
+static void add_attribute(BreakpointAttribute *** ref, const char * name, const char * str, int array) {
+    ByteArrayOutputStream buf;
+    BreakpointAttribute * attr = (BreakpointAttribute *)loc_alloc_zero(sizeof(BreakpointAttribute));
+    OutputStream * out = create_byte_array_output_stream(&buf);
+    attr->name = loc_strdup(name);
+    if (str == NULL) {
+        json_write_boolean(out, 1);
+    }
+    else if (array) {
+        write_stream(out, '[');
+        json_write_string(out, str);
+        write_stream(out, ']');
+    }
+    else {
+        json_write_string(out, str);
+    }
+    write_stream(out, 0);
+    get_byte_array_output_stream_data(&buf, &attr->value, NULL);
+    **ref = attr;
+    *ref = &attr->next;
+}
+
+static void eventpoint_hit(Context * ctx, void * args);
+
+static BreakpointInfo * create_test_eventpoint(const char * location, Context * ctx) {
+    BreakpointAttribute * attrs = NULL;
+    BreakpointAttribute ** ref = &attrs;
+    add_attribute(&ref, BREAKPOINT_ENABLED, NULL, 0);
+    add_attribute(&ref, BREAKPOINT_CONTEXTIDS, ctx->id, 1);
+    add_attribute(&ref, BREAKPOINT_LOCATION, location, 0);
+    return create_eventpoint_ext(attrs, NULL, eventpoint_hit, NULL);
+}
+
+static void resume_test_process(void * args) {
+    if (test_prs == NULL || test_prs->exited || test_stopped) return;
+    test_check(continue_debug_context(test_prs, NULL, RM_RESUME, 1, 0, 0) == 0);
+}
+
+static void read_cache_statistics(InputStream * inp, const char * name, void * args) {
+    CacheStatistics * s = (CacheStatistics *)args;
+    if (strcmp(name, "Records") == 0) s->records = json_read_ulong(inp);
+    else if (strcmp(name, "Hits") == 0) s->hits = json_read_ulong(inp);
+    else if (strcmp(name, "NameHits") == 0) s->name_hits = json_read_ulong(inp);
+    else if (strcmp(name, "NameMisses") == 0) s->name_misses = json_read_ulong(inp);
+    else if (strcmp(name, "Invalidations") == 0) s->invalidations = json_read_ulong(inp);
+    else if (strcmp(name, "ProgramHits") == 0) s->program_hits = json_read_ulong(inp);
+    else json_skip_object(inp);
+}
+
+static void read_statistics(InputStream * inp, const char * name, void * args) {
+    CacheStatistics * s = (CacheStatistics *)args;
+    if (strcmp(name, "ExpressionCache") == 0) s->found = json_read_struct(inp, read_cache_statistics, s);
+    else json_skip_object(inp);
+}
+
+static void check_statistics(CacheStatistics * s);
+
+static void statistics_reply(Channel * c, void * args, int error) {
+    CacheStatistics s;
+
+    if (error) test_error("getStatistics: %s", errno_to_str(error));
+    memset(&s, 0, sizeof(s));
+    error = read_errno(&c->inp);
+    json_read_struct(&c->inp, read_statistics, &s);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("getStatistics: %s", errno_to_str(error));
+    check_statistics(&s);
+    stats_prev = s;
+}
+
+static void send_get_statistics(void) {
+    protocol_send_command(test_channel, "Diagnostics", "getStatistics", statistics_reply, NULL);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void read_expression_props(InputStream * inp, const char * name, void * args) {
+    char * id = (char *)args;
+    if (strcmp(name, "ID") == 0 && id != NULL) json_read_string(inp, id, sizeof(expression_id));
+    else json_skip_object(inp);
+}
+
+static void create_reply(Channel * c, void * args, int error) {
+    if (error) test_error("create: %s", errno_to_str(error));
+    error = read_errno(&c->inp);
+    json_read_struct(&c->inp, read_expression_props, args);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Cannot create expression: %s", errno_to_str(error));
+    send_get_statistics();
+}
+
+/* Create an expression, 'id' receives the expression ID, can be NULL */
+static void send_create(const char * parent, const char * script, char * id) {
+    protocol_send_command(test_channel, "Expressions", "create", create_reply, id);
+    json_write_string(&test_channel->out, parent);
+    write_stream(&test_channel->out, 0);
+    json_write_string(&test_channel->out, NULL);
+    write_stream(&test_channel->out, 0);
+    json_write_string(&test_channel->out, script);
+    write_stream(&test_channel->out, 0);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void evaluate_reply(Channel * c, void * args, int error) {
+    char * data = NULL;
+    size_t size = 0;
+    size_t i;
+
+    if (error) test_error("evaluate: %s", errno_to_str(error));
+    data = json_read_alloc_binary(&c->inp, &size);
+    json_test_char(&c->inp, MARKER_EOA);
+    error = read_errno(&c->inp);
+    json_skip_object(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Cannot evaluate expression: %s", errno_to_str(error));
+    test_check(size <= sizeof(evaluate_value));
+    evaluate_value = 0;
+    for (i = 0; i < size; i++) {
+        evaluate_value |= (uint64_t)(uint8_t)data[i] << (big_endian_host() ? (size - i - 1) * 8 : i * 8);
+    }
+    loc_free(data);
+    send_get_statistics();
+}
+
+static void send_evaluate(const char * id) {
+    protocol_send_command(test_channel, "Expressions", "evaluate", evaluate_reply, NULL);
+    json_write_string(&test_channel->out, id);
+    write_stream(&test_channel->out, 0);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void test_process_attached(int error, Context * ctx, void * args) {
+    if (error) test_error("Cannot start test process: %s", errno_to_str(error));
+    test_prs = ctx;
+    context_lock(ctx);
+    test_bp = create_test_eventpoint("tcf_test_func3", ctx);
+}
+
+static void finish_test(void) {
+    test_finished = 1;
+    channel_close(test_channel);
+    test_server->close(test_server);
+    test_server = NULL;
+    test_done();
+}
+
+static void check_statistics(CacheStatistics * s) {
+    if (test_step == STEP_START) {
+        if (!s->found) {
+            printf("Skipped: no expression cache\n");
+            finish_test();
+            return;
+        }
+        stats_start = *s;
+        test_step++;
+        if (run_test_process(test_process_attached, NULL) < 0) {
+            test_error("Cannot start test process: %s", errno_to_str(errno));
+        }
+        return;
+    }
+
+    test_check(s->found);
+    switch (test_step++) {
+    case STEP_CREATE:
+        test_check(expression_id[0] != 0);
+        test_check(s->records == stats_prev.records + 1);
+        send_evaluate(expression_id);
+        break;
+    case STEP_EVALUATE:
+        test_check(s->records == stats_prev.records);
+        test_check(s->hits > stats_prev.hits);
+        test_check(s->name_hits > stats_prev.name_hits);
+        test_check(s->name_misses == stats_prev.name_misses);
+        send_create(test_thread->id, TEST_CONDITION, condition_id);
+        break;
+    case STEP_CREATE_CONDITION:
+        test_check(condition_id[0] != 0);
+        test_check(s->records == stats_prev.records + 1);
+        send_evaluate(condition_id);
+        break;
+    case STEP_COMPILE_CONDITION:
+        test_check(s->hits > stats_prev.hits);
+        test_check(s->program_hits == stats_prev.program_hits);
+        test_check(evaluate_value == 1);
+        send_evaluate(condition_id);
+        break;
+    case STEP_EVALUATE_PROGRAM:
+        test_check(s->records == stats_prev.records);
+        test_check(s->program_hits == stats_prev.program_hits + 1);
+        test_check(s->name_misses == stats_prev.name_misses);
+        test_check(evaluate_value == 1);
+        send_create(caller_frame_id, TEST_SCRIPT, NULL);
+        break;
+    case STEP_CREATE_FRAME:
+        test_check(s->records == stats_prev.records + 1);
+        send_create(other_thread_id, TEST_SCRIPT, NULL);
+        break;
+    case STEP_CREATE_CONTEXT:
+        test_check(s->records == stats_prev.records + 1);
+        /* tcf_test_func3() calls tcf_test_func4(), stop the same thread there */
+        destroy_eventpoint(test_bp);
+        test_bp = create_test_eventpoint("tcf_test_func4", test_thread);
+        test_stopped = 0;
+        resume_test_process(NULL);
+        break;
+    case STEP_EVALUATE_PC:
+        test_check(s->records == stats_prev.records + 1);
+        destroy_eventpoint(test_bp);
+        test_bp = NULL;
+        test_stopped = 0;
+        resume_test_process(NULL);
+        break;
+    case STEP_EXITED:
+        test_check(s->records == stats_start.records);
+        test_check(s->invalidations >= stats_prev.invalidations + 4);
+        finish_test();
+        break;
+    }
+}
+
+static void get_frames_cache_client(void * args) {
+    Context * ctx = test_thread;
+    int frame = 0;
+    LINK * l;
+
+    test_check(ctx->stopped);
+    frame = get_prev_frame(ctx, get_top_frame(ctx));
+    if (frame < 0) {
+        if (get_error_code(errno) == ERR_CACHE_MISS) exception(errno);
+        test_error("Cannot get caller frame: %s", errno_to_str(errno));
+    }
+    strlcpy(caller_frame_id, frame2id(ctx, frame), sizeof(caller_frame_id));
+    other_thread_id[0] = 0;
+    for (l = test_prs->children.next; l != &test_prs->children; l = l->next) {
+        Context * thread = cldl2ctxp(l);
+        if (thread == ctx || thread->exited || !thread->stopped) continue;
+        strlcpy(other_thread_id, thread->id, sizeof(other_thread_id));
+        break;
+    }
+    cache_exit();
+
+    test_check(other_thread_id[0] != 0);
+    send_create(ctx->id, TEST_SCRIPT, expression_id);
+}
+
+static void test_thread_stopped(void * args) {
+    if (test_step == STEP_CREATE) {
+        cache_enter(get_frames_cache_client, NULL, NULL, 0);
+    }
+    else {
+        send_evaluate(expression_id);
+    }
+}
+
+static int get_threads_cnt(Context * prs) {
+    int cnt = 0;
+    LINK * l;
+    for (l = prs->children.next; l != &prs->children; l = l->next) {
+        if (!cldl2ctxp(l)->exited) cnt++;
+    }
+    return cnt;
+}
+
+static void eventpoint_hit(Context * ctx, void * args) {
+    if (test_stopped) return;
+    if (test_step == STEP_CREATE) {
+        /* Wait until the test process starts worker threads */
+        if (get_threads_cnt(test_prs) < 2) return;
+        test_thread = ctx;
+        context_lock(ctx);
+    }
+    else if (test_step != STEP_EVALUATE_PC) {
+        return;
+    }
+    test_check(ctx == test_thread);
+    test_stopped = 1;
+    test_check(suspend_debug_context(test_prs) == 0);
+    test_wait_intercepted(test_prs, test_thread_stopped, NULL);
+}
+
+static void event_context_exited(Context * ctx, void * args) {
+    if (ctx != test_prs) return;
+    test_check(test_step == STEP_EXITED);
+    context_unlock(test_thread);
+    context_unlock(test_prs);
+    test_thread = NULL;
+    test_prs = NULL;
+    send_get_statistics();
+}
+
+static void event_context_intercepted(Context * ctx, void * args) {
+    /* The test process is suspended at main() and by the test, resume it */
+    if (test_prs == NULL || context_get_group(ctx, CONTEXT_GROUP_PROCESS) != test_prs) return;
+    post_event(resume_test_process, NULL);
+}
+
+static ContextEventListener context_listener = {
+    NULL,
+    event_context_exited,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static RunControlEventListener run_ctrl_listener = {
+    event_context_intercepted,
+    NULL
+};
+
+static void channel_connected(Channel * c) {
+    send_get_statistics();
+}
+
+static void channel_disconnected(Channel * c) {
+    if (!test_finished) test_error("Loopback channel disconnected");
+    protocol_release(c->protocol);
+    test_channel = NULL;
+}
+
+static void channel_connect_done(void * args, int error, Channel * c) {
+    PeerServer * ps = (PeerServer *)args;
+    if (error) test_error("Cannot connect loopback channel: %s", errno_to_str(error));
+    c->connected = channel_connected;
+    c->disconnected = channel_disconnected;
+    c->protocol = protocol_alloc();
+    channel_start(c);
+    test_channel = c;
+    peer_server_free(ps);
+}
+
+void test_expression_cache(void) {
+    PeerServer * ps = NULL;
+    char url[64];
+
+    if (ini_server("TCP:127.0.0.1:0", test_proto, test_bcg) < 0) {
+        test_error("Cannot start loopback server: %s", errno_to_str(errno));
+    }
+    test_server = servlink2channelserverp(channel_server_root.prev);
+    snprintf(url, sizeof(url), "TCP:127.0.0.1:%s", peer_server_getprop(test_server->ps, "Port", ""));
+    ps = channel_peer_from_url(url);
+    test_check(ps != NULL);
+
+    add_context_event_listener(&context_listener, NULL);
+    add_run_control_event_listener(&run_ctrl_listener, NULL);
+    channel_connect(ps, channel_connect_done, ps);
+}
+
+#else
+
+void test_expression_cache(void) {
+    printf("Skipped: no test process or expression cache support\n");
+    test_done();
+}
+
+#endif
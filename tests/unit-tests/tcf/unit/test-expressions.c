@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Compiled expressions tests.
+ *
+ * The agent test process is stopped at tcf_test_func3() by eventpoints with conditions.
+ * Conditions that are always true must trigger on every stop, and conditions that are
+ * always false must never trigger - regardless of whether the condition was compiled or
+ * evaluated by the expression interpreter. At first stop, results of compile_expression()
+ * and evaluate_compiled_expression() are compared with results of evaluate_expression().
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/cache.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/context.h>
+#include <tcf/framework/exceptions.h>
+#include <tcf/services/runctrl.h>
+#include <tcf/services/stacktrace.h>
+#include <tcf/services/breakpoints.h>
+#include <tcf/services/expressions.h>
+#include <tcf/main/test.h>
+#include <tcf/unit/unit-tests.h>
+
+#if ENABLE_RCBP_TEST && ENABLE_Expressions && ENABLE_Symbols && SERVICE_Breakpoints && SERVICE_RunControl && SERVICE_StackTrace
+
+typedef struct ConditionTest {
+    const char * condition;
+    int expected;       /* 1 - triggers on every stop, 0 - never triggers */
+    BreakpointInfo * bp;
+    unsigned hit_cnt;
+} ConditionTest;
+
+#define EXPR_COMPILED       0   /* Compiled and interpreted results must be same */
+#define EXPR_UNSUPPORTED    1   /* Too complex to compile, only interpreted */
+#define EXPR_INVALID        2   /* Both must fail */
+
+typedef struct ExpressionTest {
+    const char * script;
+    int caller;         /* Evaluate in the caller (tcf_test_func2) frame */
+    int kind;
+} ExpressionTest;
+
+static ConditionTest conditions[] = {
+    { NULL, 1 },
+    { "tcf_test_short > 0", 1 },
+    { "tcf_test_short > -1", 1 },
+    { "-1 < 0", 1 },
+    { "!tcf_test_int", 1 },
+    { "tcf_test_func_call_cnt < -1", 1 },
+    { "tcf_test_short + 1 > 1", 1 },
+    { "tcf_test_short ==", 1 },
+    { "tcf_test_no_such_symbol", 1 },
+    { "-1 < 0u", 0 },
+    { "tcf_test_short < 0", 0 },
+    { "tcf_test_int && tcf_test_short", 0 },
+    { "tcf_test_func_call_cnt > -1", 0 },
+    { "tcf_test_short + 1 < 1", 0 },
+};
+
+static ExpressionTest expressions[] = {
+    { "tcf_test_short > 0", 0, EXPR_COMPILED },
+    { "tcf_test_short >= -1", 0, EXPR_COMPILED },
+    { "tcf_test_char >= 0 && tcf_test_short != 0", 0, EXPR_COMPILED },
+    { "tcf_test_int || tcf_test_long", 0, EXPR_COMPILED },
+    { "!tcf_test_int", 0, EXPR_COMPILED },
+    { "tcf_test_str != 0", 0, EXPR_COMPILED },
+    { "tcf_test_long == tcf_test_long", 0, EXPR_COMPILED },
+    { "-1 < 0", 0, EXPR_COMPILED },
+    { "-1 < 0u", 0, EXPR_COMPILED },
+    { "0u > -1", 0, EXPR_COMPILED },
+    { "tcf_test_func_call_cnt < -1", 0, EXPR_COMPILED },
+    { "tcf_test_func_call_cnt > -1", 0, EXPR_COMPILED },
+    { "tcf_test_int < tcf_test_func_call_cnt - 1", 0, EXPR_UNSUPPORTED },
+    { "func2_local1 == 1", 1, EXPR_COMPILED },
+    { "func2_local2 > func2_local1", 1, EXPR_COMPILED },
+    { "tcf_test_short + 1 > 0", 0, EXPR_UNSUPPORTED },
+    { "(long)tcf_test_short > 0", 0, EXPR_UNSUPPORTED },
+    { "tcf_test_str[0] == 'a'", 0, EXPR_UNSUPPORTED },
+    { "tcf_test_short ==", 0, EXPR_INVALID },
+    { "tcf_test_short > )", 0, EXPR_INVALID },
+    { "tcf_test_no_such_symbol > 0", 0, EXPR_INVALID },
+    { "func2_local1 == 1", 0, EXPR_INVALID },
+};
+
+#define CONDITIONS_CNT (sizeof(conditions) / sizeof(ConditionTest))
+#define EXPRESSIONS_CNT (sizeof(expressions) / sizeof(ExpressionTest))
+
+static Context * test_prs = NULL;
+static int expressions_checked = 0;
+static int expressions_checking = 0;
+
+static void add_attribute(BreakpointAttribute *** ref, const char * name, const char * str, int array) {
+    ByteArrayOutputStream buf;
+    BreakpointAttribute * attr = (BreakpointAttribute *)loc_alloc_zero(sizeof(BreakpointAttribute));
+    OutputStream * out = create_byte_array_output_stream(&buf);
+    attr->name = loc_strdup(name);
+    if (str == NULL) {
+        json_write_boolean(out, 1);
+    }
+    else if (array) {
+        write_stream(out, '[');
+        json_write_string(out, str);
+        write_stream(out, ']');
+    }
+    else {
+        json_write_string(out, str);
+    }
+    write_stream(out, 0);
+    get_byte_array_output_stream_data(&buf, &attr->value, NULL);
+    **ref = attr;
+    *ref = &attr->next;
+}
+
+static int check_cache_miss(int r) {
+    if (r < 0 && get_error_code(errno) == ERR_CACHE_MISS) exception(errno);
+    return r;
+}
+
+static void check_expression(Context * ctx, int frame, ExpressionTest * t) {
+    CompiledExpression * e = NULL;
+    int64_t n0 = 0;
+    int64_t n1 = 0;
+    Value v;
+    int r0 = 0;
+    int r1 = 0;
+    int err = 0;
+
+    r0 = check_cache_miss(compile_expression(ctx, frame, 0, tmp_strdup(t->script), &e));
+    if (r0 < 0) {
+        err = get_error_code(errno);
+    }
+    else {
+        r0 = evaluate_compiled_expression(ctx, frame, e, &n0);
+        free_compiled_expression(e);
+        check_cache_miss(r0);
+    }
+
+    memset(&v, 0, sizeof(v));
+    r1 = check_cache_miss(evaluate_expression(ctx, frame, 0, tmp_strdup(t->script), 1, &v));
+    if (r1 == 0) r1 = value_to_signed(&v, &n1);
+
+    switch (t->kind) {
+    case EXPR_COMPILED:
+        if (r0 < 0) test_error("Cannot compile \"%s\": %s", t->script, errno_to_str(err));
+        if (r1 < 0) test_error("Cannot evaluate \"%s\": %s", t->script, errno_to_str(errno));
+        if (n0 != n1) test_error("\"%s\": compiled result %lld, interpreter result %lld",
+            t->script, (long long)n0, (long long)n1);
+        break;
+    case EXPR_UNSUPPORTED:
+        if (r0 == 0 || err != ERR_UNSUPPORTED) test_error("\"%s\" should not be compiled", t->script);
+        if (r1 < 0) test_error("Cannot evaluate \"%s\": %s", t->script, errno_to_str(errno));
+        break;
+    case EXPR_INVALID:
+        if (r0 == 0) test_error("Invalid expression \"%s\" compiled and evaluated", t->script);
+        if (r1 == 0) test_error("Invalid expression \"%s\" evaluated", t->script);
+        break;
+    }
+}
+
+static void resume_test_process(void * args) {
+    if (test_prs == NULL || test_prs->exited || expressions_checking) return;
+    test_check(continue_debug_context(test_prs, NULL, RM_RESUME, 1, 0, 0) == 0);
+}
+
+static void check_expressions_cache_client(void * args) {
+    Context * ctx = *(Context **)args;
+    int caller = STACK_NO_FRAME;
+    unsigned i;
+
+    test_check(ctx->stopped);
+    caller = check_cache_miss(get_prev_frame(ctx, get_top_frame(ctx)));
+    if (caller < 0) test_error("Cannot get caller frame: %s", errno_to_str(errno));
+    for (i = 0; i < EXPRESSIONS_CNT; i++) {
+        ExpressionTest * t = expressions + i;
+        check_expression(ctx, t->caller ? caller : STACK_TOP_FRAME, t);
+    }
+    cache_exit();
+
+    context_unlock(ctx);
+    expressions_checking = 0;
+    resume_test_process(NULL);
+}
+
+static void check_expressions(void * args) {
+    Context * ctx = (Context *)args;
+    cache_enter(check_expressions_cache_client, NULL, &ctx, sizeof(ctx));
+}
+
+static void eventpoint_hit(Context * ctx, void * args) {
+    ConditionTest * t = (ConditionTest *)args;
+    t->hit_cnt++;
+    if (t == conditions && !expressions_checked) {
+        expressions_checked = 1;
+        expressions_checking = 1;
+        test_check(suspend_debug_context(test_prs) == 0);
+        context_lock(ctx);
+        test_wait_intercepted(test_prs, check_expressions, ctx);
+    }
+}
+
+static void event_context_exited(Context * ctx, void * args) {
+    unsigned i;
+
+    if (ctx != test_prs) return;
+    test_check(expressions_checked);
+    test_check(conditions[0].hit_cnt >= 10);
+    for (i = 0; i < CONDITIONS_CNT; i++) {
+        ConditionTest * t = conditions + i;
+        unsigned n = t->expected ? conditions[0].hit_cnt : 0;
+        if (t->hit_cnt != n) test_error("Condition \"%s\": %u hits, expected %u", t->condition, t->hit_cnt, n);
+        destroy_eventpoint(t->bp);
+        t->bp = NULL;
+    }
+    context_unlock(test_prs);
+    test_prs = NULL;
+    test_done();
+}
+
+static void event_context_intercepted(Context * ctx, void * args) {
+    /* The test process is suspended at main() and by the check, resume it */
+    if (test_prs == NULL || context_get_group(ctx, CONTEXT_GROUP_PROCESS) != test_prs) return;
+    post_event(resume_test_process, NULL);
+}
+
+static ContextEventListener context_listener = {
+    NULL,
+    event_context_exited,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static RunControlEventListener run_ctrl_listener = {
+    event_context_intercepted,
+    NULL
+};
+
+static void test_process_attached(int error, Context * ctx, void * args) {
+    unsigned i;
+
+    if (error) test_error("Cannot start test process: %s", errno_to_str(error));
+    test_prs = ctx;
+    context_lock(ctx);
+    for (i = 0; i < CONDITIONS_CNT; i++) {
+        ConditionTest * t = conditions + i;
+        BreakpointAttribute * attrs = NULL;
+        BreakpointAttribute ** ref = &attrs;
+        add_attribute(&ref, BREAKPOINT_ENABLED, NULL, 0);
+        add_attribute(&ref, BREAKPOINT_CONTEXTIDS, ctx->id, 1);
+        add_attribute(&ref, BREAKPOINT_LOCATION, "tcf_test_func3", 0);
+        if (t->condition != NULL) add_attribute(&ref, BREAKPOINT_CONDITION, t->condition, 0);
+        t->bp = create_eventpoint_ext(attrs, NULL, eventpoint_hit, t);
+    }
+}
+
+void test_compiled_expressions(void) {
+    add_context_event_listener(&context_listener, NULL);
+    add_run_control_event_listener(&run_ctrl_listener, NULL);
+    if (run_test_process(test_process_attached, NULL) < 0) {
+        test_error("Cannot start test process: %s", errno_to_str(errno));
+    }
+}
+
+#else
+
+void test_compiled_expressions(void) {
+    printf("Skipped: no test process or expressions support\n");
+    test_done();
+}
+
+#endif
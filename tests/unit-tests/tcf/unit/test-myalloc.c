@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Local heap tests: loc_alloc(), loc_realloc(), loc_free() and memory pools.
+ * When the agent is built with ENABLE_SlabAlloc, the tests also check slab allocator
+ * size class statistics, for example: make run CFLAGS=-DENABLE_SlabAlloc=1 TESTS=myalloc
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/unit/unit-tests.h>
+
+#define OBJ_CNT 3000
+
+typedef struct ClassStatistics {
+    size_t size;
+    int found;
+    int pool_found;
+    const char * pool_name;
+    MemPoolStatistics stats;
+} ClassStatistics;
+
+static void fill(unsigned char * p, size_t size, unsigned seed) {
+    size_t i;
+    for (i = 0; i < size; i++) p[i] = (unsigned char)(seed + i * 7);
+}
+
+static int check(unsigned char * p, size_t size, unsigned seed) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+        if (p[i] != (unsigned char)(seed + i * 7)) return 0;
+    }
+    return 1;
+}
+
+static void test_heap(void) {
+    static const size_t sizes[] = { 0, 1, 15, 16, 17, 48, 100, 255, 256, 257, 1000, 2047, 2048, 2049, 10000 };
+    unsigned char * p[sizeof(sizes) / sizeof(size_t)];
+    unsigned i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+        p[i] = (unsigned char *)loc_alloc(sizes[i]);
+        test_check(p[i] != NULL);
+        test_check(((uintptr_t)p[i] & (sizeof(void *) - 1)) == 0);
+        fill(p[i], sizes[i], i);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+        /* Blocks must not overlap */
+        if (!check(p[i], sizes[i], i)) test_error("Block of %u bytes is corrupted", (unsigned)sizes[i]);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+        size_t size = sizes[i];
+        /* Grow across size classes and into malloc() blocks, then shrink */
+        p[i] = (unsigned char *)loc_realloc(p[i], size * 2 + 100);
+        if (!check(p[i], size, i)) test_error("Block of %u bytes is corrupted by realloc", (unsigned)size);
+        fill(p[i], size * 2 + 100, i);
+        p[i] = (unsigned char *)loc_realloc(p[i], size / 2);
+        if (!check(p[i], size / 2, i)) test_error("Block of %u bytes is corrupted by shrinking", (unsigned)size);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++) loc_free(p[i]);
+
+    p[0] = (unsigned char *)loc_alloc_zero(300);
+    for (i = 0; i < 300; i++) test_check(p[0][i] == 0);
+    loc_free(p[0]);
+    loc_free(NULL);
+}
+
+static void test_pool(MemPool * pool) {
+    unsigned char ** objs = (unsigned char **)loc_alloc(sizeof(unsigned char *) * OBJ_CNT);
+    unsigned i;
+
+    for (i = 0; i < OBJ_CNT; i++) {
+        unsigned j;
+        objs[i] = (unsigned char *)(i % 2 ? mem_pool_alloc_zero(pool) : mem_pool_alloc(pool));
+        if (i % 2) {
+            for (j = 0; j < 40; j++) test_check(objs[i][j] == 0);
+        }
+        fill(objs[i], 40, i);
+    }
+    for (i = 0; i < OBJ_CNT; i++) {
+        if (!check(objs[i], 40, i)) test_error("Pool object %u is corrupted", i);
+    }
+    /* Pool objects are disposed by loc_free() */
+    for (i = 0; i < OBJ_CNT; i++) loc_free(objs[i]);
+    loc_free(objs);
+}
+
+#if ENABLE_SlabAlloc
+
+static void get_class_statistics(MemPoolStatistics * stats, const char ** pools, unsigned pools_cnt, void * args) {
+    ClassStatistics * s = (ClassStatistics *)args;
+    unsigned i;
+    if (stats->size != s->size) return;
+    s->found = 1;
+    s->stats = *stats;
+    for (i = 0; i < pools_cnt; i++) {
+        if (strcmp(pools[i], s->pool_name) == 0) s->pool_found = 1;
+    }
+}
+
+static ClassStatistics get_class(size_t size, const char * pool_name) {
+    ClassStatistics s;
+    memset(&s, 0, sizeof(s));
+    s.size = size;
+    s.pool_name = pool_name;
+    mem_pool_statistics(get_class_statistics, &s);
+    if (!s.found) test_error("No statistics for size class %u", (unsigned)size);
+    return s;
+}
+
+static void test_slab_statistics(MemPool * pool) {
+    /* The test objects are not allocated in the 48 bytes size class */
+    unsigned char ** objs = (unsigned char **)malloc(sizeof(unsigned char *) * OBJ_CNT);
+    ClassStatistics s0;
+    ClassStatistics s1;
+    ClassStatistics s2;
+    void * p = NULL;
+    void * q = NULL;
+    unsigned i;
+
+    test_check(objs != NULL);
+    s0 = get_class(48, "UnitTest");
+    /* A pool of 40 bytes objects is accounted in the 48 bytes size class */
+    test_check(s0.pool_found);
+    for (i = 0; i < OBJ_CNT; i++) objs[i] = (unsigned char *)(i % 2 ? mem_pool_alloc(pool) : loc_alloc(48));
+    s1 = get_class(48, "UnitTest");
+    test_check(s1.stats.used == s0.stats.used + OBJ_CNT);
+    test_check(s1.stats.allocs == s0.stats.allocs + OBJ_CNT);
+    test_check(s1.stats.used_max >= s1.stats.used);
+    /* Pool objects and loc_alloc() blocks don't share slabs */
+    test_check(s1.stats.slabs >= s0.stats.slabs + 2);
+    for (i = 0; i < OBJ_CNT; i++) loc_free(objs[i]);
+    s2 = get_class(48, "UnitTest");
+    test_check(s2.stats.used == s0.stats.used);
+    test_check(s2.stats.frees == s0.stats.frees + OBJ_CNT);
+    test_check(s2.stats.used_max == s1.stats.used_max);
+    /* Empty slabs are returned to the OS, except one cached slab per pool */
+    test_check(s2.stats.slabs <= s0.stats.slabs + 2);
+    free(objs);
+
+    /* Realloc within the size class keeps the block */
+    p = loc_alloc(40);
+    test_check(loc_realloc(p, 48) == p);
+    test_check(loc_realloc(p, 20) == p);
+    s1 = get_class(48, "UnitTest");
+    q = loc_realloc(p, 49);
+    test_check(q != p);
+    s2 = get_class(48, "UnitTest");
+    test_check(s2.stats.used == s1.stats.used - 1);
+    loc_free(q);
+
+    /* Blocks larger than the max size class are allocated by malloc() */
+    s1 = get_class(2048, "UnitTest");
+    p = loc_alloc(2049);
+    s2 = get_class(2048, "UnitTest");
+    test_check(s2.stats.allocs == s1.stats.allocs);
+    loc_free(p);
+}
+
+#endif /* ENABLE_SlabAlloc */
+
+void test_myalloc(void) {
+    /* Pools are never disposed */
+    static MemPool * pool = NULL;
+
+    if (pool == NULL) pool = mem_pool_create("UnitTest", 40);
+    test_heap();
+    test_pool(pool);
+#if ENABLE_SlabAlloc
+    test_slab_statistics(pool);
+#else
+    printf("Skipped slab allocator statistics: ENABLE_SlabAlloc is not set\n");
+#endif
+    test_done();
+}
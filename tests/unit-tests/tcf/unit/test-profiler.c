@@ -0,0 +1,450 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Profiler service tests.
+ *
+ * The main thread of the agent test process is held at tcf_test_func3(), so worker threads keep
+ * calling tcf_test_func0() and its callees. A worker thread is profiled by the generic
+ * stop-and-trace profiler with a small "FrameCnt", and Profiler.read results are read over
+ * a loopback channel until a sample with the maximum stack depth is received.
+ * Then the profiler is configured again with "Incremental": true, and same is done
+ * with "StackTracesDelta" results. Every sample is checked to fit in the data exactly.
+ * Last, if the agent is built with perf events support, same is done with "Sampler": "PerfEvents",
+ * unless the kernel does not allow the agent to open perf events.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/json.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/context.h>
+#include <tcf/framework/channel.h>
+#include <tcf/framework/protocol.h>
+#include <tcf/services/runctrl.h>
+#include <tcf/services/breakpoints.h>
+#include <tcf/main/test.h>
+#include <tcf/main/server.h>
+#include <tcf/unit/unit-tests.h>
+#if defined(__linux__)
+#  include <system/GNU/Linux/tcf/profiler-perf.h>
+#endif
+
+#if ENABLE_RCBP_TEST && ENABLE_ProfilerSST && SERVICE_Breakpoints
+
+/* Max number of PCs in a sample: the PC and FRAME_CNT - 1 return addresses */
+#define FRAME_CNT 4
+/* Max number of Profiler.read commands, and delay between them, microseconds */
+#define READ_CNT_MAX 50
+#define READ_DELAY 100000
+
+typedef struct ProfilerData {
+    int found;
+    char format[64];
+    unsigned long addr_size;
+    char * data;
+    size_t data_size;
+    char * stacks;
+    size_t stacks_size;
+    int reset;
+    char * error;
+} ProfilerData;
+
+static ChannelServer * test_server = NULL;
+static Channel * test_channel = NULL;
+static int test_finished = 0;
+static Context * test_prs = NULL;
+static Context * test_main = NULL;
+static BreakpointInfo * test_bp = NULL;
+static int test_stopped = 0;
+static unsigned read_cnt = 0;
+static unsigned long samples_cnt = 0;
+static int test_incremental = 0;
+static int test_perf = 0;
+/* Lengths of stack traces received in "StackTracesDelta" results, by stack trace index */
+static unsigned * stack_lens = NULL;
+static unsigned stack_lens_cnt = 0;
+static char worker_id[256];
+
+static void add_attribute(BreakpointAttribute *** ref, const char * name, const char * str, int array) {
+    ByteArrayOutputStream buf;
+    BreakpointAttribute * attr = (BreakpointAttribute *)loc_alloc_zero(sizeof(BreakpointAttribute));
+    OutputStream * out = create_byte_array_output_stream(&buf);
+    attr->name = loc_strdup(name);
+    if (str == NULL) {
+        json_write_boolean(out, 1);
+    }
+    else if (array) {
+        write_stream(out, '[');
+        json_write_string(out, str);
+        write_stream(out, ']');
+    }
+    else {
+        json_write_string(out, str);
+    }
+    write_stream(out, 0);
+    get_byte_array_output_stream_data(&buf, &attr->value, NULL);
+    **ref = attr;
+    *ref = &attr->next;
+}
+
+static void eventpoint_hit(Context * ctx, void * args);
+
+static BreakpointInfo * create_test_eventpoint(const char * location, Context * ctx) {
+    BreakpointAttribute * attrs = NULL;
+    BreakpointAttribute ** ref = &attrs;
+    add_attribute(&ref, BREAKPOINT_ENABLED, NULL, 0);
+    add_attribute(&ref, BREAKPOINT_CONTEXTIDS, ctx->id, 1);
+    add_attribute(&ref, BREAKPOINT_LOCATION, location, 0);
+    return create_eventpoint_ext(attrs, NULL, eventpoint_hit, NULL);
+}
+
+static void resume_test_process(void * args) {
+    if (test_prs == NULL || test_prs->exited || test_stopped) return;
+    test_check(continue_debug_context(test_prs, NULL, RM_RESUME, 1, 0, 0) == 0);
+}
+
+static void finish_test(void) {
+    test_finished = 1;
+    loc_free(stack_lens);
+    stack_lens = NULL;
+    channel_close(test_channel);
+    test_server->close(test_server);
+    test_server = NULL;
+    test_done();
+}
+
+static uint64_t get_num(ProfilerData * d, size_t * pos) {
+    uint64_t v = 0;
+    unsigned i;
+    for (i = 0; i < d->addr_size; i++) {
+        v |= (uint64_t)(uint8_t)d->data[*pos + i] << (i * 8);
+    }
+    *pos += d->addr_size;
+    return v;
+}
+
+/* Check "StackTraces" data, return max number of PCs in a sample */
+static unsigned check_samples(ProfilerData * d) {
+    unsigned max = 0;
+    size_t pos = 0;
+
+    test_check(strcmp(d->format, "StackTraces") == 0);
+    if (d->data == NULL) return 0;
+    test_check(d->addr_size == sizeof(void *));
+    while (pos < d->data_size) {
+        uint64_t cnt = 0;
+        uint64_t pcs = 0;
+        unsigned n = 0;
+        if (pos + d->addr_size * 3 > d->data_size) test_error("Truncated sample");
+        cnt = get_num(d, &pos);
+        pcs = get_num(d, &pos);
+        test_check(cnt > 0);
+        test_check(pcs >= 1 && pcs <= FRAME_CNT);
+        if (pos + d->addr_size * pcs > d->data_size) test_error("Truncated stack trace");
+        for (n = 0; n < pcs; n++) test_check(get_num(d, &pos) != 0);
+        if (n > max) max = n;
+        samples_cnt += (unsigned long)cnt;
+    }
+    test_check(pos == d->data_size);
+    return max;
+}
+
+static uint64_t get_uleb(const char * buf, size_t size, size_t * pos) {
+    uint64_t v = 0;
+    unsigned n = 0;
+    for (;;) {
+        uint8_t b = 0;
+        if (*pos >= size || n >= 64) test_error("Invalid LEB128 number");
+        b = (uint8_t)buf[(*pos)++];
+        v |= (uint64_t)(b & 0x7f) << n;
+        if ((b & 0x80) == 0) break;
+        n += 7;
+    }
+    return v;
+}
+
+static int64_t get_sleb(const char * buf, size_t size, size_t * pos) {
+    /* Zigzag encoding */
+    uint64_t v = get_uleb(buf, size, pos);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Check "StackTracesDelta" data, return max number of PCs in a sample */
+static unsigned check_delta(ProfilerData * d) {
+    unsigned max = 0;
+    size_t pos = 0;
+
+    test_check(strcmp(d->format, "StackTracesDelta") == 0);
+    test_check(d->addr_size == sizeof(void *));
+    if (d->reset) stack_lens_cnt = 0;
+    while (pos < d->stacks_size) {
+        uint64_t len = get_uleb(d->stacks, d->stacks_size, &pos);
+        uint64_t n = 0;
+        test_check(len >= 1 && len < FRAME_CNT);
+        for (n = 0; n < len; n++) get_sleb(d->stacks, d->stacks_size, &pos);
+        stack_lens = (unsigned *)loc_realloc(stack_lens, sizeof(unsigned) * (stack_lens_cnt + 1));
+        stack_lens[stack_lens_cnt++] = (unsigned)len;
+    }
+    pos = 0;
+    while (pos < d->data_size) {
+        uint64_t id = 0;
+        uint64_t cnt = 0;
+        unsigned n = 1;
+        get_sleb(d->data, d->data_size, &pos);
+        id = get_uleb(d->data, d->data_size, &pos);
+        cnt = get_uleb(d->data, d->data_size, &pos);
+        test_check(id <= stack_lens_cnt);
+        test_check(cnt > 0);
+        if (id > 0) n += stack_lens[id - 1];
+        if (n > max) max = n;
+        samples_cnt += (unsigned long)cnt;
+    }
+    return max;
+}
+
+static void read_profiler_props(InputStream * inp, const char * name, void * args) {
+    ProfilerData * d = (ProfilerData *)args;
+    if (strcmp(name, "Format") == 0) json_read_string(inp, d->format, sizeof(d->format));
+    else if (strcmp(name, "AddrSize") == 0) d->addr_size = json_read_ulong(inp);
+    else if (strcmp(name, "Data") == 0) d->data = json_read_alloc_binary(inp, &d->data_size);
+    else if (strcmp(name, "Stacks") == 0) d->stacks = json_read_alloc_binary(inp, &d->stacks_size);
+    else if (strcmp(name, "Reset") == 0) d->reset = json_read_boolean(inp);
+    else if (strcmp(name, "Error") == 0) d->error = json_read_alloc_string(inp);
+    else json_skip_object(inp);
+}
+
+static void read_profiler_data(InputStream * inp, void * args) {
+    ProfilerData * d = (ProfilerData *)args;
+    test_check(!d->found);
+    d->found = json_read_struct(inp, read_profiler_props, d);
+}
+
+static void send_read(void * args);
+static void send_configure(void * args);
+
+static void stop_profiling(void) {
+    test_stopped = 0;
+    resume_test_process(NULL);
+}
+
+static void read_reply(Channel * c, void * args, int error) {
+    ProfilerData d;
+    unsigned max = 0;
+
+    if (error) test_error("Profiler.read: %s", errno_to_str(error));
+    memset(&d, 0, sizeof(d));
+    error = read_errno(&c->inp);
+    json_read_array(&c->inp, read_profiler_data, &d);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Profiler.read: %s", errno_to_str(error));
+    test_check(d.found);
+    if (d.error != NULL) {
+        /* perf_event_open() can be disabled by the kernel configuration or permissions */
+        if (!test_perf) test_error("Profiler.read: %s", d.error);
+        printf("Skipped PerfEvents sampler: %s\n", d.error);
+        loc_free(d.error);
+        loc_free(d.data);
+        stop_profiling();
+        return;
+    }
+    max = test_incremental ? check_delta(&d) : check_samples(&d);
+    loc_free(d.data);
+    loc_free(d.stacks);
+    if (max == FRAME_CNT) {
+        if (!test_incremental) {
+            if (test_perf) {
+                stop_profiling();
+                return;
+            }
+            test_incremental = 1;
+        }
+        else {
+#if ENABLE_ProfilerPerf
+            test_incremental = 0;
+            test_perf = 1;
+#else
+            stop_profiling();
+            return;
+#endif
+        }
+        read_cnt = 0;
+        send_configure(NULL);
+        return;
+    }
+    if (++read_cnt >= READ_CNT_MAX) {
+        test_error("No samples with %d PCs in %s format%s, %lu samples received",
+            FRAME_CNT, test_incremental ? "StackTracesDelta" : "StackTraces",
+            test_perf ? " from PerfEvents sampler" : "", samples_cnt);
+    }
+    post_event_with_delay(send_read, NULL, READ_DELAY);
+}
+
+static void send_read(void * args) {
+    protocol_send_command(test_channel, "Profiler", "read", read_reply, NULL);
+    json_write_string(&test_channel->out, worker_id);
+    write_stream(&test_channel->out, 0);
+    write_stream(&test_channel->out, MARKER_EOM);
+}
+
+static void configure_reply(Channel * c, void * args, int error) {
+    if (error) test_error("Profiler.configure: %s", errno_to_str(error));
+    error = read_errno(&c->inp);
+    json_test_char(&c->inp, MARKER_EOM);
+    if (error) test_error("Profiler.configure: %s", errno_to_str(error));
+    post_event_with_delay(send_read, NULL, READ_DELAY);
+}
+
+static void send_configure(void * args) {
+    OutputStream * out = &test_channel->out;
+    /* Worker threads hit the eventpoint too, and every stop cancels the profiler sampling timer */
+    if (test_bp != NULL) {
+        destroy_eventpoint(test_bp);
+        test_bp = NULL;
+    }
+    protocol_send_command(test_channel, "Profiler", "configure", configure_reply, NULL);
+    json_write_string(out, worker_id);
+    write_stream(out, 0);
+    write_stream(out, '{');
+    json_write_string(out, "FrameCnt");
+    write_stream(out, ':');
+    json_write_ulong(out, FRAME_CNT);
+    if (test_incremental) {
+        write_stream(out, ',');
+        json_write_string(out, "Incremental");
+        write_stream(out, ':');
+        json_write_boolean(out, 1);
+    }
+    if (test_perf) {
+        write_stream(out, ',');
+        json_write_string(out, "Sampler");
+        write_stream(out, ':');
+        json_write_string(out, "PerfEvents");
+    }
+    write_stream(out, '}');
+    write_stream(out, 0);
+    write_stream(out, MARKER_EOM);
+}
+
+static void test_process_attached(int error, Context * ctx, void * args) {
+    if (error) test_error("Cannot start test process: %s", errno_to_str(error));
+    test_check(!list_is_empty(&ctx->children));
+    test_prs = ctx;
+    test_main = cldl2ctxp(ctx->children.next);
+    context_lock(ctx);
+    test_bp = create_test_eventpoint("tcf_test_func3", test_main);
+}
+
+static void eventpoint_hit(Context * ctx, void * args) {
+    LINK * l;
+    if (test_stopped || ctx != test_main) return;
+    worker_id[0] = 0;
+    for (l = test_prs->children.next; l != &test_prs->children; l = l->next) {
+        Context * thread = cldl2ctxp(l);
+        if (thread == test_main || thread->exited) continue;
+        strlcpy(worker_id, thread->id, sizeof(worker_id));
+        break;
+    }
+    /* Wait until the test process starts worker threads */
+    if (worker_id[0] == 0) return;
+    /* Worker threads run until the main thread resumes */
+    test_stopped = 1;
+    test_check(suspend_debug_context(test_main) == 0);
+    post_event(send_configure, NULL);
+}
+
+static void event_context_exited(Context * ctx, void * args) {
+    if (ctx != test_prs) return;
+    test_check(test_bp == NULL);
+    context_unlock(test_prs);
+    test_prs = NULL;
+    test_main = NULL;
+    finish_test();
+}
+
+static void event_context_intercepted(Context * ctx, void * args) {
+    /* The test process is suspended at main() and by the test, resume it */
+    if (test_prs == NULL || context_get_group(ctx, CONTEXT_GROUP_PROCESS) != test_prs) return;
+    post_event(resume_test_process, NULL);
+}
+
+static ContextEventListener context_listener = {
+    NULL,
+    event_context_exited,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static RunControlEventListener run_ctrl_listener = {
+    event_context_intercepted,
+    NULL
+};
+
+static void channel_connected(Channel * c) {
+    if (run_test_process(test_process_attached, NULL) < 0) {
+        test_error("Cannot start test process: %s", errno_to_str(errno));
+    }
+}
+
+static void channel_disconnected(Channel * c) {
+    if (!test_finished) test_error("Loopback channel disconnected");
+    protocol_release(c->protocol);
+    test_channel = NULL;
+}
+
+static void channel_connect_done(void * args, int error, Channel * c) {
+    PeerServer * ps = (PeerServer *)args;
+    if (error) test_error("Cannot connect loopback channel: %s", errno_to_str(error));
+    c->connected = channel_connected;
+    c->disconnected = channel_disconnected;
+    c->protocol = protocol_alloc();
+    channel_start(c);
+    test_channel = c;
+    peer_server_free(ps);
+}
+
+void test_profiler(void) {
+    PeerServer * ps = NULL;
+    char url[64];
+
+    if (ini_server("TCP:127.0.0.1:0", test_proto, test_bcg) < 0) {
+        test_error("Cannot start loopback server: %s", errno_to_str(errno));
+    }
+    test_server = servlink2channelserverp(channel_server_root.prev);
+    snprintf(url, sizeof(url), "TCP:127.0.0.1:%s", peer_server_getprop(test_server->ps, "Port", ""));
+    ps = channel_peer_from_url(url);
+    test_check(ps != NULL);
+
+    add_context_event_listener(&context_listener, NULL);
+    add_run_control_event_listener(&run_ctrl_listener, NULL);
+    channel_connect(ps, channel_connect_done, ps);
+}
+
+#else
+
+void test_profiler(void) {
+    printf("Skipped: no test process or profiler support\n");
+    test_done();
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * I/O reactor tests: a receive request completes when data arrives,
+ * a request pending on a descriptor that is closed with reactor_close() completes with EBADF,
+ * and a request on a reused descriptor number is not affected by the stale registration.
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <tcf/framework/mdep-inet.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/asyncreq.h>
+#include <tcf/framework/reactor.h>
+#include <tcf/unit/unit-tests.h>
+
+#if ENABLE_EPoll
+
+#include <errno.h>
+
+enum {
+    STEP_RECV,
+    STEP_CLOSE,
+    STEP_REUSE,
+    STEP_DONE
+};
+
+static int step = STEP_RECV;
+static int socks[2] = { -1, -1 };
+static int closed_fd = -1;
+static char buf[16];
+static AsyncReqInfo req;
+
+static void next_step(void * args);
+
+static void open_sockets(void) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) < 0) {
+        test_error("Cannot create socket pair: %s", errno_to_str(errno));
+    }
+}
+
+static void close_sockets(void) {
+    closesocket(socks[0]);
+    closesocket(socks[1]);
+    socks[0] = socks[1] = -1;
+}
+
+static void recv_done(void * args) {
+    AsyncReqInfo * r = (AsyncReqInfo *)args;
+    test_check(r == &req);
+    switch (step) {
+    case STEP_RECV:
+    case STEP_REUSE:
+        if (req.error) test_error("Receive failed: %s", errno_to_str(req.error));
+        test_check(req.u.sio.rval == 4);
+        test_check(memcmp(buf, "test", 4) == 0);
+        close_sockets();
+        break;
+    case STEP_CLOSE:
+        test_check(req.u.sio.rval < 0);
+        test_check(req.error == EBADF);
+        break;
+    }
+    step++;
+    post_event(next_step, NULL);
+}
+
+static void post_recv(void) {
+    memset(&req, 0, sizeof(req));
+    memset(buf, 0, sizeof(buf));
+    req.type = AsyncReqRecv;
+    req.done = recv_done;
+    req.u.sio.sock = socks[0];
+    req.u.sio.bufp = buf;
+    req.u.sio.bufsz = sizeof(buf);
+    req.u.sio.flags = 0;
+    async_req_post(&req);
+}
+
+static void send_data(void * args) {
+    test_check(send(socks[1], "test", 4, 0) == 4);
+}
+
+static void close_pending(void * args) {
+    closed_fd = socks[0];
+    reactor_close(socks[0]);
+    close_sockets();
+}
+
+static void next_step(void * args) {
+    switch (step) {
+    case STEP_RECV:
+        open_sockets();
+        post_recv();
+        post_event_with_delay(send_data, NULL, 10000);
+        break;
+    case STEP_CLOSE:
+        open_sockets();
+        post_recv();
+        post_event_with_delay(close_pending, NULL, 10000);
+        break;
+    case STEP_REUSE:
+        open_sockets();
+        if (socks[0] != closed_fd) {
+            printf("Skipped descriptor reuse check: descriptor %d was not reused\n", closed_fd);
+        }
+        post_recv();
+        post_event_with_delay(send_data, NULL, 10000);
+        break;
+    case STEP_DONE:
+        test_done();
+        break;
+    }
+}
+
+void test_reactor(void) {
+    step = STEP_RECV;
+    post_event(next_step, NULL);
+}
+
+#else
+
+void test_reactor(void) {
+    printf("Skipped I/O reactor: ENABLE_EPoll is not set\n");
+    test_done();
+}
+
+#endif /* ENABLE_EPoll */
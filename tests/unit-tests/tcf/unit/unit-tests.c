@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Agent unit tests runner.
+ *
+ * Usage: unit-tests [-l<log level>] [<test name> ...]
+ * The agent test process, see tcf/main/test.c, is started as "unit-tests -t".
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/trace.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/services/runctrl.h>
+#include <tcf/main/test.h>
+#include <tcf/main/services.h>
+#include <tcf/main/framework.h>
+#include <tcf/unit/unit-tests.h>
+
+/* Max time a test can run, in microseconds */
+#define TEST_TIMEOUT (120 * 1000000)
+
+typedef struct UnitTest {
+    const char * name;
+    void (*func)(void);
+} UnitTest;
+
+extern void test_addrindex(void);
+extern void test_compression(void);
+extern void test_compiled_expressions(void);
+extern void test_deflate(void);
+extern void test_dwarf_lines(void);
+extern void test_event_statistics(void);
+extern void test_expression_cache(void);
+extern void test_myalloc(void);
+extern void test_profiler(void);
+extern void test_reactor(void);
+
+static UnitTest tests[] = {
+    { "addrindex", test_addrindex },
+    { "compression", test_compression },
+    { "compiled-expressions", test_compiled_expressions },
+    { "deflate", test_deflate },
+    { "dwarf-lines", test_dwarf_lines },
+    { "event-statistics", test_event_statistics },
+    { "expression-cache", test_expression_cache },
+    { "myalloc", test_myalloc },
+    { "profiler", test_profiler },
+    { "reactor", test_reactor },
+    { NULL, NULL }
+};
+
+Protocol * test_proto = NULL;
+TCFBroadcastGroup * test_bcg = NULL;
+
+static char ** test_names = NULL;
+static int test_names_cnt = 0;
+static UnitTest * test_current = NULL;
+static unsigned test_generation = 0;
+static unsigned test_cnt = 0;
+
+void test_fail(const char * file, int line, const char * fmt, ...) {
+    va_list ap;
+    fprintf(stderr, "FAILED: %s: %s:%d: ", test_current ? test_current->name : "?", file, line);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+#if ENABLE_RCBP_TEST
+
+typedef struct WaitInterceptedArgs {
+    Context * prs;
+    EventCallBack * done;
+    void * args;
+} WaitInterceptedArgs;
+
+static int is_all_intercepted(Context * prs) {
+    int cnt = 0;
+    LINK * l;
+    for (l = prs->children.next; l != &prs->children; l = l->next) {
+        Context * ctx = cldl2ctxp(l);
+        if (ctx->exited) continue;
+        if (!is_intercepted(ctx)) return 0;
+        cnt++;
+    }
+    return cnt > 0;
+}
+
+static void wait_intercepted_event(void * x) {
+    WaitInterceptedArgs * args = (WaitInterceptedArgs *)x;
+    if (!args->prs->exited && !is_all_intercepted(args->prs)) {
+        post_event_with_delay(wait_intercepted_event, args, 1000);
+        return;
+    }
+    context_unlock(args->prs);
+    args->done(args->args);
+    loc_free(args);
+}
+
+void test_wait_intercepted(Context * prs, EventCallBack * done, void * args) {
+    WaitInterceptedArgs * x = (WaitInterceptedArgs *)loc_alloc_zero(sizeof(WaitInterceptedArgs));
+    x->prs = prs;
+    x->done = done;
+    x->args = args;
+    context_lock(prs);
+    post_event(wait_intercepted_event, x);
+}
+
+#endif /* ENABLE_RCBP_TEST */
+
+static int is_test_selected(UnitTest * t) {
+    int i;
+    if (test_names_cnt == 0) return 1;
+    for (i = 0; i < test_names_cnt; i++) {
+        if (strcmp(test_names[i], t->name) == 0) return 1;
+    }
+    return 0;
+}
+
+static void test_timeout(void * args) {
+    if ((uintptr_t)args != test_generation) return;
+    test_error("timeout");
+}
+
+static void run_next_test(void * args) {
+    test_current = test_current == NULL ? tests : test_current + 1;
+    while (test_current->name != NULL && !is_test_selected(test_current)) test_current++;
+    if (test_current->name == NULL) {
+        printf("%u tests passed\n", test_cnt);
+        exit(test_cnt > 0 ? 0 : 1);
+    }
+    test_generation++;
+    post_event_with_delay(test_timeout, (void *)(uintptr_t)test_generation, TEST_TIMEOUT);
+    printf("Running %s\n", test_current->name);
+    fflush(stdout);
+    test_current->func();
+}
+
+void test_done(void) {
+    test_generation++;
+    test_cnt++;
+    post_event(run_next_test, NULL);
+}
+
+int main(int argc, char ** argv) {
+    int ind;
+    const char * log_level = NULL;
+
+    ini_framework();
+
+    for (ind = 1; ind < argc; ind++) {
+        char * s = argv[ind];
+        if (*s++ != '-') break;
+        switch (*s++) {
+#if ENABLE_RCBP_TEST
+        case 't':
+            test_proc();
+            exit(0);
+#endif
+        case 'l':
+            log_level = s;
+            break;
+        default:
+            fprintf(stderr, "%s: error: illegal option '%s'\n", argv[0], argv[ind]);
+            exit(1);
+        }
+    }
+    test_names = argv + ind;
+    test_names_cnt = argc - ind;
+
+    open_log_file("-");
+    log_mode = 0;
+
+    test_bcg = broadcast_group_alloc();
+    test_proto = protocol_alloc();
+    ini_services(test_proto, test_bcg);
+
+    if (log_level != NULL && parse_trace_mode(log_level, &log_mode) != 0) {
+        fprintf(stderr, "Cannot parse log level: %s\n", log_level);
+        exit(1);
+    }
+
+    post_event(run_next_test, NULL);
+    run_event_loop();
+    return 0;
+}
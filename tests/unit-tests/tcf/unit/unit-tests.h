@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Xilinx, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Xilinx - initial API and implementation
+ *******************************************************************************/
+
+
+/*
+ * Agent unit tests.
+ *
+ * Tests are run one by one on the dispatch thread. A test can finish synchronously or
+ * asynchronously - after waiting for debug events or channel replies - but in both cases
+ * it must call test_done() exactly once.
+ */
+
+#ifndef D_unit_tests
+#define D_unit_tests
+
+#include <tcf/config.h>
+#include <tcf/framework/protocol.h>
+#include <tcf/framework/channel.h>
+
+/* Protocol and broadcast group of the agent services, tests can use them to start a loopback server */
+extern Protocol * test_proto;
+extern TCFBroadcastGroup * test_bcg;
+
+/* Report test failure and exit with non-zero status */
+extern void test_fail(const char * file, int line, const char * fmt, ...);
+
+/* Must be called by a test when it is done */
+extern void test_done(void);
+
+#if ENABLE_RCBP_TEST
+#include <tcf/framework/events.h>
+#include <tcf/framework/context.h>
+
+/* Wait until all threads of a process are intercepted by the RunControl service, then call 'done' */
+extern void test_wait_intercepted(Context * prs, EventCallBack * done, void * args);
+#endif
+
+#define test_check(x) do { if (!(x)) test_fail(__FILE__, __LINE__, "%s", #x); } while (0)
+#define test_error(...) test_fail(__FILE__, __LINE__, __VA_ARGS__)
+
+#endif /* D_unit_tests */